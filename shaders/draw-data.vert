@@ -0,0 +1,47 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// --draws: one small quad per draw, its transform and id read from the per-draw data path picked at pipeline
+// creation: 0 = push constants, 1 = uniform buffer bound with a dynamic offset per draw, 2 = storage buffer indexed
+// by the draw's firstInstance. The other paths' loads are dropped when the pipeline is specialized.
+// --scene uses path 2 with one instanced draw: every instance is a node of the hierarchy.
+layout(constant_id = 5) const uint DRAW_DATA_PATH = 0;
+
+struct ObjectData {
+    mat4 transform;
+    uint objectId;
+};
+
+layout(push_constant) uniform PushedObject {
+    ObjectData object;
+} pushed;
+
+layout(set = 0, binding = 0) uniform UniformObject {
+    ObjectData object;
+} uniformObject;
+
+layout(std430, set = 0, binding = 1) readonly buffer StorageObjects {
+    ObjectData objects[];
+} storageObjects;
+
+layout(location = 0) out vec3 fragColor;
+
+vec2 corners[6] = vec2[](
+    vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+    vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0)
+);
+
+void main() {
+    ObjectData object;
+    if (DRAW_DATA_PATH == 0) {
+        object = pushed.object;
+    } else if (DRAW_DATA_PATH == 1) {
+        object = uniformObject.object;
+    } else {
+        object = storageObjects.objects[gl_InstanceIndex];
+    }
+    gl_Position = object.transform * vec4(corners[gl_VertexIndex], 0.0, 1.0);
+    // Hashed id, so neighbouring draws are told apart
+    uint hash = object.objectId * 2654435761u;
+    fragColor = vec3(hash & 0xffu, (hash >> 8) & 0xffu, (hash >> 16) & 0xffu) / 255.0;
+}
@@ -0,0 +1,22 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec3 fragNormal;
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) in vec3 fragLightDirection;
+
+// Streamed texture (sRGB, so sampling returns linear values), a white placeholder until it is resident
+layout(set = 0, binding = 0) uniform sampler2D baseColor;
+// Specialized to false without a --texture, the sampling is compiled out
+layout(constant_id = 0) const bool TEXTURED = true;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    vec3 albedo = vec3(0.8, 0.8, 0.75);
+    if (TEXTURED) {
+        albedo *= texture(baseColor, fragTexCoord).rgb;
+    }
+    float diffuse = max(dot(normalize(fragNormal), normalize(fragLightDirection)), 0.0);
+    outColor = vec4(albedo * (0.15 + 0.85 * diffuse), 1.0);
+}
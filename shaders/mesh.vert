@@ -0,0 +1,32 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Vertex layout of .nmesh files (see src/mesh-format.h), 16 bytes per vertex:
+// unorm16 position relative to the mesh bounds, half float texture coordinate, octahedral snorm8 normal.
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec2 inTexCoord;
+layout(location = 2) in vec2 inNormal;
+
+// The model-view-projection already contains the dequantization from the unit cube to the mesh bounds
+layout(push_constant) uniform Parameters {
+    mat4 mvp;
+    vec4 lightDirection; // xyz: direction towards the light in object space
+} parameters;
+
+layout(location = 0) out vec3 fragNormal;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) out vec3 fragLightDirection;
+
+vec3 decodeOctahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+    return normalize(n);
+}
+
+void main() {
+    gl_Position = parameters.mvp * vec4(inPosition.xyz, 1.0);
+    fragNormal = decodeOctahedral(inNormal);
+    fragTexCoord = inTexCoord;
+    fragLightDirection = parameters.lightDirection.xyz;
+}
@@ -0,0 +1,53 @@
+// Meshlet data and culling shared by meshlet-cull.comp and meshlet.task (included, not compiled on its own)
+
+// Same layout as MeshletDescriptor in src/mesh-format.h
+struct Meshlet {
+    vec4 sphere; // xyz: center, w: radius, object space
+    vec4 cone;   // xyz: axis, w: cutoff, 1 = never culled
+    uint vertexOffset;
+    uint triangleOffset;
+    uint vertexCount;
+    uint triangleCount;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer Meshlets {
+    Meshlet meshlets[];
+};
+
+// Written by the CPU every frame
+layout(set = 1, binding = 1) uniform CullData {
+    vec4 frustumPlanes[6]; // object space, normals pointing inwards
+    vec4 cameraPosition;   // object space
+    uint meshletCount;
+} cull;
+
+// --no-meshlet-culling specializes this to false, the bounds tests are compiled out
+layout(constant_id = 1) const bool CULLING_ENABLED = true;
+
+layout(std430, set = 1, binding = 2) readonly buffer MeshletVertices {
+    uint meshletVertices[]; // global vertex indices
+};
+
+layout(std430, set = 1, binding = 3) readonly buffer MeshletTriangles {
+    uint meshletTriangles[]; // three 8 bit meshlet-local indices
+};
+
+bool isMeshletVisible(uint index) {
+    if (index >= cull.meshletCount) {
+        return false;
+    }
+    if (!CULLING_ENABLED) {
+        return true;
+    }
+    Meshlet meshlet = meshlets[index];
+    vec3 center = meshlet.sphere.xyz;
+    float radius = meshlet.sphere.w;
+    for (int i = 0; i < 6; i++) {
+        if (dot(cull.frustumPlanes[i].xyz, center) + cull.frustumPlanes[i].w < -radius) {
+            return false;
+        }
+    }
+    // Back-facing cluster: every triangle faces away from the camera
+    vec3 toCenter = center - cull.cameraPosition.xyz;
+    return dot(toCenter, meshlet.cone.xyz) < meshlet.cone.w * length(toCenter) + radius;
+}
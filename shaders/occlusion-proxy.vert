@@ -0,0 +1,27 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// --occlusion-culling: the mesh's bounding box, drawn inside an occlusion query only. The pipeline has no fragment
+// shader and writes neither color nor depth.
+
+// Same block as mesh.vert: the model-view-projection maps the unit cube onto the mesh bounds
+layout(push_constant) uniform Parameters {
+    mat4 mvp;
+    vec4 lightDirection; // unused
+} parameters;
+
+// The cube's 12 triangles, corner bits are x, y, z
+const uint indices[36] = uint[](
+    0, 2, 6, 0, 6, 4,
+    1, 5, 7, 1, 7, 3,
+    0, 4, 5, 0, 5, 1,
+    2, 3, 7, 2, 7, 6,
+    0, 1, 3, 0, 3, 2,
+    4, 6, 7, 4, 7, 5
+);
+
+void main() {
+    uint corner = indices[gl_VertexIndex];
+    vec3 position = vec3(corner & 1u, (corner >> 1) & 1u, (corner >> 2) & 1u);
+    gl_Position = parameters.mvp * vec4(position, 1.0);
+}
@@ -0,0 +1,23 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// --particles: one point per particle, read from the state the last simulation step wrote
+struct Particle {
+    vec4 position; // xy in clip space, w = remaining lifetime in seconds
+    vec4 velocity;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer State {
+    Particle particles[];
+} state;
+
+layout(location = 0) out vec3 fragColor;
+
+void main() {
+    Particle particle = state.particles[gl_VertexIndex];
+    gl_Position = vec4(particle.position.xy, 0.0, 1.0);
+    gl_PointSize = 1.0;
+    // Blended additively, dim enough that dense regions build up instead of saturating right away
+    float speed = clamp(length(particle.velocity.xy), 0.0, 1.0);
+    fragColor = mix(vec3(0.05, 0.1, 0.4), vec3(1.0, 0.5, 0.1), speed) * 0.2;
+}
@@ -0,0 +1,50 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// --post-process: one effect per subpass, picked at pipeline creation (values of PostEffect in app-config.h):
+// 0 = tonemap, 1 = vignette, 2 = color grade. The previous subpass' result is read at this fragment's own pixel
+// through an input attachment, which on a tiler is a load from tile memory.
+layout(constant_id = 7) const uint POST_EFFECT = 0;
+
+layout(input_attachment_index = 0, set = 0, binding = 0) uniform subpassInput previous;
+
+layout(push_constant) uniform PostProcessParameters {
+    vec2 inverseExtent;
+    float exposure;
+    float vignetteStrength;
+    float saturation;
+    float contrast;
+} parameters;
+
+layout(location = 0) out vec4 outColor;
+
+// Narkowicz's fit of the ACES filmic curve
+vec3 tonemap(vec3 color) {
+    color *= parameters.exposure;
+    return clamp((color * (2.51 * color + 0.03)) / (color * (2.43 * color + 0.59) + 0.14), 0.0, 1.0);
+}
+
+vec3 vignette(vec3 color) {
+    // 0 at the center of the render area, 1 in its corners
+    vec2 position = gl_FragCoord.xy * parameters.inverseExtent - 0.5;
+    float radius = dot(position, position) * 2.0;
+    return color * (1.0 - parameters.vignetteStrength * smoothstep(0.1, 1.0, radius));
+}
+
+vec3 grade(vec3 color) {
+    float luma = dot(color, vec3(0.2126, 0.7152, 0.0722));
+    color = mix(vec3(luma), color, parameters.saturation);
+    return clamp((color - 0.18) * parameters.contrast + 0.18, 0.0, 1.0);
+}
+
+void main() {
+    vec3 color = subpassLoad(previous).rgb;
+    if (POST_EFFECT == 0) {
+        color = tonemap(color);
+    } else if (POST_EFFECT == 1) {
+        color = vignette(color);
+    } else {
+        color = grade(color);
+    }
+    outColor = vec4(color, 1.0);
+}
@@ -0,0 +1,14 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// --sprites: every atlas page is a layer of one texture array, so sprites on different pages share draws
+layout(set = 0, binding = 0) uniform sampler2DArray atlas;
+
+layout(location = 0) in vec3 fragTexCoord;
+layout(location = 1) in vec4 fragColor;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = texture(atlas, fragTexCoord) * fragColor;
+}
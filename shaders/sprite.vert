@@ -0,0 +1,30 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// --sprites: one instance per sprite, read from the frame's region of the sprite ring (SpriteVertex in
+// sprite-batcher.h). The six corners of its quad are generated here, there is no per-vertex data.
+layout(push_constant) uniform SpriteView {
+    vec2 pixelToClip; // 2 / render area size
+} view;
+
+layout(location = 0) in vec2 inPosition; // top-left corner, pixels
+layout(location = 1) in vec2 inSize;
+layout(location = 2) in vec4 inTexRect;  // left, top, right, bottom
+layout(location = 3) in vec4 inColor;
+layout(location = 4) in uint inLayer;
+
+layout(location = 0) out vec3 fragTexCoord; // u, v, array layer
+layout(location = 1) out vec4 fragColor;
+
+vec2 corners[6] = vec2[](
+    vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0),
+    vec2(0.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0)
+);
+
+void main() {
+    vec2 corner = corners[gl_VertexIndex];
+    // Vulkan clip space has y pointing down, like the pixels
+    gl_Position = vec4((inPosition + corner * inSize) * view.pixelToClip - 1.0, 0.0, 1.0);
+    fragTexCoord = vec3(mix(inTexRect.xy, inTexRect.zw, corner), float(inLayer));
+    fragColor = inColor;
+}
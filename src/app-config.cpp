@@ -0,0 +1,309 @@
+#include "app-config.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+static void printUsage(const char* executable) {
+    std::cout << "Usage: " << executable << " [options]" << std::endl
+              << "  --on-demand       only redraw when something changed (default)" << std::endl
+              << "  --continuous      redraw every frame" << std::endl
+              << "  --resize-scaled   present the old swapchain scaled while resizing, rebuild once the drag ends" << std::endl
+              << "  --fps <n>         limit the frame rate to n frames per second (0 = unlimited)" << std::endl
+              << "  --present-mode <fifo|fifo-relaxed|mailbox|immediate>" << std::endl
+              << "  --drs-min <pct>   lowest internal resolution, in percent of the window size (default 50)" << std::endl
+              << "  --drs-max <pct>   highest internal resolution, in percent of the window size (default 100)" << std::endl
+              << "  --frame-budget <ms> GPU frame time the dynamic resolution controller aims for" << std::endl
+              << "  --no-drs          always render at the window resolution" << std::endl
+              << "  --capture-frames <n,m,...> capture these frame numbers (F12 captures the next frame)" << std::endl
+              << "  --capture-dir <path> where captures are written (default: working directory)" << std::endl
+              << "  --capture-format <png|raw>" << std::endl
+              << "  --exit-after-capture quit once the --capture-frames were captured" << std::endl
+              << "  --record <path|-> stream every presented frame as video (Y4M for i420, raw for nv12)" << std::endl
+              << "  --record-format <i420|nv12>" << std::endl
+              << "  --benchmark       render uncapped for a fixed number of frames, print a report and quit" << std::endl
+              << "  --benchmark-frames <n> measured frames (default 1000)" << std::endl
+              << "  --benchmark-warmup <n> frames rendered before measuring (default 100)" << std::endl
+              << "  --benchmark-json <path> write the JSON report to a file instead of printing it" << std::endl
+              << "  --windows <n>     show the scene in n windows (default 1, at most 8)" << std::endl
+              << "  --profile-vulkan  count and time Vulkan calls per frame, reported on exit and in the benchmark report" << std::endl
+              << "  --mesh <path>     draw a .nmesh file (made with mesh-converter) instead of the triangle" << std::endl
+              << "  --meshlets <auto|mesh-shader|indirect|off> meshlet rendering path of --mesh (default auto)" << std::endl
+              << "  --no-meshlet-culling draw every meshlet, without frustum and normal cone culling" << std::endl
+              << "  --texture <path>  texture of the --mesh (PAM, binary PPM or KTX2)" << std::endl
+              << "  --texture-budget <MB> texture memory budget (default 256)" << std::endl
+              << "  --draws <n>       draw n quads with one draw call each instead of the triangle" << std::endl
+              << "  --draw-data <push|ubo|ssbo|all> how --draws get their transforms (default push, all needs --benchmark)" << std::endl
+              << "  --scene <n>       animate a hierarchy of n quads and draw it with one instanced draw instead of the triangle" << std::endl
+              << "  --sprites <n>     draw n batched 2D sprites as an overlay, in a handful of draws" << std::endl
+              << "  --particles <n>   simulate n particles in a compute shader and draw them instead of the triangle" << std::endl
+              << "  --gpu-counters    count vertex, primitive and fragment work per frame with pipeline statistics queries" << std::endl
+              << "  --occlusion-culling draw the --mesh only when its bounding box passed an occlusion query" << std::endl
+              << "  --post-process <tonemap,vignette,grade> post-processing effects, in order, as subpasses of the main render pass" << std::endl
+              << "  --log-level <verbose|info|warning|error> least severe messages printed (default info)" << std::endl
+              << "  --job-threads <n> threads running jobs, the main thread included (default: one per core)" << std::endl
+              << "  --lose-device-at <n> recover from a simulated device loss at frame n" << std::endl
+              << "  --help            show this message" << std::endl;
+}
+
+static double parseNumber(const std::string& option, const std::string& value) {
+    try {
+        size_t parsed = 0;
+        double number = std::stod(value, &parsed);
+        if (parsed == value.size() && number >= 0.0) {
+            return number;
+        }
+    } catch (const std::exception&) {
+    }
+    throw std::runtime_error("Invalid value for " + option + ": " + value);
+}
+
+static PresentModePreference parsePresentMode(const std::string& value) {
+    if (value == "fifo") {
+        return PresentModePreference::Fifo;
+    } else if (value == "fifo-relaxed") {
+        return PresentModePreference::FifoRelaxed;
+    } else if (value == "mailbox") {
+        return PresentModePreference::Mailbox;
+    } else if (value == "immediate") {
+        return PresentModePreference::Immediate;
+    }
+    throw std::runtime_error("Invalid value for --present-mode: " + value);
+}
+
+static LogLevel parseLogLevel(const std::string& value) {
+    if (value == "verbose") {
+        return LogLevel::Verbose;
+    } else if (value == "info") {
+        return LogLevel::Info;
+    } else if (value == "warning") {
+        return LogLevel::Warning;
+    } else if (value == "error") {
+        return LogLevel::Error;
+    }
+    throw std::runtime_error("Invalid value for --log-level: " + value);
+}
+
+static std::vector<uint64_t> parseFrameList(const std::string& option, const std::string& value) {
+    std::vector<uint64_t> frames;
+    size_t start = 0;
+    while (start <= value.size()) {
+        size_t end = value.find(',', start);
+        if (end == std::string::npos) {
+            end = value.size();
+        }
+        frames.push_back(static_cast<uint64_t>(parseNumber(option, value.substr(start, end - start))));
+        start = end + 1;
+    }
+    return frames;
+}
+
+static std::vector<PostEffect> parsePostEffects(const std::string& value) {
+    std::vector<PostEffect> effects;
+    size_t start = 0;
+    while (start <= value.size()) {
+        size_t end = value.find(',', start);
+        if (end == std::string::npos) {
+            end = value.size();
+        }
+        const std::string name = value.substr(start, end - start);
+        PostEffect effect;
+        if (name == "tonemap") {
+            effect = PostEffect::Tonemap;
+        } else if (name == "vignette") {
+            effect = PostEffect::Vignette;
+        } else if (name == "grade") {
+            effect = PostEffect::Grade;
+        } else {
+            throw std::runtime_error("Invalid value for --post-process: " + name);
+        }
+        if (std::find(effects.begin(), effects.end(), effect) != effects.end()) {
+            throw std::runtime_error("--post-process applies each effect once: " + name);
+        }
+        effects.push_back(effect);
+        start = end + 1;
+    }
+    return effects;
+}
+
+AppConfig parseCommandLine(int argc, char* argv[]) {
+    AppConfig config;
+    bool drawDataGiven = false; // even as push, the default
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        auto nextValue = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("Missing value for " + arg);
+            }
+            return argv[++i];
+        };
+        if (arg == "--on-demand") {
+            config.renderMode = RenderMode::OnDemand;
+        } else if (arg == "--continuous") {
+            config.renderMode = RenderMode::Continuous;
+        } else if (arg == "--resize-scaled") {
+            config.scaleDuringResize = true;
+        } else if (arg == "--fps") {
+            config.targetFps = parseNumber(arg, nextValue());
+        } else if (arg == "--present-mode") {
+            config.presentMode = parsePresentMode(nextValue());
+        } else if (arg == "--drs-min") {
+            config.minResolutionScale = static_cast<float>(parseNumber(arg, nextValue()) / 100.0);
+        } else if (arg == "--drs-max") {
+            config.maxResolutionScale = static_cast<float>(parseNumber(arg, nextValue()) / 100.0);
+        } else if (arg == "--frame-budget") {
+            config.frameBudgetMs = parseNumber(arg, nextValue());
+        } else if (arg == "--no-drs") {
+            config.dynamicResolution = false;
+        } else if (arg == "--capture-frames") {
+            config.captureFrames = parseFrameList(arg, nextValue());
+        } else if (arg == "--capture-dir") {
+            config.captureDirectory = nextValue();
+        } else if (arg == "--capture-format") {
+            const std::string format = nextValue();
+            if (format == "png") {
+                config.captureFormat = CaptureFormat::Png;
+            } else if (format == "raw") {
+                config.captureFormat = CaptureFormat::Raw;
+            } else {
+                throw std::runtime_error("Invalid value for --capture-format: " + format);
+            }
+        } else if (arg == "--exit-after-capture") {
+            config.exitAfterCapture = true;
+        } else if (arg == "--record") {
+            config.recordPath = nextValue();
+        } else if (arg == "--record-format") {
+            const std::string format = nextValue();
+            if (format == "i420") {
+                config.recordFormat = YuvFormat::I420;
+            } else if (format == "nv12") {
+                config.recordFormat = YuvFormat::Nv12;
+            } else {
+                throw std::runtime_error("Invalid value for --record-format: " + format);
+            }
+        } else if (arg == "--benchmark") {
+            config.benchmark = true;
+        } else if (arg == "--benchmark-frames") {
+            config.benchmarkFrames = static_cast<uint64_t>(parseNumber(arg, nextValue()));
+        } else if (arg == "--benchmark-warmup") {
+            config.benchmarkWarmupFrames = static_cast<uint64_t>(parseNumber(arg, nextValue()));
+        } else if (arg == "--benchmark-json") {
+            config.benchmarkJsonPath = nextValue();
+        } else if (arg == "--windows") {
+            config.windowCount = static_cast<uint32_t>(parseNumber(arg, nextValue()));
+            if (config.windowCount < 1 || config.windowCount > MAX_WINDOWS) {
+                throw std::runtime_error("--windows must be between 1 and " + std::to_string(MAX_WINDOWS));
+            }
+        } else if (arg == "--profile-vulkan") {
+            config.profileVulkanCalls = true;
+        } else if (arg == "--mesh") {
+            config.meshPath = nextValue();
+        } else if (arg == "--meshlets") {
+            const std::string mode = nextValue();
+            if (mode == "auto") {
+                config.meshletMode = MeshletMode::Auto;
+            } else if (mode == "mesh-shader") {
+                config.meshletMode = MeshletMode::MeshShader;
+            } else if (mode == "indirect") {
+                config.meshletMode = MeshletMode::Indirect;
+            } else if (mode == "off") {
+                config.meshletMode = MeshletMode::Off;
+            } else {
+                throw std::runtime_error("Invalid value for --meshlets: " + mode);
+            }
+        } else if (arg == "--no-meshlet-culling") {
+            config.meshletCulling = false;
+        } else if (arg == "--texture") {
+            config.texturePath = nextValue();
+        } else if (arg == "--texture-budget") {
+            config.textureBudgetMb = static_cast<uint32_t>(parseNumber(arg, nextValue()));
+        } else if (arg == "--draws") {
+            config.drawCount = static_cast<uint32_t>(parseNumber(arg, nextValue()));
+        } else if (arg == "--draw-data") {
+            const std::string path = nextValue();
+            drawDataGiven = true;
+            if (path == "push") {
+                config.drawDataPath = DrawDataPath::Push;
+            } else if (path == "ubo") {
+                config.drawDataPath = DrawDataPath::DynamicUniform;
+            } else if (path == "ssbo") {
+                config.drawDataPath = DrawDataPath::Storage;
+            } else if (path == "all") {
+                config.drawDataPath = DrawDataPath::All;
+            } else {
+                throw std::runtime_error("Invalid value for --draw-data: " + path);
+            }
+        } else if (arg == "--scene") {
+            config.sceneNodeCount = static_cast<uint32_t>(parseNumber(arg, nextValue()));
+        } else if (arg == "--sprites") {
+            config.spriteCount = static_cast<uint32_t>(parseNumber(arg, nextValue()));
+        } else if (arg == "--particles") {
+            config.particleCount = static_cast<uint32_t>(parseNumber(arg, nextValue()));
+        } else if (arg == "--gpu-counters") {
+            config.gpuCounters = true;
+        } else if (arg == "--occlusion-culling") {
+            config.occlusionCulling = true;
+        } else if (arg == "--post-process") {
+            config.postEffects = parsePostEffects(nextValue());
+        } else if (arg == "--log-level") {
+            config.logLevel = parseLogLevel(nextValue());
+        } else if (arg == "--job-threads") {
+            config.jobThreads = static_cast<uint32_t>(parseNumber(arg, nextValue()));
+        } else if (arg == "--lose-device-at") {
+            config.loseDeviceAtFrame = static_cast<uint64_t>(parseNumber(arg, nextValue()));
+        } else if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            std::exit(EXIT_SUCCESS);
+        } else {
+            printUsage(argv[0]);
+            throw std::runtime_error("Unknown option: " + arg);
+        }
+    }
+    if (!config.texturePath.empty() && config.meshPath.empty()) {
+        throw std::runtime_error("--texture needs a --mesh to put it on");
+    }
+    if (config.drawCount > 0 && !config.meshPath.empty()) {
+        throw std::runtime_error("--draws replaces the triangle, it can't be combined with --mesh");
+    }
+    if (config.sceneNodeCount > 0) {
+        if (!config.meshPath.empty() || config.drawCount > 0) {
+            throw std::runtime_error("--scene replaces the triangle, it can't be combined with --mesh or --draws");
+        }
+        if (drawDataGiven) {
+            throw std::runtime_error("--scene always reads its transforms from a storage buffer, --draw-data doesn't apply");
+        }
+        config.drawDataPath = DrawDataPath::Storage;
+    }
+    if (config.occlusionCulling && config.meshPath.empty()) {
+        throw std::runtime_error("--occlusion-culling needs a --mesh to cull");
+    }
+    if (config.particleCount > 0 && (!config.meshPath.empty() || config.drawCount > 0 || config.sceneNodeCount > 0)) {
+        throw std::runtime_error("--particles replaces the triangle, it can't be combined with --mesh, --draws or --scene");
+    }
+    if (!config.postEffects.empty() && config.windowCount > 1) {
+        throw std::runtime_error("--post-process is applied in the main window only, it can't be combined with --windows");
+    }
+    if (config.drawDataPath == DrawDataPath::All && !config.benchmark) {
+        throw std::runtime_error("--draw-data all compares the paths in a --benchmark");
+    }
+    if (config.minResolutionScale <= 0.0f || config.maxResolutionScale <= 0.0f || config.maxResolutionScale > 2.0f) {
+        throw std::runtime_error("Dynamic resolution scales must be within (0, 200] percent");
+    }
+    if (config.minResolutionScale > config.maxResolutionScale) {
+        throw std::runtime_error("--drs-min can't be above --drs-max");
+    }
+    if (config.benchmark) {
+        // Measure what the GPU can do: every frame drawn, nothing throttling or rescaling it
+        config.renderMode = RenderMode::Continuous;
+        config.targetFps = 0.0;
+        config.dynamicResolution = false;
+        if (config.presentMode == PresentModePreference::Auto) {
+            config.presentMode = PresentModePreference::Immediate;
+        }
+        // The first frames include pipeline and swapchain warm-up, one warm-up frame is always needed to start the clock
+        config.benchmarkWarmupFrames = std::max<uint64_t>(config.benchmarkWarmupFrames, 1);
+        config.benchmarkFrames = std::max<uint64_t>(config.benchmarkFrames, 1);
+    }
+    return config;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "frame-capture.h"
+#include "logger.h"
+#include "video-recorder.h"
+
+// Windows the scene can be shown in at once, the main window included
+constexpr uint32_t MAX_WINDOWS = 8;
+
+enum class RenderMode {
+    Continuous, // redraw as fast as the swapchain allows
+    OnDemand    // only redraw after input, a resize or an explicit invalidate()
+};
+
+enum class PresentModePreference {
+    Auto, // mailbox when available, fifo otherwise
+    Fifo,
+    FifoRelaxed,
+    Mailbox,
+    Immediate
+};
+
+enum class MeshletMode {
+    Auto,       // mesh shaders where supported, compute culling + indirect draw otherwise
+    MeshShader, // task shader culls, mesh shader expands (VK_EXT_mesh_shader)
+    Indirect,   // compute shader culls and compacts the index buffer, one indexed indirect draw
+    Off         // one indexed draw of the whole mesh
+};
+
+// How the per-draw data of --draws reaches the vertex shader (values are DRAW_DATA_PATH in draw-data.vert)
+enum class DrawDataPath {
+    Push,           // push constants recorded with every draw
+    DynamicUniform, // one uniform buffer descriptor, rebound with a dynamic offset per draw
+    Storage,        // one storage buffer bound once, indexed by the draw's firstInstance
+    All             // benchmark: the measured frames are split between the three
+};
+
+// Effects of --post-process, each one subpass (values are POST_EFFECT in post-process.frag)
+enum class PostEffect {
+    Tonemap,  // HDR scene color to display range (ACES fit)
+    Vignette, // darkens towards the corners
+    Grade     // saturation and contrast
+};
+
+struct AppConfig {
+    RenderMode renderMode = RenderMode::OnDemand;
+    bool scaleDuringResize = false; // keep presenting the old (scaled) swapchain while a resize drag is in progress
+    double targetFps = 0.0;         // frame rate limiter, 0 = unlimited
+    PresentModePreference presentMode = PresentModePreference::Auto;
+    // Dynamic resolution scaling: render between min and max scale of the window size to hold the frame budget
+    bool dynamicResolution = true;
+    float minResolutionScale = 0.5f;
+    float maxResolutionScale = 1.0f;
+    double frameBudgetMs = 0.0; // 0 = derived from targetFps (or 60 Hz)
+    // Frame capture (F12 captures the next frame at any time)
+    std::vector<uint64_t> captureFrames; // frame numbers to capture automatically
+    std::string captureDirectory;
+    CaptureFormat captureFormat = CaptureFormat::Png;
+    bool exitAfterCapture = false;
+    // Video recording of every presented frame, converted to YUV on the GPU
+    std::string recordPath; // empty = off, "-" = stdout
+    YuvFormat recordFormat = YuvFormat::I420;
+    // Benchmark: warm up, render a fixed number of frames uncapped, print a report and quit
+    bool benchmark = false;
+    uint64_t benchmarkFrames = 1000;
+    uint64_t benchmarkWarmupFrames = 100;
+    std::string benchmarkJsonPath; // empty = print the JSON report after the text report
+    // The main window plus windowCount - 1 secondary windows, all presented together
+    uint32_t windowCount = 1;
+    // Count and time every Vulkan call through an instrumented dispatch table
+    bool profileVulkanCalls = false;
+    // .nmesh file drawn instead of the triangle (see tools/mesh-converter), empty = triangle
+    std::string meshPath;
+    MeshletMode meshletMode = MeshletMode::Auto;
+    bool meshletCulling = true; // frustum and normal cone culling per meshlet, off = draw every meshlet
+    // Texture of the mesh (PAM or binary PPM), streamed in on the transfer queue with GPU generated mip levels
+    std::string texturePath;
+    uint32_t textureBudgetMb = 256; // resident texture memory, finest levels are evicted beyond it
+    // Per-draw data benchmark: this many small quads drawn one draw call each instead of the triangle, 0 = off
+    uint32_t drawCount = 0;
+    DrawDataPath drawDataPath = DrawDataPath::Push;
+    // Transform hierarchy of this many quads, animated on the CPU and drawn instanced instead of the triangle, 0 = off
+    uint32_t sceneNodeCount = 0;
+    // 2D sprites drawn over the frame through the sprite batcher, 0 = off
+    uint32_t spriteCount = 0;
+    // GPU particle simulation drawn as points instead of the triangle, 0 = off
+    uint32_t particleCount = 0;
+    // Pipeline statistics queries per frame (vertex, primitive and fragment counts), reported with the frame times
+    bool gpuCounters = false;
+    // Draw the mesh only when its bounding box passed an occlusion query in a previous frame
+    bool occlusionCulling = false;
+    // Post-processing chain applied in order as extra subpasses of the main render pass, empty = off
+    std::vector<PostEffect> postEffects;
+    // Messages below this level are dropped before they are formatted (validation layer messages included)
+    LogLevel logLevel = LogLevel::Info;
+    // Threads running jobs (asset loading, per-object data), the main thread included, 0 = one per core
+    uint32_t jobThreads = 0;
+    // Frame at which the device is treated as lost, to exercise the recovery (see tools/check-device-recovery.sh), 0 = never
+    uint64_t loseDeviceAtFrame = 0;
+};
+
+AppConfig parseCommandLine(int argc, char* argv[]);
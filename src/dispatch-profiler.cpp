@@ -0,0 +1,73 @@
+#include "dispatch-profiler.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "stats-report.h"
+
+DispatchProfiler& dispatchProfiler() {
+    static DispatchProfiler profiler;
+    return profiler;
+}
+
+void DispatchProfiler::registerFunction(size_t index, const char* name) {
+    if (index >= k_maxFunctions) {
+        throw std::runtime_error(std::string("too many instrumented functions, can't add ") + name);
+    }
+    functions[index].name = name;
+    functionCount = std::max(functionCount, index + 1);
+}
+
+void DispatchProfiler::endFrame() {
+    for (size_t i = 0; i < functionCount; i++) {
+        auto& function = functions[i];
+        const uint64_t calls = function.calls.load(std::memory_order_relaxed);
+        const uint64_t nanoseconds = function.nanoseconds.load(std::memory_order_relaxed);
+        const uint64_t frameNanoseconds = nanoseconds - function.nanosecondsAtFrameStart;
+        function.frameCalls += calls - function.callsAtFrameStart;
+        function.frameNanoseconds += frameNanoseconds;
+        function.maxFrameNanoseconds = std::max(function.maxFrameNanoseconds, frameNanoseconds);
+        function.callsAtFrameStart = calls;
+        function.nanosecondsAtFrameStart = nanoseconds;
+    }
+    frames++;
+}
+
+void DispatchProfiler::reset() {
+    for (size_t i = 0; i < functionCount; i++) {
+        auto& function = functions[i];
+        function.callsAtFrameStart = function.calls.load(std::memory_order_relaxed);
+        function.nanosecondsAtFrameStart = function.nanoseconds.load(std::memory_order_relaxed);
+        function.frameCalls = 0;
+        function.frameNanoseconds = 0;
+        function.maxFrameNanoseconds = 0;
+    }
+    frames = 0;
+}
+
+void DispatchProfiler::addToReport(StatsReport& report, const char* section) const {
+    report.add(section, "frames", frames);
+    if (frames == 0) {
+        return;
+    }
+    std::vector<const Function*> called;
+    for (size_t i = 0; i < functionCount; i++) {
+        if (functions[i].name && functions[i].frameCalls > 0) {
+            called.push_back(&functions[i]);
+        }
+    }
+    std::sort(called.begin(), called.end(), [](const Function* a, const Function* b) {
+        return a->frameNanoseconds > b->frameNanoseconds;
+    });
+    for (const Function* function : called) {
+        report.add(section, function->name, {
+            {"calls_per_frame", double(function->frameCalls) / frames},
+            {"us_per_frame", function->frameNanoseconds / 1000.0 / frames},
+            {"max_us_per_frame", function->maxFrameNanoseconds / 1000.0},
+            {"us_per_call", function->frameNanoseconds / 1000.0 / function->frameCalls}
+        });
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+class StatsReport;
+
+// Call counts and CPU time per API entry point, fed by the trampolines of the instrumented dispatch table
+// (see instrumented-dispatch.h). Counters are relaxed atomics, so any thread may make calls; endFrame() is meant
+// to be called by the render thread once per presented frame and turns the running totals into per-frame numbers.
+class DispatchProfiler {
+public:
+    static constexpr size_t k_maxFunctions = 128;
+
+    void registerFunction(size_t index, const char* name);
+
+    void recordCall(size_t index, uint64_t nanoseconds) {
+        functions[index].calls.fetch_add(1, std::memory_order_relaxed);
+        functions[index].nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+    }
+
+    void endFrame();
+    // Forget everything measured so far, e.g. after warm-up
+    void reset();
+
+    // Adds a `section` with calls and microseconds per frame for every function that was called, most expensive first
+    void addToReport(StatsReport& report, const char* section) const;
+
+    // Times one call
+    class Scope {
+    public:
+        Scope(DispatchProfiler& profiler, size_t index)
+            : profiler(profiler), index(index), start(std::chrono::steady_clock::now()) {}
+        ~Scope() {
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            profiler.recordCall(index, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+
+    private:
+        DispatchProfiler& profiler;
+        size_t index;
+        std::chrono::steady_clock::time_point start;
+    };
+
+private:
+    struct Function {
+        const char* name = nullptr;
+        std::atomic<uint64_t> calls{0};
+        std::atomic<uint64_t> nanoseconds{0};
+        // Render thread only
+        uint64_t callsAtFrameStart = 0;
+        uint64_t nanosecondsAtFrameStart = 0;
+        uint64_t frameCalls = 0;       // summed over all frames
+        uint64_t frameNanoseconds = 0; // summed over all frames
+        uint64_t maxFrameNanoseconds = 0;
+    };
+
+    std::array<Function, k_maxFunctions> functions;
+    size_t functionCount = 0;
+    uint64_t frames = 0;
+};
+
+DispatchProfiler& dispatchProfiler();
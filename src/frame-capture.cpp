@@ -0,0 +1,316 @@
+#include "frame-capture.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "logger.h"
+
+namespace {
+
+// CRC-32 as used by PNG chunks
+const std::array<uint32_t, 256>& crcTable() {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> result{};
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            result[n] = c;
+        }
+        return result;
+    }();
+    return table;
+}
+
+uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size) {
+    const auto& table = crcTable();
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+uint32_t adler32(const uint8_t* data, size_t size) {
+    uint32_t a = 1, b = 0;
+    while (size > 0) {
+        size_t block = size < 5552 ? size : 5552; // largest block that can't overflow before the modulo
+        size -= block;
+        while (block--) {
+            a += *data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& output) : out(output) {}
+
+    void write(uint32_t bits, int count) {
+        buffer |= static_cast<uint64_t>(bits) << bitCount;
+        bitCount += count;
+        while (bitCount >= 8) {
+            out.push_back(static_cast<uint8_t>(buffer));
+            buffer >>= 8;
+            bitCount -= 8;
+        }
+    }
+
+    // Huffman codes are stored most significant bit first
+    void writeReversed(uint32_t code, int length) {
+        uint32_t reversed = 0;
+        for (int i = 0; i < length; i++) {
+            reversed |= ((code >> i) & 1) << (length - 1 - i);
+        }
+        write(reversed, length);
+    }
+
+    void flush() {
+        if (bitCount > 0) {
+            out.push_back(static_cast<uint8_t>(buffer));
+        }
+        buffer = 0;
+        bitCount = 0;
+    }
+
+private:
+    std::vector<uint8_t>& out;
+    uint64_t buffer = 0;
+    int bitCount = 0;
+};
+
+// Fixed Huffman table of RFC 1951, 3.2.6
+void writeLiteralOrLength(BitWriter& writer, uint32_t symbol) {
+    if (symbol < 144) {
+        writer.writeReversed(0x30 + symbol, 8);
+    } else if (symbol < 256) {
+        writer.writeReversed(0x190 + symbol - 144, 9);
+    } else if (symbol < 280) {
+        writer.writeReversed(symbol - 256, 7);
+    } else {
+        writer.writeReversed(0xC0 + symbol - 280, 8);
+    }
+}
+
+constexpr uint16_t k_lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                       35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr uint8_t k_lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                       3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr uint16_t k_distanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                         257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+constexpr uint8_t k_distanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                         7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+void writeMatch(BitWriter& writer, uint32_t length, uint32_t distance) {
+    int lengthCode = 28;
+    while (k_lengthBase[lengthCode] > length) {
+        lengthCode--;
+    }
+    writeLiteralOrLength(writer, 257 + lengthCode);
+    writer.write(length - k_lengthBase[lengthCode], k_lengthExtra[lengthCode]);
+
+    int distanceCode = 29;
+    while (k_distanceBase[distanceCode] > distance) {
+        distanceCode--;
+    }
+    writer.writeReversed(distanceCode, 5); // fixed distance codes are plain 5 bit numbers
+    writer.write(distance - k_distanceBase[distanceCode], k_distanceExtra[distanceCode]);
+}
+
+// Single pass greedy LZ77 with one hash probe per position and the fixed Huffman code: nowhere near zlib's
+// ratio, but fast, and rendered frames (large flat areas) compress well enough with it.
+std::vector<uint8_t> zlibCompress(const std::vector<uint8_t>& data) {
+    constexpr uint32_t k_windowSize = 32768;
+    constexpr uint32_t k_hashBits = 15;
+    constexpr uint32_t k_minMatch = 3;
+    constexpr uint32_t k_maxMatch = 258;
+
+    std::vector<uint8_t> out;
+    out.reserve(data.size() / 4 + 64);
+    out.push_back(0x78); // deflate, 32K window
+    out.push_back(0x01); // fastest compression, no preset dictionary (header is a multiple of 31)
+
+    BitWriter writer(out);
+    writer.write(1, 1); // BFINAL
+    writer.write(1, 2); // BTYPE = fixed Huffman
+
+    std::vector<int32_t> head(size_t(1) << k_hashBits, -1);
+    const size_t size = data.size();
+    size_t pos = 0;
+    while (pos < size) {
+        uint32_t bestLength = 0;
+        uint32_t bestDistance = 0;
+        if (pos + k_minMatch <= size) {
+            uint32_t hash = (data[pos] << 16 | data[pos + 1] << 8 | data[pos + 2]) * 2654435761u >> (32 - k_hashBits);
+            int32_t candidate = head[hash];
+            head[hash] = static_cast<int32_t>(pos);
+            if (candidate >= 0 && pos - candidate <= k_windowSize) {
+                const size_t maxLength = std::min<size_t>(k_maxMatch, size - pos);
+                uint32_t length = 0;
+                while (length < maxLength && data[candidate + length] == data[pos + length]) {
+                    length++;
+                }
+                if (length >= k_minMatch) {
+                    bestLength = length;
+                    bestDistance = static_cast<uint32_t>(pos - candidate);
+                }
+            }
+        }
+        if (bestLength > 0) {
+            writeMatch(writer, bestLength, bestDistance);
+            pos += bestLength;
+        } else {
+            writeLiteralOrLength(writer, data[pos]);
+            pos++;
+        }
+    }
+    writeLiteralOrLength(writer, 256); // end of block
+    writer.flush();
+
+    uint32_t checksum = adler32(data.data(), data.size());
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<uint8_t>(checksum >> shift));
+    }
+    return out;
+}
+
+void writeChunk(std::ofstream& file, const char type[4], const uint8_t* data, uint32_t size) {
+    uint8_t header[8] = {uint8_t(size >> 24), uint8_t(size >> 16), uint8_t(size >> 8), uint8_t(size),
+                         uint8_t(type[0]), uint8_t(type[1]), uint8_t(type[2]), uint8_t(type[3])};
+    file.write(reinterpret_cast<const char*>(header), 8);
+    file.write(reinterpret_cast<const char*>(data), size);
+    uint32_t crc = crc32(crc32(0, header + 4, 4), data, size);
+    uint8_t trailer[4] = {uint8_t(crc >> 24), uint8_t(crc >> 16), uint8_t(crc >> 8), uint8_t(crc)};
+    file.write(reinterpret_cast<const char*>(trailer), 4);
+}
+
+} // namespace
+
+bool writePng(const std::string& path, const CapturedImage& image) {
+    // RGB, alpha of a swapchain image carries no meaning. Every row gets the cheaper of the Sub/Up filters.
+    const uint32_t rowSize = image.width * 3;
+    std::vector<uint8_t> filtered((size_t(rowSize) + 1) * image.height);
+    std::vector<uint8_t> previousRow(rowSize, 0), currentRow(rowSize), subRow(rowSize), upRow(rowSize);
+    const int red = image.bgra ? 2 : 0;
+    const int blue = image.bgra ? 0 : 2;
+    for (uint32_t y = 0; y < image.height; y++) {
+        const uint8_t* source = image.pixels + size_t(y) * image.rowPitch;
+        for (uint32_t x = 0; x < image.width; x++) {
+            currentRow[x * 3 + 0] = source[x * 4 + red];
+            currentRow[x * 3 + 1] = source[x * 4 + 1];
+            currentRow[x * 3 + 2] = source[x * 4 + blue];
+        }
+        uint64_t subCost = 0, upCost = 0;
+        for (uint32_t i = 0; i < rowSize; i++) {
+            subRow[i] = uint8_t(currentRow[i] - (i >= 3 ? currentRow[i - 3] : 0));
+            upRow[i] = uint8_t(currentRow[i] - previousRow[i]);
+            subCost += std::abs(int8_t(subRow[i]));
+            upCost += std::abs(int8_t(upRow[i]));
+        }
+        uint8_t* destination = filtered.data() + size_t(y) * (rowSize + 1);
+        destination[0] = subCost <= upCost ? 1 : 2;
+        std::memcpy(destination + 1, subCost <= upCost ? subRow.data() : upRow.data(), rowSize);
+        std::swap(previousRow, currentRow);
+    }
+    const std::vector<uint8_t> compressed = zlibCompress(filtered);
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    file.write(reinterpret_cast<const char*>(signature), 8);
+    uint8_t header[13] = {uint8_t(image.width >> 24), uint8_t(image.width >> 16), uint8_t(image.width >> 8), uint8_t(image.width),
+                          uint8_t(image.height >> 24), uint8_t(image.height >> 16), uint8_t(image.height >> 8), uint8_t(image.height),
+                          8,  // bit depth
+                          2,  // color type: RGB
+                          0, 0, 0}; // deflate, adaptive filtering, no interlace
+    writeChunk(file, "IHDR", header, sizeof(header));
+    writeChunk(file, "IDAT", compressed.data(), static_cast<uint32_t>(compressed.size()));
+    writeChunk(file, "IEND", nullptr, 0);
+    return file.good();
+}
+
+bool writeRaw(const std::string& path, const CapturedImage& image) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::vector<uint8_t> row(size_t(image.width) * 4);
+    for (uint32_t y = 0; y < image.height; y++) {
+        const uint8_t* source = image.pixels + size_t(y) * image.rowPitch;
+        std::memcpy(row.data(), source, row.size());
+        if (image.bgra) {
+            for (size_t x = 0; x < row.size(); x += 4) {
+                std::swap(row[x], row[x + 2]);
+            }
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+    return file.good();
+}
+
+CaptureWorker::CaptureWorker(std::string outputDirectory, CaptureFormat format)
+    : directory(std::move(outputDirectory)), format(format) {
+    thread = std::thread(&CaptureWorker::run, this);
+}
+
+CaptureWorker::~CaptureWorker() {
+    stopping.store(true, std::memory_order_release);
+    wake.notify_one();
+    thread.join();
+}
+
+bool CaptureWorker::submit(const CapturedImage& image, std::atomic<bool>* done) {
+    if (!jobs.tryPush(Job{image, done})) {
+        return false;
+    }
+    // No lock here, a missed notification only delays the worker until its next timed wake-up
+    wake.notify_one();
+    return true;
+}
+
+std::string CaptureWorker::outputPath(const CapturedImage& image) const {
+    std::string name = "capture-" + std::to_string(image.frameNumber);
+    if (format == CaptureFormat::Raw) {
+        name += "-" + std::to_string(image.width) + "x" + std::to_string(image.height) + ".rgba";
+    } else {
+        name += ".png";
+    }
+    return directory.empty() ? name : directory + "/" + name;
+}
+
+void CaptureWorker::run() {
+    for (;;) {
+        Job job;
+        if (!jobs.tryPop(job)) {
+            // Drain everything that was submitted before shutting down
+            if (stopping.load(std::memory_order_acquire)) {
+                break;
+            }
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait_for(lock, std::chrono::milliseconds(10));
+            continue;
+        }
+        const std::string path = outputPath(job.image);
+        bool written = format == CaptureFormat::Png ? writePng(path, job.image) : writeRaw(path, job.image);
+        if (job.done) {
+            job.done->store(true, std::memory_order_release); // the readback memory may be reused from now on
+        }
+        if (written) {
+            LOG("Captured frame " << job.image.frameNumber << " to " << path);
+        } else {
+            LOG_ERROR("Failed to write capture " << path);
+        }
+    }
+}
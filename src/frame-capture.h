@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "spsc-queue.h"
+
+enum class CaptureFormat {
+    Png,
+    Raw // tightly packed RGBA8, dimensions are in the file name
+};
+
+// A frame sitting in host-visible readback memory
+struct CapturedImage {
+    const uint8_t* pixels = nullptr;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t rowPitch = 0; // in bytes
+    bool bgra = false;     // swapchain images are usually B8G8R8A8
+    uint64_t frameNumber = 0;
+};
+
+bool writePng(const std::string& path, const CapturedImage& image);
+bool writeRaw(const std::string& path, const CapturedImage& image);
+
+// Encodes captured frames on a background thread. The render thread hands over frames without ever blocking: the
+// hand-off is a lock-free queue and ownership of the readback memory is given back through the `done` flag.
+class CaptureWorker {
+public:
+    CaptureWorker(std::string outputDirectory, CaptureFormat format);
+    ~CaptureWorker();
+
+    // Render thread only. Returns false when the queue is full, the caller keeps ownership of the memory then.
+    bool submit(const CapturedImage& image, std::atomic<bool>* done);
+
+private:
+    struct Job {
+        CapturedImage image;
+        std::atomic<bool>* done = nullptr;
+    };
+
+    void run();
+    std::string outputPath(const CapturedImage& image) const;
+
+    std::string directory;
+    CaptureFormat format;
+    SpscQueue<Job, 8> jobs;
+    std::atomic<bool> stopping{false};
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    std::thread thread;
+};
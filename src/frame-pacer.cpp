@@ -0,0 +1,88 @@
+#include "frame-pacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+static constexpr double k_smoothing = 0.1;          // weight of the newest sample in the moving averages
+static constexpr double k_maxSpinThresholdMs = 4.0; // never spin longer than this, even with a terrible scheduler
+
+static double toMilliseconds(FramePacer::Clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+static FramePacer::Clock::duration fromMilliseconds(double ms) {
+    return std::chrono::duration_cast<FramePacer::Clock::duration>(std::chrono::duration<double, std::milli>(ms));
+}
+
+static inline void cpuRelax() {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#else
+    std::this_thread::yield();
+#endif
+}
+
+void FramePacer::setTargetFps(double fps) {
+    period = fps > 0.0 ? fromMilliseconds(1000.0 / fps) : Clock::duration{0};
+    nextDeadline = Clock::time_point{};
+}
+
+void FramePacer::waitForNextFrame() {
+    if (!isEnabled()) {
+        return;
+    }
+    const auto now = Clock::now();
+    const auto cost = fromMilliseconds(predictedFrameCostMs());
+    nextDeadline += period;
+    if (nextDeadline - cost < now) {
+        // We're late (first frame, a hitch or the app was idle): don't try to catch up with a burst of frames,
+        // restart the cadence from here instead.
+        nextDeadline = now + cost;
+        return;
+    }
+    sleepUntil(nextDeadline - cost);
+}
+
+void FramePacer::recordFrameCost(double cpuMs, double gpuMs) {
+    const double cost = cpuMs + gpuMs;
+    if (costEstimateMs == 0.0) {
+        costEstimateMs = cost;
+        return;
+    }
+    costDeviationMs += k_smoothing * (std::abs(cost - costEstimateMs) - costDeviationMs);
+    costEstimateMs += k_smoothing * (cost - costEstimateMs);
+    // A frame can't be scheduled to take longer than the whole period
+    if (isEnabled()) {
+        costEstimateMs = std::min(costEstimateMs, toMilliseconds(period));
+    }
+}
+
+void FramePacer::sleepUntil(Clock::time_point wakeTime) {
+    // Coarse part: let the OS have the core until we're within the spin window
+    for (;;) {
+        const auto now = Clock::now();
+        const double remainingMs = toMilliseconds(wakeTime - now);
+        if (remainingMs <= sleepOvershootMs) {
+            break;
+        }
+        const double requestedMs = remainingMs - sleepOvershootMs;
+        std::this_thread::sleep_for(fromMilliseconds(requestedMs));
+        const double overshootMs = toMilliseconds(Clock::now() - now) - requestedMs;
+        // React quickly to bad wake-ups, forget them slowly
+        if (overshootMs > sleepOvershootMs) {
+            sleepOvershootMs = std::min(overshootMs, k_maxSpinThresholdMs);
+        } else {
+            sleepOvershootMs += k_smoothing * 0.1 * (std::max(overshootMs, 0.05) - sleepOvershootMs);
+        }
+    }
+    // Precise part
+    while (Clock::now() < wakeTime) {
+        cpuRelax();
+    }
+}
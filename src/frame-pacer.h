@@ -0,0 +1,37 @@
+#pragma once
+
+#include <chrono>
+
+// Target-FPS governor. Frames are scheduled so that they *finish* on a fixed cadence: the next frame start is the
+// next deadline minus the predicted CPU+GPU cost of a frame, which keeps the time between sampling input and the
+// frame being done as short as possible. Waiting is a hybrid of sleeping (cheap but imprecise) and spinning
+// (precise but burns the core) for the last stretch, where the spin window adapts to the measured sleep overshoot.
+class FramePacer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // 0 disables the limiter
+    void setTargetFps(double fps);
+    bool isEnabled() const { return period.count() > 0; }
+
+    // Blocks until the next frame should start. Returns immediately when the limiter is disabled.
+    void waitForNextFrame();
+
+    // Feeds back what the previous frame cost: CPU time to record and submit, GPU execution time.
+    void recordFrameCost(double cpuMs, double gpuMs);
+
+    double predictedFrameCostMs() const { return costEstimateMs + 2.0 * costDeviationMs; }
+    double spinThresholdMs() const { return sleepOvershootMs; }
+
+private:
+    void sleepUntil(Clock::time_point wakeTime);
+
+    Clock::duration period{0};
+    Clock::time_point nextDeadline{};
+
+    // Exponential moving average of the frame cost and of its mean absolute deviation
+    double costEstimateMs = 0.0;
+    double costDeviationMs = 0.0;
+    // How much later than requested sleep calls tend to return, the spin window is based on this
+    double sleepOvershootMs = 1.0;
+};
@@ -0,0 +1,31 @@
+#include "frame-statistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+double TimingSeries::total() const {
+    return std::accumulate(samples.begin(), samples.end(), 0.0);
+}
+
+TimingSummary TimingSeries::summarize() const {
+    TimingSummary summary;
+    summary.count = samples.size();
+    if (samples.empty()) {
+        return summary;
+    }
+    std::vector<double> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&](double p) {
+        // Smallest sample that at least p of all samples are less than or equal to
+        size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+        return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+    };
+    summary.mean = total() / sorted.size();
+    summary.min = sorted.front();
+    summary.p50 = percentile(0.50);
+    summary.p90 = percentile(0.90);
+    summary.p99 = percentile(0.99);
+    summary.max = sorted.back();
+    return summary;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Distribution of a series of timings, in milliseconds. Percentiles use the nearest-rank method.
+struct TimingSummary {
+    size_t count = 0;
+    double mean = 0.0;
+    double min = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+// Collects per-frame timings. Reserve the expected count up front and add() never allocates while measuring.
+class TimingSeries {
+public:
+    void reserve(size_t count) { samples.reserve(count); }
+    void clear() { samples.clear(); }
+    void add(double ms) { samples.push_back(ms); }
+    size_t size() const { return samples.size(); }
+    double total() const;
+
+    TimingSummary summarize() const;
+
+private:
+    std::vector<double> samples;
+};
@@ -0,0 +1,59 @@
+#include "gpu-counters.h"
+
+#include "stats-report.h"
+
+vk::QueryPipelineStatisticFlags GpuCounters::statisticFlags() {
+    return vk::QueryPipelineStatisticFlagBits::eInputAssemblyVertices | vk::QueryPipelineStatisticFlagBits::eInputAssemblyPrimitives |
+           vk::QueryPipelineStatisticFlagBits::eVertexShaderInvocations | vk::QueryPipelineStatisticFlagBits::eClippingInvocations |
+           vk::QueryPipelineStatisticFlagBits::eClippingPrimitives | vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations |
+           vk::QueryPipelineStatisticFlagBits::eComputeShaderInvocations;
+}
+
+void GpuCounters::addStatistics(const std::array<uint64_t, StatisticCount>& values, uint64_t framePixels) {
+    for (size_t i = 0; i < StatisticCount; i++) {
+        totals[i] += values[i];
+    }
+    pixels += framePixels;
+    statisticFrames++;
+}
+
+void GpuCounters::addOcclusion(uint64_t samples) {
+    samplesPassed += samples;
+    occludedFrames += samples == 0 ? 1 : 0;
+    occlusionFrames++;
+}
+
+void GpuCounters::reset() {
+    *this = GpuCounters{};
+}
+
+void GpuCounters::addToReport(StatsReport& report, const char* section) const {
+    if (statisticFrames > 0) {
+        const double frames = double(statisticFrames);
+        report.add(section, "frames", statisticFrames);
+        report.add(section, "input_vertices", totals[InputVertices] / frames);
+        report.add(section, "input_primitives", totals[InputPrimitives] / frames);
+        report.add(section, "vertex_invocations", totals[VertexInvocations] / frames);
+        report.add(section, "clipping_invocations", totals[ClippingInvocations] / frames);
+        report.add(section, "clipping_primitives", totals[ClippingPrimitives] / frames);
+        report.add(section, "fragment_invocations", totals[FragmentInvocations] / frames);
+        report.add(section, "compute_invocations", totals[ComputeInvocations] / frames);
+        // Wasted vertex work: vertices shaded per vertex fetched (below 1 thanks to the post-transform cache) and
+        // primitives that were shaded but never rasterized
+        if (totals[InputVertices] > 0) {
+            report.add(section, "vertex_invocations_per_vertex", double(totals[VertexInvocations]) / double(totals[InputVertices]));
+        }
+        if (totals[ClippingInvocations] > 0) {
+            report.add(section, "primitives_discarded", 1.0 - double(totals[ClippingPrimitives]) / double(totals[ClippingInvocations]));
+        }
+        // Fragments shaded per pixel; drivers may leave out the ones that failed an early depth test
+        if (pixels > 0) {
+            report.add(section, "overdraw", double(totals[FragmentInvocations]) / double(pixels));
+        }
+    }
+    if (occlusionFrames > 0) {
+        report.add(section, "occlusion_frames", occlusionFrames);
+        report.add(section, "samples_passed", double(samplesPassed) / double(occlusionFrames));
+        report.add(section, "occluded_frames", occludedFrames);
+    }
+}
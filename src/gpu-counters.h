@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "vulkan-common.h"
+
+class StatsReport;
+
+// Totals of pipeline statistics and occlusion queries over the frames they were read for, reported per frame.
+// The render thread adds one frame's results once its fence signaled (the queries never block).
+class GpuCounters {
+public:
+    // Results of a pipeline statistics query with statisticFlags(), in the order Vulkan writes them (by flag bit)
+    enum Statistic {
+        InputVertices,
+        InputPrimitives,
+        VertexInvocations,
+        ClippingInvocations, // primitives reaching the clipper
+        ClippingPrimitives,  // primitives leaving it: the difference was culled or clipped away
+        FragmentInvocations,
+        ComputeInvocations,
+        StatisticCount
+    };
+    static vk::QueryPipelineStatisticFlags statisticFlags();
+
+    // `pixels` is the render area the frame's fragments were shaded for, to turn invocations into overdraw
+    void addStatistics(const std::array<uint64_t, StatisticCount>& values, uint64_t pixels);
+    void addOcclusion(uint64_t samplesPassed);
+    // Forget everything counted so far, e.g. after warm-up
+    void reset();
+
+    // Adds a `section` with per-frame means and the derived ratios
+    void addToReport(StatsReport& report, const char* section) const;
+
+private:
+    std::array<uint64_t, StatisticCount> totals{};
+    uint64_t statisticFrames = 0;
+    uint64_t pixels = 0;
+    uint64_t occlusionFrames = 0;
+    uint64_t samplesPassed = 0;
+    uint64_t occludedFrames = 0; // no sample passed
+};
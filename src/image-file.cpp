@@ -0,0 +1,107 @@
+#include "image-file.h"
+
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// Reads the whitespace separated header tokens of a netpbm file, skipping comments
+class HeaderReader {
+public:
+    HeaderReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    std::string token() {
+        skipSpace();
+        std::string value;
+        while (position < size && !std::isspace(data[position])) {
+            value += static_cast<char>(data[position++]);
+        }
+        return value;
+    }
+
+    uint32_t number() {
+        const std::string value = token();
+        if (value.empty() || value.size() > 9 || value.find_first_not_of("0123456789") != std::string::npos) {
+            throw std::runtime_error("malformed image header");
+        }
+        return static_cast<uint32_t>(std::stoul(value));
+    }
+
+    // The pixel data starts after exactly one whitespace character
+    size_t dataOffset() const { return position + 1; }
+
+private:
+    void skipSpace() {
+        while (position < size) {
+            if (data[position] == '#') {
+                while (position < size && data[position] != '\n') {
+                    position++;
+                }
+            } else if (std::isspace(data[position])) {
+                position++;
+            } else {
+                break;
+            }
+        }
+    }
+
+    const uint8_t* data;
+    size_t size;
+    size_t position = 0;
+};
+
+} // namespace
+
+ImageFile::ImageFile(const std::string& path) : file(path) {
+    if (file.size() < 2 || file.data()[0] != 'P' || (file.data()[1] != '6' && file.data()[1] != '7')) {
+        throw std::runtime_error(path + " is not a PAM or binary PPM image");
+    }
+    HeaderReader header(file.data() + 2, file.size() - 2);
+    uint32_t channels = 3;
+    uint32_t maxValue = 0;
+    try {
+        if (file.data()[1] == '6') {
+            imageWidth = header.number();
+            imageHeight = header.number();
+            maxValue = header.number();
+        } else {
+            for (std::string key = header.token(); key != "ENDHDR"; key = header.token()) {
+                if (key == "WIDTH") {
+                    imageWidth = header.number();
+                } else if (key == "HEIGHT") {
+                    imageHeight = header.number();
+                } else if (key == "DEPTH") {
+                    channels = header.number();
+                } else if (key == "MAXVAL") {
+                    maxValue = header.number();
+                } else if (key == "TUPLTYPE") {
+                    header.token();
+                } else {
+                    throw std::runtime_error("malformed image header");
+                }
+            }
+        }
+    } catch (const std::exception&) {
+        throw std::runtime_error(path + " has a malformed header");
+    }
+    if (imageWidth == 0 || imageHeight == 0 || imageWidth > 16384 || imageHeight > 16384 || maxValue != 255
+        || (channels != 3 && channels != 4)) {
+        throw std::runtime_error(path + ": only 8 bit RGB or RGBA images up to 16384x16384 are supported");
+    }
+    const size_t offset = 2 + header.dataOffset();
+    const size_t pixelCount = size_t(imageWidth) * imageHeight;
+    if (offset > file.size() || file.size() - offset < pixelCount * channels) {
+        throw std::runtime_error(path + " is truncated");
+    }
+    const uint8_t* source = file.data() + offset;
+    if (channels == 4) {
+        rgba = source;
+        return;
+    }
+    expanded.resize(pixelCount * 4);
+    for (size_t i = 0; i < pixelCount; i++) {
+        std::memcpy(&expanded[i * 4], source + i * 3, 3);
+        expanded[i * 4 + 3] = 255;
+    }
+}
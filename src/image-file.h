@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mapped-file.h"
+
+// An uncompressed 8 bit image: binary PAM (P7, RGB_ALPHA or RGB) or PPM (P6). RGBA PAM pixels are used straight from
+// the mapping, RGB images are expanded to RGBA once on load.
+class ImageFile {
+public:
+    explicit ImageFile(const std::string& path); // throws on I/O errors and unsupported files
+
+    uint32_t width() const { return imageWidth; }
+    uint32_t height() const { return imageHeight; }
+    const uint8_t* pixels() const { return rgba ? rgba : expanded.data(); } // RGBA8, rows tightly packed
+    size_t size() const { return size_t(imageWidth) * imageHeight * 4; }
+
+private:
+    MappedFile file;
+    uint32_t imageWidth = 0;
+    uint32_t imageHeight = 0;
+    const uint8_t* rgba = nullptr; // into the mapping
+    std::vector<uint8_t> expanded;
+};
@@ -0,0 +1,196 @@
+#pragma once
+
+// Instrumented dispatch table: swaps the function pointers the application calls Vulkan through for trampolines that
+// time each call into the DispatchProfiler and then forward to the original entry point. On desktop the pointers live
+// in VULKAN_HPP_DEFAULT_DISPATCHER, on Android they are the globals of the NDK vulkan_wrapper.
+// vulkan.hpp (and the Android wrapper) come through vulkan-common.h, like in every file that talks to Vulkan.
+
+#include <cstddef>
+
+#include "dispatch-profiler.h"
+#include "vulkan-common.h"
+
+// Entry points of optional features, listed where the code using them is compiled
+#ifdef NARU_MESH_SHADER_SUPPORT
+#define NARU_INSTRUMENTED_MESH_SHADER_FUNCTIONS(X) X(vkCmdDrawMeshTasksEXT)
+#else
+#define NARU_INSTRUMENTED_MESH_SHADER_FUNCTIONS(X)
+#endif
+#ifdef NARU_CONDITIONAL_RENDERING_SUPPORT
+#define NARU_INSTRUMENTED_CONDITIONAL_RENDERING_FUNCTIONS(X) \
+    X(vkCmdBeginConditionalRenderingEXT) \
+    X(vkCmdEndConditionalRenderingEXT)
+#else
+#define NARU_INSTRUMENTED_CONDITIONAL_RENDERING_FUNCTIONS(X)
+#endif
+// Vulkan 1.1 is only requested on desktop, the features of both extensions above are queried through it
+#ifndef __ANDROID__
+#define NARU_INSTRUMENTED_VULKAN_1_1_FUNCTIONS(X) X(vkGetPhysicalDeviceFeatures2)
+#else
+#define NARU_INSTRUMENTED_VULKAN_1_1_FUNCTIONS(X)
+#endif
+#ifdef DEBUG
+#define NARU_INSTRUMENTED_DEBUG_FUNCTIONS(X) \
+    X(vkCreateDebugUtilsMessengerEXT) \
+    X(vkDestroyDebugUtilsMessengerEXT)
+#else
+#define NARU_INSTRUMENTED_DEBUG_FUNCTIONS(X)
+#endif
+
+// Every entry point the application calls once the table is installed, right after the instance was created: all but
+// vkCreateInstance. tools/check-instrumented-dispatch.sh (a ctest) fails when a call site uses one that isn't listed.
+#define NARU_INSTRUMENTED_VULKAN_FUNCTIONS(X) \
+    X(vkAcquireNextImageKHR) \
+    X(vkQueueSubmit) \
+    X(vkQueuePresentKHR) \
+    X(vkQueueWaitIdle) \
+    X(vkDeviceWaitIdle) \
+    X(vkWaitForFences) \
+    X(vkGetFenceStatus) \
+    X(vkResetFences) \
+    X(vkGetQueryPoolResults) \
+    X(vkBeginCommandBuffer) \
+    X(vkEndCommandBuffer) \
+    X(vkResetCommandBuffer) \
+    X(vkCmdBeginRenderPass) \
+    X(vkCmdNextSubpass) \
+    X(vkCmdEndRenderPass) \
+    X(vkCmdBindPipeline) \
+    X(vkCmdBindDescriptorSets) \
+    X(vkCmdPushConstants) \
+    X(vkCmdSetViewport) \
+    X(vkCmdSetScissor) \
+    X(vkCmdDraw) \
+    X(vkCmdDrawIndexed) \
+    X(vkCmdDrawIndexedIndirect) \
+    NARU_INSTRUMENTED_MESH_SHADER_FUNCTIONS(X) \
+    X(vkCmdBindVertexBuffers) \
+    X(vkCmdBindIndexBuffer) \
+    X(vkCmdDispatch) \
+    X(vkCmdPipelineBarrier) \
+    X(vkCmdBlitImage) \
+    X(vkCmdCopyBuffer) \
+    X(vkCmdCopyBufferToImage) \
+    X(vkCmdCopyImage) \
+    X(vkCmdClearColorImage) \
+    X(vkCmdUpdateBuffer) \
+    X(vkCmdFillBuffer) \
+    X(vkCmdCopyImageToBuffer) \
+    X(vkCmdResetQueryPool) \
+    X(vkCmdWriteTimestamp) \
+    X(vkCmdBeginQuery) \
+    X(vkCmdEndQuery) \
+    X(vkCmdCopyQueryPoolResults) \
+    NARU_INSTRUMENTED_CONDITIONAL_RENDERING_FUNCTIONS(X) \
+    X(vkUpdateDescriptorSets) \
+    X(vkAllocateDescriptorSets) \
+    X(vkCreateDescriptorSetLayout) \
+    X(vkDestroyDescriptorSetLayout) \
+    X(vkCreateDescriptorPool) \
+    X(vkDestroyDescriptorPool) \
+    X(vkCreatePipelineLayout) \
+    X(vkDestroyPipelineLayout) \
+    X(vkCreateSampler) \
+    X(vkDestroySampler) \
+    X(vkCreateSwapchainKHR) \
+    X(vkDestroySwapchainKHR) \
+    X(vkGetSwapchainImagesKHR) \
+    X(vkGetPhysicalDeviceSurfaceCapabilitiesKHR) \
+    X(vkGetPhysicalDeviceSurfaceFormatsKHR) \
+    X(vkGetPhysicalDeviceSurfacePresentModesKHR) \
+    X(vkEnumeratePhysicalDevices) \
+    X(vkEnumerateDeviceExtensionProperties) \
+    X(vkGetPhysicalDeviceQueueFamilyProperties) \
+    X(vkGetPhysicalDeviceSurfaceSupportKHR) \
+    X(vkGetPhysicalDeviceFeatures) \
+    NARU_INSTRUMENTED_VULKAN_1_1_FUNCTIONS(X) \
+    X(vkGetPhysicalDeviceProperties) \
+    X(vkGetPhysicalDeviceMemoryProperties) \
+    X(vkGetPhysicalDeviceFormatProperties) \
+    X(vkCreateImage) \
+    X(vkDestroyImage) \
+    X(vkCreateImageView) \
+    X(vkDestroyImageView) \
+    X(vkCreateFramebuffer) \
+    X(vkDestroyFramebuffer) \
+    X(vkCreateRenderPass) \
+    X(vkDestroyRenderPass) \
+    X(vkCreateShaderModule) \
+    X(vkDestroyShaderModule) \
+    X(vkCreateGraphicsPipelines) \
+    X(vkCreateComputePipelines) \
+    X(vkCreatePipelineCache) \
+    X(vkDestroyPipelineCache) \
+    X(vkGetPipelineCacheData) \
+    X(vkDestroyPipeline) \
+    X(vkCreateBuffer) \
+    X(vkDestroyBuffer) \
+    X(vkGetBufferMemoryRequirements) \
+    X(vkGetImageMemoryRequirements) \
+    X(vkAllocateMemory) \
+    X(vkFreeMemory) \
+    X(vkBindBufferMemory) \
+    X(vkBindImageMemory) \
+    X(vkMapMemory) \
+    X(vkUnmapMemory) \
+    X(vkCreateCommandPool) \
+    X(vkDestroyCommandPool) \
+    X(vkAllocateCommandBuffers) \
+    X(vkCreateSemaphore) \
+    X(vkDestroySemaphore) \
+    X(vkCreateFence) \
+    X(vkDestroyFence) \
+    X(vkCreateDevice) \
+    X(vkDestroyDevice) \
+    X(vkGetDeviceQueue) \
+    X(vkCreateQueryPool) \
+    X(vkDestroyQueryPool) \
+    X(vkDestroySurfaceKHR) \
+    X(vkDestroyInstance) \
+    NARU_INSTRUMENTED_DEBUG_FUNCTIONS(X)
+
+#ifdef __ANDROID__
+#define NARU_DISPATCH_SLOT(name) ::name
+#else
+#define NARU_DISPATCH_SLOT(name) VULKAN_HPP_DEFAULT_DISPATCHER.name
+#endif
+
+enum class InstrumentedFunction : size_t {
+#define NARU_INSTRUMENTED_ENUM(name) name,
+    NARU_INSTRUMENTED_VULKAN_FUNCTIONS(NARU_INSTRUMENTED_ENUM)
+#undef NARU_INSTRUMENTED_ENUM
+    Count
+};
+static_assert(static_cast<size_t>(InstrumentedFunction::Count) <= DispatchProfiler::k_maxFunctions,
+              "raise DispatchProfiler::k_maxFunctions");
+
+template <InstrumentedFunction Function, typename Pfn>
+struct CallTrampoline;
+
+template <InstrumentedFunction Function, typename R, typename... Args>
+struct CallTrampoline<Function, R (VKAPI_PTR*)(Args...)> {
+    using Pfn = R (VKAPI_PTR*)(Args...);
+    static inline Pfn original = nullptr;
+
+    static R VKAPI_PTR call(Args... args) {
+        DispatchProfiler::Scope scope(dispatchProfiler(), static_cast<size_t>(Function));
+        return original(args...);
+    }
+
+    static void install(Pfn& slot) {
+        // Entry points the driver doesn't provide stay null, already wrapped ones stay wrapped
+        if (slot && slot != &call) {
+            original = slot;
+            slot = &call;
+        }
+    }
+};
+
+// Wraps every function of the list. Call again whenever the dispatch table was (re)loaded.
+inline void installInstrumentedDispatch() {
+#define NARU_INSTRUMENT(name) \
+    dispatchProfiler().registerFunction(static_cast<size_t>(InstrumentedFunction::name), #name); \
+    CallTrampoline<InstrumentedFunction::name, PFN_##name>::install(NARU_DISPATCH_SLOT(name));
+    NARU_INSTRUMENTED_VULKAN_FUNCTIONS(NARU_INSTRUMENT)
+#undef NARU_INSTRUMENT
+}
@@ -0,0 +1,351 @@
+#include "job-system.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+// The system the current thread belongs to and its index in it (0 = main thread)
+struct ThreadRole {
+    const JobSystem* system = nullptr;
+    int32_t index = -1;
+};
+thread_local ThreadRole threadRole;
+thread_local uint32_t externalVictim = 0;
+}
+
+bool WorkStealingDeque::push(Job* job) {
+    const int64_t b = bottom.load(std::memory_order_relaxed);
+    const int64_t t = top.load(std::memory_order_acquire);
+    if (b - t >= static_cast<int64_t>(k_capacity)) {
+        return false;
+    }
+    jobs[b & (k_capacity - 1)].store(job, std::memory_order_relaxed);
+    bottom.store(b + 1, std::memory_order_release);
+    return true;
+}
+
+Job* WorkStealingDeque::pop() {
+    const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    // Sequentially consistent: a thief either sees the job gone, or this sees the thief's top update
+    bottom.store(b, std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_seq_cst);
+    if (t > b) {
+        bottom.store(b + 1, std::memory_order_relaxed); // was empty
+        return nullptr;
+    }
+    Job* job = jobs[b & (k_capacity - 1)].load(std::memory_order_relaxed);
+    if (t == b) {
+        // The last job: race the thieves for it
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            job = nullptr;
+        }
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+Job* WorkStealingDeque::steal() {
+    int64_t t = top.load(std::memory_order_seq_cst);
+    const int64_t b = bottom.load(std::memory_order_seq_cst);
+    if (t >= b) {
+        return nullptr;
+    }
+    Job* job = jobs[t & (k_capacity - 1)].load(std::memory_order_relaxed);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return nullptr; // lost against the owner or another thief
+    }
+    return job;
+}
+
+JobSystem::JobSystem(uint32_t workerCount, std::function<void()> wakeMainThread)
+    : wakeMainThread(std::move(wakeMainThread)) {
+    for (uint32_t i = 0; i <= workerCount; i++) {
+        participants.push_back(std::make_unique<Participant>());
+    }
+    threadRole = {this, 0};
+    for (uint32_t i = 1; i <= workerCount; i++) {
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    stopping.store(true, std::memory_order_seq_cst);
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        sleepCondition.notify_all();
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    if (threadRole.system == this) {
+        threadRole = {};
+    }
+}
+
+uint32_t JobSystem::defaultWorkerCount() {
+    return std::max(std::thread::hardware_concurrency(), 1u) - 1;
+}
+
+int32_t JobSystem::threadIndex() const {
+    return threadRole.system == this ? threadRole.index : -1;
+}
+
+JobPool::JobPool() {
+    for (uint32_t i = 0; i < k_size; i++) {
+        jobs[i].pool = this;
+        jobs[i].next = i + 1 < k_size ? &jobs[i + 1] : nullptr;
+    }
+    available = &jobs[0];
+}
+
+Job* JobPool::take() {
+    if (!available) {
+        available = returned.exchange(nullptr, std::memory_order_acquire);
+        if (!available) {
+            return nullptr;
+        }
+    }
+    Job* job = available;
+    available = job->next;
+    return job;
+}
+
+void JobPool::giveBack(Job& job) {
+    Job* head = returned.load(std::memory_order_relaxed);
+    do {
+        job.next = head;
+    } while (!returned.compare_exchange_weak(head, &job, std::memory_order_release, std::memory_order_relaxed));
+}
+
+Job& JobSystem::allocate() {
+    const int32_t self = threadIndex();
+    for (;;) {
+        Job* job = nullptr;
+        if (self >= 0) {
+            job = participants[self]->pool.take();
+        } else {
+            // Threads without a deque share one pool
+            std::lock_guard<std::mutex> lock(sharedMutex);
+            job = externalPool.take();
+        }
+        if (job) {
+            return *job;
+        }
+        // All of them are in flight: help until one is done
+        if (!runOne()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::start(Job& job, JobCounter* counter, JobCounter* after) {
+    job.counter = counter;
+    if (counter && counter->value.fetch_add(1, std::memory_order_relaxed) == 0) {
+        // Reopen the waiters list, once the job that took the counter to zero has released the parked ones
+        Job* expected = JobCounter::closed();
+        while (!counter->waiters.compare_exchange_weak(expected, nullptr, std::memory_order_acq_rel)) {
+            expected = JobCounter::closed();
+            std::this_thread::yield();
+        }
+    }
+    if (after) {
+        Job* head = after->waiters.load(std::memory_order_acquire);
+        do {
+            if (head == JobCounter::closed()) {
+                break; // already zero
+            }
+            job.next = head;
+        } while (!after->waiters.compare_exchange_weak(head, &job, std::memory_order_acq_rel, std::memory_order_acquire));
+        if (head != JobCounter::closed()) {
+            return; // queued by the job that takes `after` to zero
+        }
+    }
+    enqueue(job);
+}
+
+void JobSystem::enqueue(Job& job) {
+    if (job.affinity == JobAffinity::MainThread) {
+        {
+            std::lock_guard<std::mutex> lock(sharedMutex);
+            mainThreadJobs.push_back(&job);
+            mainThreadJobCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (wakeMainThread && threadIndex() != 0) {
+            wakeMainThread();
+        }
+        return;
+    }
+    const int32_t self = threadIndex();
+    if (self < 0 || !participants[self]->deque.push(&job)) {
+        std::lock_guard<std::mutex> lock(sharedMutex);
+        sharedJobs.push_back(&job);
+        sharedJobCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    // Pairs with the fence of a worker going to sleep: either it sees this job, or this sees it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        sleepCondition.notify_one();
+    }
+}
+
+void JobSystem::execute(Job& job, int32_t self) {
+    JobCounter* counter = job.counter;
+    try {
+        job.invoke(job);
+    } catch (...) {
+        if (!counter) {
+            std::terminate();
+        }
+        if (!counter->failed.exchange(true, std::memory_order_relaxed)) {
+            counter->error = std::current_exception();
+        }
+    }
+    job.destroy(job);
+    job.pool->giveBack(job);
+    (self >= 0 ? participants[self]->counters : externalCounters).jobs.fetch_add(1, std::memory_order_relaxed);
+    if (counter && counter->value.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        // Last access to the counter: once it's closed a waiter may return and destroy it
+        Job* waiter = counter->waiters.exchange(JobCounter::closed(), std::memory_order_acq_rel);
+        while (waiter) {
+            Job* next = waiter->next;
+            enqueue(*waiter);
+            waiter = next;
+        }
+    }
+}
+
+Job* JobSystem::find(int32_t self) {
+    if (self >= 0) {
+        if (Job* job = participants[self]->deque.pop()) {
+            return job;
+        }
+    }
+    if (self == 0 && mainThreadJobCount.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<std::mutex> lock(sharedMutex);
+        if (!mainThreadJobs.empty()) {
+            Job* job = mainThreadJobs.front();
+            mainThreadJobs.pop_front();
+            mainThreadJobCount.fetch_sub(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+    if (sharedJobCount.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<std::mutex> lock(sharedMutex);
+        if (!sharedJobs.empty()) {
+            Job* job = sharedJobs.front();
+            sharedJobs.pop_front();
+            sharedJobCount.fetch_sub(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+    // Steal, starting from a different victim every time so thieves spread out
+    const uint32_t count = static_cast<uint32_t>(participants.size());
+    const uint32_t first = self >= 0 ? participants[self]->nextVictim++ : externalVictim++;
+    for (uint32_t i = 0; i < count; i++) {
+        const uint32_t victim = (first + i) % count;
+        if (static_cast<int32_t>(victim) == self) {
+            continue;
+        }
+        if (Job* job = participants[victim]->deque.steal()) {
+            (self >= 0 ? participants[self]->counters : externalCounters).stolen.fetch_add(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+bool JobSystem::runOne() {
+    const int32_t self = threadIndex();
+    Job* job = find(self);
+    if (!job) {
+        return false;
+    }
+    execute(*job, self);
+    return true;
+}
+
+bool JobSystem::hasWork() const {
+    if (sharedJobCount.load(std::memory_order_relaxed) > 0) {
+        return true;
+    }
+    return std::any_of(participants.begin(), participants.end(),
+                       [](const std::unique_ptr<Participant>& participant) { return !participant->deque.empty(); });
+}
+
+void JobSystem::workerLoop(uint32_t index) {
+    threadRole = {this, static_cast<int32_t>(index)};
+    Participant& participant = *participants[index];
+    uint32_t idle = 0;
+    for (;;) {
+        if (Job* job = find(static_cast<int32_t>(index))) {
+            execute(*job, static_cast<int32_t>(index));
+            idle = 0;
+            continue;
+        }
+        if (stopping.load(std::memory_order_relaxed)) {
+            break; // only once the queued jobs are done
+        }
+        if (++idle < k_spinsBeforeSleep) {
+            std::this_thread::yield();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleeping.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!hasWork() && !stopping.load(std::memory_order_relaxed)) {
+            participant.counters.sleeps.fetch_add(1, std::memory_order_relaxed);
+            // A job queued meanwhile is seen by hasWork or wakes this up (see enqueue), the timeout is a safety net
+            sleepCondition.wait_for(lock, std::chrono::milliseconds(10));
+        }
+        sleeping.fetch_sub(1, std::memory_order_relaxed);
+        idle = 0;
+    }
+}
+
+void JobSystem::wait(JobCounter& counter) {
+    while (!counter.done()) {
+        if (!runOne()) {
+            std::this_thread::yield();
+        }
+    }
+    if (counter.failed.load(std::memory_order_acquire)) {
+        std::exception_ptr error = counter.error;
+        counter.error = nullptr;
+        counter.failed.store(false, std::memory_order_relaxed);
+        std::rethrow_exception(error);
+    }
+}
+
+void JobSystem::runMainThreadJobs() {
+    if (threadIndex() != 0) {
+        return;
+    }
+    while (mainThreadJobCount.load(std::memory_order_relaxed) > 0) {
+        Job* job = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(sharedMutex);
+            if (mainThreadJobs.empty()) {
+                break;
+            }
+            job = mainThreadJobs.front();
+            mainThreadJobs.pop_front();
+            mainThreadJobCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+        execute(*job, 0);
+    }
+}
+
+JobSystem::Statistics JobSystem::statistics() const {
+    Statistics statistics;
+    auto add = [&](const Counters& counters) {
+        statistics.jobs += counters.jobs.load(std::memory_order_relaxed);
+        statistics.stolen += counters.stolen.load(std::memory_order_relaxed);
+        statistics.sleeps += counters.sleeps.load(std::memory_order_relaxed);
+    };
+    for (const auto& participant : participants) {
+        add(participant->counters);
+    }
+    add(externalCounters);
+    return statistics;
+}
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+struct Job;
+struct JobPool;
+
+// Number of unfinished jobs started with it. Jobs can be started "after" a counter: they are parked on it and
+// queued once it drops to zero, which is how dependencies are expressed. The first exception thrown by one of its
+// jobs is rethrown by JobSystem::wait. A counter must outlive its jobs, and may only be reused once it's zero.
+class JobCounter {
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    // Also waits for the last job to have released the parked ones, after that the counter isn't touched anymore
+    bool done() const {
+        return value.load(std::memory_order_acquire) == 0 && waiters.load(std::memory_order_acquire) == closed();
+    }
+
+private:
+    friend class JobSystem;
+    static Job* closed() { return reinterpret_cast<Job*>(uintptr_t(1)); } // waiters list of a counter at zero
+
+    std::atomic<uint32_t> value{0};
+    std::atomic<Job*> waiters{closed()};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+};
+
+enum class JobAffinity {
+    Any,       // whichever thread gets to it first
+    MainThread // only the thread that created the JobSystem, e.g. for SDL window calls
+};
+
+// One unit of work, the callable is stored in place (see JobSystem::run)
+struct Job {
+    static constexpr size_t k_dataSize = 80;
+
+    void (*invoke)(Job&) = nullptr;
+    void (*destroy)(Job&) = nullptr;
+    JobCounter* counter = nullptr;
+    Job* next = nullptr;     // in the waiters list of the counter it runs after, or in its pool's free lists
+    JobPool* pool = nullptr; // it's returned to when done
+    JobAffinity affinity = JobAffinity::Any;
+    alignas(std::max_align_t) unsigned char data[k_dataSize];
+};
+
+// Jobs of one thread. Only that thread takes jobs from it, any thread returns them: finished jobs are pushed onto
+// `returned`, which the owner empties in one exchange when its own list ran dry (no ABA problem, nobody else pops).
+struct JobPool {
+    static constexpr uint32_t k_size = 1024; // jobs in flight per thread, more make the next start wait
+
+    JobPool();
+    Job* take();
+    void giveBack(Job& job);
+
+    std::unique_ptr<Job[]> jobs{new Job[k_size]};
+    Job* available = nullptr;
+    std::atomic<Job*> returned{nullptr};
+};
+
+// Fixed-capacity Chase-Lev deque: the owning thread pushes and pops at the bottom (LIFO, the freshest jobs are the
+// ones still in its cache), other threads steal from the top (FIFO, the oldest jobs are usually the biggest).
+// Lock-free, a push only fails when it's full.
+class WorkStealingDeque {
+public:
+    static constexpr size_t k_capacity = 4096;
+
+    bool push(Job* job);
+    Job* pop();
+    Job* steal();
+    bool empty() const {
+        return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr size_t k_cacheLineSize = 64;
+
+    alignas(k_cacheLineSize) std::atomic<int64_t> top{0};
+    alignas(k_cacheLineSize) std::atomic<int64_t> bottom{0};
+    alignas(k_cacheLineSize) std::array<std::atomic<Job*>, k_capacity> jobs{};
+};
+
+// Work-stealing job scheduler. Every worker thread, and the thread that created the system (the main thread),
+// owns a deque and a pool of jobs: starting and finishing a job takes no lock and no allocation. Idle workers steal
+// from the others, and sleep after a short spin. Other threads (e.g. the render thread) can start jobs as well,
+// through a shared queue, and any thread that waits for a counter runs jobs meanwhile instead of blocking.
+// MainThread jobs wait in their own queue until the main thread waits or calls runMainThreadJobs(); `wakeMainThread`
+// is called when one is queued, to get it out of its event loop.
+class JobSystem {
+public:
+    // 0 workers: everything runs on the threads that wait
+    explicit JobSystem(uint32_t workerCount, std::function<void()> wakeMainThread = {});
+    ~JobSystem(); // the workers finish the queued jobs, then stop
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Worker threads for the hardware: one per core but the calling thread's
+    static uint32_t defaultWorkerCount();
+
+    uint32_t workerCount() const { return static_cast<uint32_t>(workers.size()); }
+
+    // Starts `function` (callable without arguments, at most Job::k_dataSize bytes: capture references or pointers).
+    // `counter` is incremented now and decremented once it ran. With `after`, it's queued when `after` drops to zero.
+    // An exception escaping a job without a counter terminates, like one escaping a std::thread.
+    template <typename F>
+    void run(F&& function, JobCounter* counter = nullptr, JobCounter* after = nullptr, JobAffinity affinity = JobAffinity::Any) {
+        using Function = std::decay_t<F>;
+        static_assert(sizeof(Function) <= Job::k_dataSize, "job too big to be stored in place, capture less");
+        static_assert(alignof(Function) <= alignof(std::max_align_t), "job over-aligned");
+        Job& job = allocate();
+        new (job.data) Function(std::forward<F>(function));
+        job.invoke = [](Job& self) { (*std::launder(reinterpret_cast<Function*>(self.data)))(); };
+        job.destroy = [](Job& self) { std::launder(reinterpret_cast<Function*>(self.data))->~Function(); };
+        job.affinity = affinity;
+        start(job, counter, after);
+    }
+
+    // function(begin, end) over [0, count) in chunks of `grain` items, one job each, and waits for all of them.
+    // The calling thread takes part.
+    template <typename F>
+    void parallelFor(uint32_t count, uint32_t grain, const F& function) {
+        grain = grain > 0 ? grain : 1;
+        if (count <= grain) {
+            if (count > 0) {
+                function(0u, count);
+            }
+            return;
+        }
+        JobCounter counter;
+        for (uint32_t begin = grain; begin < count; begin += grain) {
+            const uint32_t end = count - begin > grain ? begin + grain : count;
+            run([&function, begin, end]() { function(begin, end); }, &counter);
+        }
+        // The first chunk runs here, while the others are being stolen
+        std::exception_ptr error;
+        try {
+            function(0u, grain);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        wait(counter);
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // Runs jobs until `counter` is zero, then rethrows the first exception of its jobs
+    void wait(JobCounter& counter);
+
+    // Main thread: runs the MainThread jobs queued so far
+    void runMainThreadJobs();
+
+    struct Statistics {
+        uint64_t jobs = 0;   // finished
+        uint64_t stolen = 0; // taken from another thread's deque
+        uint64_t sleeps = 0; // times a worker went to sleep for lack of work
+    };
+    Statistics statistics() const;
+
+private:
+    static constexpr uint32_t k_spinsBeforeSleep = 64;
+
+    struct Counters {
+        std::atomic<uint64_t> jobs{0};
+        std::atomic<uint64_t> stolen{0};
+        std::atomic<uint64_t> sleeps{0};
+    };
+    struct alignas(64) Participant {
+        WorkStealingDeque deque;
+        JobPool pool;
+        uint32_t nextVictim = 0;
+        Counters counters;
+    };
+
+    Job& allocate();
+    void start(Job& job, JobCounter* counter, JobCounter* after);
+    void enqueue(Job& job);
+    void execute(Job& job, int32_t self);
+    bool runOne(); // false when no job was found
+    Job* find(int32_t self);
+    bool hasWork() const;
+    void workerLoop(uint32_t index);
+    int32_t threadIndex() const; // -1 on threads that don't belong to this system
+
+    // Index 0 is the main thread, 1.. the workers
+    std::vector<std::unique_ptr<Participant>> participants;
+    std::vector<std::thread> workers;
+    std::function<void()> wakeMainThread;
+
+    // Jobs started by threads without a deque, and the MainThread jobs
+    std::mutex sharedMutex;
+    std::deque<Job*> sharedJobs;
+    std::deque<Job*> mainThreadJobs;
+    std::atomic<uint32_t> sharedJobCount{0};
+    std::atomic<uint32_t> mainThreadJobCount{0};
+    JobPool externalPool; // of the threads without a deque, guarded by sharedMutex
+    Counters externalCounters;
+
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+    std::atomic<uint32_t> sleeping{0};
+    std::atomic<bool> stopping{false};
+};
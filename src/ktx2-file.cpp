@@ -0,0 +1,171 @@
+#include "ktx2-file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+const uint8_t k_identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+// VkFormat values of the formats this loader knows the block layout of
+enum : uint32_t {
+    FORMAT_R8G8B8A8_UNORM = 37,
+    FORMAT_R8G8B8A8_SRGB = 43,
+    FORMAT_BC1_RGB_UNORM = 131,
+    FORMAT_BC1_RGBA_SRGB = 134,
+    FORMAT_BC3_UNORM = 137,
+    FORMAT_BC3_SRGB = 138,
+    FORMAT_BC4_UNORM = 139,
+    FORMAT_BC5_UNORM = 141,
+    FORMAT_BC7_SRGB = 146,
+    FORMAT_ETC2_R8G8B8_UNORM = 147,
+    FORMAT_ETC2_R8G8B8_SRGB = 148,
+    FORMAT_ETC2_R8G8B8A8_UNORM = 151,
+    FORMAT_ETC2_R8G8B8A8_SRGB = 152,
+    FORMAT_ASTC_4x4_UNORM = 157,
+    FORMAT_ASTC_12x12_SRGB = 184
+};
+
+// Block sizes of the ASTC formats, in VkFormat order (an UNORM and an SRGB variant each)
+const uint8_t k_astcBlocks[14][2] = {
+    {4, 4}, {5, 4}, {5, 5}, {6, 5}, {6, 6}, {8, 5}, {8, 6}, {8, 8}, {10, 5}, {10, 6}, {10, 8}, {10, 10}, {12, 10}, {12, 12}
+};
+
+template <typename T>
+T read(const uint8_t* bytes) {
+    T value;
+    std::memcpy(&value, bytes, sizeof(value)); // KTX2 is little endian, like every platform we build for
+    return value;
+}
+
+} // namespace
+
+Ktx2File::Ktx2File(const std::string& path) : file(path) {
+    const size_t headerSize = 80;
+    if (file.size() < headerSize || std::memcmp(file.data(), k_identifier, sizeof(k_identifier)) != 0) {
+        throw std::runtime_error(path + " is not a KTX2 file");
+    }
+    const uint8_t* header = file.data() + sizeof(k_identifier);
+    format = read<uint32_t>(header);
+    pixelWidth = read<uint32_t>(header + 8);
+    pixelHeight = read<uint32_t>(header + 12);
+    const uint32_t pixelDepth = read<uint32_t>(header + 16);
+    const uint32_t layerCount = read<uint32_t>(header + 20);
+    const uint32_t faceCount = read<uint32_t>(header + 24);
+    const uint32_t storedLevels = std::max(read<uint32_t>(header + 28), 1u); // 0: generate the mips, level 0 is stored
+    const uint32_t supercompression = read<uint32_t>(header + 32);
+    if (pixelWidth == 0 || pixelHeight == 0 || pixelDepth > 1 || layerCount > 1 || faceCount != 1) {
+        throw std::runtime_error(path + ": only single 2D textures are supported");
+    }
+    if (supercompression != 0) {
+        throw std::runtime_error(path + " is supercompressed, only plain KTX2 is supported");
+    }
+
+    if (format == FORMAT_R8G8B8A8_UNORM || format == FORMAT_R8G8B8A8_SRGB) {
+        bytesPerBlock = 4;
+    } else if (format >= FORMAT_BC1_RGB_UNORM && format <= FORMAT_BC7_SRGB) {
+        blockExtent[0] = blockExtent[1] = 4;
+        bytesPerBlock = format <= FORMAT_BC1_RGBA_SRGB || format == FORMAT_BC4_UNORM || format == FORMAT_BC4_UNORM + 1 ? 8 : 16;
+    } else if (format >= FORMAT_ETC2_R8G8B8_UNORM && format <= FORMAT_ETC2_R8G8B8A8_SRGB + 4) {
+        // ETC2 RGB8, RGB8A1, RGBA8 and EAC R11, RG11
+        blockExtent[0] = blockExtent[1] = 4;
+        bytesPerBlock = format <= FORMAT_ETC2_R8G8B8_SRGB + 2 || format == FORMAT_ETC2_R8G8B8A8_SRGB + 1
+            || format == FORMAT_ETC2_R8G8B8A8_SRGB + 2 ? 8 : 16;
+    } else if (format >= FORMAT_ASTC_4x4_UNORM && format <= FORMAT_ASTC_12x12_SRGB) {
+        blockExtent[0] = k_astcBlocks[(format - FORMAT_ASTC_4x4_UNORM) / 2][0];
+        blockExtent[1] = k_astcBlocks[(format - FORMAT_ASTC_4x4_UNORM) / 2][1];
+        bytesPerBlock = 16;
+    } else {
+        throw std::runtime_error(path + " has unsupported VkFormat " + std::to_string(format));
+    }
+
+    // Level index: byteOffset, byteLength, uncompressedByteLength per level, offsets and sizes come from disk
+    if (file.size() - headerSize < uint64_t(storedLevels) * 24) {
+        throw std::runtime_error(path + " is truncated");
+    }
+    for (uint32_t level = 0; level < storedLevels; level++) {
+        const uint8_t* entry = file.data() + headerSize + level * 24;
+        Level data;
+        data.offset = read<uint64_t>(entry);
+        data.size = read<uint64_t>(entry + 8);
+        const uint64_t blocksX = (std::max(pixelWidth >> level, 1u) + blockExtent[0] - 1) / blockExtent[0];
+        const uint64_t blocksY = (std::max(pixelHeight >> level, 1u) + blockExtent[1] - 1) / blockExtent[1];
+        if (data.size != blocksX * blocksY * bytesPerBlock) {
+            throw std::runtime_error(path + " has a level " + std::to_string(level) + " of unexpected size");
+        }
+        if (data.offset > file.size() || data.size > file.size() - data.offset) {
+            throw std::runtime_error(path + " is truncated");
+        }
+        levels.push_back(data);
+        if (pixelWidth >> level <= 1 && pixelHeight >> level <= 1) {
+            break; // more levels than a full chain, ignore the rest
+        }
+    }
+}
+
+bool Ktx2File::isSrgb() const {
+    if (format == FORMAT_R8G8B8A8_SRGB) {
+        return true;
+    }
+    if (format >= FORMAT_BC1_RGB_UNORM && format <= FORMAT_BC7_SRGB) {
+        // BC1 to BC3 and BC7 have sRGB variants, the pairs of BC4 to BC6H are signed and unsigned
+        return format == FORMAT_BC1_RGB_UNORM + 1 || format == FORMAT_BC1_RGBA_SRGB || format == FORMAT_BC3_UNORM - 1
+            || format == FORMAT_BC3_SRGB || format == FORMAT_BC7_SRGB;
+    }
+    if (format >= FORMAT_ETC2_R8G8B8_UNORM && format <= FORMAT_ETC2_R8G8B8A8_SRGB) {
+        return (format - FORMAT_ETC2_R8G8B8_UNORM) % 2 == 1;
+    }
+    return format >= FORMAT_ASTC_4x4_UNORM && format <= FORMAT_ASTC_12x12_SRGB && (format - FORMAT_ASTC_4x4_UNORM) % 2 == 1;
+}
+
+std::optional<BlockFormat> Ktx2File::blockFormat() const {
+    switch (format) {
+    case FORMAT_BC1_RGB_UNORM:
+    case FORMAT_BC1_RGB_UNORM + 1:
+    case FORMAT_BC1_RGB_UNORM + 2:
+    case FORMAT_BC1_RGBA_SRGB:
+        return BlockFormat::Bc1;
+    case FORMAT_BC3_UNORM:
+    case FORMAT_BC3_SRGB:
+        return BlockFormat::Bc3;
+    case FORMAT_BC4_UNORM:
+        return BlockFormat::Bc4;
+    case FORMAT_BC5_UNORM:
+        return BlockFormat::Bc5;
+    case FORMAT_ETC2_R8G8B8_UNORM:
+    case FORMAT_ETC2_R8G8B8_SRGB:
+        return BlockFormat::Etc2Rgb;
+    case FORMAT_ETC2_R8G8B8A8_UNORM:
+    case FORMAT_ETC2_R8G8B8A8_SRGB:
+        return BlockFormat::Etc2Rgba;
+    default:
+        return std::nullopt;
+    }
+}
+
+std::vector<uint8_t> Ktx2File::decodeToRgba8(JobSystem& jobs) const {
+    const auto decoder = blockFormat();
+    if (!decoder) {
+        throw std::runtime_error("no CPU decoder for VkFormat " + std::to_string(format));
+    }
+    size_t total = 0;
+    for (uint32_t level = 0; level < levelCount(); level++) {
+        total += size_t(std::max(pixelWidth >> level, 1u)) * std::max(pixelHeight >> level, 1u) * 4;
+    }
+    std::vector<uint8_t> rgba(total);
+    size_t offset = 0;
+    for (uint32_t level = 0; level < levelCount(); level++) {
+        const uint32_t width = std::max(pixelWidth >> level, 1u);
+        const uint32_t height = std::max(pixelHeight >> level, 1u);
+        decodeImage(*decoder, levelData(level), width, height, rgba.data() + offset, jobs);
+        offset += size_t(width) * height * 4;
+    }
+    return rgba;
+}
+
+void Ktx2File::prefetch() const {
+    for (const auto& level : levels) {
+        file.willNeed(level.offset, level.size);
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "mapped-file.h"
+#include "texture-decoder.h"
+
+class JobSystem;
+
+// A KTX 2.0 texture mapped into memory: one 2D image with its stored mip levels, level data points into the mapping.
+// Only files without supercompression are supported (no Basis Universal or Zstandard), the GPU or decodeToRgba8()
+// consumes the blocks as they are.
+class Ktx2File {
+public:
+    explicit Ktx2File(const std::string& path); // throws on I/O errors and unsupported files
+
+    uint32_t vkFormat() const { return format; } // VkFormat value
+    uint32_t width() const { return pixelWidth; }
+    uint32_t height() const { return pixelHeight; }
+    uint32_t levelCount() const { return static_cast<uint32_t>(levels.size()); }
+    const uint8_t* levelData(uint32_t level) const { return file.data() + levels[level].offset; }
+    size_t levelSize(uint32_t level) const { return levels[level].size; }
+    uint32_t blockWidth() const { return blockExtent[0]; }
+    uint32_t blockHeight() const { return blockExtent[1]; }
+    uint32_t blockBytes() const { return bytesPerBlock; }
+    bool isSrgb() const;
+
+    // The CPU decoder for the format, if there is one
+    std::optional<BlockFormat> blockFormat() const;
+    // Every level decoded to RGBA8 (spread over the job threads), for devices without the format. Level data lies
+    // back to back in the returned buffer, level 0 first.
+    std::vector<uint8_t> decodeToRgba8(JobSystem& jobs) const;
+
+    // Starts reading the pages ahead of the upload
+    void prefetch() const;
+
+private:
+    struct Level {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+    };
+
+    MappedFile file;
+    uint32_t format = 0;
+    uint32_t pixelWidth = 0;
+    uint32_t pixelHeight = 0;
+    uint32_t blockExtent[2] = {1, 1};
+    uint32_t bytesPerBlock = 0;
+    std::vector<Level> levels;
+};
@@ -0,0 +1,154 @@
+#include "layout-cache.h"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+static void hashCombine(size_t& seed, size_t value) {
+    seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+static bool sameBinding(const vk::DescriptorSetLayoutBinding& a, const vk::DescriptorSetLayoutBinding& b) {
+    return a.binding == b.binding && a.descriptorType == b.descriptorType && a.descriptorCount == b.descriptorCount &&
+           a.stageFlags == b.stageFlags;
+}
+
+static bool samePushConstants(const vk::PushConstantRange& a, const vk::PushConstantRange& b) {
+    return a.stageFlags == b.stageFlags && a.offset == b.offset && a.size == b.size;
+}
+
+LayoutCache::LayoutCache(vk::Device device) : device(device) {}
+
+LayoutCache::~LayoutCache() {
+    for (auto& bucket : pipelineLayouts) {
+        for (auto& entry : bucket.second) {
+            device.destroyPipelineLayout(entry.layout);
+        }
+    }
+    for (auto& bucket : setLayouts) {
+        for (auto& entry : bucket.second) {
+            device.destroyDescriptorSetLayout(entry.layout);
+        }
+    }
+}
+
+std::vector<vk::DescriptorSetLayoutBinding> LayoutCache::mergeBindings(const std::vector<const ShaderReflection*>& stages, uint32_t set) const {
+    std::vector<vk::DescriptorSetLayoutBinding> bindings;
+    for (const ShaderReflection* stage : stages) {
+        for (const auto& binding : stage->bindings) {
+            if (binding.set != set) {
+                continue;
+            }
+            auto it = std::find_if(bindings.begin(), bindings.end(),
+                                   [&](const vk::DescriptorSetLayoutBinding& merged) { return merged.binding == binding.binding; });
+            if (it == bindings.end()) {
+                bindings.push_back(vk::DescriptorSetLayoutBinding(binding.binding, binding.type, binding.count, stage->stage));
+            } else if (it->descriptorType != binding.type || it->descriptorCount != binding.count) {
+                throw std::runtime_error("shader stages disagree about set " + std::to_string(set) + ", binding " +
+                                         std::to_string(binding.binding));
+            } else {
+                it->stageFlags |= stage->stage;
+            }
+        }
+    }
+    return bindings;
+}
+
+LayoutCache::PipelineLayout LayoutCache::pipelineLayout(const std::vector<const ShaderReflection*>& stages) {
+    PipelineLayout result;
+    uint32_t setCount = 0;
+    for (const ShaderReflection* stage : stages) {
+        for (const auto& binding : stage->bindings) {
+            setCount = std::max(setCount, binding.set + 1);
+        }
+        if (stage->pushConstantSize > 0) {
+            result.pushConstants.stageFlags |= stage->stage;
+            result.pushConstants.size = std::max(result.pushConstants.size, stage->pushConstantSize);
+        }
+    }
+    for (uint32_t set = 0; set < setCount; set++) {
+        result.setLayouts.push_back(descriptorSetLayout(mergeBindings(stages, set)));
+    }
+    result.layout = pipelineLayout(result.setLayouts, result.pushConstants);
+    return result;
+}
+
+vk::DescriptorSetLayout LayoutCache::descriptorSetLayout(const std::vector<const ShaderReflection*>& stages, uint32_t set) {
+    return descriptorSetLayout(mergeBindings(stages, set));
+}
+
+vk::DescriptorSetLayout LayoutCache::descriptorSetLayout(const std::vector<vk::DescriptorSetLayoutBinding>& unsorted) {
+    std::vector<vk::DescriptorSetLayoutBinding> bindings = unsorted;
+    std::sort(bindings.begin(), bindings.end(),
+              [](const vk::DescriptorSetLayoutBinding& a, const vk::DescriptorSetLayoutBinding& b) { return a.binding < b.binding; });
+    size_t hash = bindings.size();
+    for (const auto& binding : bindings) {
+        hashCombine(hash, binding.binding);
+        hashCombine(hash, static_cast<size_t>(binding.descriptorType));
+        hashCombine(hash, binding.descriptorCount);
+        hashCombine(hash, static_cast<VkShaderStageFlags>(binding.stageFlags));
+    }
+    stats.requests++;
+    auto& bucket = setLayouts[hash];
+    for (const auto& entry : bucket) {
+        if (std::equal(entry.bindings.begin(), entry.bindings.end(), bindings.begin(), bindings.end(), sameBinding)) {
+            stats.reused++;
+            return entry.layout;
+        }
+    }
+    vk::DescriptorSetLayoutCreateInfo layoutInfo({}, static_cast<uint32_t>(bindings.size()), bindings.data());
+    bucket.push_back({bindings, device.createDescriptorSetLayout(layoutInfo)});
+    stats.setLayouts++;
+    return bucket.back().layout;
+}
+
+vk::PipelineLayout LayoutCache::pipelineLayout(const std::vector<vk::DescriptorSetLayout>& setLayoutHandles,
+                                               const vk::PushConstantRange& pushConstants) {
+    size_t hash = setLayoutHandles.size();
+    for (const auto& setLayout : setLayoutHandles) {
+        hashCombine(hash, std::hash<VkDescriptorSetLayout>()(static_cast<VkDescriptorSetLayout>(setLayout)));
+    }
+    hashCombine(hash, static_cast<VkShaderStageFlags>(pushConstants.stageFlags));
+    hashCombine(hash, pushConstants.size);
+    stats.requests++;
+    auto& bucket = pipelineLayouts[hash];
+    for (const auto& entry : bucket) {
+        // Set layouts are deduplicated, comparing handles compares contents
+        if (entry.setLayouts == setLayoutHandles && samePushConstants(entry.pushConstants, pushConstants)) {
+            stats.reused++;
+            return entry.layout;
+        }
+    }
+    vk::PipelineLayoutCreateInfo layoutInfo({}, static_cast<uint32_t>(setLayoutHandles.size()), setLayoutHandles.data(),
+                                            pushConstants.size > 0 ? 1 : 0, &pushConstants);
+    bucket.push_back({setLayoutHandles, pushConstants, device.createPipelineLayout(layoutInfo)});
+    stats.pipelineLayouts++;
+    return bucket.back().layout;
+}
+
+VertexInput::VertexInput(const ShaderReflection& vertexShader, uint32_t stride,
+                         const std::vector<vk::VertexInputAttributeDescription>& formats, vk::VertexInputRate inputRate) {
+    uint32_t packedEnd = 0;
+    for (const auto& input : vertexShader.inputs) {
+        auto it = std::find_if(formats.begin(), formats.end(),
+                               [&](const vk::VertexInputAttributeDescription& format) { return format.location == input.location; });
+        if (it != formats.end()) {
+            attributes.push_back(vk::VertexInputAttributeDescription(input.location, 0, it->format, it->offset));
+            continue;
+        }
+        if (!formats.empty() || input.format == vk::Format::eUndefined) {
+            throw std::runtime_error("vertex input at location " + std::to_string(input.location) + " needs an explicit format");
+        }
+        attributes.push_back(vk::VertexInputAttributeDescription(input.location, 0, input.format, packedEnd));
+        packedEnd += input.componentCount * 4;
+    }
+    if (!attributes.empty()) {
+        bindings.push_back(vk::VertexInputBindingDescription(0, stride > 0 ? stride : packedEnd, inputRate));
+    }
+}
+
+vk::PipelineVertexInputStateCreateInfo VertexInput::info() const {
+    return vk::PipelineVertexInputStateCreateInfo({}, static_cast<uint32_t>(bindings.size()), bindings.data(),
+                                                  static_cast<uint32_t>(attributes.size()), attributes.data());
+}
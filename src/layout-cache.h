@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "spirv-reflection.h"
+#include "vulkan-common.h"
+
+// Descriptor set and pipeline layouts generated from shader reflection and deduplicated by content. Pipelines whose
+// shaders declare the same sets get the same handles, so sets bound for one of them stay valid when the next
+// one is bound. Layouts live as long as the cache, which lives as long as the device. Not thread safe.
+class LayoutCache {
+public:
+    struct PipelineLayout {
+        vk::PipelineLayout layout;
+        std::vector<vk::DescriptorSetLayout> setLayouts; // indexed by set number, unused numbers get empty layouts
+        vk::PushConstantRange pushConstants;             // size 0 without push constants
+    };
+
+    explicit LayoutCache(vk::Device device);
+    ~LayoutCache(); // pipelines and descriptor sets created with the layouts must be gone
+    LayoutCache(const LayoutCache&) = delete;
+    LayoutCache& operator=(const LayoutCache&) = delete;
+
+    // The layout of a pipeline made of these stages. Bindings are merged per set and binding, their stage flags
+    // combined. The push constant range covers the largest block, for the stages that declare one.
+    PipelineLayout pipelineLayout(const std::vector<const ShaderReflection*>& stages);
+    // Set `set` of that pipeline layout, for allocating descriptor sets before the pipeline exists
+    vk::DescriptorSetLayout descriptorSetLayout(const std::vector<const ShaderReflection*>& stages, uint32_t set);
+
+    vk::DescriptorSetLayout descriptorSetLayout(const std::vector<vk::DescriptorSetLayoutBinding>& bindings);
+    vk::PipelineLayout pipelineLayout(const std::vector<vk::DescriptorSetLayout>& setLayouts, const vk::PushConstantRange& pushConstants);
+
+    struct Statistics {
+        size_t setLayouts = 0;      // distinct layouts created
+        size_t pipelineLayouts = 0;
+        uint64_t requests = 0;      // layouts asked for, including the ones a pipeline layout is made of
+        uint64_t reused = 0;        // of those, answered with an existing layout
+    };
+    Statistics statistics() const { return stats; }
+
+private:
+    struct SetLayoutEntry {
+        std::vector<vk::DescriptorSetLayoutBinding> bindings; // ordered by binding
+        vk::DescriptorSetLayout layout;
+    };
+    struct PipelineLayoutEntry {
+        std::vector<vk::DescriptorSetLayout> setLayouts;
+        vk::PushConstantRange pushConstants;
+        vk::PipelineLayout layout;
+    };
+
+    std::vector<vk::DescriptorSetLayoutBinding> mergeBindings(const std::vector<const ShaderReflection*>& stages, uint32_t set) const;
+
+    vk::Device device;
+    // Hash -> entries with that hash, compared in full
+    std::unordered_map<size_t, std::vector<SetLayoutEntry>> setLayouts;
+    std::unordered_map<size_t, std::vector<PipelineLayoutEntry>> pipelineLayouts;
+    Statistics stats;
+};
+
+// Vertex input state for a vertex shader: one interleaved binding with an attribute per shader input.
+// `attributes` gives the memory format and offset of every input when the vertices aren't stored in the shader
+// types (e.g. quantized); attributes the shader doesn't read are dropped. Without them, the inputs are tightly
+// packed in the formats of their shader types, by location. eInstance input rate: one element per instance.
+struct VertexInput {
+    VertexInput(const ShaderReflection& vertexShader, uint32_t stride = 0,
+                const std::vector<vk::VertexInputAttributeDescription>& attributes = {},
+                vk::VertexInputRate inputRate = vk::VertexInputRate::eVertex);
+
+    vk::PipelineVertexInputStateCreateInfo info() const; // points into this object
+
+    std::vector<vk::VertexInputBindingDescription> bindings; // empty without inputs
+    std::vector<vk::VertexInputAttributeDescription> attributes;
+};
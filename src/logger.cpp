@@ -0,0 +1,249 @@
+#include "logger.h"
+
+#include <algorithm>
+#include <iterator>
+#ifdef __ANDROID__
+#include <android/log.h>
+#endif
+
+// How long the writer sleeps when nothing urgent was logged; everything logged meanwhile is written as one batch
+static constexpr std::chrono::milliseconds k_writeInterval{5};
+
+Logger::Logger() : thread(&Logger::run, this) {}
+
+Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+Logger& logger() {
+    static Logger instance;
+    return instance;
+}
+
+Logger::ThreadRing& Logger::threadRing() {
+    // Marks the ring retired when its thread exits, the writer frees it once it has written what's left in it
+    struct Owner {
+        std::shared_ptr<ThreadRing> ring;
+        ~Owner() {
+            if (ring) {
+                ring->retired.store(true, std::memory_order_release);
+            }
+        }
+    };
+    thread_local Owner owner;
+    if (!owner.ring) {
+        owner.ring = std::make_shared<ThreadRing>();
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        rings.push_back(owner.ring);
+    }
+    return *owner.ring;
+}
+
+void Logger::beginRecord(Record& record, LogLevel level) {
+    record.sequence = nextSequence.fetch_add(1, std::memory_order_relaxed);
+    record.level = level;
+    record.last = false;
+    record.length = 0;
+}
+
+void Logger::pushRecord(const Record& record) {
+    ThreadRing& ring = threadRing();
+    const auto dropping = std::find(ring.dropping.begin(), ring.dropping.end(), record.sequence);
+    if (dropping != ring.dropping.end()) {
+        if (record.last) {
+            ring.dropping.erase(dropping);
+        }
+        return;
+    }
+    if (!ring.records.tryPush(record)) {
+        // The console can't keep up. Waiting for the writer would stall this thread for as long as the console does.
+        droppedMessages.fetch_add(1, std::memory_order_relaxed);
+        if (!record.last) {
+            ring.dropping.push_back(record.sequence);
+        }
+        {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            ring.cutShort.push_back(record.sequence);
+        }
+        wake.notify_one();
+        return;
+    }
+    if (record.last && record.level >= LogLevel::Error) {
+        wake.notify_one(); // errors may precede a crash, don't leave them in the ring
+    }
+}
+
+bool Logger::admit(uint64_t key, uint32_t& suppressed) {
+    const int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    RateLimitSlot& slot = rateLimits[((key * 0x9e3779b97f4a7c15ull) >> 32) & (k_rateLimitSlots - 1)];
+    // Racing threads may both start a new window, that only lets a few more messages through
+    int64_t windowStart = slot.windowStart.load(std::memory_order_relaxed);
+    if (now - windowStart >= k_rateLimitWindow.count() &&
+        slot.windowStart.compare_exchange_strong(windowStart, now, std::memory_order_relaxed)) {
+        slot.count.store(0, std::memory_order_relaxed);
+    }
+    if (slot.count.fetch_add(1, std::memory_order_relaxed) < k_rateLimitBurst) {
+        suppressed = slot.suppressed.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+    slot.suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void Logger::redirectToStderr() {
+    stdoutRedirected.store(true, std::memory_order_relaxed);
+    // A batch the writer is in the middle of may have read the flag before the store, it's done once the flush is
+    flush();
+}
+
+void Logger::flush() {
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    const uint64_t request = ++flushRequests;
+    wake.notify_one();
+    flushed.wait(lock, [&]() { return flushesDone >= request; });
+}
+
+void Logger::run() {
+    std::vector<Message> messages;
+    for (;;) {
+        uint64_t requests;
+        bool stop;
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            requests = flushRequests;
+            stop = stopping;
+        }
+        // Everything pushed before the request was read is in the rings now
+        drain(messages);
+        write(messages);
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            flushesDone = requests;
+        }
+        flushed.notify_all();
+        if (stop) {
+            break;
+        }
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        if (!stopping && flushRequests == requests) {
+            wake.wait_for(lock, k_writeInterval);
+        }
+    }
+}
+
+void Logger::drain(std::vector<Message>& messages) {
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    Record record;
+    for (auto& ring : rings) {
+        while (ring->records.tryPop(record)) {
+            // A message logged while another one was formatted completes first, the innermost one is at the back
+            auto message = std::find_if(ring->pending.rbegin(), ring->pending.rend(),
+                                        [&](const Message& pending) { return pending.sequence == record.sequence; });
+            if (message == ring->pending.rend()) {
+                ring->pending.push_back({record.sequence, record.level, {}});
+                message = ring->pending.rbegin();
+            }
+            message->text.append(record.text, record.length);
+            if (record.last) {
+                messages.push_back(std::move(*message));
+                ring->pending.erase(std::next(message).base());
+            }
+        }
+        // The records pushed before the ring filled up are all popped by now, the rest of the message won't come
+        for (uint64_t sequence : ring->cutShort) {
+            auto message = std::find_if(ring->pending.begin(), ring->pending.end(),
+                                        [&](const Message& pending) { return pending.sequence == sequence; });
+            if (message != ring->pending.end()) {
+                message->text += " [cut short]";
+                messages.push_back(std::move(*message));
+                ring->pending.erase(message);
+            }
+        }
+        ring->cutShort.clear();
+    }
+    const uint64_t dropped = droppedMessages.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) {
+        messages.push_back({nextSequence.fetch_add(1, std::memory_order_relaxed), LogLevel::Warning,
+                            std::to_string(dropped) + " log messages dropped, the console couldn't keep up"});
+    }
+    // Retired first: a ring seen empty after that has nothing more coming
+    rings.erase(std::remove_if(rings.begin(), rings.end(),
+                               [](const std::shared_ptr<ThreadRing>& ring) {
+                                   return ring->retired.load(std::memory_order_acquire) && ring->records.empty() &&
+                                          ring->pending.empty();
+                               }),
+                rings.end());
+}
+
+void Logger::write(std::vector<Message>& messages) {
+    if (messages.empty()) {
+        return;
+    }
+    std::sort(messages.begin(), messages.end(), [](const Message& a, const Message& b) { return a.sequence < b.sequence; });
+#ifdef __ANDROID__
+    for (const Message& message : messages) {
+        static const int priorities[] = {ANDROID_LOG_VERBOSE, ANDROID_LOG_INFO, ANDROID_LOG_WARN, ANDROID_LOG_ERROR};
+        __android_log_write(priorities[static_cast<int>(message.level)], "Naru", message.text.c_str());
+    }
+#else
+    const bool redirected = stdoutRedirected.load(std::memory_order_relaxed);
+    std::string out;
+    std::string err;
+    for (const Message& message : messages) {
+        std::string& text = (redirected || message.level >= LogLevel::Warning) ? err : out;
+        text += message.text;
+        text += '\n';
+    }
+    if (!out.empty()) {
+        std::fwrite(out.data(), 1, out.size(), stdout);
+        std::fflush(stdout);
+    }
+    if (!err.empty()) {
+        std::fwrite(err.data(), 1, err.size(), stderr);
+    }
+#endif
+    messages.clear();
+}
+
+LogMessage::Buffer::Buffer(LogLevel level) {
+    logger().beginRecord(record, level);
+    setp(record.text, record.text + Logger::k_recordText);
+}
+
+LogMessage::Buffer::int_type LogMessage::Buffer::overflow(int_type c) {
+    if (traits_type::eq_int_type(c, traits_type::eof())) {
+        return traits_type::not_eof(c);
+    }
+    pushFull();
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+    return c;
+}
+
+void LogMessage::Buffer::pushFull() {
+    record.length = static_cast<uint16_t>(pptr() - pbase());
+    logger().pushRecord(record);
+    // The record was copied into the ring, the same storage takes the message's next part
+    record.length = 0;
+    setp(record.text, record.text + Logger::k_recordText);
+}
+
+void LogMessage::Buffer::finish() {
+    record.length = static_cast<uint16_t>(pptr() - pbase());
+    record.last = true;
+    logger().pushRecord(record);
+}
+
+LogMessage::LogMessage(LogLevel level, uint32_t suppressed) : buffer(level), out(&buffer), suppressed(suppressed) {}
+
+LogMessage::~LogMessage() {
+    if (suppressed > 0) {
+        out << " (" << suppressed << " similar messages suppressed)";
+    }
+    buffer.finish();
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spsc-queue.h"
+
+enum class LogLevel : uint8_t {
+    Verbose, // validation layer chatter, enumerations
+    Info,    // what LOG prints
+    Warning,
+    Error
+};
+
+// Asynchronous console output. Messages are formatted on the calling thread into fixed-size records pushed into that
+// thread's ring (SpscQueue, no lock and no allocation once the thread's ring exists) and written by a
+// background thread in batches: one write and one flush per stream per wake-up, instead of an std::endl flush per
+// line on the render thread. Messages below the level are dropped before they are formatted. A full ring never
+// blocks its thread: the message is dropped, and the writer reports how many were ("N log messages dropped"). The rate
+// limit (admit) is what keeps hot paths from filling it. Verbose and Info go to stdout, Warning and Error to stderr
+// (Android: logcat).
+class Logger {
+public:
+    static constexpr size_t k_recordText = 240;    // text bytes per record, longer messages span several
+    static constexpr size_t k_threadRecords = 256; // ring size of each logging thread
+    static constexpr uint32_t k_rateLimitBurst = 5; // messages per key and window that admit() lets through
+    static constexpr std::chrono::milliseconds k_rateLimitWindow{1000};
+
+    struct Record {
+        uint64_t sequence = 0; // orders the messages of a batch, the same in all records of a message
+        LogLevel level = LogLevel::Info;
+        bool last = true;      // false: the message continues in the next record of the same thread
+        uint16_t length = 0;
+        char text[k_recordText];
+    };
+
+    Logger();
+    ~Logger(); // writes everything still queued
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    void setLevel(LogLevel level) { minimumLevel.store(level, std::memory_order_relaxed); }
+    LogLevel level() const { return minimumLevel.load(std::memory_order_relaxed); }
+    bool enabled(LogLevel level) const { return level >= minimumLevel.load(std::memory_order_relaxed); }
+
+    // Everything goes to stderr from now on, e.g. while stdout carries a video stream. Returns once the writer is done
+    // with stdout: what was logged before is written, nothing after lands there.
+    void redirectToStderr();
+
+    // Rate limit of a message source (a call site, a validation message id): at most k_rateLimitBurst messages per
+    // k_rateLimitWindow. Keys share one of k_rateLimitSlots counters by hash, a collision only makes two sources
+    // share a budget. `suppressed` is the number of messages of the slot dropped since the last one let through.
+    bool admit(uint64_t key, uint32_t& suppressed);
+
+    // Blocks until everything logged before the call is written
+    void flush();
+
+    // Used by LogMessage
+    void beginRecord(Record& record, LogLevel level); // fills in sequence and level
+    void pushRecord(const Record& record);            // record.last says whether the message ends here
+
+private:
+    static constexpr size_t k_rateLimitSlots = 64;
+
+    struct Message {
+        uint64_t sequence;
+        LogLevel level;
+        std::string text;
+    };
+    struct ThreadRing {
+        SpscQueue<Record, k_threadRecords> records;
+        std::atomic<bool> retired{false}; // the thread exited, freed by the writer once drained
+        // Writer only: messages whose last record hasn't arrived yet. Usually none or one, more when a message's
+        // streamed expression logs itself after the message already pushed a full record.
+        std::vector<Message> pending;
+        // This ring's thread only: messages a record of which didn't fit, their remaining records are dropped as well
+        std::vector<uint64_t> dropping;
+        // Guarded by ringsMutex: the same messages, for the writer to end the ones whose first records were pushed
+        std::vector<uint64_t> cutShort;
+    };
+    struct RateLimitSlot {
+        std::atomic<int64_t> windowStart{0}; // milliseconds since the logger started
+        std::atomic<uint32_t> count{0};
+        std::atomic<uint32_t> suppressed{0};
+    };
+
+    ThreadRing& threadRing();
+    void run();
+    void drain(std::vector<Message>& messages);
+    void write(std::vector<Message>& messages);
+
+    std::atomic<LogLevel> minimumLevel{LogLevel::Info};
+    std::atomic<bool> stdoutRedirected{false};
+    std::atomic<uint64_t> nextSequence{0};
+    std::atomic<uint64_t> droppedMessages{0}; // since the writer last reported them
+    std::array<RateLimitSlot, k_rateLimitSlots> rateLimits;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    std::mutex ringsMutex; // only taken when a thread logs for the first time, when a ring is full and by the writer
+    std::vector<std::shared_ptr<ThreadRing>> rings;
+
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    std::condition_variable flushed;
+    uint64_t flushRequests = 0; // guarded by wakeMutex
+    uint64_t flushesDone = 0;
+    bool stopping = false;
+    std::thread thread;
+};
+
+Logger& logger();
+
+// One message: formats into its own record through its stream, which is pushed into the thread's ring whenever full
+// and when the message is destroyed. A message logging another one while it is formatted is fine.
+class LogMessage {
+public:
+    LogMessage(LogLevel level, uint32_t suppressed = 0);
+    ~LogMessage();
+    LogMessage(const LogMessage&) = delete;
+    LogMessage& operator=(const LogMessage&) = delete;
+
+    std::ostream& stream() { return out; }
+
+private:
+    class Buffer : public std::streambuf {
+    public:
+        explicit Buffer(LogLevel level);
+        void finish();
+
+    protected:
+        int_type overflow(int_type c) override;
+
+    private:
+        void pushFull();
+        Logger::Record record;
+    };
+
+    Buffer buffer;
+    std::ostream out;
+    uint32_t suppressed;
+};
+
+inline uint64_t logSiteKey(const char* file, int line) {
+    return reinterpret_cast<uintptr_t>(file) * 31 + static_cast<uint64_t>(line);
+}
+
+#define LOG_AT(level, x)                                  \
+    do {                                                  \
+        if (logger().enabled(level)) {                    \
+            LogMessage logMessage_(level);                \
+            logMessage_.stream() << x;                    \
+        }                                                 \
+    } while (0)
+
+// At most Logger::k_rateLimitBurst messages per second from this line, for messages that can repeat every frame
+#define LOG_LIMITED(level, x)                                                                       \
+    do {                                                                                            \
+        uint32_t logSuppressed_ = 0;                                                                \
+        if (logger().enabled(level) && logger().admit(logSiteKey(__FILE__, __LINE__), logSuppressed_)) { \
+            LogMessage logMessage_(level, logSuppressed_);                                          \
+            logMessage_.stream() << x;                                                              \
+        }                                                                                           \
+    } while (0)
+
+#define LOG(x) LOG_AT(LogLevel::Info, x)
+#define LOG_VERBOSE(x) LOG_AT(LogLevel::Verbose, x)
+#define LOG_WARNING(x) LOG_AT(LogLevel::Warning, x)
+#define LOG_ERROR(x) LOG_AT(LogLevel::Error, x)
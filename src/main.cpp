@@ -1,26 +1,56 @@
-#define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
-#define NOMINMAX
 #ifdef __ANDROID__
 #include <android/asset_manager.h>
 #include <jni.h>
 #include <android/asset_manager_jni.h>
-#include "vulkan-wrapper-patch.h"
-#include <vulkan_wrapper.h>
-#undef VK_NO_PROTOTYPES
 #endif
-#include <vulkan/vulkan.hpp>
+#include "vulkan-common.h"
 #include "SDL.h"
 #include <SDL_vulkan.h>
 
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <stdexcept>
 #include <functional>
 #include <cstdlib>
 #include <optional>
+#include <map>
 #include <set>
 #include <cstdint>
 #include <fstream>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <string_view>
+#include <initializer_list>
+#include "spsc-queue.h"
+#include "app-config.h"
+#include "frame-pacer.h"
+#include "resolution-scaler.h"
+#include "frame-capture.h"
+#include "video-recorder.h"
+#include "frame-statistics.h"
+#include "stats-report.h"
+#include "instrumented-dispatch.h"
+#include "transform-math.h"
+#include "mesh-file.h"
+#include "staging-ring.h"
+#include "image-file.h"
+#include "ktx2-file.h"
+#include "texture-streamer.h"
+#include "pipeline-variants.h"
+#include "spirv-reflection.h"
+#include "layout-cache.h"
+#include "push-constants.h"
+#include "gpu-counters.h"
+#include "logger.h"
+#include "job-system.h"
+#include "scene-graph.h"
+#include "sprite-batcher.h"
 #ifdef _WIN32
 #include <Windows.h>
 #include <mutex>
@@ -37,8 +67,27 @@ VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
 static constexpr int k_width = 800;
 static constexpr int k_height = 600;
 const int MAX_FRAMES_IN_FLIGHT = 2;
-
-#define LOG(x) std::cout << x << std::endl;
+const size_t FRAME_STATE_QUEUE_SIZE = 64;
+// Readback buffers for frame captures, a capture holds one from recording until the worker encoded it
+const size_t CAPTURE_RING_SIZE = 3;
+// Converted video frames waiting for the writer; when all are busy a frame is dropped instead of waiting
+const size_t RECORDING_RING_SIZE = 4;
+// With AppConfig::scaleDuringResize, the swapchain is only rebuilt once no size change arrived for this long
+const Uint32 RESIZE_SETTLE_MS = 150;
+// Host-visible ring mesh data is streamed through on its way into device-local buffers
+const vk::DeviceSize STAGING_RING_SIZE = 16 * 1024 * 1024;
+// Orbit camera of --mesh: distance from the center in bounding sphere radii, vertical field of view in radians
+const float MESH_CAMERA_DISTANCE = 2.5f;
+const float MESH_CAMERA_FOV = 0.8f;
+// Specialization constant ids (constant_id in the shaders), shared by the stages of a pipeline
+const uint32_t SPEC_TEXTURED = 0;            // mesh.frag
+const uint32_t SPEC_MESHLET_CULLING = 1;     // meshlet-common.glsl
+const uint32_t SPEC_CULL_WORKGROUP_SIZE = 2; // meshlet-cull.comp
+const uint32_t SPEC_YUV_NV12 = 3;            // rgb-to-yuv.comp
+const uint32_t SPEC_YUV_SRGB_SOURCE = 4;     // rgb-to-yuv.comp
+const uint32_t SPEC_DRAW_DATA_PATH = 5;      // draw-data.vert
+const uint32_t SPEC_PARTICLE_WORKGROUP_SIZE = 6; // particle-simulation.comp
+const uint32_t SPEC_POST_EFFECT = 7;         // post-process.frag
 
 #ifdef DEBUG
 const std::vector<const char*> validationLayers = {
@@ -51,8 +100,22 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
     const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
     void* pUserData) {
 
-    std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
-
+    LogLevel level = LogLevel::Verbose;
+    if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) {
+        level = LogLevel::Error;
+    } else if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT) {
+        level = LogLevel::Warning;
+    }
+    // A broken call in the frame loop reports the same message every frame, limit each message id
+    uint64_t key = static_cast<uint32_t>(pCallbackData->messageIdNumber);
+    if (key == 0 && pCallbackData->pMessageIdName) {
+        key = std::hash<std::string_view>()(pCallbackData->pMessageIdName);
+    }
+    uint32_t suppressed = 0;
+    if (logger().enabled(level) && logger().admit(key, suppressed)) {
+        LogMessage message(level, suppressed);
+        message.stream() << "validation layer: " << pCallbackData->pMessage;
+    }
     return VK_FALSE;
 }
 #endif
@@ -61,20 +124,193 @@ const std::vector<const char*> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+#ifdef NARU_MESH_SHADER_SUPPORT
+const std::vector<const char*> meshShaderExtensions = {
+    VK_EXT_MESH_SHADER_EXTENSION_NAME,
+    VK_KHR_SPIRV_1_4_EXTENSION_NAME,
+    VK_KHR_SHADER_FLOAT_CONTROLS_EXTENSION_NAME
+};
+#endif
+
+// Persistently mapped host-visible buffer: a readback buffer the GPU writes (captures, query results), or an upload
+// buffer the CPU writes every frame (uniforms, instance data)
+struct MappedBuffer {
+    vk::Buffer buffer;
+    vk::DeviceMemory memory;
+    void* mapped = nullptr;
+    vk::DeviceSize size = 0;
+};
+
+// One buffer of the frame capture readback ring
+struct CaptureSlot {
+    MappedBuffer readback;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::atomic<bool> available{true}; // cleared while the slot is in use, set again by the encoder thread
+    bool inFlight = false;             // copy recorded, its frame's fence has not been seen signaled yet
+    size_t frame = 0;                  // frame in flight slot the copy was recorded in
+    uint64_t frameNumber = 0;
+};
+
+// One buffer of the video recording ring, the conversion shader writes the YUV planes straight into it
+struct RecordingSlot {
+    MappedBuffer readback;
+    vk::DescriptorSet descriptorSet;
+    std::atomic<bool> available{true}; // cleared while the slot is in use, set again by the writer thread
+    bool inFlight = false;
+    size_t frame = 0;
+};
+
+// An additional window showing the scene. It shares the device, command buffers and pipelines with the main window,
+// is recorded into the same command buffer and presented in the same presentKHR call.
+struct WindowTarget {
+    SDL_Window* window = nullptr;
+    Uint32 id = 0;
+    vk::SurfaceKHR surface;
+    vk::SwapchainKHR swapchain; // null while the window has no area
+    vk::Extent2D extent;
+    std::vector<vk::Image> images;
+    std::vector<vk::ImageView> imageViews;
+    std::vector<vk::Framebuffer> framebuffers;
+    vk::Image depthImage; // only with a depth buffer (--mesh)
+    vk::DeviceMemory depthImageMemory;
+    vk::ImageView depthImageView;
+    std::vector<vk::Fence> imagesInFlight;
+    std::vector<vk::Semaphore> imageAvailableSemaphores; // one per frame in flight
+    // Render thread only
+    bool resized = false;
+    bool minimized = false;
+    bool acquired = false; // an image was acquired for the frame being recorded
+    uint32_t imageIndex = 0;
+};
+
+// Push constants of mesh.vert and meshlet.mesh
+struct MeshPushConstants {
+    Mat4 mvp;                 // includes the dequantization of the unorm16 positions
+    float lightDirection[4];  // towards the light, object space
+};
+
+// Per-draw data of draw-data.vert (--draws), the same struct on all three paths
+struct ObjectData {
+    Mat4 transform; // quad corners to clip space
+    uint32_t objectId;
+};
+// Size of the GLSL struct in a buffer (std140 and std430 alike): it is aligned to its mat4, so rounded up to 16 bytes
+const vk::DeviceSize OBJECT_DATA_STRIDE = 80;
+// Objects whose data one job writes: big enough that scheduling is noise, small enough to spread 100k objects
+const uint32_t DRAW_DATA_JOB_SIZE = 4096;
+// --scene: children per node, their distance from the parent's center and their size, in the parent's space
+const uint32_t SCENE_FANOUT = 8;
+const float SCENE_CHILD_DISTANCE = 1.6f;
+const float SCENE_CHILD_SCALE = 0.38f;
+
+// Push constants of particle-simulation.comp
+struct ParticleSimulationParameters {
+    float deltaTime;
+    float time;
+    uint32_t count;
+};
+// Particle state in the storage buffers: position and velocity, a vec4 each
+const vk::DeviceSize PARTICLE_STRIDE = 32;
+// Fixed simulation step, so runs are comparable whatever the frame rate
+const float PARTICLE_TIME_STEP = 1.0f / 60.0f;
+// Workgroup sizes of the particle simulation the benchmark compares, those above the device limits are skipped
+const uint32_t PARTICLE_WORKGROUP_SIZES[] = {32, 64, 128, 256, 512, 1024};
+
+// Push constants of post-process.frag (--post-process)
+struct PostProcessParameters {
+    float inverseExtent[2]; // of the render area, for positions relative to it
+    float exposure;         // tonemap: scene color multiplier before the curve
+    float vignetteStrength; // vignette: darkening in the corners
+    float saturation;       // grade: 0 = grayscale, 1 = unchanged
+    float contrast;         // grade: around mid gray
+};
+// Push constants of sprite.vert (--sprites)
+struct SpriteView {
+    float pixelToClip[2]; // 2 / render area size
+};
+// Pipelines of the sprite batcher, SpriteState::pipeline
+enum class SpriteBlend : uint8_t {
+    Alpha,
+    Additive
+};
+// Sprite atlas: a texture array of SPRITE_ATLAS_LAYERS pages, each 2x2 cells of shapes
+const uint32_t SPRITE_ATLAS_SIZE = 128;
+const uint32_t SPRITE_ATLAS_LAYERS = 2;
+
+// The scene and the intermediate results of --post-process: HDR, so tonemapping has something to map. Color
+// attachment support is mandatory for it, and the images never leave tile memory on a tiler.
+const vk::Format POST_PROCESS_FORMAT = vk::Format::eR16G16B16A16Sfloat;
+
+// Orbit camera looking at the mesh, in object space (not quantized)
+struct MeshCamera {
+    Mat4 viewProjection;
+    Vec3 eye;
+    Vec3 lightDirection;
+};
+
+// Uniform block CullData of meshlet-common.glsl (std140)
+struct MeshletCullData {
+    float frustumPlanes[6][4];
+    float cameraPosition[4];
+    uint32_t meshletCount;
+};
+
+// Written by meshlet-cull.comp: the indexed indirect draw of the visible meshlets' triangles
+struct MeshletDrawCommand {
+    vk::DrawIndexedIndirectCommand command;
+    uint32_t visibleMeshlets;
+};
+
+// Snapshot of everything the render thread needs to know about the outside world.
+// The main thread fills it from SDL events and hands copies over through a lock-free queue.
+struct FrameState {
+    uint64_t sequence = 0;
+    uint32_t inputTimestamp = 0; // SDL_GetTicks() of the newest event folded into this snapshot
+    bool quit = false;
+    bool framebufferResized = false; // sticky: stays set until the render thread consumed it
+    bool deviceReset = false;        // sticky: stays set until the render thread consumed it
+    bool redraw = false;             // sticky: something visible changed (input, resize, invalidate)
+    bool captureRequested = false;   // sticky: capture the next presented frame (F12)
+    uint32_t secondaryWindowsResized = 0; // sticky: bit i is set when secondary window i changed size
+    uint32_t secondaryWindowsMinimized = 0;
+    bool minimized = false;
+    uint32_t lastResizeTimestamp = 0; // SDL_GetTicks() of the newest size change
+    uint64_t windowEventCount = 0;    // all window events seen so far, each one used to force a swapchain rebuild
+    int pointerX = 0;
+    int pointerY = 0;
+    bool pointerDown = false;
+};
+
 class HelloTriangleApplication {
 public:
+    explicit HelloTriangleApplication(const AppConfig& config) : config(config) {
+        logger().setLevel(config.logLevel);
+    }
+
     void run() {
 #ifdef DEBUG
-        std::cout << "DEBUG BUILD" << std::endl;
+        LOG("DEBUG BUILD");
 #endif
         initWindow();
         initVulkan();
         mainLoop();
         cleanup();
+        if (renderThreadError) {
+            std::rethrow_exception(renderThreadError);
+        }
+    }
+
+    // Requests a redraw in on-demand mode. Safe to call from any thread.
+    void invalidate() {
+        SDL_Event event{};
+        event.type = invalidateEventType;
+        SDL_PushEvent(&event);
     }
     struct QueueFamilyIndices {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
+        std::optional<uint32_t> transferFamily; // texture uploads, the graphics family when there is no separate one
 
         bool isComplete() {
             return graphicsFamily.has_value() && presentFamily.has_value();
@@ -99,6 +335,22 @@ public:
             }
             index++;
         }
+        // A transfer-only family (the DMA engines of discrete GPUs) uploads without taking time from the graphics
+        // queue. Texture rows are copied in arbitrary slices, so its image transfer granularity has to be one texel.
+        index = 0;
+        for (const auto& queueFamily : queueFamilies) {
+            const auto& granularity = queueFamily.minImageTransferGranularity;
+            if ((queueFamily.queueFlags & vk::QueueFlagBits::eTransfer)
+                && !(queueFamily.queueFlags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute))
+                && granularity.width == 1 && granularity.height == 1 && granularity.depth == 1) {
+                indices.transferFamily = index;
+                break;
+            }
+            index++;
+        }
+        if (!indices.transferFamily) {
+            indices.transferFamily = indices.graphicsFamily;
+        }
         return indices;
     }
 
@@ -150,6 +402,14 @@ public:
 
     vk::PresentModeKHR chooseSwapPresentMode(const std::vector<vk::PresentModeKHR>& availablePresentModes)
     {
+        if (config.presentMode != PresentModePreference::Auto) {
+            vk::PresentModeKHR requested = toVulkanPresentMode(config.presentMode);
+            if (std::find(availablePresentModes.begin(), availablePresentModes.end(), requested) != availablePresentModes.end()) {
+                return requested;
+            }
+            LOG("Requested present mode " << vk::to_string(requested) << " is not supported, falling back to FIFO");
+            return vk::PresentModeKHR::eFifo; // the only mode every implementation has to support
+        }
         for (const auto& availablePresentMode : availablePresentModes) {
             if (availablePresentMode == vk::PresentModeKHR::eMailbox) {
                 return availablePresentMode;
@@ -158,12 +418,21 @@ public:
         return vk::PresentModeKHR::eFifo;
     }
 
-    vk::Extent2D chooseSwapExtent(const vk::SurfaceCapabilitiesKHR& capabilities) {
+    static vk::PresentModeKHR toVulkanPresentMode(PresentModePreference preference) {
+        switch (preference) {
+            case PresentModePreference::Immediate: return vk::PresentModeKHR::eImmediate;
+            case PresentModePreference::Mailbox: return vk::PresentModeKHR::eMailbox;
+            case PresentModePreference::FifoRelaxed: return vk::PresentModeKHR::eFifoRelaxed;
+            default: return vk::PresentModeKHR::eFifo;
+        }
+    }
+
+    vk::Extent2D chooseSwapExtent(const vk::SurfaceCapabilitiesKHR& capabilities, SDL_Window* sdlWindow) {
         if (capabilities.currentExtent.width != UINT32_MAX) {
             return capabilities.currentExtent;
         } else {
             int width, height;
-            SDL_GetWindowSize(window, &width, &height);
+            SDL_GetWindowSize(sdlWindow, &width, &height);
             vk::Extent2D actualExtent = {(uint32_t)width, (uint32_t)height};
             actualExtent.width = std::clamp(actualExtent.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
             actualExtent.height = std::clamp(actualExtent.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
@@ -201,13 +470,28 @@ private:
             return;
         }
 #endif
+        createJobSystem();
         createInstance();
 #ifdef DEBUG
         setupDebugMessenger();
 #endif
+        configureDynamicResolution();
+        loadMesh();
+        createScene();
         createSurface();
         pickPhysicalDevice();
+        selectMeshletMode();
+        selectQueryFeatures();
         createLogicalDevice();
+        pipelineVariants = std::make_unique<PipelineVariants>(device);
+        layoutCache = std::make_unique<LayoutCache>(device);
+        selectDepthFormat();
+        createTextureStreaming();
+        createMeshBuffers();
+        startMeshUpload();
+        createDrawDataResources();
+        createParticleResources();
+        createSpriteResources();
         createSwapChain();
         createImageViews();
         createRenderPass();
@@ -216,6 +500,64 @@ private:
         createCommandPool();
         createCommandBuffers();
         createSyncObjects();
+        createSecondaryWindowTargets();
+        createTimestampQueries();
+        createCounterQueries();
+        jobs->wait(meshUploaded);
+        uploadSpriteAtlas();
+        framePacer.setTargetFps(config.targetFps);
+        createCaptureWorker();
+        createVideoRecorder();
+    }
+
+    void createVideoRecorder() {
+        if (config.recordPath.empty()) {
+            return;
+        }
+        if (!recordingSupported) {
+            LOG("Recording disabled, the swapchain images can't be sampled");
+            return;
+        }
+        // The video size is fixed by the first swapchain, later sizes get scaled to it.
+        // 4:2:0 needs even sizes, the conversion shader works on 8x2 pixel blocks.
+        recordingExtent = vk::Extent2D(std::max(8u, swapChainExtent.width & ~7u), std::max(2u, swapChainExtent.height & ~1u));
+        const double fps = config.targetFps > 0.0 ? config.targetFps : 60.0;
+        videoRecorder = std::make_unique<VideoRecorder>(config.recordPath, config.recordFormat,
+                                                        recordingExtent.width, recordingExtent.height, fps);
+        createRecordingResources();
+    }
+
+    // Job threads for the CPU side: asset loading, per-object data. Created on the main thread, which makes it the
+    // thread JobAffinity::MainThread jobs run on; it is woken up for them with an SDL event.
+    void createJobSystem() {
+        const uint32_t workers = config.jobThreads > 0 ? config.jobThreads - 1 : JobSystem::defaultWorkerCount();
+        const Uint32 eventType = mainThreadJobsEventType;
+        jobs = std::make_unique<JobSystem>(workers, [eventType]() {
+            SDL_Event event{};
+            event.type = eventType;
+            SDL_PushEvent(&event);
+        });
+        LOG("Job threads: " << jobs->workerCount() + 1);
+    }
+
+    void createCaptureWorker() {
+        std::string directory = config.captureDirectory;
+#ifdef __ANDROID__
+        if (directory.empty()) {
+            directory = SDL_AndroidGetInternalStoragePath(); // the working directory isn't writable
+        }
+#endif
+        captureWorker = std::make_unique<CaptureWorker>(directory, config.captureFormat);
+        pendingCaptureFrames = config.captureFrames;
+        std::sort(pendingCaptureFrames.begin(), pendingCaptureFrames.end());
+    }
+
+    void configureDynamicResolution() {
+        double budgetMs = config.frameBudgetMs;
+        if (budgetMs <= 0.0) {
+            budgetMs = 1000.0 / (config.targetFps > 0.0 ? config.targetFps : 60.0);
+        }
+        resolutionScaler.configure(config.minResolutionScale, config.maxResolutionScale, budgetMs);
     }
 
     void createSurface() {
@@ -244,20 +586,22 @@ private:
             throw std::runtime_error("failed to find a suitable GPU!");
         } else {
             physicalDevice = bestScoredDevice;
-            std::cout << "GPU:" << bestScoredDevice.getProperties().deviceName << "(" << bestScore << ")" << std::endl;
+            LOG("GPU:" << bestScoredDevice.getProperties().deviceName << "(" << bestScore << ")");
         }
     }
 
     void createLogicalDevice() {
         QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
         std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
-        std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+        std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value(),
+                                                  indices.transferFamily.value()};
         float queuePriority = 1.0f;
         for (uint32_t queueFamilyIndex : uniqueQueueFamilies) {
             vk::DeviceQueueCreateInfo queueCreateInfo({}, queueFamilyIndex, 1, &queuePriority);
             queueCreateInfos.push_back(queueCreateInfo);
         }
         vk::PhysicalDeviceFeatures deviceFeatures{};
+        deviceFeatures.setPipelineStatisticsQuery(pipelineStatisticsEnabled);
 
         vk::DeviceCreateInfo createInfo{};
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
@@ -270,8 +614,27 @@ private:
         createInfo.ppEnabledLayerNames = nullptr;
 #endif
 
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        std::vector<const char*> extensions = deviceExtensions;
+#ifdef NARU_MESH_SHADER_SUPPORT
+        vk::PhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures{};
+        if (activeMeshletMode == MeshletMode::MeshShader) {
+            extensions.insert(extensions.end(), meshShaderExtensions.begin(), meshShaderExtensions.end());
+            meshShaderFeatures.setTaskShader(true)
+                .setMeshShader(true);
+            createInfo.setPNext(&meshShaderFeatures);
+        }
+#endif
+#ifdef NARU_CONDITIONAL_RENDERING_SUPPORT
+        vk::PhysicalDeviceConditionalRenderingFeaturesEXT conditionalRenderingFeatures{};
+        if (conditionalRenderingEnabled) {
+            extensions.push_back(VK_EXT_CONDITIONAL_RENDERING_EXTENSION_NAME);
+            conditionalRenderingFeatures.setConditionalRendering(true)
+                .setPNext(const_cast<void*>(createInfo.pNext));
+            createInfo.setPNext(&conditionalRenderingFeatures);
+        }
+#endif
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+        createInfo.ppEnabledExtensionNames = extensions.data();
         createInfo.pEnabledFeatures = &deviceFeatures;
 
         if (physicalDevice.createDevice(&createInfo, nullptr, &device) != vk::Result::eSuccess) {
@@ -279,14 +642,15 @@ private:
         }
         graphicsQueue = device.getQueue(indices.graphicsFamily.value(), 0);
         presentQueue = device.getQueue(indices.presentFamily.value(), 0);
+        transferQueue = device.getQueue(indices.transferFamily.value(), 0);
     }
 
-    void createSwapChain() {
+    void createSwapChain(vk::SwapchainKHR oldSwapchain = nullptr) {
         SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
 
         auto surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
         auto presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
-        auto extent = chooseSwapExtent(swapChainSupport.capabilities);
+        auto extent = chooseSwapExtent(swapChainSupport.capabilities, window);
         uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
         if (swapChainSupport.capabilities.maxImageCount > 0 && 
             imageCount > swapChainSupport.capabilities.maxImageCount) {
@@ -300,6 +664,19 @@ private:
         createInfo.imageExtent = extent;
         createInfo.imageArrayLayers = 1; // 1 unless when developing a stereoscopic 3D application
         createInfo.imageUsage = vk::ImageUsageFlagBits::eColorAttachment;
+        dynamicResolution = canUseDynamicResolution(swapChainSupport.capabilities, surfaceFormat.format);
+        if (dynamicResolution) {
+            createInfo.imageUsage |= vk::ImageUsageFlagBits::eTransferDst; // the scaled scene gets blitted into the swapchain image
+        }
+        recordingSupported = !config.recordPath.empty()
+            && (swapChainSupport.capabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eSampled);
+        if (recordingSupported) {
+            createInfo.imageUsage |= vk::ImageUsageFlagBits::eSampled; // the YUV conversion samples the presented image
+        }
+        captureSupported = canCaptureFrames(swapChainSupport.capabilities, surfaceFormat.format);
+        if (captureSupported) {
+            createInfo.imageUsage |= vk::ImageUsageFlagBits::eTransferSrc; // presented images get copied into the readback ring
+        }
         QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
         uint32_t queueFamilyIndices[] = {indices.graphicsFamily.value(), indices.presentFamily.value()};
 
@@ -315,8 +692,9 @@ private:
         createInfo.preTransform = swapChainSupport.capabilities.currentTransform;
         createInfo.compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque; // alpha channel should not be used for blending with other windows
         createInfo.presentMode = presentMode;
+        swapChainPresentMode = presentMode;
         createInfo.clipped = true;
-        createInfo.oldSwapchain = nullptr;
+        createInfo.oldSwapchain = oldSwapchain;
         swapchain = device.createSwapchainKHR(createInfo);
 
         swapChainImages = device.getSwapchainImagesKHR(swapchain);
@@ -352,15 +730,65 @@ private:
             .setStoreOp(vk::AttachmentStoreOp::eStore) // Rendered contents will be stored in memory and can be read later
             .setInitialLayout(vk::ImageLayout::eUndefined) // The caveat of this special value is that the contents of the image are not guaranteed to be preserved, but that doesn't matter since we're going to clear it anyway.
             .setFinalLayout(vk::ImageLayout::ePresentSrcKHR); //  We want the image to be ready for presentation using the swap chain after rendering
+        if (dynamicResolution) {
+            // We render into the internal scene image instead, which gets blitted (and upscaled) into the swapchain image
+            colorAttachment.setFinalLayout(vk::ImageLayout::eTransferSrcOptimal);
+        }
+        const uint32_t lastSubpass = static_cast<uint32_t>(config.postEffects.size()); // the one writing colorAttachment
+        if (lastSubpass > 0) {
+            colorAttachment.setLoadOp(vk::AttachmentLoadOp::eDontCare); // the last effect writes every pixel of the render area
+        }
 
         vk::AttachmentReference colorAttachmentRef{};
         colorAttachmentRef.setAttachment(0) // Our array consists of a single VkAttachmentDescription, so its index is 0
             .setLayout(vk::ImageLayout::eColorAttachmentOptimal); // use the attachment to function as a color buffer
 
+        vk::AttachmentReference depthAttachmentRef(1, vk::ImageLayout::eDepthStencilAttachmentOptimal);
+
         vk::SubpassDescription subpass{};
         subpass.setPipelineBindPoint(vk::PipelineBindPoint::eGraphics) // may also support compute subpasses in the future, so we have to be explicit about this being a graphics subpass
             .setColorAttachmentCount(1)
             .setPColorAttachments(&colorAttachmentRef); // The index of the attachment in this array is directly referenced from the fragment shader with the layout(location = 0) out vec4 outColor directive!
+        std::vector<vk::AttachmentDescription> attachments = {colorAttachment};
+        if (hasDepthBuffer()) {
+            attachments.push_back(depthAttachmentDescription());
+            subpass.setPDepthStencilAttachment(&depthAttachmentRef);
+        }
+
+        // --post-process: the scene is drawn into an intermediate instead, then every effect is a subpass reading the
+        // previous result as an input attachment and writing the other intermediate, the last one colorAttachment.
+        // Each fragment only reads its own pixel, so the dependencies are by region: a tiler runs the whole chain
+        // per tile and the intermediates are neither loaded nor stored.
+        std::vector<vk::SubpassDescription> subpasses = {subpass};
+        std::vector<vk::AttachmentReference> effectColorRefs(lastSubpass + 1);
+        std::vector<vk::AttachmentReference> effectInputRefs(lastSubpass + 1);
+        for (uint32_t i = 0; i < postProcessAttachmentCount(); i++) {
+            vk::AttachmentDescription intermediate{};
+            intermediate.setFormat(POST_PROCESS_FORMAT)
+                .setSamples(vk::SampleCountFlagBits::e1)
+                .setLoadOp(i == 0 ? vk::AttachmentLoadOp::eClear : vk::AttachmentLoadOp::eDontCare) // the scene is drawn into the first
+                .setStoreOp(vk::AttachmentStoreOp::eDontCare)
+                .setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
+                .setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
+                .setInitialLayout(vk::ImageLayout::eUndefined)
+                .setFinalLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
+            attachments.push_back(intermediate);
+        }
+        if (lastSubpass > 0) {
+            colorAttachmentRef.setAttachment(postProcessAttachmentIndex(0)); // subpasses[0] points to it
+        }
+        for (uint32_t i = 1; i <= lastSubpass; i++) {
+            effectInputRefs[i] = vk::AttachmentReference(postProcessAttachmentIndex((i - 1) % 2), vk::ImageLayout::eShaderReadOnlyOptimal);
+            effectColorRefs[i] = vk::AttachmentReference(i == lastSubpass ? 0 : postProcessAttachmentIndex(i % 2),
+                                                         vk::ImageLayout::eColorAttachmentOptimal);
+            vk::SubpassDescription effect{};
+            effect.setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
+                .setInputAttachmentCount(1)
+                .setPInputAttachments(&effectInputRefs[i])
+                .setColorAttachmentCount(1)
+                .setPColorAttachments(&effectColorRefs[i]);
+            subpasses.push_back(effect);
+        }
 
         vk::SubpassDependency dependency{};
         dependency.setSrcSubpass(VK_SUBPASS_EXTERNAL) // VK_SUBPASS_EXTERNAL means anything outside of a given render pass scope, it specifies anything that happened before the render pass
@@ -370,17 +798,136 @@ private:
             //.setSrcAccessMask(0)
             .setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
             .setDstAccessMask(vk::AccessFlagBits::eColorAttachmentWrite);
+        addDepthDependency(dependency);
+
+        std::vector<vk::SubpassDependency> dependencies = {dependency};
+        if (lastSubpass > 0) {
+            // The intermediates are shared by all frames in flight too: the scene's clear waits for the previous
+            // frame's effects to be done with them
+            dependencies[0].setSrcStageMask(dependencies[0].srcStageMask | vk::PipelineStageFlagBits::eFragmentShader)
+                .setSrcAccessMask(dependencies[0].srcAccessMask | vk::AccessFlagBits::eColorAttachmentWrite);
+            // colorAttachment is first used by the last effect, its layout transition waits for the acquired image there
+            vk::SubpassDependency outputDependency{};
+            outputDependency.setSrcSubpass(VK_SUBPASS_EXTERNAL)
+                .setDstSubpass(lastSubpass)
+                .setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
+                .setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
+                .setDstAccessMask(vk::AccessFlagBits::eColorAttachmentWrite);
+            dependencies.push_back(outputDependency);
+        }
+        for (uint32_t i = 1; i <= lastSubpass; i++) {
+            // An effect reads what the subpass before it wrote, and overwrites what that subpass read
+            vk::SubpassDependency chainDependency{};
+            chainDependency.setSrcSubpass(i - 1)
+                .setDstSubpass(i)
+                .setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eFragmentShader)
+                .setSrcAccessMask(vk::AccessFlagBits::eColorAttachmentWrite)
+                .setDstStageMask(vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eColorAttachmentOutput)
+                .setDstAccessMask(vk::AccessFlagBits::eInputAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite)
+                .setDependencyFlags(vk::DependencyFlagBits::eByRegion);
+            dependencies.push_back(chainDependency);
+        }
+        if (dynamicResolution) {
+            // The scene image is shared by all frames in flight: don't overwrite it before the previous frame's blit read it
+            vk::SubpassDependency& outputDependency = lastSubpass > 0 ? dependencies[1] : dependencies[0];
+            outputDependency.setSrcStageMask(outputDependency.srcStageMask | vk::PipelineStageFlagBits::eTransfer);
+        }
+        if (dynamicResolution || captureSupported) {
+            // Make the rendered result visible to the blit or capture copy that follows the render pass
+            vk::SubpassDependency blitDependency{};
+            blitDependency.setSrcSubpass(lastSubpass)
+                .setDstSubpass(VK_SUBPASS_EXTERNAL)
+                .setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
+                .setSrcAccessMask(vk::AccessFlagBits::eColorAttachmentWrite)
+                .setDstStageMask(vk::PipelineStageFlagBits::eTransfer)
+                .setDstAccessMask(vk::AccessFlagBits::eTransferRead);
+            dependencies.push_back(blitDependency);
+        }
 
         vk::RenderPassCreateInfo renderPassInfo{};
-        renderPassInfo.setAttachmentCount(1)
-            .setPAttachments(&colorAttachment)
-            .setSubpassCount(1)
-            .setPSubpasses(&subpass)
-            .setDependencyCount(1)
-            .setPDependencies(&dependency);
+        renderPassInfo.setAttachmentCount(static_cast<uint32_t>(attachments.size()))
+            .setPAttachments(attachments.data())
+            .setSubpassCount(static_cast<uint32_t>(subpasses.size()))
+            .setPSubpasses(subpasses.data())
+            .setDependencyCount(static_cast<uint32_t>(dependencies.size()))
+            .setPDependencies(dependencies.data());
         renderPass = device.createRenderPass(renderPassInfo);
     }
 
+    // The depth buffer is only needed for meshes, the triangle alone is drawn without one
+    bool hasDepthBuffer() const {
+        return depthFormat != vk::Format::eUndefined;
+    }
+
+    // --post-process ping-pongs between two intermediates, a single effect only needs the one the scene is drawn into
+    uint32_t postProcessAttachmentCount() const {
+        return std::min(static_cast<uint32_t>(config.postEffects.size()), 2u);
+    }
+
+    // Attachments of the main render pass: color, depth, then the post-processing intermediates
+    uint32_t postProcessAttachmentIndex(uint32_t intermediate) const {
+        return (hasDepthBuffer() ? 2 : 1) + intermediate;
+    }
+
+    void selectDepthFormat() {
+        depthFormat = vk::Format::eUndefined;
+        if (!meshFile) {
+            return;
+        }
+        // D16 is always supported, D32 gives large models far more precision
+        for (vk::Format format : {vk::Format::eD32Sfloat, vk::Format::eD16Unorm}) {
+            if (physicalDevice.getFormatProperties(format).optimalTilingFeatures & vk::FormatFeatureFlagBits::eDepthStencilAttachment) {
+                depthFormat = format;
+                return;
+            }
+        }
+        throw std::runtime_error("failed to find a depth buffer format!");
+    }
+
+    vk::AttachmentDescription depthAttachmentDescription() {
+        vk::AttachmentDescription depthAttachment{};
+        depthAttachment.setFormat(depthFormat)
+            .setSamples(vk::SampleCountFlagBits::e1)
+            .setLoadOp(vk::AttachmentLoadOp::eClear)
+            .setStoreOp(vk::AttachmentStoreOp::eDontCare) // depth is not needed after the frame, tilers never write it out
+            .setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
+            .setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
+            .setInitialLayout(vk::ImageLayout::eUndefined)
+            .setFinalLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal);
+        return depthAttachment;
+    }
+
+    // The depth image is shared by all frames in flight: its clear has to wait for the previous frame's depth tests
+    void addDepthDependency(vk::SubpassDependency& dependency) {
+        if (!hasDepthBuffer()) {
+            return;
+        }
+        dependency.setSrcStageMask(dependency.srcStageMask | vk::PipelineStageFlagBits::eLateFragmentTests)
+            .setSrcAccessMask(dependency.srcAccessMask | vk::AccessFlagBits::eDepthStencilAttachmentWrite)
+            .setDstStageMask(dependency.dstStageMask | vk::PipelineStageFlagBits::eEarlyFragmentTests)
+            .setDstAccessMask(dependency.dstAccessMask | vk::AccessFlagBits::eDepthStencilAttachmentWrite);
+    }
+
+    void createDepthImage(vk::Extent2D extent, vk::Image& image, vk::DeviceMemory& imageMemory, vk::ImageView& imageView) {
+        if (!hasDepthBuffer()) {
+            return;
+        }
+        // Transient: on tilers the depth buffer can live in tile memory only
+        createImage(extent.width, extent.height, depthFormat, vk::ImageTiling::eOptimal,
+                    vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransientAttachment,
+                    vk::MemoryPropertyFlagBits::eDeviceLocal, image, imageMemory);
+        imageView = createImageView(image, depthFormat, vk::ImageAspectFlagBits::eDepth);
+    }
+
+    void destroyDepthImage(vk::Image& image, vk::DeviceMemory& imageMemory, vk::ImageView& imageView) {
+        device.destroyImageView(imageView);
+        device.destroyImage(image);
+        device.freeMemory(imageMemory);
+        imageView = nullptr;
+        image = nullptr;
+        imageMemory = nullptr;
+    }
+
     void createGraphicsPipeline() {
         auto vertShaderCode = readFile(getShaderPath() + "/shader.vert.spv");
         auto fragShaderCode = readFile(getShaderPath() + "/shader.frag.spv");
@@ -399,27 +946,17 @@ private:
 
         vk::PipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
-        vk::PipelineVertexInputStateCreateInfo vertexInputInfo{};
-        vertexInputInfo.setVertexBindingDescriptionCount(0)
-                       .setVertexAttributeDescriptionCount(0);
-        vertexInputInfo.pVertexBindingDescriptions = nullptr;
-        vertexInputInfo.pVertexAttributeDescriptions = nullptr;
+        // Both come from the shaders' reflection: no vertex inputs, no descriptors, no push constants
+        const ShaderReflection& vertReflection = shaderReflection("shader.vert.spv");
+        const VertexInput vertexInput(vertReflection);
+        vk::PipelineVertexInputStateCreateInfo vertexInputInfo = vertexInput.info();
 
         vk::PipelineInputAssemblyStateCreateInfo inputAssembly{};
         inputAssembly.topology = vk::PrimitiveTopology::eTriangleList;
         inputAssembly.primitiveRestartEnable = false;
 
-        vk::Viewport viewport{};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = (float)swapChainExtent.width;
-        viewport.height = (float)swapChainExtent.height;
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-
-        vk::Rect2D scissor({0, 0}, swapChainExtent);
-
-        vk::PipelineViewportStateCreateInfo viewportState({}, 1, &viewport, 1, &scissor);
+        // Viewport and scissor are dynamic states (set while recording), so a resize doesn't require a new pipeline
+        vk::PipelineViewportStateCreateInfo viewportState({}, 1, nullptr, 1, nullptr);
 
         vk::PipelineRasterizationStateCreateInfo rasterizer{};
         rasterizer.setDepthClampEnable(false) // fragments that are beyond the near and far planes are clamped to them
@@ -441,7 +978,10 @@ private:
             .setAlphaToCoverageEnable(false)
             .setAlphaToOneEnable(false);
 
-        //TODO: Depth and stencil testing
+        // The triangle is drawn without depth testing, the state is still needed when the render pass has a depth buffer
+        vk::PipelineDepthStencilStateCreateInfo depthStencil{};
+        depthStencil.setDepthTestEnable(false)
+            .setDepthWriteEnable(false);
 
         // color blending settings per framebuffer
         vk::PipelineColorBlendAttachmentState colorBlendAttachment{};
@@ -473,21 +1013,13 @@ private:
 
         vk::DynamicState dynamicStates[] = {
             vk::DynamicState::eViewport,
-            vk::DynamicState::eLineWidth
+            vk::DynamicState::eScissor
         };
         vk::PipelineDynamicStateCreateInfo dynamicState{};
         dynamicState.setDynamicStateCount(2)
             .setPDynamicStates(dynamicStates);
 
-        // for uniform values in shaders
-        // The structure also specifies push constants, 
-        // which are another way of passing dynamic values to shaders.
-        vk::PipelineLayoutCreateInfo pipelineLayoutInfo{};
-        pipelineLayoutInfo.setSetLayoutCount(0)
-            .setPSetLayouts(nullptr)
-            .setPushConstantRangeCount(0)
-            .setPPushConstantRanges(nullptr);
-        pipelineLayout = device.createPipelineLayout(pipelineLayoutInfo);
+        pipelineLayout = layoutCache->pipelineLayout({&vertReflection, &shaderReflection("shader.frag.spv")}).layout;
 
         vk::GraphicsPipelineCreateInfo pipelineInfo{};
         pipelineInfo.setStageCount(2)
@@ -497,9 +1029,9 @@ private:
             .setPViewportState(&viewportState)
             .setPRasterizationState(&rasterizer)
             .setPMultisampleState(&multisampling)
-            .setPDepthStencilState(nullptr)
+            .setPDepthStencilState(&depthStencil)
             .setPColorBlendState(&colorBlending)
-            .setPDynamicState(nullptr)
+            .setPDynamicState(&dynamicState)
             .setLayout(pipelineLayout)
             .setRenderPass(renderPass) // It is also possible to use other render passes with this pipeline instead of this specific instance, but they have to be compatible
             .setSubpass(0)             // index of the sub pass where this graphics pipeline will be used
@@ -509,178 +1041,2713 @@ private:
             .setBasePipelineHandle(nullptr)
             .setBasePipelineIndex(-1);
 
-        graphicsPipeline = device.createGraphicsPipeline({}, pipelineInfo);
+        graphicsPipeline = pipelineVariants->get("triangle", {}, [&](vk::PipelineCache cache, const vk::SpecializationInfo*) {
+            return device.createGraphicsPipeline(cache, pipelineInfo);
+        });
 
         device.destroyShaderModule(vertShaderModule);
         device.destroyShaderModule(fragShaderModule);
-    }
 
-    void createFramebuffers() {
-        swapChainFramebuffers.resize(swapChainImageViews.size());
-        for (size_t index = 0; index < swapChainImageViews.size(); index++) {
-            vk::ImageView attachments[] = { swapChainImageViews[index] };
-            vk::FramebufferCreateInfo frameBufferInfo{};
-            frameBufferInfo.setRenderPass(renderPass) // specify with which renderPass needs to be compatible
-                .setAttachmentCount(1)
-                .setPAttachments(attachments)
-                .setWidth(swapChainExtent.width)
-                .setHeight(swapChainExtent.height)
-                .setLayers(1); // Our swap chain images are single images, so the number of layers is 1
-            swapChainFramebuffers[index] = device.createFramebuffer(frameBufferInfo);
+        if (meshFile) {
+            createMeshPipeline(pipelineInfo);
+        }
+        if (activeMeshletMode == MeshletMode::MeshShader) {
+            createMeshletPipeline(pipelineInfo);
+        }
+        if (config.drawCount > 0 || config.sceneNodeCount > 0) {
+            createDrawDataPipelines(pipelineInfo);
+        }
+        if (config.particleCount > 0) {
+            createParticlePipeline(pipelineInfo);
+        }
+        if (config.spriteCount > 0) {
+            createSpritePipelines(pipelineInfo);
+        }
+        if (config.occlusionCulling) {
+            createOcclusionProxyPipeline(pipelineInfo);
+        }
+        if (!config.postEffects.empty()) {
+            createPostProcessPipelines(pipelineInfo);
         }
     }
 
-    void createCommandPool() {
-        auto queueFamiliesIndices = findQueueFamilies(physicalDevice);
-        vk::CommandPoolCreateInfo poolInfo{};
-        poolInfo.setQueueFamilyIndex(queueFamiliesIndices.graphicsFamily.value());
-        commandPool = device.createCommandPool(poolInfo);
-    }
-
-    void createCommandBuffers() {
-        commandBuffers.resize(swapChainFramebuffers.size());
-        vk::CommandBufferAllocateInfo allocInfo{};
-        allocInfo.setCommandPool(commandPool)
-            .setLevel(vk::CommandBufferLevel::ePrimary)
-            .setCommandBufferCount((uint32_t)commandBuffers.size());
-        commandBuffers = device.allocateCommandBuffers(allocInfo);
-        // CBLevel::ePrimary: Can be submitted to a queue for execution, but cannot be called from other command buffers.
-        // CBLevel::eSecondary: Cannot be submitted directly, but can be called from primary command buffers.
-        for (size_t index = 0; index < commandBuffers.size(); index++) {
-            vk::CommandBufferBeginInfo beginInfo{};
-            // eOneTimeSubmit: specifies that each recording of the command buffer will only be submitted once, and the command buffer will be reset and recorded again between each submission
-            // eRenderPassContinue: This is a secondary command buffer that will be entirely within a single render pass.
-            // eSimultaneousUse: The command buffer can be resubmitted while it is also already pending execution.
-            // None of these flags are applicable for us right now.
-            commandBuffers[index].begin(beginInfo);
-            
-            vk::RenderPassBeginInfo renderPassInfo{};
-            vk::ClearValue clearColor(std::array<float, 4> {0.0f, 0.0f, 0.0f, 1.0f});
-            renderPassInfo.setRenderPass(renderPass)
-                .setFramebuffer(swapChainFramebuffers[index])
-                .setRenderArea({{0, 0}, swapChainExtent}) // Size of the render area. The render area defines where shader loads and stores will take place. It should match the size of the attachments for best performance
-                .setClearValueCount(1)
-                .setPClearValues(&clearColor); // clear values for AttachmentLoadOp::eClear
-            commandBuffers[index].beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
-            // SubpassContents::eInline: The render pass commands will be embedded in the primary command buffer itself and no secondary command buffers will be executed.
-            // SubpassContents::eSecondaryCommandBuffers: The render pass commands will be executed from secondary command buffers.
+    // --post-process: one pipeline per effect, for the subpass it runs in. A fullscreen triangle, no blending or
+    // depth: the subpass has neither a depth attachment nor anything to blend with.
+    void createPostProcessPipelines(vk::GraphicsPipelineCreateInfo pipelineInfo) {
+        auto vertShaderModule = createShaderModule(readFile(getShaderPath() + "/fullscreen.vert.spv"));
+        auto fragShaderModule = createShaderModule(readFile(getShaderPath() + "/post-process.frag.spv"));
+        const ShaderReflection& vertReflection = shaderReflection("fullscreen.vert.spv");
+        const VertexInput vertexInput(vertReflection);
+        vk::PipelineVertexInputStateCreateInfo vertexInputInfo = vertexInput.info();
+        vk::PipelineRasterizationStateCreateInfo rasterizer = *pipelineInfo.pRasterizationState;
+        rasterizer.setCullMode(vk::CullModeFlagBits::eNone);
 
-            commandBuffers[index].bindPipeline(vk::PipelineBindPoint::eGraphics, graphicsPipeline); // first parameter specifies if is a graphics or compute pipeline
-            commandBuffers[index].draw(3, 1, 0, 0);            
-            // vertexCount: Even though we don't have a vertex buffer, we technically still have 3 vertices to draw.
-            // instanceCount: Used for instanced rendering, use 1 if you're not doing that.
-            // firstVertex: Used as an offset into the vertex buffer, defines the lowest value of gl_VertexIndex.
-            // firstInstance: Used as an offset for instanced rendering, defines the lowest value of gl_InstanceIndex.
+        const LayoutCache::PipelineLayout layout = layoutCache->pipelineLayout({&vertReflection, &shaderReflection("post-process.frag.spv")});
+        postProcessPipelineLayout = layout.layout;
+        postProcessPush = PushConstants<PostProcessParameters>(postProcessPipelineLayout, layout.pushConstants,
+                                                               physicalDevice.getProperties().limits.maxPushConstantsSize);
+        pipelineInfo.setPVertexInputState(&vertexInputInfo)
+            .setPRasterizationState(&rasterizer)
+            .setLayout(postProcessPipelineLayout);
 
-            commandBuffers[index].endRenderPass();
-            commandBuffers[index].end();
+        // Each effect is in the chain once, so its constant also stands for its subpass
+        postProcessPipelines.clear();
+        for (size_t i = 0; i < config.postEffects.size(); i++) {
+            SpecializationConstants constants;
+            constants.set(SPEC_POST_EFFECT, static_cast<uint32_t>(config.postEffects[i]));
+            postProcessPipelines.push_back(pipelineVariants->get("post-process", constants,
+                                                                 [&](vk::PipelineCache cache, const vk::SpecializationInfo* specialization) {
+                const vk::PipelineShaderStageCreateInfo stages[] = {
+                    {{}, vk::ShaderStageFlagBits::eVertex, vertShaderModule, "main"},
+                    {{}, vk::ShaderStageFlagBits::eFragment, fragShaderModule, "main", specialization}
+                };
+                vk::GraphicsPipelineCreateInfo effectInfo = pipelineInfo;
+                effectInfo.setStageCount(2)
+                    .setPStages(stages)
+                    .setSubpass(static_cast<uint32_t>(i + 1));
+                return device.createGraphicsPipeline(cache, effectInfo);
+            }));
         }
-    }
 
-    void createSyncObjects() {
-        imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        inFlightFences.clear();
-        inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-        imagesInFlight.clear();
-        imagesInFlight.resize(swapChainImages.size(), nullptr);
-        vk::SemaphoreCreateInfo semaphoreInfo{};
-        vk::FenceCreateInfo fenceInfo{};
-        fenceInfo.setFlags(vk::FenceCreateFlagBits::eSignaled);
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            imageAvailableSemaphores[i] = device.createSemaphore(semaphoreInfo);
-            renderFinishedSemaphores[i] = device.createSemaphore(semaphoreInfo);
-            inFlightFences[i] = device.createFence(fenceInfo);
-        }
+        device.destroyShaderModule(vertShaderModule);
+        device.destroyShaderModule(fragShaderModule);
     }
 
-    static std::vector<char> readFile(const std::string& filename) {
-#ifdef __ANDROID__
-        JNIEnv* env = (JNIEnv*)SDL_AndroidGetJNIEnv();  // Pointer to native interface
-        jint ver = env->GetVersion();
-        jobject activity = (jobject)SDL_AndroidGetActivity();
-        jclass clazz(env->GetObjectClass(activity));
-        jmethodID midGetContext = env->GetStaticMethodID(clazz, "getContext", "()Landroid/content/Context;");
-        auto context = env->CallStaticObjectMethod(clazz, midGetContext);
-        auto mid = env->GetMethodID(env->GetObjectClass(context), "getAssets", "()Landroid/content/res/AssetManager;");
-        jobject ez = env->CallObjectMethod(context, mid);
-        
-        AAssetManager *assetManager = AAssetManager_fromJava(env, ez);
-        AAsset* asset = AAssetManager_open(assetManager, filename.c_str(), AASSET_MODE_STREAMING);
-        size_t size = AAsset_getLength(asset);
-        std::vector<char> buffer(size);
-        AAsset_read(asset, buffer.data(), size);
-        AAsset_close(asset);
-        return buffer;
-#else
-        std::ifstream file(filename, std::ios::ate | std::ios::binary);
-            
-        if (!file.is_open()) {
-            throw std::runtime_error("failed to open file!");
-        }
+    // --occlusion-culling: the mesh's bounding box, depth tested against what was drawn before it in the pass but
+    // without any writes, so it only feeds the occlusion query
+    void createOcclusionProxyPipeline(vk::GraphicsPipelineCreateInfo pipelineInfo) {
+        auto vertShaderModule = createShaderModule(readFile(getShaderPath() + "/occlusion-proxy.vert.spv"));
+        vk::PipelineShaderStageCreateInfo shaderStage({}, vk::ShaderStageFlagBits::eVertex, vertShaderModule, "main");
+        vk::PipelineRasterizationStateCreateInfo rasterizer = *pipelineInfo.pRasterizationState;
+        rasterizer.setCullMode(vk::CullModeFlagBits::eNone); // the camera may be inside the box
+        vk::PipelineDepthStencilStateCreateInfo depthStencil{};
+        depthStencil.setDepthTestEnable(true)
+            .setDepthWriteEnable(false)
+            .setDepthCompareOp(vk::CompareOp::eLessOrEqual);
+        vk::PipelineColorBlendAttachmentState blendAttachment = pipelineInfo.pColorBlendState->pAttachments[0];
+        blendAttachment.setColorWriteMask({});
+        vk::PipelineColorBlendStateCreateInfo colorBlending = *pipelineInfo.pColorBlendState;
+        colorBlending.setPAttachments(&blendAttachment);
 
-        size_t fileSize = (size_t) file.tellg();
-        std::vector<char> buffer(fileSize);
+        const LayoutCache::PipelineLayout layout = layoutCache->pipelineLayout({&shaderReflection("occlusion-proxy.vert.spv")});
+        occlusionProxyPipelineLayout = layout.layout;
+        occlusionProxyPush = PushConstants<MeshPushConstants>(occlusionProxyPipelineLayout, layout.pushConstants,
+                                                              physicalDevice.getProperties().limits.maxPushConstantsSize);
+        pipelineInfo.setStageCount(1)
+            .setPStages(&shaderStage)
+            .setPRasterizationState(&rasterizer)
+            .setPDepthStencilState(&depthStencil)
+            .setPColorBlendState(&colorBlending)
+            .setLayout(occlusionProxyPipelineLayout);
+        occlusionProxyPipeline = pipelineVariants->get("occlusion-proxy", {}, [&](vk::PipelineCache cache, const vk::SpecializationInfo*) {
+            return device.createGraphicsPipeline(cache, pipelineInfo);
+        });
 
-        file.seekg(0);
-        file.read(buffer.data(), fileSize);
-        file.close();
-        return buffer;
-#endif
+        device.destroyShaderModule(vertShaderModule);
     }
 
-    static std::string getShaderPath() {
-#if defined(__ANDROID__)
-        return "shaders";
-#else
-        return getExecutablePath() + "/shaders";
-#endif
-    }
+    // Pipeline for .nmesh vertices: same fixed function state as the triangle, plus vertex input, depth testing and culling.
+    // The vertex attributes are read in their quantized formats, the input assembler expands them for free.
+    void createMeshPipeline(vk::GraphicsPipelineCreateInfo pipelineInfo) {
+        auto vertShaderModule = createShaderModule(readFile(getShaderPath() + "/mesh.vert.spv"));
+        auto fragShaderModule = createShaderModule(readFile(getShaderPath() + "/mesh.frag.spv"));
+        vk::PipelineShaderStageCreateInfo shaderStages[] = {
+            {{}, vk::ShaderStageFlagBits::eVertex, vertShaderModule, "main"},
+            {{}, vk::ShaderStageFlagBits::eFragment, fragShaderModule, "main"}
+        };
 
-    static std::string getExecutablePath() {
-#if defined(_WIN32)
-        static std::string path;
-        static std::once_flag once;
-        std::call_once(once, []{
-            char result[MAX_PATH];
-            std::string execPath(result, GetModuleFileName(nullptr, result, MAX_PATH));
-            std::replace(execPath.begin(), execPath.end(), '\\', '/');
-            std::string::size_type lastSlash = execPath.rfind("/");
-            path = execPath.substr(0, lastSlash);
+        const ShaderReflection& vertReflection = shaderReflection("mesh.vert.spv");
+        const VertexInput vertexInput(vertReflection, sizeof(PackedVertex), {
+            {0, 0, vk::Format::eR16G16B16A16Unorm, offsetof(PackedVertex, position)},
+            {1, 0, vk::Format::eR16G16Sfloat, offsetof(PackedVertex, texCoord)},
+            {2, 0, vk::Format::eR8G8Snorm, offsetof(PackedVertex, normal)}
         });
-        return path;
-#elif defined(__linux__) && !defined(__ANDROID__)
-        static std::string path;
-        static std::once_flag once;
-        std::call_once(once, []{
-            char result[PATH_MAX];
-            ssize_t count = readlink("/proc/self/exe", result, PATH_MAX);
-            return std::string execPath(result, (count > 0) ? count : 0);
-            std::replace(execPath.begin(), execPath.end(), '\\', '/');
-            std::string::size_type lastSlash = execPath.rfind("/");
-            path = execPath.substr(0, lastSlash);
+        vk::PipelineVertexInputStateCreateInfo vertexInputInfo = vertexInput.info();
+
+        vk::PipelineRasterizationStateCreateInfo rasterizer = *pipelineInfo.pRasterizationState;
+        rasterizer.setCullMode(vk::CullModeFlagBits::eBack)
+            .setFrontFace(vk::FrontFace::eCounterClockwise); // OBJ and glTF winding, the y flip of the projection keeps it counter-clockwise in framebuffer space
+        vk::PipelineDepthStencilStateCreateInfo depthStencil{};
+        depthStencil.setDepthTestEnable(true)
+            .setDepthWriteEnable(true)
+            .setDepthCompareOp(vk::CompareOp::eLess);
+
+        // Set 0 (the texture) is the same layout textureSetLayout is, the push constants are the vertex shader's
+        const LayoutCache::PipelineLayout layout = layoutCache->pipelineLayout({&vertReflection, &shaderReflection("mesh.frag.spv")});
+        meshPipelineLayout = layout.layout;
+        meshPush = PushConstants<MeshPushConstants>(meshPipelineLayout, layout.pushConstants,
+                                                    physicalDevice.getProperties().limits.maxPushConstantsSize);
+
+        pipelineInfo.setPStages(shaderStages)
+            .setPVertexInputState(&vertexInputInfo)
+            .setPRasterizationState(&rasterizer)
+            .setPDepthStencilState(&depthStencil)
+            .setLayout(meshPipelineLayout);
+        SpecializationConstants constants;
+        constants.set(SPEC_TEXTURED, textureHandle.has_value());
+        meshPipeline = pipelineVariants->get("mesh", constants, [&](vk::PipelineCache cache, const vk::SpecializationInfo* specialization) {
+            for (auto& stage : shaderStages) {
+                stage.setPSpecializationInfo(specialization);
+            }
+            return device.createGraphicsPipeline(cache, pipelineInfo);
         });
-        return path;
-#elif defined(__ANDROID__)
-        return "";
-#else
-        static const std::string empty;
-        return empty;
-#endif
-    }
 
-    vk::ShaderModule createShaderModule(const std::vector<char>& code) {
-        vk::ShaderModuleCreateInfo createInfo{};
-        createInfo.codeSize = code.size();
-        createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-        return device.createShaderModule(createInfo);
+        device.destroyShaderModule(vertShaderModule);
+        device.destroyShaderModule(fragShaderModule);
     }
 
-    int rateDeviceSuitability(vk::PhysicalDevice device) {
-        auto features = device.getFeatures();
-        if (!features.geometryShader || !isDeviceSuitable(device))
-            return 0;
-        int score = 0;
+    // Mesh shader counterpart of the mesh pipeline: the task shader culls meshlets, the mesh shader expands the visible
+    // ones. There is no vertex input, the mesh shader decodes the packed vertices itself.
+    void createMeshletPipeline(vk::GraphicsPipelineCreateInfo pipelineInfo) {
+#ifdef NARU_MESH_SHADER_SUPPORT
+        auto taskShaderModule = createShaderModule(readFile(getShaderPath() + "/meshlet.task.spv"));
+        auto meshShaderModule = createShaderModule(readFile(getShaderPath() + "/meshlet.mesh.spv"));
+        auto fragShaderModule = createShaderModule(readFile(getShaderPath() + "/mesh.frag.spv"));
+        vk::PipelineShaderStageCreateInfo shaderStages[] = {
+            {{}, vk::ShaderStageFlagBits::eTaskEXT, taskShaderModule, "main"},
+            {{}, vk::ShaderStageFlagBits::eMeshEXT, meshShaderModule, "main"},
+            {{}, vk::ShaderStageFlagBits::eFragment, fragShaderModule, "main"}
+        };
+        vk::PipelineRasterizationStateCreateInfo rasterizer = *pipelineInfo.pRasterizationState;
+        rasterizer.setCullMode(vk::CullModeFlagBits::eBack)
+            .setFrontFace(vk::FrontFace::eCounterClockwise);
+        vk::PipelineDepthStencilStateCreateInfo depthStencil{};
+        depthStencil.setDepthTestEnable(true)
+            .setDepthWriteEnable(true)
+            .setDepthCompareOp(vk::CompareOp::eLess);
+
+        pipelineInfo.setStageCount(3)
+            .setPStages(shaderStages)
+            .setPVertexInputState(nullptr)
+            .setPInputAssemblyState(nullptr)
+            .setPRasterizationState(&rasterizer)
+            .setPDepthStencilState(&depthStencil)
+            .setLayout(meshletPipelineLayout);
+        SpecializationConstants constants;
+        constants.set(SPEC_TEXTURED, textureHandle.has_value()).set(SPEC_MESHLET_CULLING, config.meshletCulling);
+        meshletPipeline = pipelineVariants->get("meshlet", constants, [&](vk::PipelineCache cache, const vk::SpecializationInfo* specialization) {
+            for (auto& stage : shaderStages) {
+                stage.setPSpecializationInfo(specialization);
+            }
+            return device.createGraphicsPipeline(cache, pipelineInfo);
+        });
+
+        device.destroyShaderModule(taskShaderModule);
+        device.destroyShaderModule(meshShaderModule);
+        device.destroyShaderModule(fragShaderModule);
+#endif
+    }
+
+    // --draws: one pipeline per per-draw data path, specializations of the same shaders. With --draw-data all the
+    // benchmark switches between them, so they are all created up front.
+    void createDrawDataPipelines(vk::GraphicsPipelineCreateInfo pipelineInfo) {
+        auto vertShaderModule = createShaderModule(readFile(getShaderPath() + "/draw-data.vert.spv"));
+        auto fragShaderModule = createShaderModule(readFile(getShaderPath() + "/shader.frag.spv"));
+        vk::PipelineShaderStageCreateInfo shaderStages[] = {
+            {{}, vk::ShaderStageFlagBits::eVertex, vertShaderModule, "main"},
+            {{}, vk::ShaderStageFlagBits::eFragment, fragShaderModule, "main"}
+        };
+        vk::PipelineRasterizationStateCreateInfo rasterizer = *pipelineInfo.pRasterizationState;
+        rasterizer.setCullMode(vk::CullModeFlagBits::eNone); // the quads spin
+
+        pipelineInfo.setPStages(shaderStages)
+            .setPRasterizationState(&rasterizer)
+            .setLayout(drawDataPipelineLayout);
+        for (DrawDataPath path : {DrawDataPath::Push, DrawDataPath::DynamicUniform, DrawDataPath::Storage}) {
+            if (!usesDrawDataPath(path)) {
+                continue;
+            }
+            SpecializationConstants constants;
+            constants.set(SPEC_DRAW_DATA_PATH, static_cast<uint32_t>(path));
+            drawDataPipelines[static_cast<size_t>(path)] = pipelineVariants->get("draw-data", constants,
+                                                                                [&](vk::PipelineCache cache, const vk::SpecializationInfo* specialization) {
+                for (auto& stage : shaderStages) {
+                    stage.setPSpecializationInfo(specialization);
+                }
+                return device.createGraphicsPipeline(cache, pipelineInfo);
+            });
+        }
+
+        device.destroyShaderModule(vertShaderModule);
+        device.destroyShaderModule(fragShaderModule);
+    }
+
+    // --particles: points read straight from the particle state, blended additively
+    void createParticlePipeline(vk::GraphicsPipelineCreateInfo pipelineInfo) {
+        auto vertShaderModule = createShaderModule(readFile(getShaderPath() + "/particle.vert.spv"));
+        auto fragShaderModule = createShaderModule(readFile(getShaderPath() + "/shader.frag.spv"));
+        vk::PipelineShaderStageCreateInfo shaderStages[] = {
+            {{}, vk::ShaderStageFlagBits::eVertex, vertShaderModule, "main"},
+            {{}, vk::ShaderStageFlagBits::eFragment, fragShaderModule, "main"}
+        };
+        vk::PipelineInputAssemblyStateCreateInfo inputAssembly = *pipelineInfo.pInputAssemblyState;
+        inputAssembly.setTopology(vk::PrimitiveTopology::ePointList);
+        vk::PipelineColorBlendAttachmentState blendAttachment = pipelineInfo.pColorBlendState->pAttachments[0];
+        blendAttachment.setBlendEnable(true)
+            .setSrcColorBlendFactor(vk::BlendFactor::eOne)
+            .setDstColorBlendFactor(vk::BlendFactor::eOne)
+            .setColorBlendOp(vk::BlendOp::eAdd);
+        vk::PipelineColorBlendStateCreateInfo colorBlending = *pipelineInfo.pColorBlendState;
+        colorBlending.setPAttachments(&blendAttachment);
+
+        pipelineInfo.setPStages(shaderStages)
+            .setPInputAssemblyState(&inputAssembly)
+            .setPColorBlendState(&colorBlending)
+            .setLayout(particleDrawPipelineLayout);
+        particleDrawPipeline = pipelineVariants->get("particles", {}, [&](vk::PipelineCache cache, const vk::SpecializationInfo*) {
+            return device.createGraphicsPipeline(cache, pipelineInfo);
+        });
+
+        device.destroyShaderModule(vertShaderModule);
+        device.destroyShaderModule(fragShaderModule);
+    }
+
+    // --sprites: drawn in the last subpass, over the post-processed frame. Each quad is one instance, its
+    // SpriteVertex comes from instance-rate vertex attributes. One pipeline per blend mode, the batcher sorts by them.
+    void createSpritePipelines(vk::GraphicsPipelineCreateInfo pipelineInfo) {
+        auto vertShaderModule = createShaderModule(readFile(getShaderPath() + "/sprite.vert.spv"));
+        auto fragShaderModule = createShaderModule(readFile(getShaderPath() + "/sprite.frag.spv"));
+        vk::PipelineShaderStageCreateInfo shaderStages[] = {
+            {{}, vk::ShaderStageFlagBits::eVertex, vertShaderModule, "main"},
+            {{}, vk::ShaderStageFlagBits::eFragment, fragShaderModule, "main"}
+        };
+        const VertexInput vertexInput(shaderReflection("sprite.vert.spv"), sizeof(SpriteVertex), {
+            {0, 0, vk::Format::eR32G32Sfloat, offsetof(SpriteVertex, position)},
+            {1, 0, vk::Format::eR32G32Sfloat, offsetof(SpriteVertex, size)},
+            {2, 0, vk::Format::eR16G16B16A16Unorm, offsetof(SpriteVertex, texRect)},
+            {3, 0, vk::Format::eR8G8B8A8Unorm, offsetof(SpriteVertex, color)},
+            {4, 0, vk::Format::eR32Uint, offsetof(SpriteVertex, layer)}
+        }, vk::VertexInputRate::eInstance);
+        vk::PipelineVertexInputStateCreateInfo vertexInputInfo = vertexInput.info();
+        vk::PipelineRasterizationStateCreateInfo rasterizer = *pipelineInfo.pRasterizationState;
+        rasterizer.setCullMode(vk::CullModeFlagBits::eNone);
+        pipelineInfo.setPStages(shaderStages)
+            .setPVertexInputState(&vertexInputInfo)
+            .setPRasterizationState(&rasterizer)
+            .setLayout(spritePipelineLayout)
+            .setSubpass(static_cast<uint32_t>(config.postEffects.size()));
+
+        auto create = [&](const std::string& name, vk::BlendFactor dstColor, vk::BlendFactor srcAlpha, vk::BlendFactor dstAlpha) {
+            vk::PipelineColorBlendAttachmentState blendAttachment = pipelineInfo.pColorBlendState->pAttachments[0];
+            blendAttachment.setBlendEnable(true)
+                .setSrcColorBlendFactor(vk::BlendFactor::eSrcAlpha)
+                .setDstColorBlendFactor(dstColor)
+                .setColorBlendOp(vk::BlendOp::eAdd)
+                .setSrcAlphaBlendFactor(srcAlpha)
+                .setDstAlphaBlendFactor(dstAlpha)
+                .setAlphaBlendOp(vk::BlendOp::eAdd);
+            vk::PipelineColorBlendStateCreateInfo colorBlending = *pipelineInfo.pColorBlendState;
+            colorBlending.setPAttachments(&blendAttachment);
+            vk::GraphicsPipelineCreateInfo blendInfo = pipelineInfo;
+            blendInfo.setPColorBlendState(&colorBlending);
+            return pipelineVariants->get(name, {}, [&](vk::PipelineCache cache, const vk::SpecializationInfo*) {
+                return device.createGraphicsPipeline(cache, blendInfo);
+            });
+        };
+        spritePipelines[static_cast<size_t>(SpriteBlend::Alpha)] =
+            create("sprite-alpha", vk::BlendFactor::eOneMinusSrcAlpha, vk::BlendFactor::eOne, vk::BlendFactor::eOneMinusSrcAlpha);
+        spritePipelines[static_cast<size_t>(SpriteBlend::Additive)] =
+            create("sprite-additive", vk::BlendFactor::eOne, vk::BlendFactor::eZero, vk::BlendFactor::eOne);
+
+        device.destroyShaderModule(vertShaderModule);
+        device.destroyShaderModule(fragShaderModule);
+    }
+
+    void destroyGraphicsPipelines() {
+        pipelineVariants->destroy("triangle"); // the render pass goes away with them
+        pipelineVariants->destroy("mesh");
+        pipelineVariants->destroy("meshlet");
+        pipelineVariants->destroy("draw-data");
+        pipelineVariants->destroy("particles");
+        pipelineVariants->destroy("sprite-alpha");
+        pipelineVariants->destroy("sprite-additive");
+        pipelineVariants->destroy("occlusion-proxy");
+        pipelineVariants->destroy("post-process");
+        graphicsPipeline = nullptr;
+        meshPipeline = nullptr;
+        meshPipelineLayout = nullptr;
+        meshletPipeline = nullptr;
+        drawDataPipelines = {};
+        particleDrawPipeline = nullptr;
+        spritePipelines = {};
+        occlusionProxyPipeline = nullptr;
+        postProcessPipelines.clear();
+    }
+
+    // Meshlet rendering: mesh shaders where available, compute culling with an indirect draw elsewhere
+    void selectMeshletMode() {
+        activeMeshletMode = MeshletMode::Off;
+        if (!meshFile || !meshFile->hasMeshlets() || config.meshletMode == MeshletMode::Off) {
+            return;
+        }
+        activeMeshletMode = MeshletMode::Indirect;
+        if (config.meshletMode != MeshletMode::Indirect && isMeshShaderSupported()) {
+            activeMeshletMode = MeshletMode::MeshShader;
+        } else if (config.meshletMode == MeshletMode::MeshShader) {
+            LOG("Mesh shaders are not supported, culling meshlets with a compute shader instead");
+        }
+        LOG("Meshlets: " << meshFile->header().meshletCount << ", "
+            << (activeMeshletMode == MeshletMode::MeshShader ? "task/mesh shaders" : "compute culling + indirect draw"));
+    }
+
+    // --gpu-counters and --occlusion-culling: which of the optional query features the device has
+    void selectQueryFeatures() {
+        pipelineStatisticsEnabled = config.gpuCounters && physicalDevice.getFeatures().pipelineStatisticsQuery;
+        if (config.gpuCounters && !pipelineStatisticsEnabled) {
+            LOG("Pipeline statistics queries are not supported, --gpu-counters is ignored");
+        }
+        conditionalRenderingEnabled = config.occlusionCulling && isConditionalRenderingSupported();
+        if (config.occlusionCulling && !conditionalRenderingEnabled) {
+            LOG("Conditional rendering is not supported, occlusion results are applied on the CPU");
+        }
+    }
+
+    bool isConditionalRenderingSupported() {
+#ifdef NARU_CONDITIONAL_RENDERING_SUPPORT
+        if (instanceApiVersion < VK_API_VERSION_1_1 || physicalDevice.getProperties().apiVersion < VK_API_VERSION_1_1) {
+            return false;
+        }
+        auto availableExtensions = physicalDevice.enumerateDeviceExtensionProperties();
+        auto found = std::find_if(availableExtensions.begin(), availableExtensions.end(), [](const vk::ExtensionProperties& extension) {
+            return strcmp(extension.extensionName, VK_EXT_CONDITIONAL_RENDERING_EXTENSION_NAME) == 0;
+        });
+        if (found == availableExtensions.end()) {
+            return false;
+        }
+        auto features = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceConditionalRenderingFeaturesEXT>();
+        return features.get<vk::PhysicalDeviceConditionalRenderingFeaturesEXT>().conditionalRendering;
+#else
+        return false;
+#endif
+    }
+
+    bool isMeshShaderSupported() {
+#ifdef NARU_MESH_SHADER_SUPPORT
+        if (instanceApiVersion < VK_API_VERSION_1_1 || physicalDevice.getProperties().apiVersion < VK_API_VERSION_1_1) {
+            return false;
+        }
+        auto availableExtensions = physicalDevice.enumerateDeviceExtensionProperties();
+        for (const char* name : meshShaderExtensions) {
+            auto found = std::find_if(availableExtensions.begin(), availableExtensions.end(),
+                                      [&](const vk::ExtensionProperties& extension) { return strcmp(extension.extensionName, name) == 0; });
+            if (found == availableExtensions.end()) {
+                return false;
+            }
+        }
+        auto features = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceMeshShaderFeaturesEXT>();
+        const auto& meshShaderFeatures = features.get<vk::PhysicalDeviceMeshShaderFeaturesEXT>();
+        return meshShaderFeatures.taskShader && meshShaderFeatures.meshShader;
+#else
+        return false;
+#endif
+    }
+
+    void loadMesh() {
+        const std::string ktx2Extension = ".ktx2";
+        if (config.texturePath.size() > ktx2Extension.size() &&
+            config.texturePath.compare(config.texturePath.size() - ktx2Extension.size(), ktx2Extension.size(), ktx2Extension) == 0) {
+            textureKtx = std::make_unique<Ktx2File>(config.texturePath);
+            textureKtx->prefetch();
+            LOG("Texture: " << config.texturePath << ", " << textureKtx->width() << "x" << textureKtx->height() << ", VkFormat "
+                            << textureKtx->vkFormat() << ", " << textureKtx->levelCount() << " levels");
+        } else if (!config.texturePath.empty()) {
+            textureImage = std::make_unique<ImageFile>(config.texturePath);
+            LOG("Texture: " << config.texturePath << ", " << textureImage->width() << "x" << textureImage->height());
+        }
+        if (config.meshPath.empty()) {
+            return;
+        }
+        const auto start = FramePacer::Clock::now();
+        meshFile = std::make_unique<MeshFile>(config.meshPath);
+        meshFile->prefetch(); // read-ahead runs while the device and swapchain are created
+        const auto& header = meshFile->header();
+        LOG("Mesh: " << config.meshPath << ", " << header.vertexCount << " vertices, " << header.indexCount / 3 << " triangles, mapped in "
+            << std::chrono::duration<double, std::milli>(FramePacer::Clock::now() - start).count() << " ms");
+    }
+
+    void createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties,
+                      vk::Buffer& buffer, vk::DeviceMemory& bufferMemory) {
+        vk::BufferCreateInfo bufferInfo({}, size, usage, vk::SharingMode::eExclusive);
+        buffer = device.createBuffer(bufferInfo);
+        auto memRequirements = device.getBufferMemoryRequirements(buffer);
+        vk::MemoryAllocateInfo allocInfo(memRequirements.size, findMemoryType(memRequirements.memoryTypeBits, properties));
+        bufferMemory = device.allocateMemory(allocInfo);
+        device.bindBufferMemory(buffer, bufferMemory, 0);
+    }
+
+    // Textures of the mesh: one combined image sampler per frame in flight, pointed at whatever image the streamer
+    // currently has resident (a white placeholder without --texture or until the first upload finished)
+    void createTextureStreaming() {
+        if (!meshFile) {
+            return;
+        }
+        textureSetLayout = layoutCache->descriptorSetLayout({&shaderReflection("mesh.frag.spv")}, 0);
+        vk::DescriptorPoolSize poolSize(vk::DescriptorType::eCombinedImageSampler, MAX_FRAMES_IN_FLIGHT);
+        vk::DescriptorPoolCreateInfo poolInfo({}, MAX_FRAMES_IN_FLIGHT, 1, &poolSize);
+        textureDescriptorPool = device.createDescriptorPool(poolInfo);
+        std::vector<vk::DescriptorSetLayout> setLayouts(MAX_FRAMES_IN_FLIGHT, textureSetLayout);
+        vk::DescriptorSetAllocateInfo allocInfo(textureDescriptorPool, MAX_FRAMES_IN_FLIGHT, setLayouts.data());
+        textureDescriptorSets = device.allocateDescriptorSets(allocInfo);
+        textureSetViews.assign(MAX_FRAMES_IN_FLIGHT, nullptr);
+
+        const QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+        textureStreamer = std::make_unique<TextureStreamer>(physicalDevice, device, indices.graphicsFamily.value(), transferQueue,
+                                                            indices.transferFamily.value(), vk::DeviceSize(config.textureBudgetMb) * 1024 * 1024,
+                                                            static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+        if (textureImage || textureKtx) {
+            textureHandle = textureStreamer->addTexture(textureSource());
+        }
+        if (indices.transferFamily != indices.graphicsFamily) {
+            LOG("Textures are uploaded on a separate transfer queue (family " << indices.transferFamily.value() << ")");
+        }
+    }
+
+    // Describes the --texture for the streamer. KTX2 levels are uploaded as stored when the device samples their format,
+    // block compressed formats it lacks are decoded to RGBA8 on the CPU once (kept across device recreation).
+    TextureSource textureSource() {
+        TextureSource source;
+        if (textureImage) {
+            source.width = textureImage->width();
+            source.height = textureImage->height();
+            source.levels = {textureImage->pixels()};
+            source.generateMips = true;
+            return source;
+        }
+        source.width = textureKtx->width();
+        source.height = textureKtx->height();
+        const auto format = static_cast<vk::Format>(textureKtx->vkFormat());
+        const auto features = physicalDevice.getFormatProperties(format).optimalTilingFeatures;
+        if (features & vk::FormatFeatureFlagBits::eSampledImage) {
+            source.format = format;
+            source.blockWidth = textureKtx->blockWidth();
+            source.blockHeight = textureKtx->blockHeight();
+            source.blockSize = textureKtx->blockBytes();
+            for (uint32_t level = 0; level < textureKtx->levelCount(); level++) {
+                source.levels.push_back(textureKtx->levelData(level));
+            }
+            source.generateMips = textureKtx->levelCount() == 1 && source.blockWidth == 1 &&
+                                  (features & vk::FormatFeatureFlagBits::eBlitSrc) && (features & vk::FormatFeatureFlagBits::eBlitDst);
+            return source;
+        }
+        if (!textureKtx->blockFormat()) {
+            throw std::runtime_error("the device can't sample the texture's format (VkFormat " + std::to_string(textureKtx->vkFormat()) +
+                                     ") and there is no CPU decoder for it");
+        }
+        if (decodedTexture.empty()) {
+            const auto start = FramePacer::Clock::now();
+            decodedTexture = textureKtx->decodeToRgba8(*jobs);
+            LOG("Texture format not supported by the device, decoded to RGBA8 on the CPU in "
+                << std::chrono::duration<double, std::milli>(FramePacer::Clock::now() - start).count() << " ms");
+        }
+        source.format = textureKtx->isSrgb() ? vk::Format::eR8G8B8A8Srgb : vk::Format::eR8G8B8A8Unorm;
+        const uint8_t* level = decodedTexture.data();
+        for (uint32_t index = 0; index < textureKtx->levelCount(); index++) {
+            source.levels.push_back(level);
+            level += size_t(std::max(source.width >> index, 1u)) * std::max(source.height >> index, 1u) * 4;
+        }
+        source.generateMips = textureKtx->levelCount() == 1;
+        return source;
+    }
+
+    void destroyTextureStreaming() {
+        textureStreamer.reset();
+        textureHandle.reset();
+        device.destroyDescriptorPool(textureDescriptorPool);
+        textureDescriptorPool = nullptr;
+        textureSetLayout = nullptr;
+        textureDescriptorSets.clear();
+    }
+
+    // Asks for the mip level that matches the mesh's size on screen, lets the streamer record its work and points
+    // this frame's descriptor set at the texture's current image. The set isn't in use, the frame's fence was waited for.
+    void recordTextureStreaming(vk::CommandBuffer commandBuffer, vk::Extent2D renderExtent) {
+        if (textureHandle) {
+            // The camera looks at the bounding sphere from a fixed distance, it covers this many pixels vertically.
+            // A texture mapped once around the mesh needs about as many texels, finer levels would only alias.
+            const float sphereAngle = std::asin(1.0f / MESH_CAMERA_DISTANCE);
+            const float pixels = std::max(float(renderExtent.height) * std::tan(sphereAngle) / std::tan(MESH_CAMERA_FOV * 0.5f), 1.0f);
+            const float texels = textureImage ? float(std::max(textureImage->width(), textureImage->height()))
+                                              : float(std::max(textureKtx->width(), textureKtx->height()));
+            const uint32_t mip = texels > pixels ? static_cast<uint32_t>(std::floor(std::log2(texels / pixels))) : 0;
+            textureStreamer->request(*textureHandle, mip, pixels);
+        }
+        textureStreamer->recordStreaming(commandBuffer, frameNumber);
+        if (textureStreamer->busy()) {
+            redrawRequested = true; // on demand rendering would otherwise stop before the texture arrived
+        }
+
+        const vk::ImageView view = textureHandle ? textureStreamer->view(*textureHandle) : textureStreamer->placeholderView();
+        if (textureSetViews[currentFrame] != view) {
+            vk::DescriptorImageInfo imageInfo(textureStreamer->sampler(), view, vk::ImageLayout::eShaderReadOnlyOptimal);
+            vk::WriteDescriptorSet write(textureDescriptorSets[currentFrame], 0, 0, 1, vk::DescriptorType::eCombinedImageSampler, &imageInfo);
+            device.updateDescriptorSets(1, &write, 0, nullptr);
+            textureSetViews[currentFrame] = view;
+        }
+    }
+
+    // Copies the vertex, index and meshlet blocks from the mapped file into device-local buffers. The staging ring
+    // reads straight from the mapped pages, so every byte is copied once on the CPU (page cache -> ring) and once on the GPU.
+    // The buffers only, their contents are copied by uploadMeshData
+    void createMeshBuffers() {
+        if (!meshFile) {
+            return;
+        }
+        const auto& header = meshFile->header();
+        const bool meshlets = activeMeshletMode != MeshletMode::Off;
+        vk::BufferUsageFlags vertexUsage = vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst;
+        if (activeMeshletMode == MeshletMode::MeshShader) {
+            vertexUsage |= vk::BufferUsageFlagBits::eStorageBuffer; // fetched by the mesh shader
+        }
+        createBuffer(meshFile->vertexDataSize(), vertexUsage, vk::MemoryPropertyFlagBits::eDeviceLocal, meshVertexBuffer, meshVertexBufferMemory);
+        createBuffer(meshFile->indexDataSize(), vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                     vk::MemoryPropertyFlagBits::eDeviceLocal, meshIndexBuffer, meshIndexBufferMemory);
+        if (meshlets) {
+            const vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst;
+            createBuffer(meshFile->meshletDataSize(), usage, vk::MemoryPropertyFlagBits::eDeviceLocal, meshletBuffer, meshletBufferMemory);
+            createBuffer(meshFile->meshletVertexDataSize(), usage, vk::MemoryPropertyFlagBits::eDeviceLocal,
+                         meshletVertexBuffer, meshletVertexBufferMemory);
+            createBuffer(meshFile->meshletTriangleDataSize(), usage, vk::MemoryPropertyFlagBits::eDeviceLocal,
+                         meshletTriangleBuffer, meshletTriangleBufferMemory);
+        }
+        meshIndexType = header.indexSize == 2 ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+        if (meshlets) {
+            createMeshletResources();
+        }
+    }
+
+    // Copies the mapped mesh file into the buffers of createMeshBuffers. Nothing but this and drawFrame submits to
+    // the graphics queue, so it runs as a job while the rest of the device objects are created (see startMeshUpload).
+    void uploadMeshData() {
+        if (!meshFile) {
+            return;
+        }
+        const auto start = FramePacer::Clock::now();
+        const bool meshlets = activeMeshletMode != MeshletMode::Off;
+        size_t uploadSize = meshFile->vertexDataSize() + meshFile->indexDataSize();
+        if (meshlets) {
+            uploadSize += meshFile->meshletDataSize() + meshFile->meshletVertexDataSize() + meshFile->meshletTriangleDataSize();
+        }
+        {
+            StagingRing stagingRing(physicalDevice, device, graphicsQueue, findQueueFamilies(physicalDevice).graphicsFamily.value(),
+                                    std::min<vk::DeviceSize>(STAGING_RING_SIZE, uploadSize + 256));
+            stagingRing.copyToBuffer(meshFile->vertexData(), meshFile->vertexDataSize(), meshVertexBuffer, 0);
+            stagingRing.copyToBuffer(meshFile->indexData(), meshFile->indexDataSize(), meshIndexBuffer, 0);
+            if (meshlets) {
+                stagingRing.copyToBuffer(meshFile->meshletData(), meshFile->meshletDataSize(), meshletBuffer, 0);
+                stagingRing.copyToBuffer(meshFile->meshletVertexData(), meshFile->meshletVertexDataSize(), meshletVertexBuffer, 0);
+                stagingRing.copyToBuffer(meshFile->meshletTriangleData(), meshFile->meshletTriangleDataSize(), meshletTriangleBuffer, 0);
+            }
+            stagingRing.finish();
+        }
+        const double ms = std::chrono::duration<double, std::milli>(FramePacer::Clock::now() - start).count();
+        const double megabytes = double(uploadSize) / (1024.0 * 1024.0);
+        LOG("Mesh uploaded: " << megabytes << " MB in " << ms << " ms (" << (ms > 0.0 ? megabytes * 1000.0 / ms : 0.0) << " MB/s)");
+    }
+
+    // The copies overlap the swapchain, pipeline and framebuffer creation; meshUploaded is waited for before the
+    // first frame is recorded, which rethrows the upload's errors. The job blocks its worker on the staging fences.
+    void startMeshUpload() {
+        jobs->run([this]() { uploadMeshData(); }, &meshUploaded);
+    }
+
+    void destroyMeshBuffers() {
+        destroyMeshletResources();
+        device.destroyBuffer(meshVertexBuffer);
+        device.freeMemory(meshVertexBufferMemory);
+        device.destroyBuffer(meshIndexBuffer);
+        device.freeMemory(meshIndexBufferMemory);
+        device.destroyBuffer(meshletBuffer);
+        device.freeMemory(meshletBufferMemory);
+        device.destroyBuffer(meshletVertexBuffer);
+        device.freeMemory(meshletVertexBufferMemory);
+        device.destroyBuffer(meshletTriangleBuffer);
+        device.freeMemory(meshletTriangleBufferMemory);
+        meshVertexBuffer = nullptr;
+        meshVertexBufferMemory = nullptr;
+        meshIndexBuffer = nullptr;
+        meshIndexBufferMemory = nullptr;
+        meshletBuffer = nullptr;
+        meshletBufferMemory = nullptr;
+        meshletVertexBuffer = nullptr;
+        meshletVertexBufferMemory = nullptr;
+        meshletTriangleBuffer = nullptr;
+        meshletTriangleBufferMemory = nullptr;
+    }
+
+    // Per frame in flight: the cull data uniform buffer and, for the indirect path, the compacted index buffer and
+    // draw command the compute shader writes. One descriptor set per frame binds them with the meshlet buffers.
+    void createMeshletResources() {
+        const bool meshShader = activeMeshletMode == MeshletMode::MeshShader;
+        // Set 0 is the texture of mesh.frag (an empty set for the compute culling), the meshlet buffers are set 1.
+        // The set 1 bindings are whatever the path's shaders use, see meshletBufferInfos().
+        std::vector<const ShaderReflection*> stages;
+        if (meshShader) {
+            stages = {&shaderReflection("meshlet.task.spv"), &shaderReflection("meshlet.mesh.spv"), &shaderReflection("mesh.frag.spv")};
+        } else {
+            stages = {&shaderReflection("meshlet-cull.comp.spv")};
+        }
+        const LayoutCache::PipelineLayout layout = layoutCache->pipelineLayout(stages);
+        if (layout.setLayouts.size() != 2) {
+            throw std::runtime_error("the meshlet shaders don't use descriptor set 1");
+        }
+        meshletPipelineLayout = layout.layout;
+        meshletSetLayout = layout.setLayouts[1];
+        if (meshShader) {
+            // Only the mesh shader declares them, the reflected range is for its stage alone
+            meshletPush = PushConstants<MeshPushConstants>(meshletPipelineLayout, layout.pushConstants,
+                                                           physicalDevice.getProperties().limits.maxPushConstantsSize);
+        }
+        std::vector<ShaderReflection::Binding> bindings;
+        for (const ShaderReflection* stage : stages) {
+            for (const auto& binding : stage->bindings) {
+                const bool known = std::any_of(bindings.begin(), bindings.end(),
+                                               [&](const ShaderReflection::Binding& b) { return b.binding == binding.binding; });
+                if (binding.set == 1 && !known) {
+                    bindings.push_back(binding);
+                }
+            }
+        }
+
+        std::map<vk::DescriptorType, uint32_t> descriptorCounts;
+        for (const auto& binding : bindings) {
+            descriptorCounts[binding.type] += binding.count * MAX_FRAMES_IN_FLIGHT;
+        }
+        std::vector<vk::DescriptorPoolSize> poolSizes;
+        for (const auto& count : descriptorCounts) {
+            poolSizes.push_back(vk::DescriptorPoolSize(count.first, count.second));
+        }
+        vk::DescriptorPoolCreateInfo poolInfo({}, MAX_FRAMES_IN_FLIGHT, static_cast<uint32_t>(poolSizes.size()), poolSizes.data());
+        meshletDescriptorPool = device.createDescriptorPool(poolInfo);
+        std::vector<vk::DescriptorSetLayout> frameSetLayouts(MAX_FRAMES_IN_FLIGHT, meshletSetLayout);
+        vk::DescriptorSetAllocateInfo allocInfo(meshletDescriptorPool, MAX_FRAMES_IN_FLIGHT, frameSetLayouts.data());
+        auto descriptorSets = device.allocateDescriptorSets(allocInfo);
+
+        const vk::DeviceSize indexBufferSize = vk::DeviceSize(meshFile->header().meshletTriangleCount) * 3 * sizeof(uint32_t);
+        meshletFrames.resize(MAX_FRAMES_IN_FLIGHT);
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            MeshletFrameResources& frame = meshletFrames[i];
+            frame.descriptorSet = descriptorSets[i];
+            createUploadBuffer(sizeof(MeshletCullData), vk::BufferUsageFlagBits::eUniformBuffer, frame.cullData);
+            // By binding number in meshlet-common.glsl, meshlet-cull.comp and meshlet.mesh
+            std::map<uint32_t, vk::DescriptorBufferInfo> bufferInfos = {
+                {0, {meshletBuffer, 0, VK_WHOLE_SIZE}},
+                {1, {frame.cullData.buffer, 0, VK_WHOLE_SIZE}},
+                {2, {meshletVertexBuffer, 0, VK_WHOLE_SIZE}},
+                {3, {meshletTriangleBuffer, 0, VK_WHOLE_SIZE}}
+            };
+            if (meshShader) {
+                bufferInfos[6] = {meshVertexBuffer, 0, VK_WHOLE_SIZE};
+            } else {
+                createBuffer(indexBufferSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndexBuffer,
+                             vk::MemoryPropertyFlagBits::eDeviceLocal, frame.indexBuffer, frame.indexBufferMemory);
+                createBuffer(sizeof(MeshletDrawCommand), vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer
+                             | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal,
+                             frame.drawCommandBuffer, frame.drawCommandBufferMemory);
+                bufferInfos[4] = {frame.indexBuffer, 0, VK_WHOLE_SIZE};
+                bufferInfos[5] = {frame.drawCommandBuffer, 0, VK_WHOLE_SIZE};
+            }
+            std::vector<vk::WriteDescriptorSet> writes;
+            for (const auto& binding : bindings) {
+                auto info = bufferInfos.find(binding.binding);
+                if (info == bufferInfos.end()) {
+                    throw std::runtime_error("no buffer for meshlet binding " + std::to_string(binding.binding));
+                }
+                writes.push_back(vk::WriteDescriptorSet(frame.descriptorSet, binding.binding, 0, 1, binding.type, nullptr, &info->second));
+            }
+            device.updateDescriptorSets(static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+        }
+
+        if (!meshShader) {
+            SpecializationConstants constants;
+            constants.set(SPEC_MESHLET_CULLING, config.meshletCulling).set(SPEC_CULL_WORKGROUP_SIZE, meshletCullWorkgroupSize());
+            meshletCullPipeline = pipelineVariants->get("meshlet-cull", constants,
+                                                        [&](vk::PipelineCache cache, const vk::SpecializationInfo* specialization) {
+                auto computeShaderModule = createShaderModule(readFile(getShaderPath() + "/meshlet-cull.comp.spv"));
+                vk::PipelineShaderStageCreateInfo stageInfo({}, vk::ShaderStageFlagBits::eCompute, computeShaderModule, "main", specialization);
+                vk::ComputePipelineCreateInfo pipelineInfo({}, stageInfo, meshletPipelineLayout);
+                const vk::Pipeline pipeline = device.createComputePipeline(cache, pipelineInfo);
+                device.destroyShaderModule(computeShaderModule);
+                return pipeline;
+            });
+        }
+    }
+
+    // Invocations per meshlet in meshlet-cull.comp, each strides over the triangles. AMD GPUs run 64 wide wavefronts,
+    // most others 32 wide (or narrower) subgroups; a workgroup of one subgroup needs no cross-subgroup synchronization.
+    uint32_t meshletCullWorkgroupSize() const {
+        const uint32_t VENDOR_AMD = 0x1002;
+        return physicalDevice.getProperties().vendorID == VENDOR_AMD ? 64 : 32;
+    }
+
+    void destroyMeshletResources() {
+        for (auto& frame : meshletFrames) {
+            destroyMappedBuffer(frame.cullData);
+            device.destroyBuffer(frame.indexBuffer);
+            device.freeMemory(frame.indexBufferMemory);
+            device.destroyBuffer(frame.drawCommandBuffer);
+            device.freeMemory(frame.drawCommandBufferMemory);
+        }
+        meshletFrames.clear();
+        pipelineVariants->destroy("meshlet-cull");
+        device.destroyDescriptorPool(meshletDescriptorPool);
+        meshletCullPipeline = nullptr;
+        meshletPipelineLayout = nullptr;
+        meshletPush = {};
+        meshletDescriptorPool = nullptr;
+        meshletSetLayout = nullptr;
+    }
+
+    // Updates this frame's cull data and, on the indirect path, records the culling dispatch. Every window shares the
+    // result, so the frustum is the widest one among them (same vertical field of view, the widest aspect contains the others).
+    void recordMeshletCulling(vk::CommandBuffer commandBuffer, vk::Extent2D renderExtent) {
+        float aspect = float(renderExtent.width) / float(std::max(renderExtent.height, 1u));
+        for (const auto& target : secondaryWindows) {
+            if (target.acquired) {
+                aspect = std::max(aspect, float(target.extent.width) / float(std::max(target.extent.height, 1u)));
+            }
+        }
+        const MeshCamera camera = meshCamera(aspect);
+        MeshletFrameResources& frame = meshletFrames[currentFrame];
+        MeshletCullData cullData{};
+        extractFrustumPlanes(camera.viewProjection, cullData.frustumPlanes);
+        cullData.cameraPosition[0] = camera.eye.x;
+        cullData.cameraPosition[1] = camera.eye.y;
+        cullData.cameraPosition[2] = camera.eye.z;
+        cullData.meshletCount = meshFile->header().meshletCount;
+        std::memcpy(frame.cullData.mapped, &cullData, sizeof(cullData)); // the frame's fence was waited for, the GPU is done with it
+        if (activeMeshletMode != MeshletMode::Indirect) {
+            return;
+        }
+
+        MeshletDrawCommand reset{};
+        reset.command.setInstanceCount(1);
+        commandBuffer.updateBuffer(frame.drawCommandBuffer, 0, sizeof(reset), &reset);
+        vk::MemoryBarrier toCompute(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {},
+                                      1, &toCompute, 0, nullptr, 0, nullptr);
+
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, meshletCullPipeline);
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, meshletPipelineLayout, 1, 1, &frame.descriptorSet, 0, nullptr);
+        // One workgroup per meshlet, wrapped into rows when there are more than a dimension can hold
+        const uint32_t meshletCount = cullData.meshletCount;
+        const uint32_t columns = std::min(meshletCount, 65535u);
+        commandBuffer.dispatch(columns, (meshletCount + columns - 1) / columns, 1);
+
+        vk::MemoryBarrier toDraw(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eIndexRead);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                      vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexInput, {},
+                                      1, &toDraw, 0, nullptr, 0, nullptr);
+    }
+
+    // Orbit camera around the mesh bounds, turned by the pointer
+    MeshCamera meshCamera(float aspect) const {
+        const auto& header = meshFile->header();
+        const Vec3 boundsMin{header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]};
+        const Vec3 boundsMax{header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]};
+        const Vec3 center = (boundsMin + boundsMax) * 0.5f;
+        const float radius = std::max(length(boundsMax - boundsMin) * 0.5f, 1e-4f);
+        const float yaw = frameState.pointerX * 0.01f;
+        const float pitch = std::clamp(0.4f - frameState.pointerY * 0.002f, -1.4f, 1.4f);
+        MeshCamera camera;
+        camera.eye = center + Vec3{std::sin(yaw) * std::cos(pitch), std::sin(pitch), std::cos(yaw) * std::cos(pitch)} * (radius * MESH_CAMERA_DISTANCE);
+        camera.viewProjection = perspective(MESH_CAMERA_FOV, aspect, radius * 0.05f, radius * 5.0f) * lookAt(camera.eye, center, Vec3{0.0f, 1.0f, 0.0f});
+        // Normals are stored in object space, which is world space here: the model matrix only dequantizes positions
+        camera.lightDirection = normalize(camera.eye - center + Vec3{0.0f, radius, 0.0f});
+        return camera;
+    }
+
+    // The quantized positions are in [0, 1]^3 relative to the bounds, the dequantization is folded into the model
+    // matrix so the vertex shader only does one transform
+    MeshPushConstants meshPushConstants(vk::Extent2D extent) const {
+        const auto& header = meshFile->header();
+        const Vec3 boundsMin{header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]};
+        const Vec3 boundsMax{header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]};
+        const MeshCamera camera = meshCamera(float(extent.width) / float(std::max(extent.height, 1u)));
+        MeshPushConstants constants{};
+        constants.mvp = camera.viewProjection * translation(boundsMin) * scaling(boundsMax - boundsMin);
+        constants.lightDirection[0] = camera.lightDirection.x;
+        constants.lightDirection[1] = camera.lightDirection.y;
+        constants.lightDirection[2] = camera.lightDirection.z;
+        return constants;
+    }
+
+    // --draws: per frame in flight, a uniform buffer and a storage buffer holding every draw's ObjectData, both
+    // host-visible and written in place. Only the paths in use get full-size buffers, the others a single element
+    // so the descriptor set stays complete. --scene uses the storage buffers, one element per node.
+    void createDrawDataResources() {
+        const uint32_t objectCount = config.sceneNodeCount > 0 ? config.sceneNodeCount : config.drawCount;
+        if (objectCount == 0) {
+            return;
+        }
+        const ShaderReflection& vertReflection = shaderReflection("draw-data.vert.spv");
+        // The uniform buffer becomes a dynamic one: a single descriptor serves every draw, each bind picks its element
+        std::vector<vk::DescriptorSetLayoutBinding> bindings;
+        for (const auto& binding : vertReflection.bindings) {
+            if (binding.set != 0) {
+                throw std::runtime_error("draw-data.vert only has descriptor set 0");
+            }
+            const vk::DescriptorType type = binding.type == vk::DescriptorType::eUniformBuffer ? vk::DescriptorType::eUniformBufferDynamic : binding.type;
+            bindings.push_back(vk::DescriptorSetLayoutBinding(binding.binding, type, binding.count, vertReflection.stage));
+        }
+        const vk::DescriptorSetLayout setLayout = layoutCache->descriptorSetLayout(bindings);
+        const vk::PushConstantRange pushConstants(vertReflection.stage, 0, vertReflection.pushConstantSize);
+        drawDataPipelineLayout = layoutCache->pipelineLayout({setLayout}, pushConstants);
+        const auto limits = physicalDevice.getProperties().limits;
+        drawDataPush = PushConstants<ObjectData>(drawDataPipelineLayout, pushConstants, limits.maxPushConstantsSize);
+
+        // Dynamic offsets must be multiples of minUniformBufferOffsetAlignment (up to 256 bytes), which spreads the
+        // elements out: part of what the uniform path costs
+        const vk::DeviceSize alignment = std::max<vk::DeviceSize>(limits.minUniformBufferOffsetAlignment, 1);
+        drawUniformStride = (OBJECT_DATA_STRIDE + alignment - 1) / alignment * alignment;
+        const vk::DeviceSize uniformCount = usesDrawDataPath(DrawDataPath::DynamicUniform) ? objectCount : 1;
+        const vk::DeviceSize storageCount = usesDrawDataPath(DrawDataPath::Storage) ? objectCount : 1;
+        if (storageCount * OBJECT_DATA_STRIDE > limits.maxStorageBufferRange) {
+            throw std::runtime_error("the per-object data of " + std::to_string(objectCount) + " objects exceeds the device's "
+                                     + std::to_string(limits.maxStorageBufferRange >> 20) + " MB storage buffer range");
+        }
+        if (usesDrawDataPath(DrawDataPath::Push)) {
+            drawDataScratch.resize(config.drawCount);
+        }
+
+        vk::DescriptorPoolSize poolSizes[] = {
+            {vk::DescriptorType::eUniformBufferDynamic, MAX_FRAMES_IN_FLIGHT},
+            {vk::DescriptorType::eStorageBuffer, MAX_FRAMES_IN_FLIGHT}
+        };
+        vk::DescriptorPoolCreateInfo poolInfo({}, MAX_FRAMES_IN_FLIGHT, 2, poolSizes);
+        drawDataDescriptorPool = device.createDescriptorPool(poolInfo);
+        std::vector<vk::DescriptorSetLayout> frameSetLayouts(MAX_FRAMES_IN_FLIGHT, setLayout);
+        vk::DescriptorSetAllocateInfo allocInfo(drawDataDescriptorPool, MAX_FRAMES_IN_FLIGHT, frameSetLayouts.data());
+        auto descriptorSets = device.allocateDescriptorSets(allocInfo);
+
+        drawDataFrames.resize(MAX_FRAMES_IN_FLIGHT);
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            DrawDataFrameResources& frame = drawDataFrames[i];
+            frame.descriptorSet = descriptorSets[i];
+            createUploadBuffer(uniformCount * drawUniformStride, vk::BufferUsageFlagBits::eUniformBuffer, frame.uniforms);
+            createUploadBuffer(storageCount * OBJECT_DATA_STRIDE, vk::BufferUsageFlagBits::eStorageBuffer, frame.storage);
+            // By binding number in draw-data.vert
+            std::map<uint32_t, vk::DescriptorBufferInfo> bufferInfos = {
+                {0, {frame.uniforms.buffer, 0, OBJECT_DATA_STRIDE}}, // one element, the dynamic offset moves it
+                {1, {frame.storage.buffer, 0, VK_WHOLE_SIZE}}
+            };
+            std::vector<vk::WriteDescriptorSet> writes;
+            for (const auto& binding : bindings) {
+                auto info = bufferInfos.find(binding.binding);
+                if (info == bufferInfos.end()) {
+                    throw std::runtime_error("no buffer for draw data binding " + std::to_string(binding.binding));
+                }
+                writes.push_back(vk::WriteDescriptorSet(frame.descriptorSet, binding.binding, 0, 1, binding.descriptorType, nullptr, &info->second));
+            }
+            device.updateDescriptorSets(static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+        }
+        sceneStreams = {}; // new buffers: the scene's instances are written in full again
+    }
+
+    void destroyDrawDataResources() {
+        for (auto& frame : drawDataFrames) {
+            destroyMappedBuffer(frame.uniforms);
+            destroyMappedBuffer(frame.storage);
+        }
+        drawDataFrames.clear();
+        device.destroyDescriptorPool(drawDataDescriptorPool);
+        drawDataDescriptorPool = nullptr;
+        drawDataPipelineLayout = nullptr;
+        drawDataPush = {};
+    }
+
+    bool usesDrawDataPath(DrawDataPath path) const {
+        return config.drawDataPath == path || config.drawDataPath == DrawDataPath::All;
+    }
+
+    // With --draw-data all, the measured benchmark frames are split into thirds: push constants (also during the
+    // warm-up), then the dynamic uniform buffer, then the storage buffer
+    DrawDataPath currentDrawDataPath() const {
+        if (config.drawDataPath != DrawDataPath::All) {
+            return config.drawDataPath;
+        }
+        if (frameNumber < config.benchmarkWarmupFrames) {
+            return DrawDataPath::Push;
+        }
+        const uint64_t measured = frameNumber - config.benchmarkWarmupFrames;
+        return static_cast<DrawDataPath>(std::min<uint64_t>(measured * 3 / config.benchmarkFrames, 2));
+    }
+
+    // Animates the quads of --draws: a grid of spinning quads covering the render area. The transforms cost the
+    // same on every path, only their destination differs: an array pushed draw by draw, or the frame's mapped
+    // uniform or storage buffer (the frame's fence was waited for, the GPU is done with it).
+    void writeDrawData(vk::Extent2D renderExtent) {
+        const DrawDataPath path = currentDrawDataPath();
+        drawDataPathOfSlot[currentFrame] = path;
+        DrawDataFrameResources& frame = drawDataFrames[currentFrame];
+        uint8_t* destination = reinterpret_cast<uint8_t*>(drawDataScratch.data());
+        vk::DeviceSize stride = sizeof(ObjectData);
+        if (path == DrawDataPath::DynamicUniform) {
+            destination = static_cast<uint8_t*>(frame.uniforms.mapped);
+            stride = drawUniformStride;
+        } else if (path == DrawDataPath::Storage) {
+            destination = static_cast<uint8_t*>(frame.storage.mapped);
+            stride = OBJECT_DATA_STRIDE;
+        }
+
+        const uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(double(config.drawCount))));
+        const float cell = 2.0f / float(columns);
+        const float aspect = float(renderExtent.width) / float(std::max(renderExtent.height, 1u));
+        // Quads stay square: the longer axis of the render area is scaled down
+        const float scaleX = cell * 0.4f * std::min(1.0f, 1.0f / aspect);
+        const float scaleY = cell * 0.4f * std::min(1.0f, aspect);
+        const float time = float(frameNumber % 100000) * 0.02f;
+        // Spread across the job threads, each chunk writes its own range of the buffer
+        jobs->parallelFor(config.drawCount, DRAW_DATA_JOB_SIZE, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+                const float angle = time + float(i) * 0.1f;
+                const float c = std::cos(angle);
+                const float s = std::sin(angle);
+                ObjectData object;
+                object.transform.at(0, 0) = c * scaleX;
+                object.transform.at(0, 1) = s * scaleY;
+                object.transform.at(1, 0) = -s * scaleX;
+                object.transform.at(1, 1) = c * scaleY;
+                object.transform.at(3, 0) = -1.0f + cell * (float(i % columns) + 0.5f);
+                object.transform.at(3, 1) = -1.0f + cell * (float(i / columns) + 0.5f);
+                object.objectId = i;
+                std::memcpy(destination + i * stride, &object, sizeof(object));
+            }
+        });
+    }
+
+    // --scene: a tree of quads built breadth first, SCENE_FANOUT children around every node until there are
+    // config.sceneNodeCount of them. Every other top-level branch spins, and its children with it; the other branches
+    // stand still, their subtrees stay clean and are neither recomputed nor rewritten into the instance buffers.
+    void createScene() {
+        if (config.sceneNodeCount == 0) {
+            return;
+        }
+        sceneRoot = scene.addNode(SceneGraph::k_noParent, Mat4());
+        for (uint32_t i = 1; i < config.sceneNodeCount; i++) {
+            const SceneGraph::NodeId parent = (i - 1) / SCENE_FANOUT; // breadth first: the ids are the indices
+            const SceneGraph::NodeId node = scene.addNode(parent, scenePlacement(i, 0.0f));
+            // Top-level nodes are 1..SCENE_FANOUT, the even-numbered branches spin along with their own children
+            const bool spins = parent == sceneRoot ? (i - 1) % 2 == 0 : parent <= SCENE_FANOUT && (parent - 1) % 2 == 0;
+            if (spins) {
+                sceneSpinning.push_back(node);
+            }
+        }
+        LOG("Scene: " << config.sceneNodeCount << " nodes, " << sceneSpinning.size() << " of them spinning");
+    }
+
+    // Local transform of node i of the --scene tree: on a circle around its parent, turned by `angle`
+    Mat4 scenePlacement(uint32_t i, float angle) const {
+        const float around = 2.0f * 3.14159265f * float((i - 1) % SCENE_FANOUT) / float(SCENE_FANOUT);
+        const Vec3 position{SCENE_CHILD_DISTANCE * std::cos(around), SCENE_CHILD_DISTANCE * std::sin(around), 0.0f};
+        return translation(position) * rotationZ(around + angle) * scaling({SCENE_CHILD_SCALE, SCENE_CHILD_SCALE, 1.0f});
+    }
+
+    // Animates the --scene and streams the world matrices that changed into this frame's storage buffer (the frame's
+    // fence was waited for). The buffers of the other frames in flight catch up when their turn comes.
+    void updateScene(vk::Extent2D renderExtent) {
+        const auto start = FramePacer::Clock::now();
+        if (renderExtent != sceneExtent) {
+            // The root fits the tree into the render area, square: changing it updates the whole tree
+            const float aspect = float(renderExtent.width) / float(std::max(renderExtent.height, 1u));
+            const float size = (1.0f - SCENE_CHILD_SCALE) / SCENE_CHILD_DISTANCE;
+            scene.setLocal(sceneRoot, scaling({size * std::min(1.0f, 1.0f / aspect), size * std::min(1.0f, aspect), 1.0f}));
+            sceneExtent = renderExtent;
+        }
+        const float time = float(frameNumber % 100000) * 0.02f;
+        for (SceneGraph::NodeId node : sceneSpinning) {
+            const bool topLevel = node <= SCENE_FANOUT;
+            scene.setLocal(node, scenePlacement(node, topLevel ? time * 0.5f : time * -1.5f));
+        }
+        SceneGraph::InstanceStream& stream = sceneStreams[currentFrame];
+        stream.destination = static_cast<uint8_t*>(drawDataFrames[currentFrame].storage.mapped);
+        stream.stride = OBJECT_DATA_STRIDE;
+        lastSceneUpdatedNodes = scene.update(*jobs, &stream);
+        lastSceneUpdateMs = std::chrono::duration<double, std::milli>(FramePacer::Clock::now() - start).count();
+    }
+
+    // --particles: the state lives in two device-local storage buffers, each simulation step reads one and writes
+    // the other, so no invocation sees another's half-written particle. The frames in flight share them: the steps
+    // are ordered on the queue by barriers (see recordParticleSimulation). The simulation pipelines are created
+    // for every workgroup size the benchmark compares.
+    void createParticleResources() {
+        if (config.particleCount == 0) {
+            return;
+        }
+        const auto limits = physicalDevice.getProperties().limits;
+        const vk::DeviceSize stateSize = vk::DeviceSize(config.particleCount) * PARTICLE_STRIDE;
+        if (stateSize > limits.maxStorageBufferRange) {
+            throw std::runtime_error("--particles needs " + std::to_string(stateSize >> 20) + " MB storage buffers, the device binds at most "
+                                     + std::to_string(limits.maxStorageBufferRange >> 20) + " MB");
+        }
+        particleWorkgroupSizes.clear();
+        particleDefaultWorkgroup = 0;
+        for (uint32_t size : PARTICLE_WORKGROUP_SIZES) {
+            if (size > limits.maxComputeWorkGroupSize[0] || size > limits.maxComputeWorkGroupInvocations) {
+                continue;
+            }
+            if (size <= 256) {
+                particleDefaultWorkgroup = particleWorkgroupSizes.size(); // a common sweet spot, when not benchmarking them
+            }
+            particleWorkgroupSizes.push_back(size);
+        }
+        for (size_t i = 0; i < particleStateBuffers.size(); i++) {
+            createBuffer(stateSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                         vk::MemoryPropertyFlagBits::eDeviceLocal, particleStateBuffers[i], particleStateMemory[i]);
+        }
+
+        const LayoutCache::PipelineLayout simulationLayout = layoutCache->pipelineLayout({&shaderReflection("particle-simulation.comp.spv")});
+        const LayoutCache::PipelineLayout drawLayout = layoutCache->pipelineLayout({&shaderReflection("particle.vert.spv"),
+                                                                                    &shaderReflection("shader.frag.spv")});
+        particleSimulationPipelineLayout = simulationLayout.layout;
+        particleDrawPipelineLayout = drawLayout.layout;
+        particleSimulationPush = PushConstants<ParticleSimulationParameters>(particleSimulationPipelineLayout, simulationLayout.pushConstants,
+                                                                             limits.maxPushConstantsSize);
+
+        // Two sets per pipeline, one per direction: simulation set i reads state i and writes the other one,
+        // draw set i reads state i
+        vk::DescriptorPoolSize poolSize(vk::DescriptorType::eStorageBuffer, 6);
+        vk::DescriptorPoolCreateInfo poolInfo({}, 4, 1, &poolSize);
+        particleDescriptorPool = device.createDescriptorPool(poolInfo);
+        const vk::DescriptorSetLayout setLayouts[] = {simulationLayout.setLayouts[0], simulationLayout.setLayouts[0],
+                                                      drawLayout.setLayouts[0], drawLayout.setLayouts[0]};
+        vk::DescriptorSetAllocateInfo allocInfo(particleDescriptorPool, 4, setLayouts);
+        auto descriptorSets = device.allocateDescriptorSets(allocInfo);
+        for (size_t i = 0; i < 2; i++) {
+            particleSimulationSets[i] = descriptorSets[i];
+            particleDrawSets[i] = descriptorSets[2 + i];
+            // By binding number in particle-simulation.comp and particle.vert
+            const vk::DescriptorBufferInfo source(particleStateBuffers[i], 0, VK_WHOLE_SIZE);
+            const vk::DescriptorBufferInfo destination(particleStateBuffers[1 - i], 0, VK_WHOLE_SIZE);
+            const vk::WriteDescriptorSet writes[] = {
+                {particleSimulationSets[i], 0, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &source},
+                {particleSimulationSets[i], 1, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &destination},
+                {particleDrawSets[i], 0, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &source}
+            };
+            device.updateDescriptorSets(3, writes, 0, nullptr);
+        }
+
+        auto computeShaderModule = createShaderModule(readFile(getShaderPath() + "/particle-simulation.comp.spv"));
+        particleSimulationPipelines.clear();
+        for (uint32_t size : particleWorkgroupSizes) {
+            SpecializationConstants constants;
+            constants.set(SPEC_PARTICLE_WORKGROUP_SIZE, size);
+            particleSimulationPipelines.push_back(pipelineVariants->get("particle-simulation", constants,
+                                                                        [&](vk::PipelineCache cache, const vk::SpecializationInfo* specialization) {
+                vk::PipelineShaderStageCreateInfo stageInfo({}, vk::ShaderStageFlagBits::eCompute, computeShaderModule, "main", specialization);
+                vk::ComputePipelineCreateInfo pipelineInfo({}, stageInfo, particleSimulationPipelineLayout);
+                return device.createComputePipeline(cache, pipelineInfo);
+            }));
+        }
+        device.destroyShaderModule(computeShaderModule);
+
+        particleStateReset = true;
+        particleSource = 0;
+        particleSteps = 0;
+        LOG("Particles: " << config.particleCount << ", " << double(2 * stateSize) / (1024.0 * 1024.0) << " MB of state");
+    }
+
+    void destroyParticleResources() {
+        for (size_t i = 0; i < particleStateBuffers.size(); i++) {
+            device.destroyBuffer(particleStateBuffers[i]);
+            device.freeMemory(particleStateMemory[i]);
+            particleStateBuffers[i] = nullptr;
+            particleStateMemory[i] = nullptr;
+        }
+        pipelineVariants->destroy("particle-simulation");
+        particleSimulationPipelines.clear();
+        device.destroyDescriptorPool(particleDescriptorPool);
+        particleDescriptorPool = nullptr;
+        particleSimulationPipelineLayout = nullptr;
+        particleDrawPipelineLayout = nullptr;
+        particleSimulationPush = {};
+    }
+
+    // --sprites: the vertex ring holds MAX_FRAMES_IN_FLIGHT regions of config.spriteCount sprites, host-visible and
+    // mapped for its lifetime; a frame writes its own region once its fence was waited for. The atlas is a texture
+    // array sampled through one descriptor set, uploaded by uploadSpriteAtlas.
+    void createSpriteResources() {
+        if (config.spriteCount == 0) {
+            return;
+        }
+        spriteCapacity = config.spriteCount;
+        createUploadBuffer(vk::DeviceSize(spriteCapacity) * sizeof(SpriteVertex) * MAX_FRAMES_IN_FLIGHT,
+                           vk::BufferUsageFlagBits::eVertexBuffer, spriteRing);
+
+        createImage(SPRITE_ATLAS_SIZE, SPRITE_ATLAS_SIZE, vk::Format::eR8G8B8A8Unorm, vk::ImageTiling::eOptimal,
+                    vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled, vk::MemoryPropertyFlagBits::eDeviceLocal,
+                    spriteAtlas, spriteAtlasMemory, SPRITE_ATLAS_LAYERS);
+        vk::ImageViewCreateInfo viewInfo{};
+        viewInfo.setImage(spriteAtlas)
+            .setViewType(vk::ImageViewType::e2DArray)
+            .setFormat(vk::Format::eR8G8B8A8Unorm)
+            .setSubresourceRange({vk::ImageAspectFlagBits::eColor, 0, 1, 0, SPRITE_ATLAS_LAYERS});
+        spriteAtlasView = device.createImageView(viewInfo);
+        vk::SamplerCreateInfo samplerInfo{};
+        samplerInfo.setMagFilter(vk::Filter::eLinear)
+            .setMinFilter(vk::Filter::eLinear)
+            .setAddressModeU(vk::SamplerAddressMode::eClampToEdge)
+            .setAddressModeV(vk::SamplerAddressMode::eClampToEdge)
+            .setAddressModeW(vk::SamplerAddressMode::eClampToEdge);
+        spriteSampler = device.createSampler(samplerInfo);
+
+        const LayoutCache::PipelineLayout layout = layoutCache->pipelineLayout({&shaderReflection("sprite.vert.spv"),
+                                                                                &shaderReflection("sprite.frag.spv")});
+        spritePipelineLayout = layout.layout;
+        spritePush = PushConstants<SpriteView>(spritePipelineLayout, layout.pushConstants, physicalDevice.getProperties().limits.maxPushConstantsSize);
+        vk::DescriptorPoolSize poolSize(vk::DescriptorType::eCombinedImageSampler, 1);
+        vk::DescriptorPoolCreateInfo poolInfo({}, 1, 1, &poolSize);
+        spriteDescriptorPool = device.createDescriptorPool(poolInfo);
+        vk::DescriptorSetAllocateInfo allocInfo(spriteDescriptorPool, 1, &layout.setLayouts[0]);
+        spriteDescriptorSet = device.allocateDescriptorSets(allocInfo)[0];
+        const vk::DescriptorImageInfo imageInfo(spriteSampler, spriteAtlasView, vk::ImageLayout::eShaderReadOnlyOptimal);
+        const vk::WriteDescriptorSet write(spriteDescriptorSet, 0, 0, 1, vk::DescriptorType::eCombinedImageSampler, &imageInfo);
+        device.updateDescriptorSets(1, &write, 0, nullptr);
+        spriteBatches.clear();
+    }
+
+    void destroySpriteResources() {
+        if (!spriteAtlas) {
+            return;
+        }
+        destroyMappedBuffer(spriteRing);
+        device.destroyDescriptorPool(spriteDescriptorPool);
+        device.destroySampler(spriteSampler);
+        device.destroyImageView(spriteAtlasView);
+        device.destroyImage(spriteAtlas);
+        device.freeMemory(spriteAtlasMemory);
+        spriteDescriptorPool = nullptr;
+        spriteSampler = nullptr;
+        spriteAtlasView = nullptr;
+        spriteAtlas = nullptr;
+        spriteAtlasMemory = nullptr;
+        spritePipelineLayout = nullptr;
+        spritePush = {};
+    }
+
+    // The pages of the sprite atlas, 2x2 cells each: a disc, a ring, a rounded panel and a diamond, with hard
+    // (antialiased) edges on page 0 and a soft glow on page 1. White, the sprites tint them.
+    std::vector<uint8_t> generateSpriteAtlas() const {
+        const uint32_t cell = SPRITE_ATLAS_SIZE / 2;
+        std::vector<uint8_t> texels(size_t(SPRITE_ATLAS_SIZE) * SPRITE_ATLAS_SIZE * 4 * SPRITE_ATLAS_LAYERS);
+        for (uint32_t layer = 0; layer < SPRITE_ATLAS_LAYERS; layer++) {
+            for (uint32_t y = 0; y < SPRITE_ATLAS_SIZE; y++) {
+                for (uint32_t x = 0; x < SPRITE_ATLAS_SIZE; x++) {
+                    // -1..1 within the cell
+                    const float u = (float(x % cell) + 0.5f) / float(cell) * 2.0f - 1.0f;
+                    const float v = (float(y % cell) + 0.5f) / float(cell) * 2.0f - 1.0f;
+                    const uint32_t shape = (y / cell) * 2 + x / cell;
+                    float distance = 0.0f; // signed, in cell units: negative inside
+                    if (shape == 0) {
+                        distance = std::sqrt(u * u + v * v) - 0.9f;
+                    } else if (shape == 1) {
+                        distance = std::abs(std::sqrt(u * u + v * v) - 0.7f) - 0.2f;
+                    } else if (shape == 2) {
+                        const float qx = std::max(std::abs(u) - 0.7f, 0.0f);
+                        const float qy = std::max(std::abs(v) - 0.7f, 0.0f);
+                        distance = std::sqrt(qx * qx + qy * qy) - 0.2f;
+                    } else {
+                        distance = (std::abs(u) + std::abs(v)) * 0.7071f - 0.65f;
+                    }
+                    const float pixel = 2.0f / float(cell);
+                    const float alpha = layer == 0 ? std::clamp(0.5f - distance / pixel, 0.0f, 1.0f)
+                                                   : std::clamp(1.0f - (distance + 0.3f) / 0.4f, 0.0f, 1.0f) * 0.8f;
+                    uint8_t* texel = &texels[((size_t(layer) * SPRITE_ATLAS_SIZE + y) * SPRITE_ATLAS_SIZE + x) * 4];
+                    texel[0] = texel[1] = texel[2] = 255;
+                    texel[3] = static_cast<uint8_t>(alpha * 255.0f + 0.5f);
+                }
+            }
+        }
+        return texels;
+    }
+
+    // On the graphics queue, so only once the mesh upload job is done with it
+    void uploadSpriteAtlas() {
+        if (!spriteAtlas) {
+            return;
+        }
+        const std::vector<uint8_t> texels = generateSpriteAtlas();
+        StagingRing stagingRing(physicalDevice, device, graphicsQueue, findQueueFamilies(physicalDevice).graphicsFamily.value(),
+                                texels.size() + 256);
+        const vk::ImageSubresourceRange layers(vk::ImageAspectFlagBits::eColor, 0, 1, 0, SPRITE_ATLAS_LAYERS);
+        vk::ImageMemoryBarrier toTransfer({}, vk::AccessFlagBits::eTransferWrite, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+                                          VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, spriteAtlas, layers);
+        stagingRing.commandBuffer().pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {},
+                                                    0, nullptr, 0, nullptr, 1, &toTransfer);
+        const size_t layerSize = size_t(SPRITE_ATLAS_SIZE) * SPRITE_ATLAS_SIZE * 4;
+        for (uint32_t layer = 0; layer < SPRITE_ATLAS_LAYERS; layer++) {
+            stagingRing.copyToImage(texels.data() + layer * layerSize, SPRITE_ATLAS_SIZE, SPRITE_ATLAS_SIZE, 0, SPRITE_ATLAS_SIZE,
+                                    SPRITE_ATLAS_SIZE * 4, 1, spriteAtlas, 0, layer);
+        }
+        vk::ImageMemoryBarrier toShader(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead, vk::ImageLayout::eTransferDstOptimal,
+                                        vk::ImageLayout::eShaderReadOnlyOptimal, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, spriteAtlas, layers);
+        stagingRing.commandBuffer().pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {},
+                                                    0, nullptr, 0, nullptr, 1, &toShader);
+        stagingRing.finish();
+    }
+
+    // The --sprites overlay: sprites drifting across the render area, every 16th a translucent panel drawn below
+    // the others, glowing ones blended additively. They are submitted in an order that switches state from one
+    // sprite to the next; the batcher still draws them all with two draws: the panels and the alpha-blended sprites
+    // above them are neighbours in draw order with the same pipeline, one draw, the additive ones the other.
+    void buildSprites(vk::Extent2D extent) {
+        const auto start = FramePacer::Clock::now();
+        const float width = float(extent.width);
+        const float height = float(extent.height);
+        const float time = float(frameNumber % 100000) * (1.0f / 60.0f);
+        auto wrap = [](float value, float range) { return value - range * std::floor(value / range); };
+        spriteBatcher.begin();
+        for (uint32_t i = 0; i < config.spriteCount; i++) {
+            const uint32_t hash = i * 2654435761u;
+            const bool panel = i % 16 == 0;
+            const uint32_t layer = panel ? 0 : (hash >> 7) & 1;
+            const uint32_t shape = panel ? 2 : (hash >> 5) & 3;
+            SpriteState state;
+            state.order = panel ? 0 : 1;
+            state.pipeline = static_cast<uint8_t>(layer == 1 ? SpriteBlend::Additive : SpriteBlend::Alpha);
+
+            SpriteVertex sprite;
+            const float size = panel ? 64.0f : 8.0f + float(hash >> 28) * 2.0f;
+            const float velocityX = float(int32_t((hash >> 8) & 0xff) - 128) * 0.5f; // pixels per second
+            const float velocityY = float(int32_t((hash >> 16) & 0xff) - 128) * 0.5f;
+            sprite.position[0] = wrap(float(hash & 0xffff) / 65535.0f * width + velocityX * time, width + size) - size;
+            sprite.position[1] = wrap(float(hash >> 16) / 65535.0f * height + velocityY * time, height + size) - size;
+            sprite.size[0] = size;
+            sprite.size[1] = size;
+            // The cell, half a texel inside so linear filtering doesn't reach into the neighbours
+            const uint16_t inset = static_cast<uint16_t>(65535 / (2 * SPRITE_ATLAS_SIZE));
+            sprite.texRect[0] = static_cast<uint16_t>((shape & 1) * 32767 + inset);
+            sprite.texRect[1] = static_cast<uint16_t>((shape >> 1) * 32767 + inset);
+            sprite.texRect[2] = static_cast<uint16_t>((shape & 1) * 32767 + 32767 - inset);
+            sprite.texRect[3] = static_cast<uint16_t>((shape >> 1) * 32767 + 32767 - inset);
+            sprite.color = panel ? 0xa0302020u : (0xff000000u | 0x808080u | (hash & 0x7f7f7fu));
+            sprite.layer = layer;
+            spriteBatcher.add(state, sprite);
+        }
+        SpriteVertex* region = static_cast<SpriteVertex*>(spriteRing.mapped) + currentFrame * spriteCapacity;
+        spriteBatches = spriteBatcher.finish(region, spriteCapacity);
+        if (spriteBatcher.dropped() > 0) {
+            LOG_LIMITED(LogLevel::Warning, "Sprite ring full: " << spriteBatcher.dropped() << " sprites dropped");
+        }
+        lastSpriteBatchMs = std::chrono::duration<double, std::milli>(FramePacer::Clock::now() - start).count();
+    }
+
+    // One instanced draw per batch, state only set where it changes
+    void drawSprites(vk::CommandBuffer commandBuffer, vk::Extent2D extent) {
+        if (spriteBatches.empty()) {
+            return;
+        }
+        vk::Viewport viewport(0.0f, 0.0f, (float)extent.width, (float)extent.height, 0.0f, 1.0f);
+        vk::Rect2D scissor({0, 0}, extent);
+        const vk::DeviceSize offset = vk::DeviceSize(currentFrame) * spriteCapacity * sizeof(SpriteVertex);
+        commandBuffer.bindVertexBuffers(0, 1, &spriteRing.buffer, &offset);
+        SpriteView view{};
+        view.pixelToClip[0] = 2.0f / float(extent.width);
+        view.pixelToClip[1] = 2.0f / float(extent.height);
+        uint32_t boundPipeline = UINT32_MAX;
+        for (const SpriteBatcher::Batch& batch : spriteBatches) {
+            if (batch.pipeline != boundPipeline) {
+                commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, spritePipelines[batch.pipeline]);
+                if (boundPipeline == UINT32_MAX) {
+                    // Same layout for both pipelines: set once, the bindings survive the pipeline switches
+                    commandBuffer.setViewport(0, 1, &viewport);
+                    commandBuffer.setScissor(0, 1, &scissor);
+                    spritePush.push(commandBuffer, view);
+                    // A single texture array holds every atlas page, so batch.texture is always 0
+                    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, spritePipelineLayout, 0, 1,
+                                                     &spriteDescriptorSet, 0, nullptr);
+                }
+                boundPipeline = batch.pipeline;
+            }
+            commandBuffer.draw(6, batch.spriteCount, 0, batch.firstSprite);
+        }
+    }
+
+    // The benchmark splits its measured frames evenly between the workgroup sizes, smallest first. Otherwise, and
+    // during the warm-up, the default size is used.
+    size_t currentParticleWorkgroup() const {
+        if (!config.benchmark || frameNumber < config.benchmarkWarmupFrames) {
+            return particleDefaultWorkgroup;
+        }
+        const uint64_t measured = frameNumber - config.benchmarkWarmupFrames;
+        return static_cast<size_t>(std::min<uint64_t>(measured * particleWorkgroupSizes.size() / config.benchmarkFrames,
+                                                      particleWorkgroupSizes.size() - 1));
+    }
+
+    // One simulation step, recorded before the render pass and timed on its own. The frames in flight share the
+    // state, so the previous frame's step and draw may still be running: the first barrier orders this step after
+    // them (its source is what the previous step wrote, its destination what the previous step read), the second
+    // one orders this frame's draws after it.
+    void recordParticleSimulation(vk::CommandBuffer commandBuffer) {
+        if (particleStateReset) {
+            // Zeroed particles are dead, the first step spawns all of them
+            for (vk::Buffer buffer : particleStateBuffers) {
+                commandBuffer.fillBuffer(buffer, 0, VK_WHOLE_SIZE, 0);
+            }
+            vk::MemoryBarrier cleared(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {},
+                                          1, &cleared, 0, nullptr, 0, nullptr);
+            particleStateReset = false;
+        } else {
+            vk::MemoryBarrier previousStep(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eVertexShader,
+                                          vk::PipelineStageFlagBits::eComputeShader, {}, 1, &previousStep, 0, nullptr, 0, nullptr);
+        }
+
+        const size_t workgroup = currentParticleWorkgroup();
+        particleWorkgroupOfSlot[currentFrame] = workgroup;
+        const uint32_t workgroupSize = particleWorkgroupSizes[workgroup];
+        ParticleSimulationParameters parameters{};
+        parameters.deltaTime = PARTICLE_TIME_STEP;
+        parameters.time = float(particleSteps) * PARTICLE_TIME_STEP;
+        parameters.count = config.particleCount;
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, particleSimulationPipelines[workgroup]);
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, particleSimulationPipelineLayout, 0, 1,
+                                         &particleSimulationSets[particleSource], 0, nullptr);
+        particleSimulationPush.push(commandBuffer, parameters);
+
+        const uint32_t firstTimestamp = static_cast<uint32_t>(currentFrame) * 2;
+        if (particleQueryPool) {
+            commandBuffer.resetQueryPool(particleQueryPool, firstTimestamp, 2);
+            commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, particleQueryPool, firstTimestamp);
+        }
+        // Wrapped into rows when there are more workgroups than a dimension can hold
+        const uint32_t groups = (config.particleCount + workgroupSize - 1) / workgroupSize;
+        const uint32_t columns = std::min(groups, 65535u);
+        commandBuffer.dispatch(columns, (groups + columns - 1) / columns, 1);
+        if (particleQueryPool) {
+            commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, particleQueryPool, firstTimestamp + 1);
+        }
+
+        vk::MemoryBarrier toDraw(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eVertexShader, {},
+                                      1, &toDraw, 0, nullptr, 0, nullptr);
+        particleSource = 1 - particleSource; // what was just written is drawn, and read by the next step
+        particleSteps++;
+    }
+
+    void createFramebuffers() {
+        if (dynamicResolution) {
+            createSceneRenderTarget();
+            return;
+        }
+        createDepthImage(swapChainExtent, depthImage, depthImageMemory, depthImageView);
+        createPostProcessTargets(swapChainExtent);
+        swapChainFramebuffers.resize(swapChainImageViews.size());
+        for (size_t index = 0; index < swapChainImageViews.size(); index++) {
+            const std::vector<vk::ImageView> attachments = framebufferAttachments(swapChainImageViews[index]);
+            vk::FramebufferCreateInfo frameBufferInfo{};
+            frameBufferInfo.setRenderPass(renderPass) // specify with which renderPass needs to be compatible
+                .setAttachmentCount(static_cast<uint32_t>(attachments.size()))
+                .setPAttachments(attachments.data())
+                .setWidth(swapChainExtent.width)
+                .setHeight(swapChainExtent.height)
+                .setLayers(1); // Our swap chain images are single images, so the number of layers is 1
+            swapChainFramebuffers[index] = device.createFramebuffer(frameBufferInfo);
+        }
+    }
+
+    bool canUseDynamicResolution(const vk::SurfaceCapabilitiesKHR& capabilities, vk::Format format) {
+        if (!config.dynamicResolution) {
+            return false;
+        }
+        auto queueFamilies = physicalDevice.getQueueFamilyProperties();
+        auto formatFeatures = physicalDevice.getFormatProperties(format).optimalTilingFeatures;
+        auto required = vk::FormatFeatureFlagBits::eColorAttachment | vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst;
+        if (!(capabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferDst)
+            || (formatFeatures & required) != required
+            || queueFamilies[findQueueFamilies(physicalDevice).graphicsFamily.value()].timestampValidBits == 0) { // the controller is driven by GPU timestamps
+            LOG("Dynamic resolution is not supported on this device/surface, rendering at native resolution");
+            return false;
+        }
+        upscaleFilter = (formatFeatures & vk::FormatFeatureFlagBits::eSampledImageFilterLinear) ? vk::Filter::eLinear : vk::Filter::eNearest;
+        return true;
+    }
+
+    // Internal render target for dynamic resolution. It's allocated for the largest scale, lower scales
+    // only render into its top-left corner, so changing the scale never reallocates anything.
+    void createSceneRenderTarget() {
+        auto maxDimension = physicalDevice.getProperties().limits.maxImageDimension2D;
+        float maxScale = resolutionScaler.maxScale();
+        sceneImageExtent.width = std::min((uint32_t)std::ceil(swapChainExtent.width * maxScale), maxDimension);
+        sceneImageExtent.height = std::min((uint32_t)std::ceil(swapChainExtent.height * maxScale), maxDimension);
+        createImage(sceneImageExtent.width, sceneImageExtent.height, swapChainImageFormat, vk::ImageTiling::eOptimal,
+                    vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc,
+                    vk::MemoryPropertyFlagBits::eDeviceLocal, sceneImage, sceneImageMemory);
+        sceneImageView = createImageView(sceneImage, swapChainImageFormat, vk::ImageAspectFlagBits::eColor);
+        createDepthImage(sceneImageExtent, depthImage, depthImageMemory, depthImageView);
+        createPostProcessTargets(sceneImageExtent);
+
+        const std::vector<vk::ImageView> attachments = framebufferAttachments(sceneImageView);
+        vk::FramebufferCreateInfo frameBufferInfo{};
+        frameBufferInfo.setRenderPass(renderPass)
+            .setAttachmentCount(static_cast<uint32_t>(attachments.size()))
+            .setPAttachments(attachments.data())
+            .setWidth(sceneImageExtent.width)
+            .setHeight(sceneImageExtent.height)
+            .setLayers(1);
+        sceneFramebuffer = device.createFramebuffer(frameBufferInfo);
+    }
+
+    // In the order of the render pass' attachments, around the color attachment of the framebuffer
+    std::vector<vk::ImageView> framebufferAttachments(vk::ImageView colorView) const {
+        std::vector<vk::ImageView> attachments = {colorView};
+        if (hasDepthBuffer()) {
+            attachments.push_back(depthImageView);
+        }
+        for (uint32_t i = 0; i < postProcessAttachmentCount(); i++) {
+            attachments.push_back(postProcessImageViews[i]);
+        }
+        return attachments;
+    }
+
+    // --post-process intermediates, sized like the depth buffer and shared by the frames in flight like it. Transient:
+    // they are only ever accessed within the render pass, a tiler keeps them in tile memory. Their descriptor sets
+    // point at the images, so they are rebuilt with them.
+    void createPostProcessTargets(vk::Extent2D extent) {
+        const uint32_t count = postProcessAttachmentCount();
+        if (count == 0) {
+            return;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            createImage(extent.width, extent.height, POST_PROCESS_FORMAT, vk::ImageTiling::eOptimal,
+                        vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eInputAttachment |
+                            vk::ImageUsageFlagBits::eTransientAttachment,
+                        vk::MemoryPropertyFlagBits::eDeviceLocal, postProcessImages[i], postProcessImageMemory[i]);
+            postProcessImageViews[i] = createImageView(postProcessImages[i], POST_PROCESS_FORMAT, vk::ImageAspectFlagBits::eColor);
+        }
+
+        // Set i reads intermediate i, effect n of the chain reads intermediate n % 2
+        vk::DescriptorPoolSize poolSize(vk::DescriptorType::eInputAttachment, count);
+        vk::DescriptorPoolCreateInfo poolInfo({}, count, 1, &poolSize);
+        postProcessDescriptorPool = device.createDescriptorPool(poolInfo);
+        const vk::DescriptorSetLayout setLayout = layoutCache->descriptorSetLayout({&shaderReflection("post-process.frag.spv")}, 0);
+        const vk::DescriptorSetLayout setLayouts[] = {setLayout, setLayout};
+        vk::DescriptorSetAllocateInfo allocInfo(postProcessDescriptorPool, count, setLayouts);
+        auto descriptorSets = device.allocateDescriptorSets(allocInfo);
+        for (uint32_t i = 0; i < count; i++) {
+            postProcessSets[i] = descriptorSets[i];
+            const vk::DescriptorImageInfo imageInfo(nullptr, postProcessImageViews[i], vk::ImageLayout::eShaderReadOnlyOptimal);
+            const vk::WriteDescriptorSet write(postProcessSets[i], 0, 0, 1, vk::DescriptorType::eInputAttachment, &imageInfo);
+            device.updateDescriptorSets(1, &write, 0, nullptr);
+        }
+    }
+
+    void destroyPostProcessTargets() {
+        device.destroyDescriptorPool(postProcessDescriptorPool);
+        postProcessDescriptorPool = nullptr;
+        postProcessSets = {};
+        for (size_t i = 0; i < postProcessImages.size(); i++) {
+            device.destroyImageView(postProcessImageViews[i]);
+            device.destroyImage(postProcessImages[i]);
+            device.freeMemory(postProcessImageMemory[i]);
+            postProcessImageViews[i] = nullptr;
+            postProcessImages[i] = nullptr;
+            postProcessImageMemory[i] = nullptr;
+        }
+    }
+
+    // Size of the area rendered this frame
+    vk::Extent2D currentRenderExtent() {
+        if (!dynamicResolution) {
+            return swapChainExtent;
+        }
+        float scale = resolutionScaler.scale();
+        return vk::Extent2D(std::clamp((uint32_t)(swapChainExtent.width * scale), 1u, sceneImageExtent.width),
+                            std::clamp((uint32_t)(swapChainExtent.height * scale), 1u, sceneImageExtent.height));
+    }
+
+    // Upscales the rendered part of the scene image into the swapchain image and leaves it ready for presentation
+    void blitSceneToSwapChain(vk::CommandBuffer commandBuffer, uint32_t imageIndex, vk::Extent2D renderExtent) {
+        vk::ImageMemoryBarrier toTransferDst{};
+        toTransferDst.setSrcAccessMask({})
+            .setDstAccessMask(vk::AccessFlagBits::eTransferWrite)
+            .setOldLayout(vk::ImageLayout::eUndefined) // previous contents are overwritten entirely
+            .setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+            .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+            .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+            .setImage(swapChainImages[imageIndex])
+            .setSubresourceRange({vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1});
+        // The image available semaphore is waited on at the transfer stage, which this barrier chains onto
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {},
+                                      0, nullptr, 0, nullptr, 1, &toTransferDst);
+
+        vk::ImageBlit region{};
+        region.srcSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+        region.srcOffsets[0] = vk::Offset3D(0, 0, 0);
+        region.srcOffsets[1] = vk::Offset3D((int32_t)renderExtent.width, (int32_t)renderExtent.height, 1);
+        region.dstSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+        region.dstOffsets[0] = vk::Offset3D(0, 0, 0);
+        region.dstOffsets[1] = vk::Offset3D((int32_t)swapChainExtent.width, (int32_t)swapChainExtent.height, 1);
+        commandBuffer.blitImage(sceneImage, vk::ImageLayout::eTransferSrcOptimal,
+                                swapChainImages[imageIndex], vk::ImageLayout::eTransferDstOptimal,
+                                1, &region, upscaleFilter);
+
+        vk::ImageMemoryBarrier toPresent = toTransferDst;
+        toPresent.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+            .setDstAccessMask({})
+            .setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+            .setNewLayout(vk::ImageLayout::ePresentSrcKHR);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {},
+                                      0, nullptr, 0, nullptr, 1, &toPresent);
+    }
+
+    uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) {
+        auto memProperties = physicalDevice.getMemoryProperties();
+        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+            if ((typeFilter & (1u << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+                return i;
+            }
+        }
+        throw std::runtime_error("failed to find suitable memory type!");
+    }
+
+    void createImage(uint32_t width, uint32_t height, vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage,
+                     vk::MemoryPropertyFlags properties, vk::Image& image, vk::DeviceMemory& imageMemory, uint32_t arrayLayers = 1) {
+        vk::ImageCreateInfo imageInfo{};
+        imageInfo.setImageType(vk::ImageType::e2D)
+            .setExtent(vk::Extent3D(width, height, 1))
+            .setMipLevels(1)
+            .setArrayLayers(arrayLayers)
+            .setFormat(format)
+            .setTiling(tiling)
+            .setInitialLayout(vk::ImageLayout::eUndefined)
+            .setUsage(usage)
+            .setSamples(vk::SampleCountFlagBits::e1)
+            .setSharingMode(vk::SharingMode::eExclusive);
+        image = device.createImage(imageInfo);
+
+        auto memRequirements = device.getImageMemoryRequirements(image);
+        vk::MemoryAllocateInfo allocInfo{};
+        allocInfo.setAllocationSize(memRequirements.size)
+            .setMemoryTypeIndex(findMemoryType(memRequirements.memoryTypeBits, properties));
+        imageMemory = device.allocateMemory(allocInfo);
+        device.bindImageMemory(image, imageMemory, 0);
+    }
+
+    vk::ImageView createImageView(vk::Image image, vk::Format format, vk::ImageAspectFlags aspectFlags) {
+        vk::ImageViewCreateInfo viewInfo{};
+        viewInfo.setImage(image)
+            .setViewType(vk::ImageViewType::e2D)
+            .setFormat(format)
+            .setSubresourceRange({aspectFlags, 0, 1, 0, 1});
+        return device.createImageView(viewInfo);
+    }
+
+    void createCommandPool() {
+        auto queueFamiliesIndices = findQueueFamilies(physicalDevice);
+        vk::CommandPoolCreateInfo poolInfo{};
+        poolInfo.setQueueFamilyIndex(queueFamiliesIndices.graphicsFamily.value())
+            .setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer); // command buffers are re-recorded every frame
+        commandPool = device.createCommandPool(poolInfo);
+    }
+
+    // One command buffer per frame in flight, recorded right before submission so that
+    // it can use the most recent input instead of being baked once per swapchain image.
+    void createCommandBuffers() {
+        vk::CommandBufferAllocateInfo allocInfo{};
+        allocInfo.setCommandPool(commandPool)
+            .setLevel(vk::CommandBufferLevel::ePrimary)
+            .setCommandBufferCount(MAX_FRAMES_IN_FLIGHT);
+        commandBuffers = device.allocateCommandBuffers(allocInfo);
+        // CBLevel::ePrimary: Can be submitted to a queue for execution, but cannot be called from other command buffers.
+        // CBLevel::eSecondary: Cannot be submitted directly, but can be called from primary command buffers.
+    }
+
+    void recordCommandBuffer(vk::CommandBuffer commandBuffer, uint32_t imageIndex, CaptureSlot* capture, RecordingSlot* recording) {
+        vk::CommandBufferBeginInfo beginInfo{};
+        // eOneTimeSubmit: specifies that each recording of the command buffer will only be submitted once, and the command buffer will be reset and recorded again between each submission
+        // eRenderPassContinue: This is a secondary command buffer that will be entirely within a single render pass.
+        // eSimultaneousUse: The command buffer can be resubmitted while it is also already pending execution.
+        beginInfo.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+        commandBuffer.begin(beginInfo); // implicitly resets the command buffer, the pool allows it
+
+        const uint32_t firstTimestamp = static_cast<uint32_t>(currentFrame) * 2;
+        if (timestampQueryPool) {
+            commandBuffer.resetQueryPool(timestampQueryPool, firstTimestamp, 2);
+            commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, timestampQueryPool, firstTimestamp);
+        }
+
+        const vk::Extent2D renderExtent = currentRenderExtent();
+        beginCounterQueries(commandBuffer, renderExtent);
+        if (textureStreamer) {
+            recordTextureStreaming(commandBuffer, renderExtent);
+        }
+        if (activeMeshletMode != MeshletMode::Off) {
+            recordMeshletCulling(commandBuffer, renderExtent);
+        }
+        if (config.drawCount > 0) {
+            writeDrawData(renderExtent);
+        }
+        if (config.sceneNodeCount > 0) {
+            updateScene(renderExtent);
+        }
+        if (config.spriteCount > 0) {
+            buildSprites(renderExtent);
+        }
+        if (config.particleCount > 0) {
+            recordParticleSimulation(commandBuffer);
+        }
+        vk::RenderPassBeginInfo renderPassInfo{};
+        vk::ClearValue clearValues[4] = {
+            vk::ClearColorValue(std::array<float, 4> {0.0f, 0.0f, 0.0f, 1.0f}),
+            vk::ClearDepthStencilValue(1.0f, 0)
+        };
+        uint32_t clearValueCount = hasDepthBuffer() ? 2 : 1;
+        for (uint32_t i = 0; i < postProcessAttachmentCount(); i++) {
+            clearValues[clearValueCount++] = clearValues[0]; // the scene is drawn into the first intermediate
+        }
+        renderPassInfo.setRenderPass(renderPass)
+            .setFramebuffer(dynamicResolution ? sceneFramebuffer : swapChainFramebuffers[imageIndex])
+            .setRenderArea({{0, 0}, renderExtent}) // Size of the render area. The render area defines where shader loads and stores will take place. It should match the size of the attachments for best performance
+            .setClearValueCount(clearValueCount)
+            .setPClearValues(clearValues); // clear values for AttachmentLoadOp::eClear, one per attachment
+        commandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+        // SubpassContents::eInline: The render pass commands will be embedded in the primary command buffer itself and no secondary command buffers will be executed.
+        // SubpassContents::eSecondaryCommandBuffers: The render pass commands will be executed from secondary command buffers.
+
+        if (occlusionQueryPool) {
+            drawOcclusionCulled(commandBuffer, renderExtent);
+        } else {
+            drawScene(commandBuffer, renderExtent);
+        }
+        recordPostProcessing(commandBuffer, renderExtent);
+        if (config.spriteCount > 0) {
+            drawSprites(commandBuffer, renderExtent);
+        }
+        commandBuffer.endRenderPass();
+        endCounterQueries(commandBuffer);
+        if (dynamicResolution) {
+            blitSceneToSwapChain(commandBuffer, imageIndex, renderExtent);
+        }
+        if (capture) {
+            recordFrameCapture(commandBuffer, imageIndex, *capture);
+        }
+        if (recording) {
+            recordYuvConversion(commandBuffer, imageIndex, *recording);
+        }
+        for (const auto& target : secondaryWindows) {
+            if (target.acquired) {
+                recordWindowTarget(commandBuffer, target);
+            }
+        }
+        if (timestampQueryPool) {
+            commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, timestampQueryPool, firstTimestamp + 1);
+        }
+        commandBuffer.end();
+    }
+
+    // Records the scene into the render pass that is currently active
+    void drawScene(vk::CommandBuffer commandBuffer, vk::Extent2D extent) {
+        vk::Viewport viewport(0.0f, 0.0f, (float)extent.width, (float)extent.height, 0.0f, 1.0f);
+        vk::Rect2D scissor({0, 0}, extent);
+        if (meshFile) {
+            const MeshPushConstants constants = meshPushConstants(extent);
+#ifdef NARU_MESH_SHADER_SUPPORT
+            if (activeMeshletMode == MeshletMode::MeshShader) {
+                commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, meshletPipeline);
+                commandBuffer.setViewport(0, 1, &viewport);
+                commandBuffer.setScissor(0, 1, &scissor);
+                const vk::DescriptorSet descriptorSets[] = {textureDescriptorSets[currentFrame], meshletFrames[currentFrame].descriptorSet};
+                commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, meshletPipelineLayout, 0, 2, descriptorSets, 0, nullptr);
+                meshletPush.push(commandBuffer, constants);
+                commandBuffer.drawMeshTasksEXT((meshFile->header().meshletCount + 31) / 32, 1, 1); // 32 meshlets per task workgroup
+                return;
+            }
+#endif
+            commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, meshPipeline);
+            commandBuffer.setViewport(0, 1, &viewport);
+            commandBuffer.setScissor(0, 1, &scissor);
+            meshPush.push(commandBuffer, constants);
+            commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, meshPipelineLayout, 0, 1,
+                                             &textureDescriptorSets[currentFrame], 0, nullptr);
+            const vk::DeviceSize offset = 0;
+            commandBuffer.bindVertexBuffers(0, 1, &meshVertexBuffer, &offset);
+            if (activeMeshletMode == MeshletMode::Indirect) {
+                // Only the triangles of the meshlets that survived culling, compacted by meshlet-cull.comp
+                commandBuffer.bindIndexBuffer(meshletFrames[currentFrame].indexBuffer, 0, vk::IndexType::eUint32);
+                commandBuffer.drawIndexedIndirect(meshletFrames[currentFrame].drawCommandBuffer, 0, 1, sizeof(MeshletDrawCommand));
+                return;
+            }
+            commandBuffer.bindIndexBuffer(meshIndexBuffer, 0, meshIndexType);
+            commandBuffer.drawIndexed(meshFile->header().indexCount, 1, 0, 0, 0);
+            return;
+        }
+        if (config.particleCount > 0) {
+            commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, particleDrawPipeline);
+            commandBuffer.setViewport(0, 1, &viewport);
+            commandBuffer.setScissor(0, 1, &scissor);
+            commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, particleDrawPipelineLayout, 0, 1,
+                                             &particleDrawSets[particleSource], 0, nullptr);
+            commandBuffer.draw(config.particleCount, 1, 0, 0);
+            return;
+        }
+        if (config.drawCount > 0) {
+            commandBuffer.setViewport(0, 1, &viewport);
+            commandBuffer.setScissor(0, 1, &scissor);
+            drawObjects(commandBuffer);
+            return;
+        }
+        if (config.sceneNodeCount > 0) {
+            commandBuffer.setViewport(0, 1, &viewport);
+            commandBuffer.setScissor(0, 1, &scissor);
+            drawSceneGraph(commandBuffer);
+            return;
+        }
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, graphicsPipeline); // first parameter specifies if is a graphics or compute pipeline
+        commandBuffer.setViewport(0, 1, &viewport);
+        commandBuffer.setScissor(0, 1, &scissor);
+        commandBuffer.draw(3, 1, 0, 0);
+        // vertexCount: Even though we don't have a vertex buffer, we technically still have 3 vertices to draw.
+        // instanceCount: Used for instanced rendering, use 1 if you're not doing that.
+        // firstVertex: Used as an offset into the vertex buffer, defines the lowest value of gl_VertexIndex.
+        // firstInstance: Used as an offset for instanced rendering, defines the lowest value of gl_InstanceIndex.
+    }
+
+    // One draw call per quad of --draws, each getting its ObjectData through the frame's path
+    void drawObjects(vk::CommandBuffer commandBuffer) {
+        const DrawDataPath path = drawDataPathOfSlot[currentFrame];
+        const vk::DescriptorSet descriptorSet = drawDataFrames[currentFrame].descriptorSet;
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, drawDataPipelines[static_cast<size_t>(path)]);
+        if (path == DrawDataPath::Push) {
+            for (uint32_t i = 0; i < config.drawCount; i++) {
+                drawDataPush.push(commandBuffer, drawDataScratch[i]);
+                commandBuffer.draw(6, 1, 0, 0);
+            }
+        } else if (path == DrawDataPath::DynamicUniform) {
+            for (uint32_t i = 0; i < config.drawCount; i++) {
+                const uint32_t offset = static_cast<uint32_t>(i * drawUniformStride);
+                commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, drawDataPipelineLayout, 0, 1, &descriptorSet, 1, &offset);
+                commandBuffer.draw(6, 1, 0, 0);
+            }
+        } else {
+            // Bound once; the draws could be one instanced draw, they stay separate to compare the per-draw cost
+            const uint32_t offset = 0; // the set's uniform buffer is dynamic, unused here
+            commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, drawDataPipelineLayout, 0, 1, &descriptorSet, 1, &offset);
+            for (uint32_t i = 0; i < config.drawCount; i++) {
+                commandBuffer.draw(6, 1, 0, i); // firstInstance is the index into the storage buffer
+            }
+        }
+    }
+
+    // The whole --scene in one instanced draw: instance i reads element i of the frame's storage buffer
+    void drawSceneGraph(vk::CommandBuffer commandBuffer) {
+        const vk::DescriptorSet descriptorSet = drawDataFrames[currentFrame].descriptorSet;
+        const uint32_t offset = 0; // the set's uniform buffer is dynamic, unused here
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, drawDataPipelines[static_cast<size_t>(DrawDataPath::Storage)]);
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, drawDataPipelineLayout, 0, 1, &descriptorSet, 1, &offset);
+        commandBuffer.draw(6, scene.nodeCount(), 0, 0);
+    }
+
+    // --occlusion-culling, main window only: the bounding box is drawn inside this frame's occlusion query, the
+    // mesh only if the box passed in an earlier frame. With conditional rendering the GPU reads the previous frame's
+    // result itself; otherwise the CPU uses the newest result it has read back, MAX_FRAMES_IN_FLIGHT frames old.
+    void drawOcclusionCulled(vk::CommandBuffer commandBuffer, vk::Extent2D extent) {
+        vk::Viewport viewport(0.0f, 0.0f, (float)extent.width, (float)extent.height, 0.0f, 1.0f);
+        vk::Rect2D scissor({0, 0}, extent);
+        commandBuffer.beginQuery(occlusionQueryPool, static_cast<uint32_t>(currentFrame), {});
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, occlusionProxyPipeline);
+        commandBuffer.setViewport(0, 1, &viewport);
+        commandBuffer.setScissor(0, 1, &scissor);
+        occlusionProxyPush.push(commandBuffer, meshPushConstants(extent));
+        commandBuffer.draw(36, 1, 0, 0);
+        commandBuffer.endQuery(occlusionQueryPool, static_cast<uint32_t>(currentFrame));
+#ifdef NARU_CONDITIONAL_RENDERING_SUPPORT
+        if (conditionalRenderingEnabled) {
+            const size_t previousFrame = (currentFrame + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT;
+            vk::ConditionalRenderingBeginInfoEXT conditionalInfo(occlusionResults[previousFrame].buffer, 0);
+            commandBuffer.beginConditionalRenderingEXT(conditionalInfo);
+            drawScene(commandBuffer, extent);
+            commandBuffer.endConditionalRenderingEXT();
+            return;
+        }
+#endif
+        if (lastOcclusionSamples > 0) {
+            drawScene(commandBuffer, extent);
+        }
+    }
+
+    // --post-process: the subpasses after the scene's, one fullscreen triangle each. The parameters are pushed once,
+    // every effect pipeline has the same layout.
+    void recordPostProcessing(vk::CommandBuffer commandBuffer, vk::Extent2D extent) {
+        if (postProcessPipelines.empty()) {
+            return;
+        }
+        vk::Viewport viewport(0.0f, 0.0f, (float)extent.width, (float)extent.height, 0.0f, 1.0f);
+        vk::Rect2D scissor({0, 0}, extent);
+        PostProcessParameters parameters{};
+        parameters.inverseExtent[0] = 1.0f / extent.width;
+        parameters.inverseExtent[1] = 1.0f / extent.height;
+        parameters.exposure = 1.5f;
+        parameters.vignetteStrength = 0.4f;
+        parameters.saturation = 1.15f;
+        parameters.contrast = 1.1f;
+        postProcessPush.push(commandBuffer, parameters);
+        for (size_t i = 0; i < postProcessPipelines.size(); i++) {
+            commandBuffer.nextSubpass(vk::SubpassContents::eInline);
+            commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, postProcessPipelines[i]);
+            commandBuffer.setViewport(0, 1, &viewport);
+            commandBuffer.setScissor(0, 1, &scissor);
+            commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, postProcessPipelineLayout, 0, 1,
+                                             &postProcessSets[i % 2], 0, nullptr);
+            commandBuffer.draw(3, 1, 0, 0);
+        }
+    }
+
+    // Secondary windows: the scene is drawn straight into their swapchain images at native resolution, in the same
+    // command buffer as the main window. windowRenderPass is compatible with renderPass (same format, one subpass),
+    // so the graphics pipeline is shared.
+    void createSecondaryWindowTargets() {
+        if (secondaryWindows.empty()) {
+            return;
+        }
+        createWindowRenderPass();
+
+        const uint32_t presentFamily = findQueueFamilies(physicalDevice).presentFamily.value();
+        vk::SemaphoreCreateInfo semaphoreInfo{};
+        for (auto& target : secondaryWindows) {
+            VkSurfaceKHR temporarySurface;
+            if (!SDL_Vulkan_CreateSurface(target.window, instance, &temporarySurface)) {
+                throw std::runtime_error("SDL could not create a Vulkan surface.");
+            }
+            target.surface = vk::SurfaceKHR(temporarySurface);
+            // All windows are presented with one call on the present queue
+            if (!physicalDevice.getSurfaceSupportKHR(presentFamily, target.surface)) {
+                throw std::runtime_error("the present queue can't present to every window!");
+            }
+            target.imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+            for (auto& semaphore : target.imageAvailableSemaphores) {
+                semaphore = device.createSemaphore(semaphoreInfo);
+            }
+            createWindowSwapChain(target);
+        }
+    }
+
+    void createWindowRenderPass() {
+        vk::AttachmentDescription colorAttachment{};
+        colorAttachment.setFormat(swapChainImageFormat)
+            .setSamples(vk::SampleCountFlagBits::e1)
+            .setLoadOp(vk::AttachmentLoadOp::eClear)
+            .setStoreOp(vk::AttachmentStoreOp::eStore)
+            .setInitialLayout(vk::ImageLayout::eUndefined)
+            .setFinalLayout(vk::ImageLayout::ePresentSrcKHR);
+        vk::AttachmentReference colorAttachmentRef(0, vk::ImageLayout::eColorAttachmentOptimal);
+        vk::AttachmentReference depthAttachmentRef(1, vk::ImageLayout::eDepthStencilAttachmentOptimal);
+        vk::SubpassDescription subpass{};
+        subpass.setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
+            .setColorAttachmentCount(1)
+            .setPColorAttachments(&colorAttachmentRef);
+        std::vector<vk::AttachmentDescription> attachments = {colorAttachment};
+        if (hasDepthBuffer()) {
+            attachments.push_back(depthAttachmentDescription());
+            subpass.setPDepthStencilAttachment(&depthAttachmentRef);
+        }
+        vk::SubpassDependency dependency{};
+        dependency.setSrcSubpass(VK_SUBPASS_EXTERNAL)
+            .setDstSubpass(0)
+            .setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
+            .setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
+            .setDstAccessMask(vk::AccessFlagBits::eColorAttachmentWrite);
+        addDepthDependency(dependency);
+        vk::RenderPassCreateInfo renderPassInfo({}, static_cast<uint32_t>(attachments.size()), attachments.data(), 1, &subpass, 1, &dependency);
+        windowRenderPass = device.createRenderPass(renderPassInfo);
+    }
+
+    // The secondary windows share the pipelines, so their render pass and swapchains follow the main window's format
+    void recreateSecondaryWindowTargets() {
+        if (secondaryWindows.empty()) {
+            return;
+        }
+        device.destroyRenderPass(windowRenderPass);
+        createWindowRenderPass();
+        for (auto& target : secondaryWindows) {
+            target.resized = false;
+            createWindowSwapChain(target); // its framebuffers are rebuilt for the new render pass
+        }
+    }
+
+    void createWindowSwapChain(WindowTarget& target) {
+        vk::SwapchainKHR oldSwapchain = target.swapchain;
+        for (auto framebuffer : target.framebuffers) {
+            device.destroyFramebuffer(framebuffer);
+        }
+        for (auto imageView : target.imageViews) {
+            device.destroyImageView(imageView);
+        }
+        target.framebuffers.clear();
+        target.imageViews.clear();
+        target.swapchain = nullptr;
+        destroyDepthImage(target.depthImage, target.depthImageMemory, target.depthImageView);
+
+        auto capabilities = physicalDevice.getSurfaceCapabilitiesKHR(target.surface);
+        auto formats = physicalDevice.getSurfaceFormatsKHR(target.surface);
+        auto presentModes = physicalDevice.getSurfacePresentModesKHR(target.surface);
+        auto format = std::find_if(formats.begin(), formats.end(), [&](const vk::SurfaceFormatKHR& f) { return f.format == swapChainImageFormat; });
+        if (format == formats.end()) {
+            throw std::runtime_error("a secondary window doesn't support the main window's format, the pipelines can't be shared!");
+        }
+        target.extent = chooseSwapExtent(capabilities, target.window);
+        if (target.extent.width == 0 || target.extent.height == 0) {
+            device.destroySwapchainKHR(oldSwapchain); // nothing to present to until the window has an area again
+            return;
+        }
+        uint32_t imageCount = capabilities.minImageCount + 1;
+        if (capabilities.maxImageCount > 0 && imageCount > capabilities.maxImageCount) {
+            imageCount = capabilities.maxImageCount;
+        }
+        vk::SwapchainCreateInfoKHR createInfo{};
+        createInfo.surface = target.surface;
+        createInfo.minImageCount = imageCount;
+        createInfo.imageFormat = format->format;
+        createInfo.imageColorSpace = format->colorSpace;
+        createInfo.imageExtent = target.extent;
+        createInfo.imageArrayLayers = 1;
+        createInfo.imageUsage = vk::ImageUsageFlagBits::eColorAttachment;
+        QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+        uint32_t queueFamilyIndices[] = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+        if (indices.graphicsFamily != indices.presentFamily) {
+            createInfo.imageSharingMode = vk::SharingMode::eConcurrent;
+            createInfo.queueFamilyIndexCount = 2;
+            createInfo.pQueueFamilyIndices = queueFamilyIndices;
+        } else {
+            createInfo.imageSharingMode = vk::SharingMode::eExclusive;
+        }
+        createInfo.preTransform = capabilities.currentTransform;
+        createInfo.compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque;
+        createInfo.presentMode = chooseSwapPresentMode(presentModes);
+        createInfo.clipped = true;
+        createInfo.oldSwapchain = oldSwapchain;
+        target.swapchain = device.createSwapchainKHR(createInfo);
+        device.destroySwapchainKHR(oldSwapchain);
+
+        target.images = device.getSwapchainImagesKHR(target.swapchain);
+        target.imagesInFlight.assign(target.images.size(), nullptr);
+        createDepthImage(target.extent, target.depthImage, target.depthImageMemory, target.depthImageView);
+        for (auto image : target.images) {
+            vk::ImageView imageView = createImageView(image, swapChainImageFormat, vk::ImageAspectFlagBits::eColor);
+            target.imageViews.push_back(imageView);
+            vk::ImageView attachments[] = {imageView, target.depthImageView};
+            vk::FramebufferCreateInfo framebufferInfo({}, windowRenderPass, hasDepthBuffer() ? 2 : 1, attachments,
+                                                      target.extent.width, target.extent.height, 1);
+            target.framebuffers.push_back(device.createFramebuffer(framebufferInfo));
+        }
+    }
+
+    void destroySecondaryWindowTargets() {
+        for (auto& target : secondaryWindows) {
+            for (auto framebuffer : target.framebuffers) {
+                device.destroyFramebuffer(framebuffer);
+            }
+            for (auto imageView : target.imageViews) {
+                device.destroyImageView(imageView);
+            }
+            for (auto semaphore : target.imageAvailableSemaphores) {
+                device.destroySemaphore(semaphore);
+            }
+            destroyDepthImage(target.depthImage, target.depthImageMemory, target.depthImageView);
+            device.destroySwapchainKHR(target.swapchain);
+            instance.destroySurfaceKHR(target.surface);
+            target.framebuffers.clear();
+            target.imageViews.clear();
+            target.imageAvailableSemaphores.clear();
+            target.images.clear();
+            target.imagesInFlight.clear();
+            target.swapchain = nullptr;
+            target.surface = nullptr;
+            target.acquired = false;
+        }
+        device.destroyRenderPass(windowRenderPass);
+        windowRenderPass = nullptr;
+    }
+
+    // Rebuilds the swapchains of resized secondary windows, coalesced like the main window's: once per frame at most
+    void rebuildResizedWindows() {
+        bool idle = false;
+        for (auto& target : secondaryWindows) {
+            if (!target.resized || target.minimized) {
+                continue;
+            }
+            if (!idle) {
+                device.waitIdle();
+                idle = true;
+            }
+            target.resized = false;
+            createWindowSwapChain(target);
+        }
+    }
+
+    void acquireWindowImages() {
+        for (auto& target : secondaryWindows) {
+            target.acquired = false;
+            if (target.minimized || !target.swapchain) {
+                continue;
+            }
+            auto result = device.acquireNextImageKHR(target.swapchain, UINT64_MAX, target.imageAvailableSemaphores[currentFrame],
+                                                     nullptr, &target.imageIndex);
+            if (result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR) {
+                target.resized = true; // out of date, skip the window this frame and rebuild it before the next
+                continue;
+            }
+            if (target.imagesInFlight[target.imageIndex]) {
+                device.waitForFences(1, &target.imagesInFlight[target.imageIndex], true, UINT64_MAX);
+            }
+            target.imagesInFlight[target.imageIndex] = inFlightFences[currentFrame];
+            target.acquired = true;
+        }
+    }
+
+    void recordWindowTarget(vk::CommandBuffer commandBuffer, const WindowTarget& target) {
+        vk::ClearValue clearValues[] = {
+            vk::ClearColorValue(std::array<float, 4> {0.0f, 0.0f, 0.0f, 1.0f}),
+            vk::ClearDepthStencilValue(1.0f, 0)
+        };
+        vk::RenderPassBeginInfo renderPassInfo(windowRenderPass, target.framebuffers[target.imageIndex], {{0, 0}, target.extent},
+                                               hasDepthBuffer() ? 2 : 1, clearValues);
+        commandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+        drawScene(commandBuffer, target.extent);
+        commandBuffer.endRenderPass();
+    }
+
+    bool canCaptureFrames(const vk::SurfaceCapabilitiesKHR& capabilities, vk::Format format) {
+        // The encoders expect 8 bit RGBA or BGRA texels
+        bool supportedFormat = format == vk::Format::eB8G8R8A8Unorm || format == vk::Format::eB8G8R8A8Srgb
+                            || format == vk::Format::eR8G8B8A8Unorm || format == vk::Format::eR8G8B8A8Srgb;
+        return supportedFormat && (capabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferSrc);
+    }
+
+    // Frame captures: the presented image is copied into a host-visible buffer of the readback ring as part of the
+    // frame's own command buffer. The buffer is only handed to the encoder thread once the frame's fence signaled,
+    // which drawFrame waits for anyway before reusing the frame slot, so a capture never adds a wait to the loop.
+    CaptureSlot* acquireCaptureSlot() {
+        if (!captureSupported) {
+            return nullptr;
+        }
+        const vk::DeviceSize size = vk::DeviceSize(swapChainExtent.width) * swapChainExtent.height * 4;
+        for (auto& slot : captureSlots) {
+            if (slot.inFlight || !slot.available.load(std::memory_order_acquire)) {
+                continue;
+            }
+            if (slot.readback.size < size) {
+                destroyMappedBuffer(slot.readback);
+                createReadbackBuffer(size, vk::BufferUsageFlagBits::eTransferDst, slot.readback);
+            }
+            slot.available.store(false, std::memory_order_relaxed);
+            slot.inFlight = true;
+            slot.frame = currentFrame;
+            slot.frameNumber = frameNumber;
+            slot.width = swapChainExtent.width;
+            slot.height = swapChainExtent.height;
+            return &slot;
+        }
+        LOG_LIMITED(LogLevel::Warning, "Frame capture skipped, all readback buffers are still being encoded");
+        return nullptr;
+    }
+
+    // GPU-written, CPU-read. Host cached memory makes the encoder's reads much faster, coherent spares us the
+    // invalidate calls.
+    void createReadbackBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, MappedBuffer& readback) {
+        const vk::MemoryPropertyFlags hostMemory = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+        createMappedBuffer(size, usage, {hostMemory | vk::MemoryPropertyFlagBits::eHostCached, hostMemory}, readback);
+    }
+
+    // CPU-written, GPU-read. The CPU only writes it, sequentially, which write-combined (uncached) memory is fast at;
+    // device-local host-visible memory (resizable BAR, unified memory) also spares the GPU's reads the trip over the bus.
+    void createUploadBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, MappedBuffer& upload) {
+        const vk::MemoryPropertyFlags hostMemory = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+        createMappedBuffer(size, usage, {hostMemory | vk::MemoryPropertyFlagBits::eDeviceLocal, hostMemory}, upload);
+    }
+
+    // Memory of the first of `preferences` there is a type for and that can be allocated: a small device-local
+    // host-visible heap (256 MB without resizable BAR) may be exhausted
+    void createMappedBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, std::initializer_list<vk::MemoryPropertyFlags> preferences,
+                            MappedBuffer& mapped) {
+        vk::BufferCreateInfo bufferInfo{};
+        bufferInfo.setSize(size)
+            .setUsage(usage)
+            .setSharingMode(vk::SharingMode::eExclusive);
+        mapped.buffer = device.createBuffer(bufferInfo);
+        auto memRequirements = device.getBufferMemoryRequirements(mapped.buffer);
+        vk::MemoryAllocateInfo allocInfo{};
+        allocInfo.setAllocationSize(memRequirements.size);
+        for (auto properties = preferences.begin(); properties != preferences.end(); ++properties) {
+            try {
+                allocInfo.setMemoryTypeIndex(findMemoryType(memRequirements.memoryTypeBits, *properties));
+                mapped.memory = device.allocateMemory(allocInfo);
+                break;
+            } catch (const std::runtime_error&) {
+                if (properties + 1 == preferences.end()) {
+                    device.destroyBuffer(mapped.buffer);
+                    mapped.buffer = nullptr;
+                    throw;
+                }
+            }
+        }
+        device.bindBufferMemory(mapped.buffer, mapped.memory, 0);
+        mapped.mapped = device.mapMemory(mapped.memory, 0, VK_WHOLE_SIZE); // stays mapped for the buffer's lifetime
+        mapped.size = size;
+    }
+
+    void destroyMappedBuffer(MappedBuffer& mapped) {
+        if (mapped.mapped) {
+            device.unmapMemory(mapped.memory);
+        }
+        device.destroyBuffer(mapped.buffer);
+        device.freeMemory(mapped.memory);
+        mapped = MappedBuffer{};
+    }
+
+    void recordFrameCapture(vk::CommandBuffer commandBuffer, uint32_t imageIndex, const CaptureSlot& slot) {
+        vk::ImageMemoryBarrier toTransferSrc{};
+        toTransferSrc.setSrcAccessMask(vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eTransferWrite)
+            .setDstAccessMask(vk::AccessFlagBits::eTransferRead)
+            .setOldLayout(vk::ImageLayout::ePresentSrcKHR)
+            .setNewLayout(vk::ImageLayout::eTransferSrcOptimal)
+            .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+            .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+            .setImage(swapChainImages[imageIndex])
+            .setSubresourceRange({vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1});
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eTransfer,
+                                      vk::PipelineStageFlagBits::eTransfer, {}, 0, nullptr, 0, nullptr, 1, &toTransferSrc);
+
+        vk::BufferImageCopy region{};
+        region.setBufferOffset(0)
+            .setBufferRowLength(0) // tightly packed
+            .setBufferImageHeight(0)
+            .setImageSubresource({vk::ImageAspectFlagBits::eColor, 0, 0, 1})
+            .setImageOffset({0, 0, 0})
+            .setImageExtent({slot.width, slot.height, 1});
+        commandBuffer.copyImageToBuffer(swapChainImages[imageIndex], vk::ImageLayout::eTransferSrcOptimal, slot.readback.buffer, 1, &region);
+
+        vk::ImageMemoryBarrier toPresent = toTransferSrc;
+        toPresent.setSrcAccessMask(vk::AccessFlagBits::eTransferRead)
+            .setDstAccessMask({})
+            .setOldLayout(vk::ImageLayout::eTransferSrcOptimal)
+            .setNewLayout(vk::ImageLayout::ePresentSrcKHR);
+        // Make the copy visible to the host once the fence signaled
+        vk::BufferMemoryBarrier toHost{};
+        toHost.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+            .setDstAccessMask(vk::AccessFlagBits::eHostRead)
+            .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+            .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+            .setBuffer(slot.readback.buffer)
+            .setOffset(0)
+            .setSize(VK_WHOLE_SIZE);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {},
+                                      0, nullptr, 0, nullptr, 1, &toPresent);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {},
+                                      0, nullptr, 1, &toHost, 0, nullptr);
+    }
+
+    // Hands the captures recorded in `frame` to the encoder. Must only be called after that frame's fence signaled.
+    void collectFinishedCaptures(size_t frame) {
+        for (auto& slot : captureSlots) {
+            if (!slot.inFlight || slot.frame != frame) {
+                continue;
+            }
+            slot.inFlight = false;
+            CapturedImage image{};
+            image.pixels = static_cast<const uint8_t*>(slot.readback.mapped);
+            image.width = slot.width;
+            image.height = slot.height;
+            image.rowPitch = slot.width * 4;
+            image.bgra = swapChainImageFormat == vk::Format::eB8G8R8A8Unorm || swapChainImageFormat == vk::Format::eB8G8R8A8Srgb;
+            image.frameNumber = slot.frameNumber;
+            if (!captureWorker->submit(image, &slot.available)) {
+                slot.available.store(true, std::memory_order_release);
+                LOG_LIMITED(LogLevel::Warning, "Frame capture dropped, the encoder queue is full");
+            }
+        }
+        if (config.exitAfterCapture && !config.captureFrames.empty() && pendingCaptureFrames.empty() && !frameState.captureRequested && !exitRequested) {
+            bool anyInFlight = std::any_of(captureSlots.begin(), captureSlots.end(), [](const CaptureSlot& slot) { return slot.inFlight; });
+            if (!anyInFlight) {
+                // Queued captures are still written, the worker drains its queue on shutdown
+                requestExit();
+            }
+        }
+    }
+
+    // Asks the main thread to shut down, as if the window was closed
+    void requestExit() {
+        if (exitRequested) {
+            return;
+        }
+        exitRequested = true;
+        SDL_Event quitEvent{};
+        quitEvent.type = SDL_QUIT;
+        SDL_PushEvent(&quitEvent);
+    }
+
+    bool shouldCaptureFrame() {
+        if (frameState.captureRequested) {
+            frameState.captureRequested = false;
+            return true;
+        }
+        if (!pendingCaptureFrames.empty() && pendingCaptureFrames.front() <= frameNumber) {
+            pendingCaptureFrames.erase(pendingCaptureFrames.begin());
+            return true;
+        }
+        return false;
+    }
+
+    // The device must be idle. A slot still in flight was never handed to the encoder, so nothing would make it
+    // available: its capture is dropped.
+    void releaseCaptureSlots() {
+        for (auto& slot : captureSlots) {
+            if (slot.inFlight) {
+                slot.inFlight = false;
+                slot.available.store(true, std::memory_order_release);
+            }
+            // Wait for the encoder to let go of the memory, only happens on teardown
+            while (!slot.available.load(std::memory_order_acquire)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            slot.inFlight = false;
+            destroyMappedBuffer(slot.readback);
+        }
+    }
+
+    // Video recording: every presented frame is converted to YUV by a compute shader that writes the planes straight
+    // into a host-visible buffer of the recording ring. Like captures, a buffer is handed to the writer thread after
+    // its frame's fence signaled, so recording costs one small dispatch per frame and never waits.
+    void createRecordingResources() {
+        vk::SamplerCreateInfo samplerInfo{};
+        samplerInfo.setMagFilter(vk::Filter::eLinear)
+            .setMinFilter(vk::Filter::eLinear)
+            .setAddressModeU(vk::SamplerAddressMode::eClampToEdge)
+            .setAddressModeV(vk::SamplerAddressMode::eClampToEdge)
+            .setAddressModeW(vk::SamplerAddressMode::eClampToEdge);
+        recordingSampler = device.createSampler(samplerInfo);
+
+        // Set 0: the source image (binding 0) and the output planes (binding 1)
+        const LayoutCache::PipelineLayout layout = layoutCache->pipelineLayout({&shaderReflection("rgb-to-yuv.comp.spv")});
+        if (layout.pushConstants.size != sizeof(YuvConversionParameters)) {
+            throw std::runtime_error("rgb-to-yuv.comp doesn't match YuvConversionParameters");
+        }
+        recordingSetLayout = layout.setLayouts.at(0);
+        recordingPipelineLayout = layout.layout;
+
+        std::array<vk::DescriptorPoolSize, 2> poolSizes = {
+            vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, RECORDING_RING_SIZE),
+            vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, RECORDING_RING_SIZE)
+        };
+        vk::DescriptorPoolCreateInfo poolInfo({}, RECORDING_RING_SIZE, static_cast<uint32_t>(poolSizes.size()), poolSizes.data());
+        recordingDescriptorPool = device.createDescriptorPool(poolInfo);
+
+        const vk::DeviceSize size = VideoRecorder::frameSize(recordingExtent.width, recordingExtent.height);
+        for (auto& slot : recordingSlots) {
+            vk::DescriptorSetAllocateInfo allocInfo(recordingDescriptorPool, 1, &recordingSetLayout);
+            if (device.allocateDescriptorSets(&allocInfo, &slot.descriptorSet) != vk::Result::eSuccess) {
+                throw std::runtime_error("failed to allocate a recording descriptor set!");
+            }
+            createReadbackBuffer(size, vk::BufferUsageFlagBits::eStorageBuffer, slot.readback);
+            vk::DescriptorBufferInfo bufferInfo(slot.readback.buffer, 0, VK_WHOLE_SIZE);
+            vk::WriteDescriptorSet write(slot.descriptorSet, 1, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &bufferInfo);
+            device.updateDescriptorSets(1, &write, 0, nullptr);
+        }
+    }
+
+    // The device must be idle. A slot still in flight was never handed to the writer: its frame is dropped.
+    void destroyRecordingResources() {
+        for (auto& slot : recordingSlots) {
+            if (slot.inFlight) {
+                slot.inFlight = false;
+                slot.available.store(true, std::memory_order_release);
+                recordingFramesDropped++;
+            }
+            // Wait for the writer to let go of the memory, only happens on teardown
+            while (!slot.available.load(std::memory_order_acquire)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            slot.inFlight = false;
+            slot.descriptorSet = nullptr; // freed with the pool
+            destroyMappedBuffer(slot.readback);
+        }
+        device.destroyDescriptorPool(recordingDescriptorPool);
+        pipelineVariants->destroy("rgb-to-yuv");
+        device.destroySampler(recordingSampler);
+        recordingDescriptorPool = nullptr;
+        recordingPipelineLayout = nullptr;
+        recordingSetLayout = nullptr;
+        recordingSampler = nullptr;
+    }
+
+    // The YUV layout and the swapchain's sRGB encoding are fixed while recording, the conversion is specialized for
+    // them. A swapchain format change picks (and on first use creates) the other variant.
+    vk::Pipeline recordingPipeline() {
+        const bool srgbSource = swapChainImageFormat == vk::Format::eB8G8R8A8Srgb || swapChainImageFormat == vk::Format::eR8G8B8A8Srgb;
+        SpecializationConstants constants;
+        constants.set(SPEC_YUV_NV12, config.recordFormat == YuvFormat::Nv12).set(SPEC_YUV_SRGB_SOURCE, srgbSource);
+        return pipelineVariants->get("rgb-to-yuv", constants, [&](vk::PipelineCache cache, const vk::SpecializationInfo* specialization) {
+            auto shaderModule = createShaderModule(readFile(getShaderPath() + "/rgb-to-yuv.comp.spv"));
+            vk::ComputePipelineCreateInfo pipelineInfo{};
+            pipelineInfo.setStage(vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eCompute, shaderModule, "main", specialization))
+                .setLayout(recordingPipelineLayout);
+            vk::Pipeline pipeline;
+            if (device.createComputePipelines(cache, 1, &pipelineInfo, nullptr, &pipeline) != vk::Result::eSuccess) {
+                throw std::runtime_error("failed to create the YUV conversion pipeline!");
+            }
+            device.destroyShaderModule(shaderModule);
+            return pipeline;
+        });
+    }
+
+    RecordingSlot* acquireRecordingSlot() {
+        if (!videoRecorder) {
+            return nullptr;
+        }
+        for (auto& slot : recordingSlots) {
+            if (!slot.inFlight && slot.available.load(std::memory_order_acquire)) {
+                slot.available.store(false, std::memory_order_relaxed);
+                slot.inFlight = true;
+                slot.frame = currentFrame;
+                return &slot;
+            }
+        }
+        recordingFramesDropped++;
+        return nullptr;
+    }
+
+    void recordYuvConversion(vk::CommandBuffer commandBuffer, uint32_t imageIndex, const RecordingSlot& slot) {
+        // The slot isn't used by any pending frame, so its descriptor set can be pointed at this frame's image
+        vk::DescriptorImageInfo imageInfo(recordingSampler, swapChainImageViews[imageIndex], vk::ImageLayout::eShaderReadOnlyOptimal);
+        vk::WriteDescriptorSet write(slot.descriptorSet, 0, 0, 1, vk::DescriptorType::eCombinedImageSampler, &imageInfo);
+        device.updateDescriptorSets(1, &write, 0, nullptr);
+
+        vk::ImageMemoryBarrier toShaderRead{};
+        toShaderRead.setSrcAccessMask(vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eTransferWrite)
+            .setDstAccessMask(vk::AccessFlagBits::eShaderRead)
+            .setOldLayout(vk::ImageLayout::ePresentSrcKHR)
+            .setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+            .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+            .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+            .setImage(swapChainImages[imageIndex])
+            .setSubresourceRange({vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1});
+        // The transfer stage also covers a frame capture copy that may still be reading the image
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eTransfer,
+                                      vk::PipelineStageFlagBits::eComputeShader, {}, 0, nullptr, 0, nullptr, 1, &toShaderRead);
+
+        YuvConversionParameters parameters{};
+        parameters.width = recordingExtent.width;
+        parameters.height = recordingExtent.height;
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, recordingPipeline());
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, recordingPipelineLayout, 0, 1, &slot.descriptorSet, 0, nullptr);
+        commandBuffer.pushConstants(recordingPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(parameters), &parameters);
+        // One invocation per 8x2 pixel block, 8x8 invocations per workgroup
+        const uint32_t blocksX = recordingExtent.width / 8;
+        const uint32_t blocksY = recordingExtent.height / 2;
+        commandBuffer.dispatch((blocksX + 7) / 8, (blocksY + 7) / 8, 1);
+
+        vk::ImageMemoryBarrier toPresent = toShaderRead;
+        toPresent.setSrcAccessMask(vk::AccessFlagBits::eShaderRead)
+            .setDstAccessMask({})
+            .setOldLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+            .setNewLayout(vk::ImageLayout::ePresentSrcKHR);
+        vk::BufferMemoryBarrier toHost{};
+        toHost.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+            .setDstAccessMask(vk::AccessFlagBits::eHostRead)
+            .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+            .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+            .setBuffer(slot.readback.buffer)
+            .setOffset(0)
+            .setSize(VK_WHOLE_SIZE);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eBottomOfPipe, {},
+                                      0, nullptr, 0, nullptr, 1, &toPresent);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eHost, {},
+                                      0, nullptr, 1, &toHost, 0, nullptr);
+    }
+
+    // Hands the video frames converted in `frame` to the writer. Must only be called after that frame's fence signaled.
+    void collectRecordedFrames(size_t frame) {
+        for (auto& slot : recordingSlots) {
+            if (!slot.inFlight || slot.frame != frame) {
+                continue;
+            }
+            slot.inFlight = false;
+            if (!videoRecorder->submit(static_cast<const uint8_t*>(slot.readback.mapped), &slot.available)) {
+                slot.available.store(true, std::memory_order_release);
+                recordingFramesDropped++;
+            }
+        }
+    }
+
+    // Two timestamps (start/end) per frame in flight, used to measure the GPU cost of a frame
+    void createTimestampQueries() {
+        auto properties = physicalDevice.getProperties();
+        auto queueFamilies = physicalDevice.getQueueFamilyProperties();
+        timestampValidBits = queueFamilies[findQueueFamilies(physicalDevice).graphicsFamily.value()].timestampValidBits;
+        timestampPeriod = properties.limits.timestampPeriod;
+        timestampsWritten.assign(MAX_FRAMES_IN_FLIGHT, false);
+        particleTimestampsWritten.assign(MAX_FRAMES_IN_FLIGHT, false);
+        if (timestampValidBits == 0) {
+            LOG("GPU timestamps are not supported on the graphics queue, frame pacing only uses CPU timings");
+            return;
+        }
+        vk::QueryPoolCreateInfo poolInfo{};
+        poolInfo.setQueryType(vk::QueryType::eTimestamp)
+            .setQueryCount(MAX_FRAMES_IN_FLIGHT * 2);
+        timestampQueryPool = device.createQueryPool(poolInfo);
+        if (config.particleCount > 0) {
+            particleQueryPool = device.createQueryPool(poolInfo); // around the simulation step
+        }
+    }
+
+    // Milliseconds between two timestamps of the graphics queue, which may have wrapped around its valid bits
+    double timestampDurationMs(const uint64_t timestamps[2]) const {
+        const uint64_t mask = timestampValidBits >= 64 ? ~0ull : ((1ull << timestampValidBits) - 1);
+        const uint64_t ticks = ((timestamps[1] & mask) - (timestamps[0] & mask)) & mask;
+        return static_cast<double>(ticks) * timestampPeriod / 1e6;
+    }
+
+    // Only called once the frame's fence signaled, so the results are available and this never blocks.
+    // Returns whether a new measurement was read.
+    bool readGpuFrameTime(size_t frame) {
+        if (!timestampQueryPool || !timestampsWritten[frame]) {
+            return false;
+        }
+        timestampsWritten[frame] = false;
+        uint64_t timestamps[2] = {};
+        auto result = device.getQueryPoolResults(timestampQueryPool, static_cast<uint32_t>(frame) * 2, 2, sizeof(timestamps), timestamps,
+                                                 sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+        if (result != vk::Result::eSuccess) {
+            return false;
+        }
+        lastGpuFrameTimeMs = timestampDurationMs(timestamps);
+        return true;
+    }
+
+    // Same as readGpuFrameTime, for the particle simulation step of the frame
+    bool readParticleSimulationTime(size_t frame) {
+        if (!particleQueryPool || !particleTimestampsWritten[frame]) {
+            return false;
+        }
+        particleTimestampsWritten[frame] = false;
+        uint64_t timestamps[2] = {};
+        auto result = device.getQueryPoolResults(particleQueryPool, static_cast<uint32_t>(frame) * 2, 2, sizeof(timestamps), timestamps,
+                                                 sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+        if (result != vk::Result::eSuccess) {
+            return false;
+        }
+        lastParticleSimulationMs = timestampDurationMs(timestamps);
+        lastParticleWorkgroup = particleWorkgroupOfSlot[frame];
+        return true;
+    }
+
+    // --gpu-counters and --occlusion-culling: one query of each per frame in flight, so a frame's results are read
+    // once its fence signaled, like the timestamps. The occlusion results are copied into small host-visible
+    // buffers, which double as conditional rendering predicates.
+    void createCounterQueries() {
+        countersWritten.assign(MAX_FRAMES_IN_FLIGHT, false);
+        if (pipelineStatisticsEnabled) {
+            vk::QueryPoolCreateInfo poolInfo{};
+            poolInfo.setQueryType(vk::QueryType::ePipelineStatistics)
+                .setQueryCount(MAX_FRAMES_IN_FLIGHT)
+                .setPipelineStatistics(GpuCounters::statisticFlags());
+            statisticsQueryPool = device.createQueryPool(poolInfo);
+        }
+        if (config.occlusionCulling) {
+            vk::QueryPoolCreateInfo poolInfo{};
+            poolInfo.setQueryType(vk::QueryType::eOcclusion)
+                .setQueryCount(MAX_FRAMES_IN_FLIGHT);
+            occlusionQueryPool = device.createQueryPool(poolInfo);
+            vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eTransferDst;
+#ifdef NARU_CONDITIONAL_RENDERING_SUPPORT
+            if (conditionalRenderingEnabled) {
+                usage |= vk::BufferUsageFlagBits::eConditionalRenderingEXT;
+            }
+#endif
+            occlusionResults.resize(MAX_FRAMES_IN_FLIGHT);
+            for (auto& result : occlusionResults) {
+                createReadbackBuffer(sizeof(uint32_t), usage, result);
+                *static_cast<uint32_t*>(result.mapped) = 1; // visible until a query says otherwise
+            }
+            lastOcclusionSamples = 1;
+        }
+    }
+
+    void destroyCounterQueries() {
+        device.destroyQueryPool(statisticsQueryPool);
+        device.destroyQueryPool(occlusionQueryPool);
+        statisticsQueryPool = nullptr;
+        occlusionQueryPool = nullptr;
+        for (auto& result : occlusionResults) {
+            destroyMappedBuffer(result);
+        }
+        occlusionResults.clear();
+    }
+
+    // Outside the render pass, before this frame's first GPU work: the statistics cover the compute passes and the
+    // main window's render pass
+    void beginCounterQueries(vk::CommandBuffer commandBuffer, vk::Extent2D renderExtent) {
+        const uint32_t query = static_cast<uint32_t>(currentFrame);
+        if (occlusionQueryPool) {
+            commandBuffer.resetQueryPool(occlusionQueryPool, query, 1);
+#ifdef NARU_CONDITIONAL_RENDERING_SUPPORT
+            if (conditionalRenderingEnabled) {
+                // The previous frame's result copy must land before it is read as a predicate, and the predicate
+                // read by the previous frame before this frame's copy overwrites it
+                vk::MemoryBarrier predicates(vk::AccessFlagBits::eTransferWrite,
+                                             vk::AccessFlagBits::eConditionalRenderingReadEXT | vk::AccessFlagBits::eTransferWrite);
+                commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eConditionalRenderingEXT,
+                                              vk::PipelineStageFlagBits::eConditionalRenderingEXT | vk::PipelineStageFlagBits::eTransfer, {},
+                                              1, &predicates, 0, nullptr, 0, nullptr);
+            }
+#endif
+        }
+        if (statisticsQueryPool) {
+            commandBuffer.resetQueryPool(statisticsQueryPool, query, 1);
+            commandBuffer.beginQuery(statisticsQueryPool, query, {});
+            counterPixelsOfSlot[currentFrame] = uint64_t(renderExtent.width) * renderExtent.height;
+        }
+    }
+
+    void endCounterQueries(vk::CommandBuffer commandBuffer) {
+        const uint32_t query = static_cast<uint32_t>(currentFrame);
+        if (statisticsQueryPool) {
+            commandBuffer.endQuery(statisticsQueryPool, query);
+        }
+        if (occlusionQueryPool) {
+            // The wait is on the GPU, for the query to finish; a nonzero sample count is a true predicate
+            commandBuffer.copyQueryPoolResults(occlusionQueryPool, query, 1, occlusionResults[currentFrame].buffer, 0, sizeof(uint32_t),
+                                               vk::QueryResultFlagBits::eWait);
+            vk::MemoryBarrier toHost(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead);
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {},
+                                          1, &toHost, 0, nullptr, 0, nullptr);
+        }
+    }
+
+    // Only called once the frame's fence signaled, nothing blocks
+    void readGpuCounters(size_t frame) {
+        if (!countersWritten[frame]) {
+            return;
+        }
+        countersWritten[frame] = false;
+        if (statisticsQueryPool) {
+            std::array<uint64_t, GpuCounters::StatisticCount> values{};
+            auto result = device.getQueryPoolResults(statisticsQueryPool, static_cast<uint32_t>(frame), 1, sizeof(values), values.data(),
+                                                     sizeof(values), vk::QueryResultFlagBits::e64);
+            if (result == vk::Result::eSuccess) {
+                gpuCounters.addStatistics(values, counterPixelsOfSlot[frame]);
+            }
+        }
+        if (occlusionQueryPool) {
+            lastOcclusionSamples = *static_cast<const uint32_t*>(occlusionResults[frame].mapped);
+            gpuCounters.addOcclusion(lastOcclusionSamples);
+        }
+    }
+
+    void createSyncObjects() {
+        imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+        renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+        inFlightFences.clear();
+        inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+        imagesInFlight.clear();
+        imagesInFlight.resize(swapChainImages.size(), nullptr);
+        vk::SemaphoreCreateInfo semaphoreInfo{};
+        vk::FenceCreateInfo fenceInfo{};
+        fenceInfo.setFlags(vk::FenceCreateFlagBits::eSignaled);
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            imageAvailableSemaphores[i] = device.createSemaphore(semaphoreInfo);
+            renderFinishedSemaphores[i] = device.createSemaphore(semaphoreInfo);
+            inFlightFences[i] = device.createFence(fenceInfo);
+        }
+    }
+
+    static std::vector<char> readFile(const std::string& filename) {
+#ifdef __ANDROID__
+        JNIEnv* env = (JNIEnv*)SDL_AndroidGetJNIEnv();  // Pointer to native interface
+        jint ver = env->GetVersion();
+        jobject activity = (jobject)SDL_AndroidGetActivity();
+        jclass clazz(env->GetObjectClass(activity));
+        jmethodID midGetContext = env->GetStaticMethodID(clazz, "getContext", "()Landroid/content/Context;");
+        auto context = env->CallStaticObjectMethod(clazz, midGetContext);
+        auto mid = env->GetMethodID(env->GetObjectClass(context), "getAssets", "()Landroid/content/res/AssetManager;");
+        jobject ez = env->CallObjectMethod(context, mid);
+        
+        AAssetManager *assetManager = AAssetManager_fromJava(env, ez);
+        AAsset* asset = AAssetManager_open(assetManager, filename.c_str(), AASSET_MODE_STREAMING);
+        size_t size = AAsset_getLength(asset);
+        std::vector<char> buffer(size);
+        AAsset_read(asset, buffer.data(), size);
+        AAsset_close(asset);
+        return buffer;
+#else
+        std::ifstream file(filename, std::ios::ate | std::ios::binary);
+            
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open file!");
+        }
+
+        size_t fileSize = (size_t) file.tellg();
+        std::vector<char> buffer(fileSize);
+
+        file.seekg(0);
+        file.read(buffer.data(), fileSize);
+        file.close();
+        return buffer;
+#endif
+    }
+
+    static std::string getShaderPath() {
+#if defined(__ANDROID__)
+        return "shaders";
+#else
+        return getExecutablePath() + "/shaders";
+#endif
+    }
+
+    static std::string getExecutablePath() {
+#if defined(_WIN32)
+        static std::string path;
+        static std::once_flag once;
+        std::call_once(once, []{
+            char result[MAX_PATH];
+            std::string execPath(result, GetModuleFileName(nullptr, result, MAX_PATH));
+            std::replace(execPath.begin(), execPath.end(), '\\', '/');
+            std::string::size_type lastSlash = execPath.rfind("/");
+            path = execPath.substr(0, lastSlash);
+        });
+        return path;
+#elif defined(__linux__) && !defined(__ANDROID__)
+        static std::string path;
+        static std::once_flag once;
+        std::call_once(once, []{
+            char result[PATH_MAX];
+            ssize_t count = readlink("/proc/self/exe", result, PATH_MAX);
+            return std::string execPath(result, (count > 0) ? count : 0);
+            std::replace(execPath.begin(), execPath.end(), '\\', '/');
+            std::string::size_type lastSlash = execPath.rfind("/");
+            path = execPath.substr(0, lastSlash);
+        });
+        return path;
+#elif defined(__ANDROID__)
+        return "";
+#else
+        static const std::string empty;
+        return empty;
+#endif
+    }
+
+    // Interface of a shader in the shader directory, read from its SPIR-V once per run
+    const ShaderReflection& shaderReflection(const std::string& name) {
+        auto it = shaderReflections.find(name);
+        if (it == shaderReflections.end()) {
+            const auto code = readFile(getShaderPath() + "/" + name);
+            it = shaderReflections.emplace(name, reflectShader(reinterpret_cast<const uint32_t*>(code.data()), code.size() / 4)).first;
+        }
+        return it->second;
+    }
+
+    vk::ShaderModule createShaderModule(const std::vector<char>& code) {
+        vk::ShaderModuleCreateInfo createInfo{};
+        createInfo.codeSize = code.size();
+        createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+        return device.createShaderModule(createInfo);
+    }
+
+    int rateDeviceSuitability(vk::PhysicalDevice device) {
+        auto features = device.getFeatures();
+        if (!features.geometryShader || !isDeviceSuitable(device))
+            return 0;
+        int score = 0;
         auto properties = device.getProperties();
         score += properties.deviceType == vk::PhysicalDeviceType::eDiscreteGpu ? 1000 : 0;
         score += properties.limits.maxImageDimension2D;
@@ -689,8 +3756,7 @@ private:
 
     void initWindow() {
         if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) != 0) {
-		    std::cerr << "Failed to initialize SDL:" << SDL_GetError() << std::endl;
-            throw std::runtime_error("Failed to initialize SDL!");
+            throw std::runtime_error(std::string("Failed to initialize SDL: ") + SDL_GetError());
 	    }
         window = SDL_CreateWindow(
             "A Simple Triangle",
@@ -702,6 +3768,24 @@ private:
 #else
         SDL_SetWindowFullscreen(window, SDL_FALSE);
 #endif
+        mainWindowId = SDL_GetWindowID(window);
+#ifndef __ANDROID__
+        // Android has a single native window
+        for (uint32_t i = 1; i < config.windowCount; i++) {
+            WindowTarget target;
+            const std::string title = "A Simple Triangle (" + std::to_string(i + 1) + ")";
+            target.window = SDL_CreateWindow(title.c_str(), SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+                k_width / 2, k_height / 2, SDL_WINDOW_RESIZABLE | SDL_WINDOW_VULKAN | SDL_WINDOW_ALLOW_HIGHDPI);
+            if (!target.window) {
+                throw std::runtime_error(std::string("Failed to create a window: ") + SDL_GetError());
+            }
+            target.id = SDL_GetWindowID(target.window);
+            secondaryWindows.push_back(std::move(target));
+        }
+#endif
+        invalidateEventType = SDL_RegisterEvents(2);
+        mainThreadJobsEventType = invalidateEventType + 1;
+        renderWakeup = SDL_CreateSemaphore(0);
 
     }
 
@@ -709,50 +3793,296 @@ private:
         framebufferResized = true;
     }
 
+    // Main thread: only pumps SDL events and publishes state snapshots, it never touches the GPU.
+    // Vulkan submission and presentation happen on the render thread, so a blocking
+    // waitForFences or presentKHR can no longer delay input handling.
     void mainLoop() {
-        while (true) {
+        running.store(true, std::memory_order_release);
+        renderThread = std::thread(&HelloTriangleApplication::renderLoop, this);
+
+        FrameState state{};
+        bool statePending = false;
+        while (!state.quit) {
             SDL_Event event;
-            // Each loop we will process any events that are waiting for us.
-            bool quit = false;
-            while (SDL_PollEvent(&event)) {
-                switch (event.type) {
-                    case SDL_WINDOWEVENT:
-                        onWindowResize();
-                        break;
-                    case SDL_RENDER_DEVICE_RESET:
-                        recreateVulkanStructures();
-                        break;
+            // Block until something happens; the render thread keeps drawing on its own.
+            if (!SDL_WaitEvent(&event)) {
+                continue;
+            }
+            do {
+                statePending |= processEvent(event, state);
+            } while (SDL_PollEvent(&event));
+            jobs->runMainThreadJobs();
 
-                    case SDL_QUIT:
-                        quit = true;
+            if (statePending) {
+                state.sequence++;
+                if (frameStates.tryPush(state)) {
+                    // Sticky flags were delivered, don't report them twice
+                    state.framebufferResized = false;
+                    state.deviceReset = false;
+                    state.redraw = false;
+                    state.captureRequested = false;
+                    state.secondaryWindowsResized = 0;
+                    statePending = false;
+                    SDL_SemPost(renderWakeup);
+                }
+                // else: the render thread is behind, keep accumulating and retry on the next event
+            }
+        }
+        running.store(false, std::memory_order_release);
+        SDL_SemPost(renderWakeup);
+        renderThread.join();
+    }
 
-                    case SDL_KEYDOWN:
-                        if (event.key.keysym.sym == SDLK_ESCAPE) {
-                            quit = true;
-                        }
-                        break;
+    // Folds an SDL event into the snapshot, returns whether the snapshot changed.
+    bool processEvent(const SDL_Event& event, FrameState& state) {
+        if (event.type == mainThreadJobsEventType) {
+            return false; // the jobs run once the events are processed
+        }
+        state.inputTimestamp = event.common.timestamp;
+        if (event.type == invalidateEventType) {
+            state.redraw = true;
+            return true;
+        }
+        switch (event.type) {
+            case SDL_WINDOWEVENT:
+                state.windowEventCount++;
+                if (event.window.windowID != mainWindowId) {
+                    return processSecondaryWindowEvent(event.window, state);
+                }
+                switch (event.window.event) {
+                    // Only size changes invalidate the swapchain, focus/move/enter/leave don't affect it at all
+                    case SDL_WINDOWEVENT_RESIZED:
+                    case SDL_WINDOWEVENT_SIZE_CHANGED:
+                        state.framebufferResized = true;
+                        state.lastResizeTimestamp = event.window.timestamp;
+                        state.minimized = false;
+                        state.redraw = true;
+                        return true;
+                    case SDL_WINDOWEVENT_MINIMIZED:
+                        state.minimized = true;
+                        return true;
+                    case SDL_WINDOWEVENT_RESTORED:
+                    case SDL_WINDOWEVENT_MAXIMIZED:
+                    case SDL_WINDOWEVENT_SHOWN:
+                        state.minimized = false;
+                        state.redraw = true;
+                        return true;
+                    case SDL_WINDOWEVENT_EXPOSED:
+                        state.redraw = true;
+                        return true;
+                    case SDL_WINDOWEVENT_CLOSE:
+                        // SDL only sends SDL_QUIT once the last window is closed, secondary windows may still be open
+                        state.quit = true;
+                        return true;
                     default:
-                        break;
+                        return true; // keeps windowEventCount current for the rebuild statistics
+                }
+            case SDL_RENDER_DEVICE_RESET:
+                state.deviceReset = true;
+                state.redraw = true;
+                return true;
+            case SDL_APP_DIDENTERFOREGROUND:
+                state.redraw = true;
+                return true;
+            case SDL_QUIT:
+                state.quit = true;
+                return true;
+            case SDL_KEYDOWN:
+                if (event.key.keysym.sym == SDLK_ESCAPE) {
+                    state.quit = true;
+                } else if (event.key.keysym.sym == SDLK_F12) {
+                    state.captureRequested = true;
                 }
+                state.redraw = true;
+                return true;
+            case SDL_KEYUP:
+            case SDL_MOUSEWHEEL:
+            case SDL_FINGERDOWN:
+            case SDL_FINGERUP:
+            case SDL_FINGERMOTION:
+                state.redraw = true;
+                return true;
+            case SDL_MOUSEMOTION:
+                state.pointerX = event.motion.x;
+                state.pointerY = event.motion.y;
+                state.redraw = true;
+                return true;
+            case SDL_MOUSEBUTTONDOWN:
+            case SDL_MOUSEBUTTONUP:
+                state.pointerX = event.button.x;
+                state.pointerY = event.button.y;
+                state.pointerDown = event.button.state == SDL_PRESSED;
+                state.redraw = true;
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool processSecondaryWindowEvent(const SDL_WindowEvent& event, FrameState& state) {
+        for (size_t i = 0; i < secondaryWindows.size(); i++) {
+            if (secondaryWindows[i].id != event.windowID) {
+                continue;
             }
-            if (quit) {
-                break;
+            const uint32_t bit = 1u << i;
+            switch (event.event) {
+                case SDL_WINDOWEVENT_RESIZED:
+                case SDL_WINDOWEVENT_SIZE_CHANGED:
+                    state.secondaryWindowsResized |= bit;
+                    state.secondaryWindowsMinimized &= ~bit;
+                    state.redraw = true;
+                    return true;
+                case SDL_WINDOWEVENT_MINIMIZED:
+                    state.secondaryWindowsMinimized |= bit;
+                    return true;
+                case SDL_WINDOWEVENT_RESTORED:
+                case SDL_WINDOWEVENT_MAXIMIZED:
+                case SDL_WINDOWEVENT_SHOWN:
+                    state.secondaryWindowsMinimized &= ~bit;
+                    state.redraw = true;
+                    return true;
+                case SDL_WINDOWEVENT_EXPOSED:
+                    state.redraw = true;
+                    return true;
+                case SDL_WINDOWEVENT_CLOSE:
+                    // Closing a secondary window only hides it, the application lives as long as the main window
+                    SDL_HideWindow(secondaryWindows[i].window);
+                    state.secondaryWindowsMinimized |= bit;
+                    return true;
+                default:
+                    return true;
             }
-            drawFrame();
         }
-        device.waitIdle();
+        return false;
+    }
+
+    // Render thread: drains the snapshot queue (keeping only the newest state) and draws.
+    // In on-demand mode it sleeps on renderWakeup while nothing visible changed,
+    // so a static scene costs neither CPU nor GPU time.
+    void renderLoop() {
+        try {
+            FrameState& state = frameState;
+            while (running.load(std::memory_order_acquire)) {
+                pollFrameStates();
+                if (state.quit) {
+                    break;
+                }
+                if (state.deviceReset) {
+                    state.deviceReset = false;
+                    recreateVulkanStructures();
+                }
+                if (state.framebufferResized) {
+                    state.framebufferResized = false;
+                    lastResizeTicks = state.lastResizeTimestamp;
+                    onWindowResize();
+                }
+                if (state.redraw) {
+                    state.redraw = false;
+                    redrawRequested = true;
+                }
+                windowEventCount = state.windowEventCount;
+                for (size_t i = 0; i < secondaryWindows.size(); i++) {
+                    secondaryWindows[i].resized |= (state.secondaryWindowsResized >> i) & 1;
+                    secondaryWindows[i].minimized = (state.secondaryWindowsMinimized >> i) & 1;
+                }
+                state.secondaryWindowsResized = 0;
+                if (state.minimized) {
+                    // A minimized window has a zero sized surface, a swapchain can't be created for it
+                    SDL_SemWait(renderWakeup);
+                    continue;
+                }
+                if (config.renderMode == RenderMode::OnDemand && !redrawRequested && !framebufferResized) {
+                    SDL_SemWait(renderWakeup);
+                    continue;
+                }
+                if (config.renderMode == RenderMode::OnDemand && !redrawRequested && isSwapChainRebuildDeferred()) {
+                    // Nothing to draw but a deferred rebuild: wake up once the drag settled to rebuild at the final size
+                    SDL_SemWaitTimeout(renderWakeup, RESIZE_SETTLE_MS);
+                    if (isSwapChainRebuildDeferred()) {
+                        continue;
+                    }
+                }
+                framePacer.waitForNextFrame();
+                redrawRequested = false;
+                try {
+                    drawFrame();
+                } catch (const vk::DeviceLostError&) {
+                    if (deviceLostAtFrame == frameNumber) {
+                        throw; // lost again before a frame made it through: the device can't be recovered
+                    }
+                    deviceLostAtFrame = frameNumber;
+                    LOG_WARNING("The device was lost, recreating it");
+                    recreateVulkanStructures(true);
+                    redrawRequested = true;
+                }
+            }
+            LOG("Swapchain rebuilds: " << swapChainRebuilds << " for " << windowEventCount << " window events ("
+                << (windowEventCount > swapChainRebuilds ? windowEventCount - swapChainRebuilds : 0) << " rebuilds avoided)");
+            if (deviceResetTimes.size() > 0) {
+                const TimingSummary recovery = deviceResetTimes.summarize();
+                LOG("Device resets: " << recovery.count << ", recovered in " << recovery.mean << " ms on average (max " << recovery.max << " ms)");
+            }
+            device.waitIdle();
+            for (size_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+                collectFinishedCaptures(frame);
+                if (videoRecorder) {
+                    collectRecordedFrames(frame);
+                }
+            }
+            if (recordingFramesDropped > 0) {
+                LOG("Recording dropped " << recordingFramesDropped << " frames, the writer couldn't keep up");
+            }
+            if (config.profileVulkanCalls && !config.benchmark) {
+                // The benchmark report already has these
+                StatsReport report;
+                dispatchProfiler().addToReport(report, "vulkan_calls");
+                LOG(report.text());
+            }
+            if ((statisticsQueryPool || occlusionQueryPool) && !config.benchmark) {
+                StatsReport report;
+                gpuCounters.addToReport(report, "gpu_counters");
+                LOG(report.text());
+            }
+        } catch (...) {
+            renderThreadError = std::current_exception();
+            // Wake up the main thread so it can shut down and report the error
+            SDL_Event quitEvent{};
+            quitEvent.type = SDL_QUIT;
+            SDL_PushEvent(&quitEvent);
+        }
     }
 
     void drawFrame() {
         device.waitForFences(1, &inFlightFences[currentFrame], true, UINT64_MAX);
+        if (config.loseDeviceAtFrame != 0 && frameNumber == config.loseDeviceAtFrame && !deviceLossSimulated) {
+            // The other frame in flight, and its captures and video frame, may still be pending, as in a real loss
+            deviceLossSimulated = true;
+            throw vk::DeviceLostError("--lose-device-at"); // recovered from in renderLoop
+        }
+        const bool gpuTimeRead = readGpuFrameTime(currentFrame);
+        const DrawDataPath gpuTimeDrawDataPath = drawDataPathOfSlot[currentFrame]; // the path of the frame that was timed
+        const bool particleTimeRead = readParticleSimulationTime(currentFrame);
+        readGpuCounters(currentFrame);
+        if (gpuTimeRead && dynamicResolution) {
+            resolutionScaler.update(lastGpuFrameTimeMs);
+        }
+        collectFinishedCaptures(currentFrame);
+        if (videoRecorder) {
+            collectRecordedFrames(currentFrame);
+        }
         uint32_t imageIndex;
 
-        if (framebufferResized)
+        // Size changes are coalesced: however many arrived since the last present, we rebuild once, at the latest size.
+        if (framebufferResized && !isSwapChainRebuildDeferred()) {
+            framebufferResized = false;
             recreateSwapChain();
+        }
+        rebuildResizedWindows();
         // acquireNextImageKHR will signal semaphore when complete
         auto result = device.acquireNextImageKHR(swapchain, UINT64_MAX, imageAvailableSemaphores[currentFrame], nullptr);
         if (result.result == vk::Result::eErrorOutOfDateKHR) {
             recreateSwapChain();
+            redrawRequested = true; // nothing was presented, the new swapchain still needs a frame
             return;
         }
         imageIndex = result.value;
@@ -762,54 +4092,400 @@ private:
         }
         // Mark the image as now being in use by this frame
         imagesInFlight[imageIndex] = inFlightFences[currentFrame];
+        acquireWindowImages();
+
+        // Sample input as late as possible, right before recording what gets submitted
+        auto recordStart = FramePacer::Clock::now();
+        pollFrameStates();
+        CaptureSlot* capture = shouldCaptureFrame() ? acquireCaptureSlot() : nullptr;
+        RecordingSlot* recording = acquireRecordingSlot();
+        recordCommandBuffer(commandBuffers[currentFrame], imageIndex, capture, recording);
+
+        // One entry per window that gets presented this frame, the main window first
+        std::array<vk::Semaphore, MAX_WINDOWS> waitSemaphores;
+        std::array<vk::PipelineStageFlags, MAX_WINDOWS> waitStages;
+        std::array<vk::SwapchainKHR, MAX_WINDOWS> swapChains;
+        std::array<uint32_t, MAX_WINDOWS> imageIndices;
+        std::array<vk::Result, MAX_WINDOWS> presentResults;
+        std::array<WindowTarget*, MAX_WINDOWS> presentedWindows;
+        uint32_t windowCount = 0;
+        waitSemaphores[0] = imageAvailableSemaphores[currentFrame];
+        waitStages[0] = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+        if (dynamicResolution) {
+            waitStages[0] |= vk::PipelineStageFlagBits::eTransfer; // the first write to the swapchain image is the blit
+        }
+        swapChains[0] = swapchain;
+        imageIndices[0] = imageIndex;
+        presentedWindows[0] = nullptr;
+        windowCount++;
+        for (auto& target : secondaryWindows) {
+            if (target.acquired) {
+                waitSemaphores[windowCount] = target.imageAvailableSemaphores[currentFrame];
+                waitStages[windowCount] = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+                swapChains[windowCount] = target.swapchain;
+                imageIndices[windowCount] = target.imageIndex;
+                presentedWindows[windowCount] = &target;
+                windowCount++;
+            }
+        }
+
         vk::SubmitInfo submitInfo{};
-        vk::Semaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-        vk::PipelineStageFlags waitStages(vk::PipelineStageFlagBits::eColorAttachmentOutput);
         // Specify which semaphores to wait on before execution begins and in which stage(s) of the pipeline to wait
         vk::Semaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-        submitInfo.setWaitSemaphoreCount(1)
-            .setPWaitSemaphores(waitSemaphores)
-            .setPWaitDstStageMask(&waitStages)
+        submitInfo.setWaitSemaphoreCount(windowCount)
+            .setPWaitSemaphores(waitSemaphores.data())
+            .setPWaitDstStageMask(waitStages.data())
             .setCommandBufferCount(1)
-            .setPCommandBuffers(&commandBuffers[imageIndex])
+            .setPCommandBuffers(&commandBuffers[currentFrame])
             .setSignalSemaphoreCount(1)
             .setPSignalSemaphores(signalSemaphores);
 
         device.resetFences(1, &inFlightFences[currentFrame]);
 
         graphicsQueue.submit(1, &submitInfo, inFlightFences[currentFrame]);
+        timestampsWritten[currentFrame] = static_cast<bool>(timestampQueryPool);
+        particleTimestampsWritten[currentFrame] = static_cast<bool>(particleQueryPool);
+        countersWritten[currentFrame] = statisticsQueryPool || occlusionQueryPool;
+        lastCpuFrameTimeMs = std::chrono::duration<double, std::milli>(FramePacer::Clock::now() - recordStart).count();
+        framePacer.recordFrameCost(lastCpuFrameTimeMs, lastGpuFrameTimeMs);
 
-        vk::SwapchainKHR swapChains[] = {swapchain};
+        // All windows are presented with a single call, which waits on the one render finished semaphore
         vk::PresentInfoKHR presentInfo{};
         presentInfo.setWaitSemaphoreCount(1)
             .setPWaitSemaphores(signalSemaphores)
-            .setSwapchainCount(1)
-            .setPSwapchains(swapChains)
-            .setPImageIndices(&imageIndex)
-            .setPResults(nullptr); // only relevant for multiple swapchains
+            .setSwapchainCount(windowCount)
+            .setPSwapchains(swapChains.data())
+            .setPImageIndices(imageIndices.data())
+            .setPResults(presentResults.data()); // per swapchain, so one out of date window doesn't affect the others
 
-        auto presentResult = presentQueue.presentKHR(&presentInfo);
-        if (presentResult == vk::Result::eErrorOutOfDateKHR || presentResult == vk::Result::eSuboptimalKHR || framebufferResized) {
-            framebufferResized = false;
-            recreateSwapChain();
-            return;
+        vk::Result presentResult = presentQueue.presentKHR(&presentInfo);
+        if (presentResult == vk::Result::eErrorDeviceLost) {
+            throw vk::DeviceLostError("vkQueuePresentKHR"); // recovered from in renderLoop
+        }
+        if (static_cast<int>(presentResult) < 0 && presentResult != vk::Result::eErrorOutOfDateKHR) {
+            throw std::runtime_error("failed to present: " + vk::to_string(presentResult));
+        }
+        for (uint32_t i = 0; i < windowCount; i++) {
+            if (presentResults[i] != vk::Result::eErrorOutOfDateKHR && presentResults[i] != vk::Result::eSuboptimalKHR) {
+                continue;
+            }
+            // Don't rebuild right away, the next frame does it before acquiring. This caps rebuilds at one per presented frame.
+            if (presentedWindows[i]) {
+                presentedWindows[i]->resized = true;
+            } else {
+                framebufferResized = true;
+            }
+            redrawRequested = true;
         }
+        frameNumber++;
         currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+        if (config.profileVulkanCalls) {
+            dispatchProfiler().endFrame();
+        }
+        if (config.benchmark) {
+            updateBenchmark(gpuTimeRead, gpuTimeDrawDataPath, particleTimeRead);
+        }
+    }
+
+    // Benchmark mode: after the warm-up frames, the time between consecutive presents is measured for a fixed number
+    // of frames, along with the CPU recording time and the GPU time from the timestamp queries. With --draws, the
+    // timings are also collected per per-draw data path, the GPU time by the path of the frame it measured. With
+    // --particles, the simulation step times by workgroup size. With --scene, the transform update times.
+    void updateBenchmark(bool gpuTimeRead, DrawDataPath gpuTimeDrawDataPath, bool particleTimeRead) {
+        if (benchmarkDone) {
+            return;
+        }
+        const auto now = FramePacer::Clock::now();
+        if (frameNumber == config.benchmarkWarmupFrames) {
+            benchmarkStart = now;
+            dispatchProfiler().reset();
+            gpuCounters.reset();
+            benchmarkFrameTimes.reserve(config.benchmarkFrames);
+            benchmarkCpuTimes.reserve(config.benchmarkFrames);
+            benchmarkGpuTimes.reserve(config.benchmarkFrames);
+            for (auto& timings : drawDataTimings) {
+                timings.frameTimes.reserve(config.benchmarkFrames);
+                timings.cpuTimes.reserve(config.benchmarkFrames);
+                timings.gpuTimes.reserve(config.benchmarkFrames);
+            }
+            particleSimulationTimes.resize(particleWorkgroupSizes.size());
+            for (auto& times : particleSimulationTimes) {
+                times.reserve(config.benchmarkFrames);
+            }
+            sceneUpdateTimes.reserve(config.benchmarkFrames);
+            sceneUpdatedNodes = 0;
+            spriteBatchTimes.reserve(config.benchmarkFrames);
+            spriteDraws = 0;
+        } else if (frameNumber > config.benchmarkWarmupFrames) {
+            benchmarkFrameTimes.add(std::chrono::duration<double, std::milli>(now - benchmarkLastFrameEnd).count());
+            benchmarkCpuTimes.add(lastCpuFrameTimeMs);
+            if (gpuTimeRead) {
+                // Timestamps are read one frame slot later, so these trail the measured frames by MAX_FRAMES_IN_FLIGHT
+                benchmarkGpuTimes.add(lastGpuFrameTimeMs);
+            }
+            if (config.drawCount > 0) {
+                // The frame just presented was recorded in the previous slot
+                const size_t recordedSlot = (currentFrame + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT;
+                DrawDataTimings& recorded = drawDataTimings[static_cast<size_t>(drawDataPathOfSlot[recordedSlot])];
+                recorded.frameTimes.add(std::chrono::duration<double, std::milli>(now - benchmarkLastFrameEnd).count());
+                recorded.cpuTimes.add(lastCpuFrameTimeMs);
+                if (gpuTimeRead) {
+                    drawDataTimings[static_cast<size_t>(gpuTimeDrawDataPath)].gpuTimes.add(lastGpuFrameTimeMs);
+                }
+            }
+            if (particleTimeRead && lastParticleWorkgroup < particleSimulationTimes.size()) {
+                particleSimulationTimes[lastParticleWorkgroup].add(lastParticleSimulationMs);
+            }
+            if (config.sceneNodeCount > 0) {
+                sceneUpdateTimes.add(lastSceneUpdateMs);
+                sceneUpdatedNodes += lastSceneUpdatedNodes;
+            }
+            if (config.spriteCount > 0) {
+                spriteBatchTimes.add(lastSpriteBatchMs);
+                spriteDraws += spriteBatches.size();
+            }
+            if (benchmarkFrameTimes.size() == config.benchmarkFrames) {
+                finishBenchmark(std::chrono::duration<double>(now - benchmarkStart).count());
+            }
+        }
+        benchmarkLastFrameEnd = now;
+    }
+
+    void finishBenchmark(double seconds) {
+        benchmarkDone = true;
+        StatsReport report = createStatsReport();
+        report.add("benchmark", "frames", static_cast<uint64_t>(benchmarkFrameTimes.size()));
+        report.add("benchmark", "warmup_frames", config.benchmarkWarmupFrames);
+        report.add("benchmark", "duration_s", seconds);
+        report.add("benchmark", "fps", benchmarkFrameTimes.size() / seconds);
+        report.add("frame_time", benchmarkFrameTimes.summarize());
+        report.add("cpu_time", benchmarkCpuTimes.summarize());
+        if (benchmarkGpuTimes.size() > 0) {
+            report.add("gpu_time", benchmarkGpuTimes.summarize());
+        }
+        if (config.drawCount > 0) {
+            // Means per path, to compare them at a glance; ns_per_draw is the GPU time spread over the draws
+            const char* pathNames[] = {"push", "ubo", "ssbo"};
+            for (size_t path = 0; path < drawDataTimings.size(); path++) {
+                const TimingSummary frame = drawDataTimings[path].frameTimes.summarize();
+                if (frame.count == 0) {
+                    continue;
+                }
+                const TimingSummary cpu = drawDataTimings[path].cpuTimes.summarize();
+                const TimingSummary gpu = drawDataTimings[path].gpuTimes.summarize();
+                report.add("draw_data", pathNames[path], {
+                    {"frames", double(frame.count)},
+                    {"frame_ms", frame.mean},
+                    {"frame_p99_ms", frame.p99},
+                    {"cpu_ms", cpu.mean},
+                    {"gpu_ms", gpu.mean},
+                    {"gpu_p99_ms", gpu.p99},
+                    {"ns_per_draw", gpu.mean * 1e6 / config.drawCount}
+                });
+            }
+        }
+        if (statisticsQueryPool || occlusionQueryPool) {
+            gpuCounters.addToReport(report, "gpu_counters");
+        }
+        if (deviceResetTimes.size() > 0) {
+            report.add("device_resets", deviceResetTimes.summarize());
+        }
+        // Simulation step alone, without drawing: particles_per_ms is the throughput to compare devices by
+        for (size_t i = 0; i < particleSimulationTimes.size(); i++) {
+            const TimingSummary step = particleSimulationTimes[i].summarize();
+            if (step.count == 0) {
+                continue;
+            }
+            report.add("particles", "workgroup_" + std::to_string(particleWorkgroupSizes[i]), {
+                {"steps", double(step.count)},
+                {"step_ms", step.mean},
+                {"step_p99_ms", step.p99},
+                {"particles_per_ms", step.mean > 0.0 ? config.particleCount / step.mean : 0.0}
+            });
+        }
+        // Animation and world matrix update of the scene, the nodes recomputed per frame, and the time per node
+        if (sceneUpdateTimes.size() > 0) {
+            const TimingSummary update = sceneUpdateTimes.summarize();
+            const double nodesPerFrame = double(sceneUpdatedNodes) / double(update.count);
+            report.add("scene", "update", {
+                {"frames", double(update.count)},
+                {"update_ms", update.mean},
+                {"update_p99_ms", update.p99},
+                {"nodes_updated", nodesPerFrame},
+                {"ns_per_node", nodesPerFrame > 0.0 ? update.mean * 1e6 / nodesPerFrame : 0.0}
+            });
+        }
+        // Building the sprite batches on the CPU (sorting and writing the ring), and the draws they took
+        if (spriteBatchTimes.size() > 0) {
+            const TimingSummary batch = spriteBatchTimes.summarize();
+            report.add("sprites", "batching", {
+                {"frames", double(batch.count)},
+                {"batch_ms", batch.mean},
+                {"batch_p99_ms", batch.p99},
+                {"draws", double(spriteDraws) / double(batch.count)},
+                {"ns_per_sprite", batch.mean * 1e6 / config.spriteCount}
+            });
+        }
+        if (config.profileVulkanCalls) {
+            dispatchProfiler().addToReport(report, "vulkan_calls");
+        }
+
+        LOG(report.text());
+        if (config.benchmarkJsonPath.empty()) {
+            LOG(report.json());
+        } else {
+            std::ofstream file(config.benchmarkJsonPath, std::ios::trunc);
+            file << report.json();
+            if (!file) {
+                throw std::runtime_error("failed to write " + config.benchmarkJsonPath);
+            }
+            LOG("Benchmark report written to " << config.benchmarkJsonPath);
+        }
+        requestExit();
+    }
+
+    // Device and configuration sections shared by every report the application exports
+    StatsReport createStatsReport() {
+        StatsReport report;
+        auto properties = physicalDevice.getProperties();
+        std::string deviceName = properties.deviceName;
+        report.add("device", "name", deviceName);
+        report.add("device", "type", vk::to_string(properties.deviceType));
+        report.add("device", "vendor_id", static_cast<uint64_t>(properties.vendorID));
+        report.add("device", "device_id", static_cast<uint64_t>(properties.deviceID));
+        report.add("device", "driver_version", formatDriverVersion(properties.vendorID, properties.driverVersion));
+        report.add("device", "api_version", formatVersion(properties.apiVersion));
+
+        report.add("configuration", "windows", static_cast<uint64_t>(1 + secondaryWindows.size()));
+        report.add("configuration", "resolution", std::to_string(swapChainExtent.width) + "x" + std::to_string(swapChainExtent.height));
+        report.add("configuration", "swapchain_format", vk::to_string(swapChainImageFormat));
+        report.add("configuration", "present_mode", vk::to_string(swapChainPresentMode));
+        report.add("configuration", "swapchain_images", static_cast<uint64_t>(swapChainImages.size()));
+        report.add("configuration", "frames_in_flight", static_cast<uint64_t>(MAX_FRAMES_IN_FLIGHT));
+        report.add("configuration", "render_mode", config.renderMode == RenderMode::Continuous ? "continuous" : "on-demand");
+        report.add("configuration", "target_fps", config.targetFps);
+        report.add("configuration", "dynamic_resolution", dynamicResolution);
+        if (meshFile) {
+            report.add("configuration", "mesh", config.meshPath);
+            report.add("configuration", "mesh_triangles", static_cast<uint64_t>(meshFile->header().indexCount / 3));
+            const char* meshletModes[] = {"", "mesh-shader", "indirect", "off"};
+            report.add("configuration", "meshlets", meshletModes[static_cast<int>(activeMeshletMode)]);
+            report.add("configuration", "meshlet_culling", activeMeshletMode != MeshletMode::Off && config.meshletCulling);
+        }
+        if (config.drawCount > 0) {
+            const char* drawDataPaths[] = {"push", "ubo", "ssbo", "all"};
+            report.add("configuration", "draws", static_cast<uint64_t>(config.drawCount));
+            report.add("configuration", "draw_data", drawDataPaths[static_cast<int>(config.drawDataPath)]);
+            report.add("configuration", "uniform_stride", static_cast<uint64_t>(drawUniformStride));
+        }
+        if (config.particleCount > 0) {
+            report.add("configuration", "particles", static_cast<uint64_t>(config.particleCount));
+        }
+        if (config.spriteCount > 0) {
+            report.add("configuration", "sprites", static_cast<uint64_t>(config.spriteCount));
+        }
+        if (config.sceneNodeCount > 0) {
+            report.add("configuration", "scene_nodes", static_cast<uint64_t>(config.sceneNodeCount));
+            report.add("configuration", "scene_levels", static_cast<uint64_t>(scene.depthCount()));
+        }
+        report.add("configuration", "job_threads", static_cast<uint64_t>(jobs->workerCount() + 1));
+        if (config.occlusionCulling) {
+            report.add("configuration", "occlusion_culling", conditionalRenderingEnabled ? "conditional-rendering" : "cpu");
+        }
+        if (!config.postEffects.empty()) {
+            const char* const effectNames[] = {"tonemap", "vignette", "grade"};
+            std::string chain;
+            for (PostEffect effect : config.postEffects) {
+                chain += (chain.empty() ? "" : ",") + std::string(effectNames[static_cast<size_t>(effect)]);
+            }
+            report.add("configuration", "post_process", chain);
+        }
+        if (textureStreamer && textureHandle) {
+            const auto textureStats = textureStreamer->statistics();
+            report.add("textures", "budget_mb", double(textureStats.budget) / (1024.0 * 1024.0));
+            report.add("textures", "resident_mb", double(textureStats.residentBytes) / (1024.0 * 1024.0));
+            report.add("textures", "uploaded_mb", double(textureStats.uploadedBytes) / (1024.0 * 1024.0));
+            report.add("textures", "streamed_in", textureStats.streamedIn);
+            report.add("textures", "evictions", textureStats.evictions);
+        }
+        const auto variantStats = pipelineVariants->statistics();
+        report.add("pipelines", "variants_created", variantStats.created);
+        report.add("pipelines", "variants_reused", variantStats.reused);
+        report.add("pipelines", "variants_live", static_cast<uint64_t>(variantStats.live));
+        const auto layoutStats = layoutCache->statistics();
+        report.add("pipelines", "set_layouts", static_cast<uint64_t>(layoutStats.setLayouts));
+        report.add("pipelines", "pipeline_layouts", static_cast<uint64_t>(layoutStats.pipelineLayouts));
+        report.add("pipelines", "layouts_reused", layoutStats.reused);
+#ifdef DEBUG
+        report.add("configuration", "validation", true);
+#else
+        report.add("configuration", "validation", false);
+#endif
+        return report;
+    }
+
+    static std::string formatVersion(uint32_t version) {
+        return std::to_string(version >> 22) + "." + std::to_string((version >> 12) & 0x3ff) + "." + std::to_string(version & 0xfff);
+    }
+
+    // Vendors encode their driver versions differently, this covers the common schemes
+    static std::string formatDriverVersion(uint32_t vendorId, uint32_t version) {
+        if (vendorId == 0x10DE) { // NVIDIA: 10.8.8.6 bits
+            return std::to_string(version >> 22) + "." + std::to_string((version >> 14) & 0xff) + "."
+                 + std::to_string((version >> 6) & 0xff) + "." + std::to_string(version & 0x3f);
+        }
+#ifdef _WIN32
+        if (vendorId == 0x8086) { // Intel on Windows: 18.14 bits
+            return std::to_string(version >> 14) + "." + std::to_string(version & 0x3fff);
+        }
+#endif
+        return formatVersion(version); // Vulkan version encoding, used by most other drivers
+    }
+
+    // Folds every published snapshot into frameState, keeping the newest input.
+    void pollFrameStates() {
+        FrameState next;
+        while (frameStates.tryPop(next)) {
+            // sticky flags from intermediate snapshots must not get lost when we skip them
+            next.framebufferResized |= frameState.framebufferResized;
+            next.deviceReset |= frameState.deviceReset;
+            next.redraw |= frameState.redraw;
+            next.captureRequested |= frameState.captureRequested;
+            next.secondaryWindowsResized |= frameState.secondaryWindowsResized;
+            frameState = next;
+        }
+    }
+
+    // While the user is still dragging the window edge, keep presenting the old swapchain and let the
+    // presentation engine scale it, instead of rebuilding for every intermediate size.
+    bool isSwapChainRebuildDeferred() {
+        return framebufferResized && config.scaleDuringResize && SDL_GetTicks() - lastResizeTicks < RESIZE_SETTLE_MS;
     }
 
     void recreateSwapChain() {
-        int width = 0, height = 0;
-        SDL_GetWindowSize(window, &width, &height);
         device.waitIdle();
 
-        cleanupSwapChain();
+        cleanupSwapChainImages();
 
-        createSwapChain();
+        // Handing the old swapchain over lets the driver recycle its resources
+        vk::SwapchainKHR oldSwapchain = swapchain;
+        vk::Format oldFormat = swapChainImageFormat;
+        bool oldDynamicResolution = dynamicResolution;
+        createSwapChain(oldSwapchain);
+        device.destroySwapchainKHR(oldSwapchain);
         createImageViews();
-        createRenderPass();
-        createGraphicsPipeline();
+        // Viewport and scissor are dynamic, so the render pass and pipeline only depend on the image format
+        if (swapChainImageFormat != oldFormat || dynamicResolution != oldDynamicResolution) {
+            destroyGraphicsPipelines();
+            device.destroyRenderPass(renderPass);
+            createRenderPass();
+            createGraphicsPipeline();
+            recreateSecondaryWindowTargets();
+        }
         createFramebuffers();
-        createCommandBuffers();
+        // The image count may have changed
+        imagesInFlight.assign(swapChainImages.size(), nullptr);
+        swapChainRebuilds++;
     }
 
     void createInstance() {
@@ -822,6 +4498,14 @@ private:
         if (!checkValidationLayerSupport()) {
             throw std::runtime_error("validation layers requested, but not available!");
         }
+#endif
+#ifdef NARU_MESH_SHADER_SUPPORT
+        // Vulkan 1.1 (for mesh shaders) is only requested from loaders that know it, 1.0 implementations reject it
+        uint32_t loaderVersion = VK_API_VERSION_1_0;
+        if (VULKAN_HPP_DEFAULT_DISPATCHER.vkEnumerateInstanceVersion
+            && vk::enumerateInstanceVersion(&loaderVersion) == vk::Result::eSuccess && loaderVersion >= VK_API_VERSION_1_1) {
+            instanceApiVersion = VK_API_VERSION_1_1;
+        }
 #endif
         const vk::ApplicationInfo appInfo = getApplicationInfo();
         auto extensions = getRequiredExtensions();
@@ -845,6 +4529,9 @@ private:
 #ifndef __ANDROID__
         VULKAN_HPP_DEFAULT_DISPATCHER.init(instance);
 #endif
+        if (config.profileVulkanCalls) {
+            installInstrumentedDispatch(); // after init(instance), which reloads every entry point
+        }
     }
     
 #ifdef DEBUG
@@ -854,15 +4541,20 @@ private:
     }
 
     vk::DebugUtilsMessengerCreateInfoEXT createDebugMessenger() {
+        // Verbose messages are only asked for when they are logged, the layer doesn't even format them otherwise
+        vk::DebugUtilsMessageSeverityFlagsEXT severities = vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning | vk::DebugUtilsMessageSeverityFlagBitsEXT::eError;
+        if (logger().enabled(LogLevel::Verbose)) {
+            severities |= vk::DebugUtilsMessageSeverityFlagBitsEXT::eVerbose;
+        }
         return vk::DebugUtilsMessengerCreateInfoEXT(vk::DebugUtilsMessengerCreateFlagsEXT(), 
-                                                    vk::DebugUtilsMessageSeverityFlagBitsEXT::eVerbose | vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning | vk::DebugUtilsMessageSeverityFlagBitsEXT::eError,
+                                                    severities,
                                                     vk::DebugUtilsMessageTypeFlagBitsEXT::eGeneral | vk::DebugUtilsMessageTypeFlagBitsEXT::eValidation | vk::DebugUtilsMessageTypeFlagBitsEXT::ePerformance,
                                                     debugCallback);
     }
 #endif
 
     vk::ApplicationInfo getApplicationInfo() {
-        return vk::ApplicationInfo("Hello Triangle", VK_MAKE_VERSION(1, 0, 0), "No Engine", VK_MAKE_VERSION(1, 0, 0), VK_API_VERSION_1_0);
+        return vk::ApplicationInfo("Hello Triangle", VK_MAKE_VERSION(1, 0, 0), "No Engine", VK_MAKE_VERSION(1, 0, 0), instanceApiVersion);
     }
 
     std::vector<const char*> getRequiredExtensions() {
@@ -879,16 +4571,19 @@ private:
         std::vector<const char*> sdlExtensions(*sdlExtensionNames, *sdlExtensionNames + sdlExtensionCount);
 
 
-        std::cout << "Extensions:" << sdlExtensionCount << std::endl;
-        for (const auto& extension : availableExtensions) {
-            bool enabled = false;
-            for (auto i = 0u; i < sdlExtensionCount; ++i) {
-                if (!strcmp(extension.extensionName, (*sdlExtensionNames)[i])) {
-                    enabled = true;
-                    break;
+        if (logger().enabled(LogLevel::Verbose)) {
+            LogMessage message(LogLevel::Verbose);
+            message.stream() << "Extensions:" << sdlExtensionCount;
+            for (const auto& extension : availableExtensions) {
+                bool enabled = false;
+                for (auto i = 0u; i < sdlExtensionCount; ++i) {
+                    if (!strcmp(extension.extensionName, (*sdlExtensionNames)[i])) {
+                        enabled = true;
+                        break;
+                    }
                 }
+                message.stream() << "\n\t" << ((enabled) ? " [X] " : " [ ] ") << extension.extensionName;
             }
-            std::cout << "\t" << ((enabled) ? " [X] " : " [ ] ") << extension.extensionName << std::endl;
         }
 #ifdef DEBUG
         sdlExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -897,38 +4592,118 @@ private:
     }
 
     void cleanup() {
+        captureWorker.reset(); // finishes writing queued captures
+        releaseCaptureSlots();
+        if (videoRecorder) {
+            videoRecorder.reset(); // finishes writing queued frames
+            destroyRecordingResources();
+        }
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
             device.destroySemaphore(renderFinishedSemaphores[i]);
             device.destroySemaphore(imageAvailableSemaphores[i]);
             device.destroyFence(inFlightFences[i]);
         }
+        device.destroyQueryPool(timestampQueryPool);
+        device.destroyQueryPool(particleQueryPool);
+        destroyCounterQueries();
+        destroyMeshBuffers();
+        destroyDrawDataResources();
+        destroyParticleResources();
+        destroySpriteResources();
+        destroyTextureStreaming();
+        destroySecondaryWindowTargets();
         cleanupSwapChain();
         device.destroyCommandPool(commandPool);
+        pipelineVariants.reset();
+        layoutCache.reset();
         instance.destroySurfaceKHR(surface);
         device.destroy();
 #ifdef DEBUG
         instance.destroyDebugUtilsMessengerEXT(debugMessenger);
 #endif
         instance.destroy();
+        SDL_DestroySemaphore(renderWakeup);
+        for (auto& target : secondaryWindows) {
+            SDL_DestroyWindow(target.window);
+        }
         SDL_DestroyWindow(window);
         SDL_Quit();
     }
 
-    void recreateVulkanStructures() {
-        device.waitIdle();
+    // Device reset (SDL_RENDER_DEVICE_RESET, or the device was lost while drawing): only what belongs to the logical
+    // device is rebuilt. The instance and the physical device picked at startup are kept, so are the CPU side copies
+    // the GPU resources are made from (the mapped mesh and texture files, decoded texture levels). Pipelines are
+    // created through a pipeline cache seeded with the old device's, and the mesh is uploaded on a worker thread
+    // meanwhile. The surface is created again: on Android the native window is a new one after the app resumed.
+    // `deviceLost`: the frames in flight never complete, their captures and video frames are dropped.
+    void recreateVulkanStructures(bool deviceLost = false) {
+        const auto start = FramePacer::Clock::now();
+        try {
+            device.waitIdle();
+        } catch (const vk::DeviceLostError&) {
+            // Nothing is executing anymore, everything can be destroyed right away
+            deviceLost = true;
+        }
+        try {
+            pipelineCacheData = pipelineVariants->cacheData();
+        } catch (const vk::SystemError&) {
+            // Keep what the previous reset saved, if anything
+        }
+        // The frames in flight are done, their captures and video frames are written as usual. After a loss their
+        // contents are undefined: the slots are released without being collected.
+        if (!deviceLost) {
+            for (size_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+                collectFinishedCaptures(frame);
+                if (videoRecorder) {
+                    collectRecordedFrames(frame);
+                }
+            }
+        }
+        releaseCaptureSlots();
+        if (videoRecorder) {
+            destroyRecordingResources();
+        }
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
             device.destroySemaphore(renderFinishedSemaphores[i]);
             device.destroySemaphore(imageAvailableSemaphores[i]);
             device.destroyFence(inFlightFences[i]);
         }
+        device.destroyQueryPool(timestampQueryPool);
+        device.destroyQueryPool(particleQueryPool);
+        timestampQueryPool = nullptr;
+        particleQueryPool = nullptr;
+        destroyCounterQueries();
+        destroyMeshBuffers();
+        destroyDrawDataResources();
+        destroyParticleResources();
+        destroySpriteResources();
+        destroyTextureStreaming();
+        destroySecondaryWindowTargets();
         cleanupSwapChain();
         device.destroyCommandPool(commandPool);
+        pipelineVariants.reset();
+        layoutCache.reset();
         instance.destroySurfaceKHR(surface);
         device.destroy();
+        const auto teardownEnd = FramePacer::Clock::now();
 
         createSurface();
-        pickPhysicalDevice();
+        if (rateDeviceSuitability(physicalDevice) == 0) {
+            // The new surface may not be presentable from the old choice (a GPU switch), the features are re-checked
+            pickPhysicalDevice();
+            selectMeshletMode();
+            selectQueryFeatures();
+        }
         createLogicalDevice();
+        pipelineVariants = std::make_unique<PipelineVariants>(device, pipelineCacheData);
+        layoutCache = std::make_unique<LayoutCache>(device);
+        selectDepthFormat();
+        createTextureStreaming(); // textures are streamed in again from their mapped files
+        createMeshBuffers();
+        startMeshUpload(); // the file is still mapped, re-uploading is cheap
+        createDrawDataResources();
+        createParticleResources();
+        createSpriteResources();
         createSwapChain();
         createImageViews();
         createRenderPass();
@@ -937,23 +4712,56 @@ private:
         createCommandPool();
         createCommandBuffers();
         createSyncObjects();
+        createSecondaryWindowTargets();
+        createTimestampQueries();
+        createCounterQueries();
+        if (videoRecorder) {
+            createRecordingResources();
+        }
+        jobs->wait(meshUploaded);
+        uploadSpriteAtlas();
+
+        const auto end = FramePacer::Clock::now();
+        const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        deviceResetTimes.add(ms);
+        LOG("Device recreated in " << ms << " ms (teardown " << std::chrono::duration<double, std::milli>(teardownEnd - start).count()
+            << " ms), " << pipelineVariants->statistics().created << " pipelines created through a "
+            << pipelineCacheData.size() / 1024 << " KB pipeline cache");
     }
     
     void cleanupSwapChain() {
+        cleanupSwapChainImages();
+        destroyGraphicsPipelines();
+        device.destroyRenderPass(renderPass);
+        device.destroySwapchainKHR(swapchain);
+    }
+
+    // Everything that depends on the swapchain images or their size
+    void cleanupSwapChainImages() {
         for (auto framebuffer : swapChainFramebuffers) {
             device.destroyFramebuffer(framebuffer);
         }
-        device.freeCommandBuffers(commandPool, commandBuffers);
-        device.destroyPipeline(graphicsPipeline);
-        device.destroyPipelineLayout(pipelineLayout);
-        device.destroyRenderPass(renderPass);
+        swapChainFramebuffers.clear();
+        device.destroyFramebuffer(sceneFramebuffer);
+        device.destroyImageView(sceneImageView);
+        device.destroyImage(sceneImage);
+        device.freeMemory(sceneImageMemory);
+        sceneFramebuffer = nullptr;
+        sceneImageView = nullptr;
+        sceneImage = nullptr;
+        sceneImageMemory = nullptr;
+        destroyDepthImage(depthImage, depthImageMemory, depthImageView);
+        destroyPostProcessTargets();
         for (auto imageView : swapChainImageViews) {
             device.destroyImageView(imageView);
         }
-        device.destroySwapchainKHR(swapchain);
     }
     
+    const AppConfig config;
     SDL_Window* window;
+    Uint32 mainWindowId = 0;
+    std::vector<WindowTarget> secondaryWindows; // fixed after initWindow
+    vk::RenderPass windowRenderPass;
 
     vk::Instance instance;
     vk::DebugUtilsMessengerEXT debugMessenger;
@@ -964,6 +4772,7 @@ private:
 
     vk::Queue graphicsQueue;
     vk::Queue presentQueue;
+    vk::Queue transferQueue; // the graphics queue when the device has no separate transfer family
 
     vk::SwapchainKHR swapchain;
     std::vector<vk::Image> swapChainImages;
@@ -972,9 +4781,168 @@ private:
     std::vector<vk::ImageView> swapChainImageViews;
     std::vector<vk::Framebuffer> swapChainFramebuffers;
 
+    // Dynamic resolution: the scene is rendered into sceneImage at a variable scale and blitted into the swapchain
+    bool dynamicResolution = false;
+    ResolutionScaler resolutionScaler;
+    vk::Image sceneImage;
+    vk::DeviceMemory sceneImageMemory;
+    vk::ImageView sceneImageView;
+    vk::Framebuffer sceneFramebuffer;
+    vk::Extent2D sceneImageExtent;
+    vk::Filter upscaleFilter = vk::Filter::eLinear;
+
+    bool captureSupported = false;
+    std::array<CaptureSlot, CAPTURE_RING_SIZE> captureSlots;
+    std::unique_ptr<CaptureWorker> captureWorker;
+    std::vector<uint64_t> pendingCaptureFrames;
+    uint64_t frameNumber = 0; // presented frames so far
+
+    // Push constants of rgb-to-yuv.comp
+    struct YuvConversionParameters {
+        uint32_t width;
+        uint32_t height;
+    };
+    bool recordingSupported = false;
+    vk::Extent2D recordingExtent;
+    std::unique_ptr<VideoRecorder> videoRecorder;
+    std::array<RecordingSlot, RECORDING_RING_SIZE> recordingSlots;
+    vk::Sampler recordingSampler;
+    vk::DescriptorSetLayout recordingSetLayout;
+    vk::PipelineLayout recordingPipelineLayout;
+    vk::DescriptorPool recordingDescriptorPool;
+    uint64_t recordingFramesDropped = 0;
+    bool exitRequested = false;
+
+    vk::PresentModeKHR swapChainPresentMode = vk::PresentModeKHR::eFifo;
+    TimingSeries benchmarkFrameTimes; // time between consecutive presents
+    TimingSeries benchmarkCpuTimes;
+    TimingSeries benchmarkGpuTimes;
+    FramePacer::Clock::time_point benchmarkStart;
+    FramePacer::Clock::time_point benchmarkLastFrameEnd;
+    bool benchmarkDone = false;
+
     vk::RenderPass renderPass;
     vk::PipelineLayout pipelineLayout;
-    vk::Pipeline graphicsPipeline;
+    vk::Pipeline graphicsPipeline; // owned by pipelineVariants
+    // Every pipeline, specialized or not, so all of them are created through the device's pipeline cache
+    std::unique_ptr<PipelineVariants> pipelineVariants;
+    // Descriptor set and pipeline layouts built from shader reflection, it owns all of the application's layouts
+    std::unique_ptr<LayoutCache> layoutCache;
+    std::map<std::string, ShaderReflection> shaderReflections; // by .spv file name, they don't depend on the device
+
+    // Mesh loaded with --mesh, kept mapped so a device reset can upload it again
+    std::unique_ptr<MeshFile> meshFile;
+    vk::Buffer meshVertexBuffer;
+    vk::DeviceMemory meshVertexBufferMemory;
+    vk::Buffer meshIndexBuffer;
+    vk::DeviceMemory meshIndexBufferMemory;
+    vk::IndexType meshIndexType = vk::IndexType::eUint32;
+    vk::PipelineLayout meshPipelineLayout;
+    vk::Pipeline meshPipeline; // owned by pipelineVariants
+    PushConstants<MeshPushConstants> meshPush;
+    // Meshlet path (meshlet blocks of the mesh file)
+    struct MeshletFrameResources {
+        MappedBuffer cullData; // host-visible MeshletCullData, the CPU writes it every frame
+        vk::Buffer indexBuffer;  // indirect path: compacted triangles of the visible meshlets
+        vk::DeviceMemory indexBufferMemory;
+        vk::Buffer drawCommandBuffer; // indirect path: MeshletDrawCommand
+        vk::DeviceMemory drawCommandBufferMemory;
+        vk::DescriptorSet descriptorSet;
+    };
+    // Texture of the mesh (--texture), streamed by priority within --texture-budget
+    std::unique_ptr<ImageFile> textureImage; // PAM/PPM
+    std::unique_ptr<Ktx2File> textureKtx;
+    std::vector<uint8_t> decodedTexture;     // KTX2 levels decoded on the CPU, when the device lacks the format
+    std::unique_ptr<TextureStreamer> textureStreamer; // with --mesh, owns the placeholder when there is no texture
+    std::optional<TextureStreamer::Handle> textureHandle;
+    vk::DescriptorSetLayout textureSetLayout;
+    vk::DescriptorPool textureDescriptorPool;
+    std::vector<vk::DescriptorSet> textureDescriptorSets; // per frame in flight
+    std::vector<vk::ImageView> textureSetViews;           // what each of them currently points at
+    MeshletMode activeMeshletMode = MeshletMode::Off;
+    uint32_t instanceApiVersion = VK_API_VERSION_1_0;
+    vk::Buffer meshletBuffer;
+    vk::DeviceMemory meshletBufferMemory;
+    vk::Buffer meshletVertexBuffer;
+    vk::DeviceMemory meshletVertexBufferMemory;
+    vk::Buffer meshletTriangleBuffer;
+    vk::DeviceMemory meshletTriangleBufferMemory;
+    vk::DescriptorSetLayout meshletSetLayout;
+    vk::PipelineLayout meshletPipelineLayout;
+    vk::DescriptorPool meshletDescriptorPool;
+    vk::Pipeline meshletCullPipeline; // indirect path, owned by pipelineVariants
+    vk::Pipeline meshletPipeline;     // mesh shader path, owned by pipelineVariants
+    PushConstants<MeshPushConstants> meshletPush;
+    std::vector<MeshletFrameResources> meshletFrames;
+    // Per-draw data benchmark (--draws)
+    struct DrawDataFrameResources {
+        MappedBuffer uniforms; // ObjectData per draw at drawUniformStride, for the dynamic offsets
+        MappedBuffer storage;  // ObjectData per draw at OBJECT_DATA_STRIDE, indexed by firstInstance
+        vk::DescriptorSet descriptorSet;
+    };
+    struct DrawDataTimings {
+        TimingSeries frameTimes;
+        TimingSeries cpuTimes;
+        TimingSeries gpuTimes;
+    };
+    vk::PipelineLayout drawDataPipelineLayout;
+    vk::DescriptorPool drawDataDescriptorPool;
+    std::array<vk::Pipeline, 3> drawDataPipelines; // by DrawDataPath, owned by pipelineVariants
+    PushConstants<ObjectData> drawDataPush;
+    std::vector<DrawDataFrameResources> drawDataFrames;
+    std::vector<ObjectData> drawDataScratch; // push path: the frame's data, pushed draw by draw
+    vk::DeviceSize drawUniformStride = 0;
+    std::array<DrawDataPath, MAX_FRAMES_IN_FLIGHT> drawDataPathOfSlot{}; // what each frame slot was last recorded with
+    // Animated hierarchy (--scene), drawn through the storage buffers of drawDataFrames
+    SceneGraph scene;
+    SceneGraph::NodeId sceneRoot = 0;
+    std::vector<SceneGraph::NodeId> sceneSpinning; // set every frame, the rest of the tree stays put
+    std::array<SceneGraph::InstanceStream, MAX_FRAMES_IN_FLIGHT> sceneStreams; // by frame slot, over their storage buffers
+    vk::Extent2D sceneExtent;
+    double lastSceneUpdateMs = 0.0;
+    uint32_t lastSceneUpdatedNodes = 0;
+    TimingSeries sceneUpdateTimes; // benchmark
+    uint64_t sceneUpdatedNodes = 0;
+    std::array<DrawDataTimings, 3> drawDataTimings; // benchmark, by DrawDataPath
+    // GPU particle simulation (--particles)
+    std::array<vk::Buffer, 2> particleStateBuffers; // double-buffered state, see createParticleResources
+    std::array<vk::DeviceMemory, 2> particleStateMemory;
+    std::array<vk::DescriptorSet, 2> particleSimulationSets; // set i reads state i, writes the other one
+    std::array<vk::DescriptorSet, 2> particleDrawSets;       // set i reads state i
+    vk::DescriptorPool particleDescriptorPool;
+    vk::PipelineLayout particleSimulationPipelineLayout;
+    vk::PipelineLayout particleDrawPipelineLayout;
+    std::vector<vk::Pipeline> particleSimulationPipelines; // by particleWorkgroupSizes, owned by pipelineVariants
+    vk::Pipeline particleDrawPipeline;                     // owned by pipelineVariants
+    PushConstants<ParticleSimulationParameters> particleSimulationPush;
+    std::vector<uint32_t> particleWorkgroupSizes; // of PARTICLE_WORKGROUP_SIZES, those the device supports
+    size_t particleDefaultWorkgroup = 0;
+    size_t particleSource = 0;   // state the next step reads, the last one written
+    uint64_t particleSteps = 0;
+    bool particleStateReset = false; // the buffers still need zeroing
+    std::array<size_t, MAX_FRAMES_IN_FLIGHT> particleWorkgroupOfSlot{};
+    std::vector<TimingSeries> particleSimulationTimes; // benchmark, by particleWorkgroupSizes
+    // Sprite overlay (--sprites)
+    SpriteBatcher spriteBatcher;
+    std::vector<SpriteBatcher::Batch> spriteBatches; // of the frame being recorded
+    MappedBuffer spriteRing;                          // MAX_FRAMES_IN_FLIGHT regions of spriteCapacity SpriteVertex
+    uint32_t spriteCapacity = 0;
+    vk::Image spriteAtlas;
+    vk::DeviceMemory spriteAtlasMemory;
+    vk::ImageView spriteAtlasView;
+    vk::Sampler spriteSampler;
+    vk::DescriptorPool spriteDescriptorPool;
+    vk::DescriptorSet spriteDescriptorSet;
+    vk::PipelineLayout spritePipelineLayout;
+    PushConstants<SpriteView> spritePush;
+    std::array<vk::Pipeline, 2> spritePipelines; // by SpriteBlend, owned by pipelineVariants
+    double lastSpriteBatchMs = 0.0;
+    TimingSeries spriteBatchTimes; // benchmark
+    uint64_t spriteDraws = 0;      // benchmark, summed over the measured frames
+    vk::Format depthFormat = vk::Format::eUndefined; // eUndefined: no depth buffer
+    vk::Image depthImage;                            // main window, sized like the scene image or the swapchain
+    vk::DeviceMemory depthImageMemory;
+    vk::ImageView depthImageView;
 
     vk::CommandPool commandPool;
     std::vector<vk::CommandBuffer> commandBuffers;
@@ -983,17 +4951,72 @@ private:
     std::vector<vk::Semaphore> renderFinishedSemaphores;
     std::vector<vk::Fence> inFlightFences;
     std::vector<vk::Fence> imagesInFlight;
+
+    vk::QueryPool timestampQueryPool;
+    std::vector<bool> timestampsWritten; // per frame in flight: the slot holds results of a submitted frame
+    vk::QueryPool particleQueryPool;     // --particles: timestamps around the simulation step
+    std::vector<bool> particleTimestampsWritten;
+    double lastParticleSimulationMs = 0.0;
+    size_t lastParticleWorkgroup = 0;
+    // --gpu-counters and --occlusion-culling, one query per frame in flight
+    bool pipelineStatisticsEnabled = false;
+    bool conditionalRenderingEnabled = false;
+    vk::QueryPool statisticsQueryPool;
+    vk::QueryPool occlusionQueryPool;
+    std::vector<MappedBuffer> occlusionResults; // samples passed, the conditional rendering predicates
+    std::vector<bool> countersWritten;
+    std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> counterPixelsOfSlot{};
+    uint32_t lastOcclusionSamples = 1;
+    GpuCounters gpuCounters;
+    vk::PipelineLayout occlusionProxyPipelineLayout;
+    vk::Pipeline occlusionProxyPipeline; // owned by pipelineVariants
+    PushConstants<MeshPushConstants> occlusionProxyPush;
+    // --post-process, intermediates sized like the depth buffer (see createPostProcessTargets)
+    std::array<vk::Image, 2> postProcessImages;
+    std::array<vk::DeviceMemory, 2> postProcessImageMemory;
+    std::array<vk::ImageView, 2> postProcessImageViews;
+    vk::DescriptorPool postProcessDescriptorPool;
+    std::array<vk::DescriptorSet, 2> postProcessSets; // set i reads intermediate i
+    vk::PipelineLayout postProcessPipelineLayout;
+    std::vector<vk::Pipeline> postProcessPipelines; // per effect, in chain order, owned by pipelineVariants
+    PushConstants<PostProcessParameters> postProcessPush;
+    uint32_t timestampValidBits = 0;
+    float timestampPeriod = 1.0f; // nanoseconds per timestamp tick
+    double lastGpuFrameTimeMs = 0.0;
+    double lastCpuFrameTimeMs = 0.0;
+    FramePacer framePacer;
     
     size_t currentFrame = 0;
     bool framebufferResized = false;
+
+    std::thread renderThread;
+    std::atomic<bool> running{false};
+    SDL_sem* renderWakeup = nullptr; // posted whenever a new FrameState was published
+    Uint32 invalidateEventType = 0;
+    Uint32 mainThreadJobsEventType = 0; // wakes the main thread for its JobAffinity::MainThread jobs
+    bool redrawRequested = true; // render thread only, the first frame is always drawn
+    Uint32 lastResizeTicks = 0;
+    uint64_t windowEventCount = 0;
+    uint64_t swapChainRebuilds = 0;
+    // Device resets: recovery time of each, and the pipeline cache carried over to the next device
+    TimingSeries deviceResetTimes;
+    std::vector<uint8_t> pipelineCacheData;
+    uint64_t deviceLostAtFrame = UINT64_MAX;
+    bool deviceLossSimulated = false; // --lose-device-at
+    std::exception_ptr renderThreadError;
+    SpscQueue<FrameState, FRAME_STATE_QUEUE_SIZE> frameStates;
+    FrameState frameState; // render thread only: newest snapshot received
+    // Last, so it's destroyed first: queued jobs still see the rest of the application
+    JobCounter meshUploaded;
+    std::unique_ptr<JobSystem> jobs;
 };
 
-int SDL_main(int, char* []) {
+int SDL_main(int argc, char* argv[]) {
     try {
-        HelloTriangleApplication app {};
+        HelloTriangleApplication app(parseCommandLine(argc, argv));
         app.run();
     } catch (const std::exception& e) {
-        std::cerr << "Error:" << e.what() << std::endl;
+        LOG_ERROR("Error:" << e.what());
         return EXIT_FAILURE;
     }
     return EXIT_SUCCESS;
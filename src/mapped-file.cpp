@@ -0,0 +1,143 @@
+#include "mapped-file.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__ANDROID__)
+#include "SDL.h"
+#elif defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path) {
+#if defined(__ANDROID__)
+    SDL_RWops* file = SDL_RWFromFile(path.c_str(), "rb");
+    if (!file) {
+        throw std::runtime_error("failed to open " + path + ": " + SDL_GetError());
+    }
+    Sint64 fileSize = SDL_RWsize(file);
+    buffer.resize(fileSize > 0 ? static_cast<size_t>(fileSize) : 0);
+    size_t read = buffer.empty() ? 0 : SDL_RWread(file, buffer.data(), 1, buffer.size());
+    SDL_RWclose(file);
+    if (read != buffer.size()) {
+        throw std::runtime_error("failed to read " + path);
+    }
+    bytes = buffer.data();
+    length = buffer.size();
+#elif defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("failed to open " + path);
+    }
+    LARGE_INTEGER fileSize{};
+    GetFileSizeEx(file, &fileSize);
+    length = static_cast<size_t>(fileSize.QuadPart);
+    if (length > 0) {
+        mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mappingHandle) {
+            mapping = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+        }
+    }
+    CloseHandle(file); // the mapping keeps the file open
+    if (length > 0 && !mapping) {
+        close();
+        throw std::runtime_error("failed to map " + path);
+    }
+    bytes = static_cast<const uint8_t*>(mapping);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("failed to open " + path);
+    }
+    struct stat status{};
+    if (fstat(fd, &status) != 0) {
+        ::close(fd);
+        throw std::runtime_error("failed to stat " + path);
+    }
+    length = static_cast<size_t>(status.st_size);
+    if (length > 0) {
+        void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("failed to map " + path);
+        }
+        mapping = address;
+    }
+    ::close(fd); // the mapping keeps the file open
+    bytes = static_cast<const uint8_t*>(mapping);
+#endif
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        const bool usesBuffer = other.bytes && !other.mapping;
+        buffer = std::move(other.buffer);
+        bytes = usesBuffer ? buffer.data() : other.bytes;
+        length = other.length;
+        mapping = other.mapping;
+#if defined(_WIN32)
+        mappingHandle = other.mappingHandle;
+        other.mappingHandle = nullptr;
+#endif
+        other.bytes = nullptr;
+        other.length = 0;
+        other.mapping = nullptr;
+    }
+    return *this;
+}
+
+void MappedFile::willNeed(size_t offset, size_t size) const {
+#if !defined(_WIN32) && !defined(__ANDROID__)
+    if (!mapping || offset >= length) {
+        return;
+    }
+    // madvise wants a page aligned start
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t start = offset / pageSize * pageSize;
+    const size_t end = std::min(offset + size, length);
+    madvise(static_cast<uint8_t*>(mapping) + start, end - start, MADV_WILLNEED);
+    madvise(static_cast<uint8_t*>(mapping) + start, end - start, MADV_SEQUENTIAL);
+#else
+    (void)offset;
+    (void)size;
+#endif
+}
+
+void MappedFile::close() {
+#if defined(_WIN32)
+    if (mapping) {
+        UnmapViewOfFile(mapping);
+    }
+    if (mappingHandle) {
+        CloseHandle(mappingHandle);
+    }
+    mappingHandle = nullptr;
+#elif !defined(__ANDROID__)
+    if (mapping) {
+        munmap(mapping, length);
+    }
+#endif
+    mapping = nullptr;
+    bytes = nullptr;
+    length = 0;
+    buffer.clear();
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Read-only view of a whole file. Where the platform allows it, the file is memory-mapped, so pages are only read
+// from disk when they are touched and data can be copied straight out of the page cache. Android assets live inside
+// the APK and are read into memory instead.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path); // throws if the file can't be opened
+    ~MappedFile();
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+    bool isMapped() const { return mapping != nullptr; }
+
+    // Hints that [offset, offset + size) is about to be read sequentially, so the OS can read ahead
+    void willNeed(size_t offset, size_t size) const;
+
+private:
+    void close();
+
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+    void* mapping = nullptr;     // base address of the mapping, null when the fallback buffer is used
+#if defined(_WIN32)
+    void* mappingHandle = nullptr;
+#endif
+    std::vector<uint8_t> buffer; // fallback when mapping isn't possible
+};
@@ -0,0 +1,85 @@
+#include "mesh-file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// Only the largest index matters, a loop the compiler vectorizes
+template <typename Index>
+bool indicesBelow(const uint8_t* data, uint32_t count, uint32_t limit) {
+    const Index* indices = reinterpret_cast<const Index*>(data);
+    Index largest = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        largest = std::max(largest, indices[i]);
+    }
+    return largest < limit;
+}
+
+}
+
+MeshFile::MeshFile(const std::string& path) : file(path) {
+    if (file.size() < sizeof(MeshFileHeader)) {
+        throw std::runtime_error(path + " is not a mesh file");
+    }
+    std::memcpy(&fileHeader, file.data(), sizeof(fileHeader));
+    if (std::memcmp(fileHeader.magic, MESH_FILE_MAGIC, sizeof(MESH_FILE_MAGIC)) != 0) {
+        throw std::runtime_error(path + " is not a mesh file");
+    }
+    if (fileHeader.version != MESH_FILE_VERSION) {
+        throw std::runtime_error(path + " has mesh format version " + std::to_string(fileHeader.version)
+                                 + ", expected " + std::to_string(MESH_FILE_VERSION) + ", convert it again");
+    }
+    if (fileHeader.vertexStride != sizeof(PackedVertex) || (fileHeader.indexSize != 2 && fileHeader.indexSize != 4)
+        || fileHeader.indexCount % 3 != 0) {
+        throw std::runtime_error(path + " has an unsupported vertex or index layout");
+    }
+    if (fileHeader.vertexCount == 0 || fileHeader.indexCount == 0) {
+        throw std::runtime_error(path + " has no triangles"); // the buffers would be empty, which Vulkan doesn't allow
+    }
+    // Offsets and sizes come from disk, check them before anything reads through them
+    const uint64_t fileSize = file.size();
+    auto inFile = [&](uint64_t offset, uint64_t size) { return offset <= fileSize && size <= fileSize - offset; };
+    if (!inFile(fileHeader.vertexOffset, vertexDataSize()) || !inFile(fileHeader.indexOffset, indexDataSize())
+        || !inFile(fileHeader.meshletOffset, meshletDataSize()) || !inFile(fileHeader.meshletVertexOffset, meshletVertexDataSize())
+        || !inFile(fileHeader.meshletTriangleOffset, meshletTriangleDataSize())) {
+        throw std::runtime_error(path + " is truncated");
+    }
+    // Vertex fetch isn't bounds checked: every index has to name a vertex
+    const bool indicesInRange = fileHeader.indexSize == 2 ? indicesBelow<uint16_t>(indexData(), fileHeader.indexCount, fileHeader.vertexCount)
+                                                          : indicesBelow<uint32_t>(indexData(), fileHeader.indexCount, fileHeader.vertexCount);
+    if (!indicesInRange) {
+        throw std::runtime_error(path + " has indices beyond its vertices");
+    }
+    // The meshlet shaders index with these without bounds checks: the ranges of every meshlet, the vertex indices of
+    // the meshlet vertex block and the meshlet-local indices of the triangles
+    if (!indicesBelow<uint32_t>(meshletVertexData(), fileHeader.meshletVertexCount, fileHeader.vertexCount)) {
+        throw std::runtime_error(path + " has meshlet vertices beyond its vertices");
+    }
+    const auto* meshlets = reinterpret_cast<const MeshletDescriptor*>(meshletData());
+    const auto* triangles = reinterpret_cast<const uint32_t*>(meshletTriangleData());
+    for (uint32_t i = 0; i < fileHeader.meshletCount; i++) {
+        const MeshletDescriptor& meshlet = meshlets[i];
+        if (meshlet.vertexCount > MESHLET_MAX_VERTICES || meshlet.triangleCount > MESHLET_MAX_TRIANGLES
+            || uint64_t(meshlet.vertexOffset) + meshlet.vertexCount > fileHeader.meshletVertexCount
+            || uint64_t(meshlet.triangleOffset) + meshlet.triangleCount > fileHeader.meshletTriangleCount) {
+            throw std::runtime_error(path + " has a malformed meshlet");
+        }
+        uint32_t largest = 0;
+        for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+            const uint32_t packed = triangles[meshlet.triangleOffset + t];
+            largest = std::max({largest, packed & 0xFF, (packed >> 8) & 0xFF, (packed >> 16) & 0xFF});
+        }
+        if (meshlet.triangleCount > 0 && largest >= meshlet.vertexCount) {
+            throw std::runtime_error(path + " has a meshlet triangle beyond the meshlet's vertices");
+        }
+    }
+}
+
+void MeshFile::prefetch() const {
+    file.willNeed(fileHeader.vertexOffset, vertexDataSize());
+    file.willNeed(fileHeader.indexOffset, indexDataSize());
+    file.willNeed(fileHeader.meshletVertexOffset, meshletVertexDataSize());
+    file.willNeed(fileHeader.meshletTriangleOffset, meshletTriangleDataSize());
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+
+#include "mapped-file.h"
+#include "mesh-format.h"
+
+// A .nmesh file mapped into memory. The data blocks point into the mapping, nothing is copied.
+class MeshFile {
+public:
+    explicit MeshFile(const std::string& path); // throws on I/O errors and malformed files
+
+    const MeshFileHeader& header() const { return fileHeader; }
+    const uint8_t* vertexData() const { return file.data() + fileHeader.vertexOffset; }
+    size_t vertexDataSize() const { return size_t(fileHeader.vertexCount) * fileHeader.vertexStride; }
+    const uint8_t* indexData() const { return file.data() + fileHeader.indexOffset; }
+    size_t indexDataSize() const { return size_t(fileHeader.indexCount) * fileHeader.indexSize; }
+
+    bool hasMeshlets() const { return fileHeader.meshletCount > 0; }
+    const uint8_t* meshletData() const { return file.data() + fileHeader.meshletOffset; }
+    size_t meshletDataSize() const { return size_t(fileHeader.meshletCount) * sizeof(MeshletDescriptor); }
+    const uint8_t* meshletVertexData() const { return file.data() + fileHeader.meshletVertexOffset; }
+    size_t meshletVertexDataSize() const { return size_t(fileHeader.meshletVertexCount) * sizeof(uint32_t); }
+    const uint8_t* meshletTriangleData() const { return file.data() + fileHeader.meshletTriangleOffset; }
+    size_t meshletTriangleDataSize() const { return size_t(fileHeader.meshletTriangleCount) * sizeof(uint32_t); }
+
+    // Starts reading the pages ahead of the upload
+    void prefetch() const;
+
+private:
+    MappedFile file;
+    MeshFileHeader fileHeader{};
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Naru binary mesh (.nmesh), written by tools/mesh-converter and memory-mapped at runtime.
+//
+//   MeshFileHeader
+//   vertices          (vertexCount * sizeof(PackedVertex))            at vertexOffset
+//   indices           (indexCount * indexSize)                        at indexOffset
+//   meshlets          (meshletCount * sizeof(MeshletDescriptor))      at meshletOffset
+//   meshlet vertices  (meshletVertexCount * 4, global vertex indices) at meshletVertexOffset
+//   meshlet triangles (meshletTriangleCount * 4, three 8 bit meshlet-local indices each) at meshletTriangleOffset
+//
+// All blocks start on a MESH_FILE_ALIGNMENT boundary, so they can be copied into GPU buffers straight from the
+// mapped pages. All values are little endian. Vertices are quantized to 16 bytes:
+//   position  unorm16 x3 (+1 padding) relative to the bounds below  -> VK_FORMAT_R16G16B16A16_UNORM
+//   texcoord  float16 x2                                           -> VK_FORMAT_R16G16_SFLOAT
+//   normal    octahedral snorm8 x2                                 -> VK_FORMAT_R8G8_SNORM
+//   (2 bytes padding)
+// compared to 32 bytes for float positions, normals and texcoords.
+// The meshlets cover the same triangles as the index block, in the same order.
+
+constexpr char MESH_FILE_MAGIC[4] = {'N', 'M', 'S', 'H'};
+constexpr uint32_t MESH_FILE_VERSION = 2;
+constexpr uint64_t MESH_FILE_ALIGNMENT = 256;
+// Meshlet limits, sized for mesh shader workgroups (124 primitives keep the output within 128 including padding)
+constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+struct MeshFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t vertexStride; // sizeof(PackedVertex)
+    uint32_t indexSize;    // 2 or 4 bytes
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    float boundsMin[3];    // dequantized position = boundsMin + unorm * (boundsMax - boundsMin)
+    float boundsMax[3];
+    uint32_t meshletCount;
+    uint32_t meshletVertexCount;
+    uint32_t meshletTriangleCount;
+    uint32_t reserved;
+    uint64_t meshletOffset;
+    uint64_t meshletVertexOffset;
+    uint64_t meshletTriangleOffset;
+    uint8_t padding[24];
+};
+static_assert(sizeof(MeshFileHeader) == 128, "MeshFileHeader layout is part of the file format");
+
+// Bounds are in dequantized object space. The layout matches the std430 struct in shaders/meshlet-common.glsl.
+struct MeshletDescriptor {
+    float center[3];     // bounding sphere
+    float radius;
+    float coneAxis[3];   // normal cone: all triangles face away from a viewer at camera when
+    float coneCutoff;    // dot(center - camera, coneAxis) >= coneCutoff * length(center - camera) + radius; 1 = never
+    uint32_t vertexOffset;   // first entry in the meshlet vertex block
+    uint32_t triangleOffset; // first entry in the meshlet triangle block
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+};
+static_assert(sizeof(MeshletDescriptor) == 48, "MeshletDescriptor layout is part of the file format");
+
+struct PackedVertex {
+    uint16_t position[4];
+    uint16_t texCoord[2];
+    int8_t normal[2];
+    uint16_t padding;
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex layout is part of the file format");
+
+namespace meshquantization {
+
+inline uint16_t toUnorm16(float value) {
+    return static_cast<uint16_t>(std::lround(std::min(std::max(value, 0.0f), 1.0f) * 65535.0f));
+}
+
+inline int8_t toSnorm8(float value) {
+    return static_cast<int8_t>(std::lround(std::min(std::max(value, -1.0f), 1.0f) * 127.0f));
+}
+
+// IEEE 754 half float, round to nearest even
+inline uint16_t toHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000u;
+    const uint32_t absolute = bits & 0x7FFFFFFFu;
+    if (absolute >= 0x7F800000u) { // inf or nan
+        return static_cast<uint16_t>(sign | 0x7C00u | (absolute > 0x7F800000u ? 0x200u : 0u));
+    }
+    if (absolute >= 0x477FF000u) { // rounds to a value beyond the largest half
+        return static_cast<uint16_t>(sign | 0x7C00u);
+    }
+    if (absolute < 0x38800000u) { // subnormal half (or zero)
+        float magnitude;
+        std::memcpy(&magnitude, &absolute, sizeof(magnitude));
+        return static_cast<uint16_t>(sign | static_cast<uint32_t>(std::nearbyint(magnitude * 16777216.0f)));
+    }
+    const uint32_t rounded = absolute + 0xFFFu + ((absolute >> 13) & 1u) - (112u << 23);
+    return static_cast<uint16_t>(sign | (rounded >> 13));
+}
+
+// Octahedral normal encoding: maps the unit sphere onto a square, so two bytes keep the error below a degree
+inline void toOctahedral(const float normal[3], int8_t out[2]) {
+    const float sum = std::fabs(normal[0]) + std::fabs(normal[1]) + std::fabs(normal[2]);
+    float x = sum > 0.0f ? normal[0] / sum : 0.0f;
+    float y = sum > 0.0f ? normal[1] / sum : 0.0f;
+    if (normal[2] < 0.0f) {
+        const float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        const float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+    out[0] = toSnorm8(x);
+    out[1] = toSnorm8(y);
+}
+
+} // namespace meshquantization
@@ -0,0 +1,99 @@
+#include "pipeline-variants.h"
+
+#include <algorithm>
+#include <cstring>
+
+SpecializationConstants& SpecializationConstants::set(uint32_t id, bool value) {
+    return set(id, static_cast<uint32_t>(value ? VK_TRUE : VK_FALSE));
+}
+
+SpecializationConstants& SpecializationConstants::set(uint32_t id, int32_t value) {
+    return set(id, static_cast<uint32_t>(value));
+}
+
+SpecializationConstants& SpecializationConstants::set(uint32_t id, float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return set(id, bits);
+}
+
+SpecializationConstants& SpecializationConstants::set(uint32_t id, uint32_t value) {
+    auto it = std::lower_bound(constants.begin(), constants.end(), id,
+                               [](const std::pair<uint32_t, uint32_t>& constant, uint32_t key) { return constant.first < key; });
+    if (it != constants.end() && it->first == id) {
+        it->second = value;
+    } else {
+        constants.insert(it, {id, value});
+    }
+    return *this;
+}
+
+const vk::SpecializationInfo* SpecializationConstants::info() const {
+    if (constants.empty()) {
+        return nullptr;
+    }
+    entries.clear();
+    data.clear();
+    for (const auto& constant : constants) {
+        entries.push_back(vk::SpecializationMapEntry(constant.first, static_cast<uint32_t>(data.size() * sizeof(uint32_t)), sizeof(uint32_t)));
+        data.push_back(constant.second);
+    }
+    specialization = vk::SpecializationInfo(static_cast<uint32_t>(entries.size()), entries.data(), data.size() * sizeof(uint32_t), data.data());
+    return &specialization;
+}
+
+std::string SpecializationConstants::toString() const {
+    std::string result;
+    for (const auto& constant : constants) {
+        if (!result.empty()) {
+            result += " ";
+        }
+        result += std::to_string(constant.first) + "=" + std::to_string(constant.second);
+    }
+    return result;
+}
+
+PipelineVariants::PipelineVariants(vk::Device device, const std::vector<uint8_t>& cacheData) : device(device) {
+    pipelineCache = device.createPipelineCache(vk::PipelineCacheCreateInfo({}, cacheData.size(), cacheData.data()));
+}
+
+PipelineVariants::~PipelineVariants() {
+    for (auto& entry : pipelines) {
+        device.destroyPipeline(entry.second);
+    }
+    device.destroyPipelineCache(pipelineCache);
+}
+
+vk::Pipeline PipelineVariants::get(const std::string& name, const SpecializationConstants& constants, const Create& create) {
+    auto key = std::make_pair(name, constants);
+    auto it = pipelines.find(key);
+    if (it != pipelines.end()) {
+        stats.reused++;
+        return it->second;
+    }
+    const vk::Pipeline pipeline = create(pipelineCache, constants.info());
+    pipelines.emplace(std::move(key), pipeline);
+    stats.created++;
+    return pipeline;
+}
+
+void PipelineVariants::destroy(const std::string& name) {
+    for (auto it = pipelines.begin(); it != pipelines.end();) {
+        if (it->first.first == name) {
+            device.destroyPipeline(it->second);
+            it = pipelines.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+std::vector<uint8_t> PipelineVariants::cacheData() const {
+    return device.getPipelineCacheData(pipelineCache);
+}
+
+PipelineVariants::Statistics PipelineVariants::statistics() const {
+    Statistics result = stats;
+    result.live = pipelines.size();
+    return result;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "vulkan-common.h"
+
+// Values for specialization constants: `layout(constant_id = N) const ...` in GLSL, and workgroup sizes declared with
+// `local_size_x_id = N`. Every constant is 32 bits wide (bool, int, uint and float all are). The same values are handed
+// to every stage of a pipeline, so the ids are shared by its shaders. A stage ignores the ids it doesn't declare.
+class SpecializationConstants {
+public:
+    SpecializationConstants& set(uint32_t id, bool value);
+    SpecializationConstants& set(uint32_t id, int32_t value);
+    SpecializationConstants& set(uint32_t id, uint32_t value);
+    SpecializationConstants& set(uint32_t id, float value);
+
+    // For vk::PipelineShaderStageCreateInfo::pSpecializationInfo, nullptr without constants.
+    // Valid until this object is changed or destroyed.
+    const vk::SpecializationInfo* info() const;
+    std::string toString() const; // "id=value ..." for logs, values as raw 32 bit words
+
+    bool operator<(const SpecializationConstants& other) const { return constants < other.constants; }
+
+private:
+    std::vector<std::pair<uint32_t, uint32_t>> constants; // id and raw value, ordered by id
+    mutable std::vector<vk::SpecializationMapEntry> entries;
+    mutable std::vector<uint32_t> data;
+    mutable vk::SpecializationInfo specialization;
+};
+
+// Pipelines keyed by a name and their specialization constants. The name stands for the shaders and the fixed
+// function state, chosen by the caller. Each variant specializes the same SPIR-V modules. It is created on first
+// use, and the driver constant folds the values and drops the code they disable. There is no runtime branching and
+// no extra GLSL copy per feature. Creation goes through a vk::PipelineCache that lives as long as the device, so
+// re-creating a variant after its render pass was replaced mostly reuses compiled code. The cache's contents can be
+// handed to the next device's PipelineVariants, e.g. after a device reset.
+// Not thread safe.
+class PipelineVariants {
+public:
+    // Creates the pipeline, passing `cache` and `specialization` into its create info (the same info for every stage)
+    using Create = std::function<vk::Pipeline(vk::PipelineCache cache, const vk::SpecializationInfo* specialization)>;
+
+    // `cacheData` from cacheData() of an earlier device; the driver ignores it when it was made by another driver or GPU
+    explicit PipelineVariants(vk::Device device, const std::vector<uint8_t>& cacheData = {});
+    ~PipelineVariants(); // the device must not use the pipelines anymore
+    PipelineVariants(const PipelineVariants&) = delete;
+    PipelineVariants& operator=(const PipelineVariants&) = delete;
+
+    // The variant, created with `create` when it doesn't exist yet
+    vk::Pipeline get(const std::string& name, const SpecializationConstants& constants, const Create& create);
+    // Destroys every variant of `name`, e.g. when the render pass or layout it was created with goes away.
+    // The device must not use them anymore.
+    void destroy(const std::string& name);
+    // Serialized contents of the pipeline cache
+    std::vector<uint8_t> cacheData() const;
+
+    struct Statistics {
+        uint64_t created = 0; // variants compiled, including ones created again after destroy()
+        uint64_t reused = 0;  // get() calls that found the variant
+        size_t live = 0;
+    };
+    Statistics statistics() const;
+
+private:
+    vk::Device device;
+    vk::PipelineCache pipelineCache;
+    std::map<std::pair<std::string, SpecializationConstants>, vk::Pipeline> pipelines;
+    Statistics stats;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "vulkan-common.h"
+
+// Typed writer for a push constant block: T is the block's C++ mirror, copied byte for byte into the command buffer.
+// Push constants need no descriptor, buffer or memory write, which makes them the cheapest way to hand a draw its
+// own small data (a transform, an object id). Construction checks the block against the layout's range and the
+// device's maxPushConstantsSize (128 bytes guaranteed, 256 common on desktop), so an oversized block fails once at
+// setup instead of as a validation error per draw.
+template <typename T>
+class PushConstants {
+    static_assert(std::is_trivially_copyable<T>::value, "push constants are copied byte for byte");
+    static_assert(sizeof(T) % 4 == 0, "push constant sizes are multiples of 4 bytes");
+
+public:
+    PushConstants() = default;
+    // `range` is the layout's push constant range (see LayoutCache::PipelineLayout), T is written at `offset`
+    PushConstants(vk::PipelineLayout layout, const vk::PushConstantRange& range, uint32_t maxPushConstantsSize, uint32_t offset = 0)
+        : layout(layout), stages(range.stageFlags), offset(offset) {
+        if (range.offset + range.size > maxPushConstantsSize) {
+            throw std::runtime_error("push constant range of " + std::to_string(range.offset + range.size) +
+                                     " bytes exceeds the device's maxPushConstantsSize of " + std::to_string(maxPushConstantsSize));
+        }
+        if (offset < range.offset || offset + sizeof(T) > range.offset + range.size) {
+            throw std::runtime_error("push constants of " + std::to_string(sizeof(T)) + " bytes at offset " + std::to_string(offset) +
+                                     " are outside the layout's range");
+        }
+    }
+
+    // Visible to draws and dispatches recorded after it, until a layout with a different range is bound
+    void push(vk::CommandBuffer commandBuffer, const T& value) const {
+        commandBuffer.pushConstants(layout, stages, offset, sizeof(T), &value);
+    }
+
+    explicit operator bool() const { return static_cast<bool>(layout); }
+
+private:
+    vk::PipelineLayout layout;
+    vk::ShaderStageFlags stages;
+    uint32_t offset = 0;
+};
@@ -0,0 +1,44 @@
+#include "resolution-scaler.h"
+
+#include <algorithm>
+#include <cmath>
+
+static constexpr double k_smoothing = 0.15;     // weight of the newest measurement
+static constexpr double k_headroom = 0.9;       // aim slightly below the budget so normal jitter doesn't overrun it
+static constexpr float k_step = 0.05f;          // scales are quantized to 5% steps
+static constexpr int k_downscaleCooldown = 4;   // frames to wait after a change before lowering the scale again
+static constexpr int k_upscaleCooldown = 30;    // frames to wait after a change before raising the scale again
+
+void ResolutionScaler::configure(float minScale, float maxScale, double budgetMs) {
+    minimum = minScale;
+    maximum = maxScale;
+    budget = budgetMs;
+    currentScale = maximum;
+    averageMs = 0.0;
+    framesSinceChange = 0;
+}
+
+bool ResolutionScaler::update(double gpuFrameTimeMs) {
+    if (gpuFrameTimeMs <= 0.0 || budget <= 0.0) {
+        return false;
+    }
+    averageMs = averageMs == 0.0 ? gpuFrameTimeMs : averageMs + k_smoothing * (gpuFrameTimeMs - averageMs);
+    framesSinceChange++;
+
+    // Frame time ~ pixel count ~ scale^2
+    float desired = currentScale * static_cast<float>(std::sqrt(budget * k_headroom / averageMs));
+    desired = std::clamp(std::round(desired / k_step) * k_step, minimum, maximum);
+
+    const bool lower = desired < currentScale - k_step * 0.5f;
+    const bool raise = desired > currentScale + k_step * 0.5f;
+    if ((lower && framesSinceChange >= k_downscaleCooldown) || (raise && framesSinceChange >= k_upscaleCooldown)) {
+        // Going up is done one step at a time, a too optimistic estimate would otherwise cause a visible hitch
+        const float previousScale = currentScale;
+        currentScale = raise ? std::min(currentScale + k_step, desired) : desired;
+        framesSinceChange = 0;
+        // The running average belonged to the old resolution, predict it for the new one
+        averageMs *= (currentScale * currentScale) / (previousScale * previousScale);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+// Picks the internal render resolution (as a fraction of the output size) that keeps the GPU frame time within a
+// budget. Fed with GPU timestamp measurements once per frame. Pixel cost scales with the area, so the controller
+// corrects the linear scale by the square root of the budget/time ratio, and it reacts to overruns faster than it
+// gives resolution back, which avoids oscillating around the budget.
+class ResolutionScaler {
+public:
+    void configure(float minScale, float maxScale, double budgetMs); // minScale <= maxScale
+
+    // Returns true when the scale changed
+    bool update(double gpuFrameTimeMs);
+
+    float scale() const { return currentScale; }
+    float maxScale() const { return maximum; }
+    double budgetMs() const { return budget; }
+
+private:
+    float minimum = 0.5f;
+    float maximum = 1.0f;
+    double budget = 16.6;
+    float currentScale = 1.0f;
+    double averageMs = 0.0;
+    int framesSinceChange = 0;
+};
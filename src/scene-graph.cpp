@@ -0,0 +1,198 @@
+#include "scene-graph.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "job-system.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SCENE_GRAPH_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SCENE_GRAPH_SSE 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SCENE_GRAPH_NEON 1
+#endif
+
+namespace {
+
+// out = a * b, column-major. Every column of the result is the columns of a weighted by one column of b.
+inline void multiply(const float* a, const float* b, float* out) {
+#if SCENE_GRAPH_AVX
+    // Two result columns per iteration: a's columns in both halves, b's elements broadcast within each half
+    const __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a));
+    const __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 4));
+    const __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 8));
+    const __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 12));
+    for (int column = 0; column < 4; column += 2) {
+        const __m256 bc = _mm256_loadu_ps(b + column * 4);
+        __m256 r = _mm256_mul_ps(a0, _mm256_shuffle_ps(bc, bc, 0x00));
+        r = _mm256_add_ps(r, _mm256_mul_ps(a1, _mm256_shuffle_ps(bc, bc, 0x55)));
+        r = _mm256_add_ps(r, _mm256_mul_ps(a2, _mm256_shuffle_ps(bc, bc, 0xaa)));
+        r = _mm256_add_ps(r, _mm256_mul_ps(a3, _mm256_shuffle_ps(bc, bc, 0xff)));
+        _mm256_storeu_ps(out + column * 4, r);
+    }
+#elif SCENE_GRAPH_SSE
+    const __m128 a0 = _mm_loadu_ps(a);
+    const __m128 a1 = _mm_loadu_ps(a + 4);
+    const __m128 a2 = _mm_loadu_ps(a + 8);
+    const __m128 a3 = _mm_loadu_ps(a + 12);
+    for (int column = 0; column < 4; column++) {
+        const __m128 bc = _mm_loadu_ps(b + column * 4);
+        __m128 r = _mm_mul_ps(a0, _mm_shuffle_ps(bc, bc, 0x00));
+        r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_shuffle_ps(bc, bc, 0x55)));
+        r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_shuffle_ps(bc, bc, 0xaa)));
+        r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_shuffle_ps(bc, bc, 0xff)));
+        _mm_storeu_ps(out + column * 4, r);
+    }
+#elif SCENE_GRAPH_NEON
+    const float32x4_t a0 = vld1q_f32(a);
+    const float32x4_t a1 = vld1q_f32(a + 4);
+    const float32x4_t a2 = vld1q_f32(a + 8);
+    const float32x4_t a3 = vld1q_f32(a + 12);
+    for (int column = 0; column < 4; column++) {
+        const float32x4_t bc = vld1q_f32(b + column * 4);
+#if defined(__aarch64__)
+        float32x4_t r = vmulq_laneq_f32(a0, bc, 0);
+        r = vfmaq_laneq_f32(r, a1, bc, 1);
+        r = vfmaq_laneq_f32(r, a2, bc, 2);
+        r = vfmaq_laneq_f32(r, a3, bc, 3);
+#else
+        const float32x2_t low = vget_low_f32(bc);
+        const float32x2_t high = vget_high_f32(bc);
+        float32x4_t r = vmulq_lane_f32(a0, low, 0);
+        r = vmlaq_lane_f32(r, a1, low, 1);
+        r = vmlaq_lane_f32(r, a2, high, 0);
+        r = vmlaq_lane_f32(r, a3, high, 1);
+#endif
+        vst1q_f32(out + column * 4, r);
+    }
+#else
+    for (int column = 0; column < 4; column++) {
+        for (int row = 0; row < 4; row++) {
+            out[column * 4 + row] = a[row] * b[column * 4] + a[4 + row] * b[column * 4 + 1] +
+                                    a[8 + row] * b[column * 4 + 2] + a[12 + row] * b[column * 4 + 3];
+        }
+    }
+#endif
+}
+
+}
+
+SceneGraph::NodeId SceneGraph::addNode(NodeId parent, const Mat4& local) {
+    const NodeId id = static_cast<NodeId>(positions.size());
+    if (parent != k_noParent && parent >= id) {
+        throw std::runtime_error("scene graph node " + std::to_string(id) + " added before its parent " + std::to_string(parent));
+    }
+    // Appended for now, moved to its level by the next update
+    const uint32_t position = static_cast<uint32_t>(parents.size());
+    parents.push_back(parent == k_noParent ? k_noParent : positions[parent]);
+    depths.push_back(parent == k_noParent ? 0 : depths[positions[parent]] + 1);
+    locals.push_back(local);
+    worlds.push_back(local);
+    dirty.push_back(1);
+    changedAt.push_back(0);
+    ids.push_back(id);
+    positions.push_back(position);
+    sorted = false;
+    return id;
+}
+
+void SceneGraph::setLocal(NodeId node, const Mat4& local) {
+    const uint32_t position = positions[node];
+    locals[position] = local;
+    dirty[position] = 1;
+}
+
+// Counting sort by depth, stable: within a level the nodes keep their order, usually their parents' order
+void SceneGraph::sortByDepth() {
+    const uint32_t count = nodeCount();
+    uint32_t maxDepth = 0;
+    for (uint32_t depth : depths) {
+        maxDepth = std::max(maxDepth, depth);
+    }
+    levelStarts.assign(maxDepth + 2, 0);
+    for (uint32_t depth : depths) {
+        levelStarts[depth + 1]++;
+    }
+    for (size_t level = 1; level < levelStarts.size(); level++) {
+        levelStarts[level] += levelStarts[level - 1];
+    }
+    std::vector<uint32_t> next(levelStarts.begin(), levelStarts.end() - 1);
+    std::vector<uint32_t> newPositions(count);
+    for (uint32_t position = 0; position < count; position++) {
+        newPositions[position] = next[depths[position]]++;
+    }
+
+    auto permute = [&](auto& values) {
+        std::remove_reference_t<decltype(values)> moved(values.size());
+        for (uint32_t position = 0; position < count; position++) {
+            moved[newPositions[position]] = values[position];
+        }
+        values.swap(moved);
+    };
+    for (uint32_t& parent : parents) {
+        parent = parent == k_noParent ? k_noParent : newPositions[parent];
+    }
+    permute(parents);
+    permute(depths);
+    permute(locals);
+    permute(worlds);
+    permute(ids);
+    for (uint32_t position = 0; position < count; position++) {
+        positions[ids[position]] = position;
+    }
+    // The instances moved: recompute and rewrite everything once
+    dirty.assign(count, 1);
+    changedAt.assign(count, 0);
+    sorted = true;
+}
+
+uint32_t SceneGraph::updateRange(uint32_t begin, uint32_t end, InstanceStream* stream) {
+    uint32_t updated = 0;
+    for (uint32_t i = begin; i < end; i++) {
+        const uint32_t parent = parents[i];
+        // The parent's level is done: changedAt tells whether it was recomputed in this update
+        if (dirty[i] || (parent != k_noParent && changedAt[parent] == updateCount)) {
+            if (parent == k_noParent) {
+                worlds[i] = locals[i];
+            } else {
+                multiply(worlds[parent].m, locals[i].m, worlds[i].m);
+            }
+            dirty[i] = 0;
+            changedAt[i] = updateCount;
+            updated++;
+        }
+        if (stream && changedAt[i] > stream->writtenAt) {
+            uint8_t* element = stream->destination + i * stream->stride;
+            std::memcpy(element, worlds[i].m, sizeof(worlds[i].m));
+            std::memcpy(element + sizeof(worlds[i].m), &ids[i], sizeof(ids[i]));
+        }
+    }
+    return updated;
+}
+
+uint32_t SceneGraph::update(JobSystem& jobs, InstanceStream* stream) {
+    if (!sorted) {
+        sortByDepth();
+    }
+    updateCount++;
+    std::atomic<uint32_t> updated{0};
+    // Levels in order, the nodes of one level in parallel: each reads its parent's finished world matrix
+    for (size_t level = 0; level + 1 < levelStarts.size(); level++) {
+        const uint32_t first = levelStarts[level];
+        jobs.parallelFor(levelStarts[level + 1] - first, k_chunkSize, [&](uint32_t begin, uint32_t end) {
+            updated.fetch_add(updateRange(first + begin, first + end, stream), std::memory_order_relaxed);
+        });
+    }
+    if (stream) {
+        stream->writtenAt = updateCount;
+    }
+    return updated.load(std::memory_order_relaxed);
+}
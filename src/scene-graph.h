@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "transform-math.h"
+
+class JobSystem;
+
+// Transform hierarchy kept as parallel arrays (parent, local matrix, world matrix, dirty flag...) sorted by depth:
+// every parent comes before its children and each level is one contiguous range, so a level only depends on the
+// levels before it and is updated in parallel chunks, walking the arrays in order instead of chasing pointers.
+// Setting a local transform marks the node dirty; an update recomputes the dirty nodes and everything below them,
+// clean subtrees keep their world matrices. The matrix products use SSE (AVX when the compiler targets it) or NEON.
+class SceneGraph {
+public:
+    using NodeId = uint32_t; // in the order the nodes were added, stays valid when the arrays are re-sorted
+    static constexpr NodeId k_noParent = UINT32_MAX;
+    static constexpr uint32_t k_chunkSize = 2048; // nodes per job
+
+    // Per-instance buffer the world matrices go to, e.g. one per frame in flight: element i (stride bytes apart)
+    // gets the 4x4 column-major world matrix of instance i followed by its NodeId as a uint32, like the shaders'
+    // ObjectData. Only the elements that changed since the stream was last written are rewritten.
+    struct InstanceStream {
+        uint8_t* destination = nullptr;
+        size_t stride = 0;
+        uint64_t writtenAt = 0; // update that last wrote it, 0 = never: everything is written
+    };
+
+    // `parent` must have been added before
+    NodeId addNode(NodeId parent, const Mat4& local);
+    void setLocal(NodeId node, const Mat4& local);
+
+    const Mat4& world(NodeId node) const { return worlds[positions[node]]; } // as of the last update
+    uint32_t nodeCount() const { return static_cast<uint32_t>(parents.size()); }
+    uint32_t depthCount() const { return static_cast<uint32_t>(levelStarts.empty() ? 0 : levelStarts.size() - 1); }
+    // Element of the node in the instance streams, valid after an update
+    uint32_t instanceOf(NodeId node) const { return positions[node]; }
+
+    // Recomputes the world matrices of the dirty nodes and their descendants, level by level, and writes every
+    // instance that changed since `stream` was last written to it. Returns the number of nodes recomputed.
+    uint32_t update(JobSystem& jobs, InstanceStream* stream = nullptr);
+
+private:
+    void sortByDepth();
+    uint32_t updateRange(uint32_t begin, uint32_t end, InstanceStream* stream);
+
+    // By position (depth order)
+    std::vector<uint32_t> parents; // position of the parent, k_noParent for roots
+    std::vector<uint32_t> depths;
+    std::vector<Mat4> locals;
+    std::vector<Mat4> worlds;
+    std::vector<uint8_t> dirty;       // local transform set since the last update
+    std::vector<uint64_t> changedAt;  // update that last recomputed the world matrix
+    std::vector<NodeId> ids;
+    // By NodeId
+    std::vector<uint32_t> positions;
+
+    std::vector<uint32_t> levelStarts; // first position of each depth, and the node count
+    bool sorted = true;
+    uint64_t updateCount = 0;
+};
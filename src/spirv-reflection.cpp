@@ -0,0 +1,399 @@
+#include "spirv-reflection.h"
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// The few parts of the SPIR-V grammar reflection needs (SPIR-V specification, sections 3 and 3.32)
+const uint32_t k_magic = 0x07230203;
+
+enum Op : uint32_t {
+    OpEntryPoint = 15,
+    OpTypeBool = 20,
+    OpTypeInt = 21,
+    OpTypeFloat = 22,
+    OpTypeVector = 23,
+    OpTypeMatrix = 24,
+    OpTypeImage = 25,
+    OpTypeSampler = 26,
+    OpTypeSampledImage = 27,
+    OpTypeArray = 28,
+    OpTypeRuntimeArray = 29,
+    OpTypeStruct = 30,
+    OpTypePointer = 32,
+    OpConstant = 43,
+    OpSpecConstantTrue = 48,
+    OpSpecConstantFalse = 49,
+    OpSpecConstant = 50,
+    OpVariable = 59,
+    OpDecorate = 71,
+    OpMemberDecorate = 72
+};
+
+enum Decoration : uint32_t {
+    SpecId = 1,
+    Block = 2,
+    BufferBlock = 3,
+    ArrayStride = 6,
+    MatrixStride = 7,
+    BuiltIn = 11,
+    Location = 30,
+    Binding = 33,
+    DescriptorSet = 34,
+    Offset = 35
+};
+
+enum StorageClass : uint32_t {
+    UniformConstant = 0,
+    Input = 1,
+    Uniform = 2,
+    PushConstant = 9,
+    StorageBuffer = 12
+};
+
+const uint32_t k_dimBuffer = 5;
+const uint32_t k_dimSubpassData = 6;
+
+struct Id {
+    uint32_t opcode = 0;
+    std::vector<uint32_t> operands; // of a type or constant, after the result id
+    std::map<uint32_t, uint32_t> decorations;
+    std::map<uint32_t, std::map<uint32_t, uint32_t>> memberDecorations; // member -> decorations
+};
+
+struct Variable {
+    uint32_t id;
+    uint32_t pointerType;
+    uint32_t storageClass;
+};
+
+class Module {
+public:
+    Module(const uint32_t* words, size_t wordCount);
+
+    ShaderReflection reflect() const;
+
+private:
+    const Id& id(uint32_t index) const;
+    uint32_t decoration(uint32_t index, uint32_t decoration, uint32_t fallback) const;
+    uint32_t arrayLength(uint32_t type) const;
+    uint32_t typeSize(uint32_t type, uint32_t matrixStride) const;
+    bool isBuiltIn(uint32_t variable, uint32_t type) const;
+    vk::Format inputFormat(uint32_t type, uint32_t& componentCount) const;
+    vk::DescriptorType descriptorType(uint32_t type, uint32_t storageClass) const;
+
+    std::vector<Id> ids;
+    std::vector<Variable> variables;
+    std::vector<uint32_t> specConstants;
+    uint32_t executionModel = 0;
+    std::vector<uint32_t> interface; // input and output variables of the entry point
+    bool hasEntryPoint = false;
+};
+
+Module::Module(const uint32_t* words, size_t wordCount) {
+    if (wordCount < 5 || words[0] != k_magic) {
+        throw std::runtime_error("not a SPIR-V module");
+    }
+    ids.resize(words[3]); // the id bound
+    size_t position = 5;
+    while (position < wordCount) {
+        const uint32_t length = words[position] >> 16;
+        const uint32_t opcode = words[position] & 0xFFFF;
+        if (length == 0 || position + length > wordCount) {
+            throw std::runtime_error("malformed SPIR-V instruction at word " + std::to_string(position));
+        }
+        const uint32_t* operands = words + position + 1;
+        const uint32_t operandCount = length - 1;
+        auto result = [&](uint32_t index) -> Id& {
+            if (index >= operandCount || operands[index] >= ids.size()) {
+                throw std::runtime_error("SPIR-V id out of bounds at word " + std::to_string(position));
+            }
+            return ids[operands[index]];
+        };
+        switch (opcode) {
+        case OpEntryPoint:
+            if (!hasEntryPoint && operandCount >= 3) {
+                hasEntryPoint = true;
+                executionModel = operands[0];
+                // The name is a nul-terminated string packed into words, the interface ids follow it
+                uint32_t index = 2;
+                while (index < operandCount && (operands[index] >> 24) != 0) {
+                    index++;
+                }
+                interface.assign(operands + std::min(index + 1, operandCount), operands + operandCount);
+            }
+            break;
+        case OpTypeBool:
+        case OpTypeInt:
+        case OpTypeFloat:
+        case OpTypeVector:
+        case OpTypeMatrix:
+        case OpTypeImage:
+        case OpTypeSampler:
+        case OpTypeSampledImage:
+        case OpTypeArray:
+        case OpTypeRuntimeArray:
+        case OpTypeStruct:
+        case OpTypePointer: {
+            Id& type = result(0);
+            type.opcode = opcode;
+            type.operands.assign(operands + 1, operands + operandCount);
+            break;
+        }
+        case OpConstant:
+        case OpSpecConstantTrue:
+        case OpSpecConstantFalse:
+        case OpSpecConstant: {
+            // Result type first, then the result id
+            Id& constant = result(1);
+            constant.opcode = opcode;
+            constant.operands.assign(operands, operands + operandCount);
+            if (opcode != OpConstant) {
+                specConstants.push_back(operands[1]);
+            }
+            break;
+        }
+        case OpVariable:
+            if (operandCount >= 3) {
+                result(1);
+                variables.push_back({operands[1], operands[0], operands[2]});
+            }
+            break;
+        case OpDecorate:
+            if (operandCount >= 2) {
+                result(0).decorations[operands[1]] = operandCount >= 3 ? operands[2] : 0;
+            }
+            break;
+        case OpMemberDecorate:
+            if (operandCount >= 3) {
+                result(0).memberDecorations[operands[1]][operands[2]] = operandCount >= 4 ? operands[3] : 0;
+            }
+            break;
+        default:
+            break;
+        }
+        position += length;
+    }
+    if (!hasEntryPoint) {
+        throw std::runtime_error("SPIR-V module without an entry point");
+    }
+}
+
+const Id& Module::id(uint32_t index) const {
+    if (index >= ids.size()) {
+        throw std::runtime_error("SPIR-V id out of bounds");
+    }
+    return ids[index];
+}
+
+uint32_t Module::decoration(uint32_t index, uint32_t decoration, uint32_t fallback) const {
+    const auto& decorations = id(index).decorations;
+    auto it = decorations.find(decoration);
+    return it != decorations.end() ? it->second : fallback;
+}
+
+uint32_t Module::arrayLength(uint32_t type) const {
+    const Id& length = id(id(type).operands.at(1));
+    if (length.opcode != OpConstant) {
+        throw std::runtime_error("array sized by a specialization constant, its length isn't known before pipeline creation");
+    }
+    return length.operands.at(2);
+}
+
+// Bytes a member of this type covers in an explicitly laid out block
+uint32_t Module::typeSize(uint32_t type, uint32_t matrixStride) const {
+    const Id& info = id(type);
+    switch (info.opcode) {
+    case OpTypeBool:
+        return 4;
+    case OpTypeInt:
+    case OpTypeFloat:
+        return info.operands.at(0) / 8;
+    case OpTypeVector:
+        return info.operands.at(1) * typeSize(info.operands.at(0), 0);
+    case OpTypeMatrix: {
+        const uint32_t columns = info.operands.at(1);
+        const uint32_t columnSize = typeSize(info.operands.at(0), 0);
+        return matrixStride > 0 ? (columns - 1) * matrixStride + columnSize : columns * columnSize;
+    }
+    case OpTypeArray: {
+        const uint32_t length = arrayLength(type);
+        const uint32_t stride = decoration(type, ArrayStride, typeSize(info.operands.at(0), matrixStride));
+        return length * stride;
+    }
+    case OpTypeStruct: {
+        uint32_t size = 0;
+        for (uint32_t member = 0; member < info.operands.size(); member++) {
+            uint32_t offset = 0;
+            uint32_t memberMatrixStride = 0;
+            auto decorations = info.memberDecorations.find(member);
+            if (decorations != info.memberDecorations.end()) {
+                auto it = decorations->second.find(Offset);
+                offset = it != decorations->second.end() ? it->second : 0;
+                it = decorations->second.find(MatrixStride);
+                memberMatrixStride = it != decorations->second.end() ? it->second : 0;
+            }
+            size = std::max(size, offset + typeSize(info.operands[member], memberMatrixStride));
+        }
+        return size;
+    }
+    default:
+        throw std::runtime_error("unsupported type in a SPIR-V block (opcode " + std::to_string(info.opcode) + ")");
+    }
+}
+
+bool Module::isBuiltIn(uint32_t variable, uint32_t type) const {
+    if (id(variable).decorations.count(BuiltIn)) {
+        return true;
+    }
+    // gl_PerVertex style blocks decorate their members
+    for (const auto& member : id(type).memberDecorations) {
+        if (member.second.count(BuiltIn)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+vk::Format Module::inputFormat(uint32_t type, uint32_t& componentCount) const {
+    const Id* info = &id(type);
+    componentCount = 1;
+    if (info->opcode == OpTypeVector) {
+        componentCount = info->operands.at(1);
+        info = &id(info->operands.at(0));
+    }
+    static const vk::Format floats[] = {vk::Format::eR32Sfloat, vk::Format::eR32G32Sfloat, vk::Format::eR32G32B32Sfloat,
+                                        vk::Format::eR32G32B32A32Sfloat};
+    static const vk::Format ints[] = {vk::Format::eR32Sint, vk::Format::eR32G32Sint, vk::Format::eR32G32B32Sint, vk::Format::eR32G32B32A32Sint};
+    static const vk::Format uints[] = {vk::Format::eR32Uint, vk::Format::eR32G32Uint, vk::Format::eR32G32B32Uint, vk::Format::eR32G32B32A32Uint};
+    if (componentCount < 1 || componentCount > 4 || info->operands.empty() || info->operands[0] != 32) {
+        return vk::Format::eUndefined; // matrices, 16 and 64 bit types: the caller has to name the format
+    }
+    if (info->opcode == OpTypeFloat) {
+        return floats[componentCount - 1];
+    }
+    if (info->opcode == OpTypeInt) {
+        return info->operands.at(1) ? ints[componentCount - 1] : uints[componentCount - 1];
+    }
+    return vk::Format::eUndefined;
+}
+
+vk::DescriptorType Module::descriptorType(uint32_t type, uint32_t storageClass) const {
+    const Id& info = id(type);
+    if (storageClass == StorageBuffer) {
+        return vk::DescriptorType::eStorageBuffer;
+    }
+    if (storageClass == Uniform) {
+        // Before SPIR-V 1.3 storage buffers are Uniform blocks decorated BufferBlock
+        return id(type).decorations.count(BufferBlock) ? vk::DescriptorType::eStorageBuffer : vk::DescriptorType::eUniformBuffer;
+    }
+    switch (info.opcode) {
+    case OpTypeSampledImage:
+        return vk::DescriptorType::eCombinedImageSampler;
+    case OpTypeSampler:
+        return vk::DescriptorType::eSampler;
+    case OpTypeImage: {
+        // Sampled type, Dim, Depth, Arrayed, MS, Sampled, Image Format
+        const uint32_t dim = info.operands.at(1);
+        const bool storage = info.operands.at(5) == 2;
+        if (dim == k_dimSubpassData) {
+            return vk::DescriptorType::eInputAttachment;
+        }
+        if (dim == k_dimBuffer) {
+            return storage ? vk::DescriptorType::eStorageTexelBuffer : vk::DescriptorType::eUniformTexelBuffer;
+        }
+        return storage ? vk::DescriptorType::eStorageImage : vk::DescriptorType::eSampledImage;
+    }
+    default:
+        throw std::runtime_error("unsupported SPIR-V descriptor type (opcode " + std::to_string(info.opcode) + ")");
+    }
+}
+
+ShaderReflection Module::reflect() const {
+    ShaderReflection reflection;
+    switch (executionModel) {
+    case 0: reflection.stage = vk::ShaderStageFlagBits::eVertex; break;
+    case 1: reflection.stage = vk::ShaderStageFlagBits::eTessellationControl; break;
+    case 2: reflection.stage = vk::ShaderStageFlagBits::eTessellationEvaluation; break;
+    case 3: reflection.stage = vk::ShaderStageFlagBits::eGeometry; break;
+    case 4: reflection.stage = vk::ShaderStageFlagBits::eFragment; break;
+    case 5: reflection.stage = vk::ShaderStageFlagBits::eCompute; break;
+#ifdef VK_EXT_mesh_shader
+    case 5364: reflection.stage = vk::ShaderStageFlagBits::eTaskEXT; break;
+    case 5365: reflection.stage = vk::ShaderStageFlagBits::eMeshEXT; break;
+#endif
+    default:
+        throw std::runtime_error("unsupported SPIR-V execution model " + std::to_string(executionModel));
+    }
+
+    for (const auto& variable : variables) {
+        const Id& pointer = id(variable.pointerType);
+        if (pointer.opcode != OpTypePointer) {
+            throw std::runtime_error("SPIR-V variable without a pointer type");
+        }
+        uint32_t type = pointer.operands.at(1);
+        switch (variable.storageClass) {
+        case Input:
+            if (reflection.stage == vk::ShaderStageFlagBits::eVertex && !isBuiltIn(variable.id, type) &&
+                std::find(interface.begin(), interface.end(), variable.id) != interface.end()) {
+                ShaderReflection::Input input;
+                input.location = decoration(variable.id, Location, 0);
+                input.format = inputFormat(type, input.componentCount);
+                reflection.inputs.push_back(input);
+            }
+            break;
+        case PushConstant:
+            reflection.pushConstantSize = std::max(reflection.pushConstantSize, typeSize(type, 0));
+            break;
+        case UniformConstant:
+        case Uniform:
+        case StorageBuffer: {
+            if (!id(variable.id).decorations.count(Binding)) {
+                break; // not a descriptor
+            }
+            ShaderReflection::Binding binding;
+            binding.set = decoration(variable.id, DescriptorSet, 0);
+            binding.binding = decoration(variable.id, Binding, 0);
+            if (id(type).opcode == OpTypeRuntimeArray) {
+                throw std::runtime_error("runtime sized descriptor array at set " + std::to_string(binding.set) + ", binding " +
+                                         std::to_string(binding.binding));
+            }
+            if (id(type).opcode == OpTypeArray) {
+                binding.count = arrayLength(type);
+                type = id(type).operands.at(0);
+            }
+            binding.type = descriptorType(type, variable.storageClass);
+            reflection.bindings.push_back(binding);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    for (uint32_t constant : specConstants) {
+        if (!id(constant).decorations.count(SpecId)) {
+            continue; // an operation on specialization constants, not one the application sets
+        }
+        const uint32_t resultType = id(constant).operands.at(0);
+        reflection.specializationConstants.push_back({decoration(constant, SpecId, 0), typeSize(resultType, 0)});
+    }
+
+    std::sort(reflection.inputs.begin(), reflection.inputs.end(),
+              [](const ShaderReflection::Input& a, const ShaderReflection::Input& b) { return a.location < b.location; });
+    std::sort(reflection.bindings.begin(), reflection.bindings.end(), [](const ShaderReflection::Binding& a, const ShaderReflection::Binding& b) {
+        return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+    });
+    std::sort(reflection.specializationConstants.begin(), reflection.specializationConstants.end(),
+              [](const ShaderReflection::SpecializationConstant& a, const ShaderReflection::SpecializationConstant& b) { return a.id < b.id; });
+    return reflection;
+}
+
+} // namespace
+
+ShaderReflection reflectShader(const uint32_t* words, size_t wordCount) {
+    return Module(words, wordCount).reflect();
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "vulkan-common.h"
+
+// A shader's interface as far as pipeline creation is concerned, read from its SPIR-V
+struct ShaderReflection {
+    struct Input {
+        uint32_t location = 0;
+        uint32_t componentCount = 0;
+        vk::Format format = vk::Format::eUndefined; // of the variable's type, e.g. eR32G32B32A32Sfloat for a vec4
+    };
+    struct Binding {
+        uint32_t set = 0;
+        uint32_t binding = 0;
+        vk::DescriptorType type = vk::DescriptorType::eUniformBuffer;
+        uint32_t count = 1; // array size
+    };
+    struct SpecializationConstant {
+        uint32_t id = 0;
+        uint32_t size = 0; // bytes
+    };
+
+    vk::ShaderStageFlagBits stage = vk::ShaderStageFlagBits::eVertex;
+    std::vector<Input> inputs;     // user-defined inputs of a vertex shader (no built-ins), ordered by location
+    std::vector<Binding> bindings; // ordered by set and binding
+    uint32_t pushConstantSize = 0; // end of the push constant block's last member, 0 without one
+    std::vector<SpecializationConstant> specializationConstants; // ordered by id
+};
+
+// Parses a SPIR-V module with one entry point. Descriptors follow what the module declares: after spirv-opt, that
+// is the ones the shader uses. Throws std::runtime_error on malformed modules and on interfaces the layouts can't
+// express (runtime sized descriptor arrays).
+ShaderReflection reflectShader(const uint32_t* words, size_t wordCount);
@@ -0,0 +1,75 @@
+#include "sprite-batcher.h"
+
+#include <algorithm>
+#include <cstring>
+
+void SpriteBatcher::begin() {
+    // States that went unused for a frame lose their bucket, the others keep their capacity
+    const bool unused = std::any_of(buckets.begin(), buckets.end(), [](const Bucket& bucket) { return bucket.sprites.empty(); });
+    if (unused) {
+        buckets.erase(std::remove_if(buckets.begin(), buckets.end(), [](const Bucket& bucket) { return bucket.sprites.empty(); }),
+                      buckets.end());
+        bucketOfKey.clear();
+        for (uint32_t i = 0; i < buckets.size(); i++) {
+            bucketOfKey[buckets[i].state.key()] = i;
+        }
+    }
+    for (Bucket& bucket : buckets) {
+        bucket.sprites.clear();
+    }
+    lastKey = UINT64_MAX;
+    batches.clear();
+    added = 0;
+    droppedSprites = 0;
+}
+
+SpriteBatcher::Bucket& SpriteBatcher::findBucket(const SpriteState& state) {
+    const uint32_t key = state.key();
+    lastKey = key;
+    // A handful of states is the usual case, scanning them beats hashing
+    if (buckets.size() <= k_scannedBuckets) {
+        for (uint32_t i = 0; i < buckets.size(); i++) {
+            if (buckets[i].state.key() == key) {
+                lastBucket = i;
+                return buckets[i];
+            }
+        }
+    } else if (auto it = bucketOfKey.find(key); it != bucketOfKey.end()) {
+        lastBucket = it->second;
+        return buckets[lastBucket];
+    }
+    lastBucket = static_cast<uint32_t>(buckets.size());
+    bucketOfKey.emplace(key, lastBucket);
+    buckets.push_back({state, {}});
+    return buckets[lastBucket];
+}
+
+const std::vector<SpriteBatcher::Batch>& SpriteBatcher::finish(SpriteVertex* destination, uint32_t capacity) {
+    order.clear();
+    for (uint32_t i = 0; i < buckets.size(); i++) {
+        if (!buckets[i].sprites.empty()) {
+            order.push_back(i);
+        }
+    }
+    std::sort(order.begin(), order.end(),
+              [&](uint32_t a, uint32_t b) { return buckets[a].state.key() < buckets[b].state.key(); });
+
+    uint32_t written = 0;
+    for (uint32_t index : order) {
+        const Bucket& bucket = buckets[index];
+        const uint32_t count = std::min(static_cast<uint32_t>(bucket.sprites.size()), capacity - written);
+        if (count == 0) {
+            break;
+        }
+        std::memcpy(destination + written, bucket.sprites.data(), count * sizeof(SpriteVertex));
+        // Another order with the same pipeline and texture right after the previous batch: nothing to switch
+        if (!batches.empty() && batches.back().pipeline == bucket.state.pipeline && batches.back().texture == bucket.state.texture) {
+            batches.back().spriteCount += count;
+        } else {
+            batches.push_back({bucket.state.pipeline, bucket.state.texture, written, count});
+        }
+        written += count;
+    }
+    droppedSprites = added - written;
+    return batches;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// One quad as sprite.vert reads it: instance-rate vertex attributes, one element per sprite, the corners are
+// generated in the shader
+struct SpriteVertex {
+    float position[2];   // top-left corner, pixels from the top-left corner of the render area
+    float size[2];       // pixels
+    uint16_t texRect[4]; // unorm16 texture coordinates within the layer: left, top, right, bottom
+    uint32_t color;      // RGBA8, red in the lowest byte, multiplies the texel
+    uint32_t layer;      // array layer of the atlas texture, each layer is an atlas page
+};
+static_assert(sizeof(SpriteVertex) == 32, "sprite.vert reads 32 byte elements");
+
+// Render state of a sprite, what the sprites are sorted by
+struct SpriteState {
+    uint16_t order = 0;   // lower orders are drawn first, sprites of the same order may be reordered to share draws
+    uint8_t pipeline = 0; // the caller's pipeline, e.g. a blend mode
+    uint8_t texture = 0;  // the caller's texture array (descriptor set)
+
+    uint32_t key() const { return uint32_t(order) << 16 | uint32_t(pipeline) << 8 | texture; }
+};
+
+// Batches 2D sprites and quads (UI, overlays) into as few draws as their states allow. Sprites are appended to a
+// bucket per state (order, pipeline, texture), the last bucket used is remembered since consecutive sprites usually
+// share it. finish() sorts the buckets, which are few, not the sprites, and copies each one in a single run into the
+// frame's region of the persistently mapped vertex ring, so write-combined memory is written once and in order.
+// Each bucket becomes one instanced draw; neighbours in draw order with the same pipeline and texture are merged.
+// Atlas pages are layers of one texture array, picked per sprite, so they don't split batches: the draw count
+// depends on the states in use, not on the number of sprites.
+// Not thread safe.
+class SpriteBatcher {
+public:
+    struct Batch {
+        uint8_t pipeline;
+        uint8_t texture;
+        uint32_t firstSprite; // element in the destination, the draw's firstInstance
+        uint32_t spriteCount;
+    };
+
+    // Forgets the previous frame's sprites (the buckets keep their memory)
+    void begin();
+    void add(const SpriteState& state, const SpriteVertex& sprite) {
+        Bucket& bucket = state.key() == lastKey ? buckets[lastBucket] : findBucket(state);
+        bucket.sprites.push_back(sprite);
+        added++;
+    }
+
+    // Writes the sprites in draw order to `destination`, at most `capacity`; the rest is dropped and counted in
+    // dropped(). Returns the draws, valid until the next begin().
+    const std::vector<Batch>& finish(SpriteVertex* destination, uint32_t capacity);
+
+    uint32_t spriteCount() const { return added; }
+    uint32_t dropped() const { return droppedSprites; }
+
+private:
+    static constexpr size_t k_scannedBuckets = 16; // up to this many states, add() finds its bucket without hashing
+
+    struct Bucket {
+        SpriteState state;
+        std::vector<SpriteVertex> sprites;
+    };
+
+    Bucket& findBucket(const SpriteState& state); // creates it for a new state, remembers it as the last one
+
+    std::vector<Bucket> buckets;
+    std::unordered_map<uint32_t, uint32_t> bucketOfKey; // state key -> index in buckets
+    uint64_t lastKey = UINT64_MAX;                       // key of buckets[lastBucket], UINT64_MAX: none yet
+    uint32_t lastBucket = 0;
+    std::vector<uint32_t> order; // scratch of finish(): non-empty buckets by key
+    std::vector<Batch> batches;
+    uint32_t added = 0;
+    uint32_t droppedSprites = 0;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Bounded single-producer/single-consumer ring buffer.
+// Exactly one thread may call tryPush and exactly one (other) thread may call tryPop.
+// Neither side ever blocks or takes a lock: a full queue makes tryPush fail, an empty one makes tryPop fail.
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    bool tryPush(const T& value) {
+        const size_t write = writeIndex.load(std::memory_order_relaxed);
+        if (write - cachedReadIndex >= Capacity) {
+            // Only refresh the consumer's index when the cached copy says we are full,
+            // this keeps the two indices from ping-ponging between cores on every call.
+            cachedReadIndex = readIndex.load(std::memory_order_acquire);
+            if (write - cachedReadIndex >= Capacity) {
+                return false;
+            }
+        }
+        slots[write & (Capacity - 1)] = value;
+        writeIndex.store(write + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& value) {
+        const size_t read = readIndex.load(std::memory_order_relaxed);
+        if (read == cachedWriteIndex) {
+            cachedWriteIndex = writeIndex.load(std::memory_order_acquire);
+            if (read == cachedWriteIndex) {
+                return false;
+            }
+        }
+        value = slots[read & (Capacity - 1)];
+        readIndex.store(read + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return readIndex.load(std::memory_order_acquire) == writeIndex.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr size_t k_cacheLineSize = 64;
+
+    // Producer side
+    alignas(k_cacheLineSize) std::atomic<size_t> writeIndex{0};
+    size_t cachedReadIndex = 0;
+
+    // Consumer side
+    alignas(k_cacheLineSize) std::atomic<size_t> readIndex{0};
+    size_t cachedWriteIndex = 0;
+
+    alignas(k_cacheLineSize) std::array<T, Capacity> slots{};
+};
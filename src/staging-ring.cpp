@@ -0,0 +1,198 @@
+#include "staging-ring.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+static uint32_t findHostVisibleMemoryType(vk::PhysicalDevice physicalDevice, uint32_t typeFilter) {
+    auto memProperties = physicalDevice.getMemoryProperties();
+    const vk::MemoryPropertyFlags wanted = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1u << i)) && (memProperties.memoryTypes[i].propertyFlags & wanted) == wanted) {
+            return i;
+        }
+    }
+    throw std::runtime_error("failed to find a memory type for the staging ring!");
+}
+
+StagingRing::StagingRing(vk::PhysicalDevice physicalDevice, vk::Device device, vk::Queue queue, uint32_t queueFamilyIndex,
+                         vk::DeviceSize capacity)
+    : device(device), queue(queue), ringSize(capacity) {
+    vk::BufferCreateInfo bufferInfo({}, capacity, vk::BufferUsageFlagBits::eTransferSrc, vk::SharingMode::eExclusive);
+    buffer = device.createBuffer(bufferInfo);
+    auto memRequirements = device.getBufferMemoryRequirements(buffer);
+    // Write-combined (uncached) memory is fine, the ring is only ever written sequentially
+    vk::MemoryAllocateInfo allocInfo(memRequirements.size, findHostVisibleMemoryType(physicalDevice, memRequirements.memoryTypeBits));
+    memory = device.allocateMemory(allocInfo);
+    device.bindBufferMemory(buffer, memory, 0);
+    mapped = static_cast<uint8_t*>(device.mapMemory(memory, 0, VK_WHOLE_SIZE));
+
+    vk::CommandPoolCreateInfo poolInfo(vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+                                       queueFamilyIndex);
+    commandPool = device.createCommandPool(poolInfo);
+    vk::CommandBufferAllocateInfo commandBufferInfo(commandPool, vk::CommandBufferLevel::ePrimary, k_batchCount);
+    auto commandBuffers = device.allocateCommandBuffers(commandBufferInfo);
+    for (size_t i = 0; i < k_batchCount; i++) {
+        batches[i].commandBuffer = commandBuffers[i];
+        batches[i].fence = device.createFence(vk::FenceCreateInfo());
+    }
+}
+
+StagingRing::~StagingRing() {
+    try {
+        finish();
+    } catch (const vk::DeviceLostError&) {
+        // Nothing completes on a lost device anymore, its objects can still be destroyed
+    }
+    for (auto& batch : batches) {
+        device.destroyFence(batch.fence);
+    }
+    device.destroyCommandPool(commandPool);
+    device.unmapMemory(memory);
+    device.destroyBuffer(buffer);
+    device.freeMemory(memory);
+}
+
+void StagingRing::copyToBuffer(const void* source, vk::DeviceSize size, vk::Buffer destination, vk::DeviceSize destinationOffset) {
+    // Large uploads are split so several chunks can be in flight at once
+    const vk::DeviceSize maxChunk = std::max<vk::DeviceSize>(ringSize / k_batchCount, k_alignment);
+    const uint8_t* bytes = static_cast<const uint8_t*>(source);
+    while (size > 0) {
+        const vk::DeviceSize chunk = std::min(size, maxChunk);
+        const vk::DeviceSize offset = allocate(chunk);
+        std::memcpy(mapped + offset, bytes, static_cast<size_t>(chunk)); // the only CPU copy: source pages -> ring
+        vk::BufferCopy region(offset, destinationOffset, chunk);
+        currentCommandBuffer().copyBuffer(buffer, destination, 1, &region);
+        bytes += chunk;
+        size -= chunk;
+        destinationOffset += chunk;
+        uploaded += chunk;
+    }
+}
+
+void StagingRing::copyToImage(const void* source, uint32_t width, uint32_t height, uint32_t firstRow, uint32_t rowCount,
+                              vk::DeviceSize rowSize, uint32_t blockHeight, vk::Image destination, uint32_t mipLevel,
+                              uint32_t arrayLayer) {
+    // Split by rows, like copyToBuffer by bytes
+    const vk::DeviceSize maxChunk = std::max<vk::DeviceSize>(ringSize / k_batchCount, k_alignment);
+    const uint32_t rowsPerChunk = static_cast<uint32_t>(std::max<vk::DeviceSize>(maxChunk / rowSize, 1));
+    const uint8_t* bytes = static_cast<const uint8_t*>(source);
+    while (rowCount > 0) {
+        const uint32_t rows = std::min(rowCount, rowsPerChunk);
+        const vk::DeviceSize chunk = rowSize * rows;
+        const vk::DeviceSize offset = allocate(chunk);
+        std::memcpy(mapped + offset, bytes, static_cast<size_t>(chunk));
+        // The last block row may reach past the image edge, the copy extent stops at the edge
+        const uint32_t y = firstRow * blockHeight;
+        vk::BufferImageCopy region(offset, 0, 0, vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, mipLevel, arrayLayer, 1),
+                                   vk::Offset3D(0, static_cast<int32_t>(y), 0), vk::Extent3D(width, std::min(rows * blockHeight, height - y), 1));
+        currentCommandBuffer().copyBufferToImage(buffer, destination, vk::ImageLayout::eTransferDstOptimal, 1, &region);
+        bytes += chunk;
+        firstRow += rows;
+        rowCount -= rows;
+        uploaded += chunk;
+    }
+}
+
+uint64_t StagingRing::flush() {
+    if (!recording) {
+        return submittedSerial;
+    }
+    Batch& batch = batches[current];
+    // A host fence wait does not make device writes visible to later submissions, the barrier does: any command
+    // submitted after this batch (vertex fetch, index read, shader read) sees the copies.
+    vk::MemoryBarrier barrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eMemoryRead);
+    batch.commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands, {},
+                                        1, &barrier, 0, nullptr, 0, nullptr);
+    batch.commandBuffer.end();
+    batch.end = head;
+    batch.serial = ++submittedSerial;
+    vk::SubmitInfo submitInfo(0, nullptr, nullptr, 1, &batch.commandBuffer);
+    queue.submit(1, &submitInfo, batch.fence);
+    inFlight.push_back(current);
+    recording = false;
+    return batch.serial;
+}
+
+void StagingRing::finish() {
+    flush();
+    while (!inFlight.empty()) {
+        retireOldestBatch();
+    }
+}
+
+bool StagingRing::isComplete(uint64_t serial) {
+    while (!inFlight.empty() && device.getFenceStatus(batches[inFlight.front()].fence) == vk::Result::eSuccess) {
+        retireOldestBatch(); // signaled, doesn't block
+    }
+    return serial <= completedSerial;
+}
+
+vk::DeviceSize StagingRing::allocate(vk::DeviceSize size) {
+    vk::DeviceSize offset = 0;
+    while (!tryAllocate(size, offset)) {
+        if (recording) {
+            flush();
+        }
+        if (inFlight.empty()) {
+            throw std::runtime_error("staging ring allocation larger than the ring");
+        }
+        retireOldestBatch();
+    }
+    return offset;
+}
+
+bool StagingRing::tryAllocate(vk::DeviceSize size, vk::DeviceSize& offset) {
+    const vk::DeviceSize start = (head + k_alignment - 1) / k_alignment * k_alignment;
+    if (head >= tail) {
+        // Free space is [head, ringSize) and [0, tail). head == tail only happens when the ring is empty,
+        // so the wrapped allocation has to stay strictly below tail.
+        if (start + size <= ringSize) {
+            offset = start;
+        } else if (size < tail) {
+            offset = 0;
+        } else {
+            return false;
+        }
+    } else {
+        if (start + size >= tail) {
+            return false;
+        }
+        offset = start;
+    }
+    head = offset + size;
+    return true;
+}
+
+vk::CommandBuffer StagingRing::currentCommandBuffer() {
+    if (!recording) {
+        // All batches in flight: wait for the oldest one to free a command buffer
+        if (inFlight.size() == k_batchCount) {
+            retireOldestBatch();
+        }
+        // Pick a batch that isn't in flight
+        for (size_t i = 0; i < k_batchCount; i++) {
+            if (std::find(inFlight.begin(), inFlight.end(), i) == inFlight.end()) {
+                current = i;
+                break;
+            }
+        }
+        batches[current].commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+        recording = true;
+    }
+    return batches[current].commandBuffer;
+}
+
+void StagingRing::retireOldestBatch() {
+    Batch& batch = batches[inFlight.front()];
+    if (device.waitForFences(1, &batch.fence, true, UINT64_MAX) != vk::Result::eSuccess) {
+        throw std::runtime_error("waiting for a staging upload failed");
+    }
+    device.resetFences(1, &batch.fence);
+    inFlight.pop_front();
+    tail = batch.end;
+    completedSerial = batch.serial;
+    if (inFlight.empty() && !recording) {
+        head = tail = 0; // empty, start over at the beginning to avoid needless wrapping
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+
+#include "vulkan-common.h"
+
+// Uploads data to device-local resources through a persistently mapped, host-visible ring buffer.
+// Callers hand over a pointer (e.g. into a memory-mapped file) and the bytes are written into the ring exactly once,
+// from where copy commands move them to the destination. Copies are batched into command buffers; when the ring is
+// full, the oldest batch is waited for and its space reused. Not thread safe, one owner thread.
+class StagingRing {
+public:
+    StagingRing(vk::PhysicalDevice physicalDevice, vk::Device device, vk::Queue queue, uint32_t queueFamilyIndex,
+                vk::DeviceSize capacity);
+    ~StagingRing();
+    StagingRing(const StagingRing&) = delete;
+    StagingRing& operator=(const StagingRing&) = delete;
+
+    // Copies `size` bytes from `source` into `destination` at `destinationOffset`.
+    void copyToBuffer(const void* source, vk::DeviceSize size, vk::Buffer destination, vk::DeviceSize destinationOffset);
+    // Copies `rowCount` tightly packed rows of `rowSize` bytes to rows [firstRow, firstRow + rowCount) of a mip level
+    // that is width x height texels. Rows are rows of blocks, `blockHeight` texels high, for block compressed formats.
+    // The image has to be in eTransferDstOptimal layout, see commandBuffer() for recording the transition.
+    void copyToImage(const void* source, uint32_t width, uint32_t height, uint32_t firstRow, uint32_t rowCount, vk::DeviceSize rowSize,
+                     uint32_t blockHeight, vk::Image destination, uint32_t mipLevel, uint32_t arrayLayer = 0);
+
+    // The command buffer the next copies go to, for barriers around them (e.g. layout transitions, queue family
+    // ownership transfers). Valid until the next flush.
+    vk::CommandBuffer commandBuffer() { return currentCommandBuffer(); }
+
+    // Submits the copies recorded so far. Returns the serial number of the submitted batch, isComplete() tells
+    // when it (and every batch before it) has finished.
+    uint64_t flush();
+    // Submits and waits until every copy completed
+    void finish();
+    // Non-blocking: true once the batch with the given serial number completed
+    bool isComplete(uint64_t serial);
+
+    vk::DeviceSize capacity() const { return ringSize; }
+    uint64_t bytesUploaded() const { return uploaded; }
+
+private:
+    struct Batch {
+        vk::CommandBuffer commandBuffer;
+        vk::Fence fence;
+        vk::DeviceSize end = 0; // ring offset right after the batch's last allocation
+        uint64_t serial = 0;
+    };
+    static constexpr size_t k_batchCount = 4;
+    static constexpr vk::DeviceSize k_alignment = 16;
+
+    // Returns the ring offset for `size` bytes, waits for older batches when the ring is full
+    vk::DeviceSize allocate(vk::DeviceSize size);
+    bool tryAllocate(vk::DeviceSize size, vk::DeviceSize& offset);
+    vk::CommandBuffer currentCommandBuffer();
+    void retireOldestBatch();
+
+    vk::Device device;
+    vk::Queue queue;
+    vk::CommandPool commandPool;
+    vk::Buffer buffer;
+    vk::DeviceMemory memory;
+    uint8_t* mapped = nullptr;
+    vk::DeviceSize ringSize = 0;
+    vk::DeviceSize head = 0; // next free byte
+    vk::DeviceSize tail = 0; // first byte still in use, head == tail means empty
+    std::array<Batch, k_batchCount> batches;
+    std::deque<size_t> inFlight; // submitted batches, oldest first
+    size_t current = 0;          // batch being recorded
+    bool recording = false;
+    uint64_t uploaded = 0;
+    uint64_t submittedSerial = 0;
+    uint64_t completedSerial = 0;
+};
@@ -0,0 +1,142 @@
+#include "stats-report.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+
+namespace {
+
+std::string escapeJson(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        switch (c) {
+            case '"': escaped += "\\\""; break;
+            case '\\': escaped += "\\\\"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\t': escaped += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char code[8];
+                    std::snprintf(code, sizeof(code), "\\u%04x", c);
+                    escaped += code;
+                } else {
+                    escaped += c;
+                }
+        }
+    }
+    return escaped;
+}
+
+std::string formatNumber(double value) {
+    if (!std::isfinite(value)) {
+        return "null";
+    }
+    char formatted[32];
+    std::snprintf(formatted, sizeof(formatted), "%.3f", value);
+    return formatted;
+}
+
+} // namespace
+
+StatsReport::Entry& StatsReport::set(const std::string& section, const std::string& key, std::string value, bool quoted) {
+    auto sectionIt = std::find_if(sections.begin(), sections.end(), [&](const Section& s) { return s.name == section; });
+    if (sectionIt == sections.end()) {
+        sections.push_back(Section{section, {}});
+        sectionIt = sections.end() - 1;
+    }
+    auto& entries = sectionIt->entries;
+    auto entryIt = std::find_if(entries.begin(), entries.end(), [&](const Entry& e) { return e.key == key; });
+    if (entryIt != entries.end()) {
+        entryIt->value = std::move(value);
+        entryIt->quoted = quoted;
+        entryIt->fields.clear();
+        return *entryIt;
+    }
+    entries.push_back(Entry{key, std::move(value), quoted, {}});
+    return entries.back();
+}
+
+void StatsReport::add(const std::string& section, const std::string& key, const std::string& value) {
+    set(section, key, value, true);
+}
+
+void StatsReport::add(const std::string& section, const std::string& key, double value) {
+    set(section, key, formatNumber(value), false);
+}
+
+void StatsReport::add(const std::string& section, const std::string& key, uint64_t value) {
+    set(section, key, std::to_string(value), false);
+}
+
+void StatsReport::add(const std::string& section, const std::string& key, bool value) {
+    set(section, key, value ? "true" : "false", false);
+}
+
+void StatsReport::add(const std::string& section, const TimingSummary& summary) {
+    add(section, "count", static_cast<uint64_t>(summary.count));
+    add(section, "mean_ms", summary.mean);
+    add(section, "min_ms", summary.min);
+    add(section, "p50_ms", summary.p50);
+    add(section, "p90_ms", summary.p90);
+    add(section, "p99_ms", summary.p99);
+    add(section, "max_ms", summary.max);
+}
+
+void StatsReport::add(const std::string& section, const std::string& key, const std::vector<std::pair<std::string, double>>& fields) {
+    Entry& group = set(section, key, "", false);
+    for (const auto& field : fields) {
+        group.fields.emplace_back(field.first, formatNumber(field.second));
+    }
+}
+
+std::string StatsReport::text() const {
+    size_t keyWidth = 0;
+    for (const auto& section : sections) {
+        for (const auto& entry : section.entries) {
+            keyWidth = std::max(keyWidth, entry.key.size());
+        }
+    }
+    std::ostringstream out;
+    for (const auto& section : sections) {
+        out << section.name << ":" << std::endl;
+        for (const auto& entry : section.entries) {
+            out << "  " << entry.key << std::string(keyWidth - entry.key.size() + 1, ' ');
+            if (entry.fields.empty()) {
+                out << entry.value;
+            }
+            for (size_t f = 0; f < entry.fields.size(); f++) {
+                out << (f ? " " : "") << entry.fields[f].first << "=" << entry.fields[f].second;
+            }
+            out << std::endl;
+        }
+    }
+    return out.str();
+}
+
+std::string StatsReport::json() const {
+    std::ostringstream out;
+    out << "{";
+    for (size_t s = 0; s < sections.size(); s++) {
+        out << (s ? ",\n" : "\n") << "  \"" << escapeJson(sections[s].name) << "\": {";
+        const auto& entries = sections[s].entries;
+        for (size_t e = 0; e < entries.size(); e++) {
+            out << (e ? ",\n" : "\n") << "    \"" << escapeJson(entries[e].key) << "\": ";
+            if (!entries[e].fields.empty()) {
+                out << "{";
+                for (size_t f = 0; f < entries[e].fields.size(); f++) {
+                    out << (f ? ", " : "") << "\"" << escapeJson(entries[e].fields[f].first) << "\": " << entries[e].fields[f].second;
+                }
+                out << "}";
+            } else if (entries[e].quoted) {
+                out << "\"" << escapeJson(entries[e].value) << "\"";
+            } else {
+                out << entries[e].value;
+            }
+        }
+        out << "\n  }";
+    }
+    out << "\n}\n";
+    return out.str();
+}
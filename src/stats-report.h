@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "frame-statistics.h"
+
+// Named sections of key/value pairs that render as human-readable text and as JSON.
+// Sections and keys keep the order they were first added in, so reports diff cleanly between runs.
+class StatsReport {
+public:
+    void add(const std::string& section, const std::string& key, const std::string& value);
+    void add(const std::string& section, const std::string& key, const char* value) { add(section, key, std::string(value)); }
+    void add(const std::string& section, const std::string& key, double value);
+    void add(const std::string& section, const std::string& key, uint64_t value);
+    void add(const std::string& section, const std::string& key, bool value);
+    // count, mean_ms, min_ms, p50_ms, p90_ms, p99_ms, max_ms
+    void add(const std::string& section, const TimingSummary& summary);
+    // A group of named numbers under one key, e.g. one row of a per-function table
+    void add(const std::string& section, const std::string& key, const std::vector<std::pair<std::string, double>>& fields);
+
+    std::string text() const;
+    std::string json() const;
+
+private:
+    struct Entry {
+        std::string key;
+        std::string value; // already formatted
+        bool quoted;       // strings are quoted in JSON, numbers and booleans aren't
+        std::vector<std::pair<std::string, std::string>> fields; // set for groups, value is unused then
+    };
+    struct Section {
+        std::string name;
+        std::vector<Entry> entries;
+    };
+
+    Entry& set(const std::string& section, const std::string& key, std::string value, bool quoted);
+
+    std::vector<Section> sections;
+};
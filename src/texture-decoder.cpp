@@ -0,0 +1,609 @@
+#include "texture-decoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "job-system.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define TEXTURE_DECODER_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TEXTURE_DECODER_SSE 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TEXTURE_DECODER_NEON 1
+#endif
+
+// The palettes are built and the indices unpacked with 16 bit lanes. The AVX path is the SSE2 one plus the SSSE3 byte
+// shuffles every AVX CPU has for the palette lookups, 256 bit integer vectors would need AVX2.
+
+namespace {
+
+uint32_t readLittle32(const uint8_t* bytes) {
+    return uint32_t(bytes[0]) | uint32_t(bytes[1]) << 8 | uint32_t(bytes[2]) << 16 | uint32_t(bytes[3]) << 24;
+}
+
+uint64_t readBig64(const uint8_t* bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value = value << 8 | bytes[i];
+    }
+    return value;
+}
+
+uint8_t clampByte(int value) {
+    return static_cast<uint8_t>(std::min(std::max(value, 0), 255));
+}
+
+// Where the 16 indices of a block lie in its bits, in texel order (row by row). The SIMD paths take every index from
+// one of the 16 bit windows at bits 0, 12, 24 and 36: a multiplication moves it to the top of the window, a shift down
+// to outputBit.
+struct FieldLayout {
+    uint16_t select[4][16]; // 0xffff in the window holding the field
+    uint16_t multiplier[16];
+    uint8_t bit[16];
+    int width;
+    int outputBit;
+};
+
+template <typename Position>
+constexpr FieldLayout fieldLayout(int width, int outputBit, Position position) {
+    FieldLayout layout = {};
+    layout.width = width;
+    layout.outputBit = outputBit;
+    for (int i = 0; i < 16; i++) {
+        const int bit = position(i % 4, i / 4);
+        const int window = std::min(bit / 12, 3);
+        layout.select[window][i] = 0xffff;
+        layout.multiplier[i] = uint16_t(1 << (16 - width - (bit - 12 * window)));
+        layout.bit[i] = uint8_t(bit);
+    }
+    return layout;
+}
+
+constexpr FieldLayout k_bc1Indices = fieldLayout(2, 0, [](int x, int y) { return 2 * (y * 4 + x); });
+constexpr FieldLayout k_bc4Indices = fieldLayout(3, 0, [](int x, int y) { return 3 * (y * 4 + x); });
+// ETC and EAC store their indices column by column, EAC's from the top bits down
+constexpr FieldLayout k_eacIndices = fieldLayout(3, 0, [](int x, int y) { return 45 - 3 * (x * 4 + y); });
+constexpr FieldLayout k_etcIndexLsbs = fieldLayout(1, 0, [](int x, int y) { return x * 4 + y; });
+constexpr FieldLayout k_etcIndexMsbs = fieldLayout(1, 1, [](int x, int y) { return 16 + x * 4 + y; });
+
+// fields[i] |= field i of bits, shifted to the layout's output bit
+void unpackFields(uint64_t bits, const FieldLayout& layout, uint8_t* fields) {
+#if TEXTURE_DECODER_AVX || TEXTURE_DECODER_SSE
+    const __m128i windows[4] = {
+        _mm_set1_epi16(short(bits)), _mm_set1_epi16(short(bits >> 12)),
+        _mm_set1_epi16(short(bits >> 24)), _mm_set1_epi16(short(bits >> 36))
+    };
+    const __m128i shift = _mm_cvtsi32_si128(16 - layout.width - layout.outputBit);
+    const __m128i mask = _mm_set1_epi16(short(((1 << layout.width) - 1) << layout.outputBit));
+    __m128i halves[2];
+    for (int half = 0; half < 2; half++) {
+        __m128i window = _mm_setzero_si128();
+        for (int i = 0; i < 4; i++) {
+            const __m128i select = _mm_loadu_si128(reinterpret_cast<const __m128i*>(layout.select[i] + half * 8));
+            window = _mm_or_si128(window, _mm_and_si128(windows[i], select));
+        }
+        const __m128i multiplier = _mm_loadu_si128(reinterpret_cast<const __m128i*>(layout.multiplier + half * 8));
+        halves[half] = _mm_and_si128(_mm_srl_epi16(_mm_mullo_epi16(window, multiplier), shift), mask);
+    }
+    __m128i* out = reinterpret_cast<__m128i*>(fields);
+    _mm_storeu_si128(out, _mm_or_si128(_mm_loadu_si128(out), _mm_packus_epi16(halves[0], halves[1])));
+#elif TEXTURE_DECODER_NEON
+    const uint16x8_t windows[4] = {
+        vdupq_n_u16(uint16_t(bits)), vdupq_n_u16(uint16_t(bits >> 12)),
+        vdupq_n_u16(uint16_t(bits >> 24)), vdupq_n_u16(uint16_t(bits >> 36))
+    };
+    const int16x8_t shift = vdupq_n_s16(int16_t(layout.width + layout.outputBit - 16));
+    const uint16x8_t mask = vdupq_n_u16(uint16_t(((1 << layout.width) - 1) << layout.outputBit));
+    uint8x8_t halves[2];
+    for (int half = 0; half < 2; half++) {
+        uint16x8_t window = vdupq_n_u16(0);
+        for (int i = 0; i < 4; i++) {
+            window = vorrq_u16(window, vandq_u16(windows[i], vld1q_u16(layout.select[i] + half * 8)));
+        }
+        const uint16x8_t top = vmulq_u16(window, vld1q_u16(layout.multiplier + half * 8));
+        halves[half] = vmovn_u16(vandq_u16(vshlq_u16(top, shift), mask));
+    }
+    vst1q_u8(fields, vorrq_u8(vld1q_u8(fields), vcombine_u8(halves[0], halves[1])));
+#else
+    for (int i = 0; i < 16; i++) {
+        fields[i] |= uint8_t(((bits >> layout.bit[i]) & ((1u << layout.width) - 1)) << layout.outputBit);
+    }
+#endif
+}
+
+#if TEXTURE_DECODER_AVX || TEXTURE_DECODER_SSE
+// Bytes 4 * group to 4 * group + 3, zero extended to 32 bits
+inline __m128i widenGroup(__m128i bytes, int group) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i words = group < 2 ? _mm_unpacklo_epi8(bytes, zero) : _mm_unpackhi_epi8(bytes, zero);
+    return group % 2 == 0 ? _mm_unpacklo_epi16(words, zero) : _mm_unpackhi_epi16(words, zero);
+}
+#elif TEXTURE_DECODER_NEON
+inline uint32x4_t widenGroup(uint8x16_t bytes, int group) {
+    const uint16x8_t words = vmovl_u8(group < 2 ? vget_low_u8(bytes) : vget_high_u8(bytes));
+    return vmovl_u16(group % 2 == 0 ? vget_low_u16(words) : vget_high_u16(words));
+}
+
+// The high 16 bits of the 32 bit products, _mm_mulhi_epu16
+inline uint16x8_t multiplyHigh(uint16x8_t a, uint16x8_t b) {
+    const uint32x4_t low = vmull_u16(vget_low_u16(a), vget_low_u16(b));
+    const uint32x4_t high = vmull_u16(vget_high_u16(a), vget_high_u16(b));
+    return vcombine_u16(vshrn_n_u32(low, 16), vshrn_n_u32(high, 16));
+}
+#endif
+
+// rgba[i] = palette[fields[i]] for the 16 texels, the palette has count (4 or 8) RGBA entries
+void lookupTexels(const uint8_t (*palette)[4], int count, const uint8_t* fields, uint8_t* rgba) {
+#if TEXTURE_DECODER_AVX
+    // Byte shuffles: the 4 control bytes of a texel are its entry's byte offsets, entries 4 to 7 are a second table
+    const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(palette[0]));
+    const __m128i high = count > 4 ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(palette[4])) : _mm_setzero_si128();
+    const __m128i indices = _mm_loadu_si128(reinterpret_cast<const __m128i*>(fields));
+    for (int group = 0; group < 4; group++) {
+        const __m128i control = _mm_add_epi32(_mm_mullo_epi32(widenGroup(indices, group), _mm_set1_epi32(0x04040404)),
+                                              _mm_set1_epi32(0x03020100));
+        const __m128i upper = _mm_cmpgt_epi8(control, _mm_set1_epi8(15));
+        const __m128i texels = _mm_or_si128(_mm_shuffle_epi8(low, _mm_or_si128(control, upper)),
+                                            _mm_and_si128(_mm_shuffle_epi8(high, control), upper));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + group * 16), texels);
+    }
+#elif TEXTURE_DECODER_SSE
+    // No byte shuffle in SSE2, every entry is selected where the index matches it
+    const __m128i indices = _mm_loadu_si128(reinterpret_cast<const __m128i*>(fields));
+    for (int group = 0; group < 4; group++) {
+        const __m128i entries = widenGroup(indices, group);
+        __m128i texels = _mm_setzero_si128();
+        for (int i = 0; i < count; i++) {
+            const __m128i match = _mm_cmpeq_epi32(entries, _mm_set1_epi32(i));
+            texels = _mm_or_si128(texels, _mm_and_si128(match, _mm_set1_epi32(int(readLittle32(palette[i])))));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + group * 16), texels);
+    }
+#elif TEXTURE_DECODER_NEON
+    // Table lookups: the 4 control bytes of a texel are its entry's byte offsets into the 32 byte palette
+    const uint8x16_t low = vld1q_u8(palette[0]);
+    const uint8x16_t high = count > 4 ? vld1q_u8(palette[4]) : vdupq_n_u8(0);
+    const uint8x16_t indices = vld1q_u8(fields);
+    for (int group = 0; group < 4; group++) {
+        const uint32x4_t offsets = vmlaq_n_u32(vdupq_n_u32(0x03020100), widenGroup(indices, group), 0x04040404);
+        const uint8x16_t control = vreinterpretq_u8_u32(offsets);
+#if defined(__aarch64__)
+        const uint8x16x2_t table = {{low, high}};
+        vst1q_u8(rgba + group * 16, vqtbl2q_u8(table, control));
+#else
+        const uint8x8x4_t table = {{vget_low_u8(low), vget_high_u8(low), vget_low_u8(high), vget_high_u8(high)}};
+        vst1_u8(rgba + group * 16, vtbl4_u8(table, vget_low_u8(control)));
+        vst1_u8(rgba + group * 16 + 8, vtbl4_u8(table, vget_high_u8(control)));
+#endif
+    }
+#else
+    (void)count;
+    for (int i = 0; i < 16; i++) {
+        std::memcpy(rgba + i * 4, palette[fields[i]], 4);
+    }
+#endif
+}
+
+// rgba[i * 4 + channel] = values[fields[i]] for the 16 texels, the other channels are kept
+void lookupChannel(const uint8_t* values, const uint8_t* fields, uint8_t* rgba, int channel) {
+#if TEXTURE_DECODER_AVX || TEXTURE_DECODER_SSE
+    const __m128i indices = _mm_loadu_si128(reinterpret_cast<const __m128i*>(fields));
+#if TEXTURE_DECODER_AVX
+    const __m128i looked = _mm_shuffle_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(values)), indices);
+#else
+    __m128i looked = _mm_setzero_si128();
+    for (int i = 0; i < 8; i++) {
+        const __m128i match = _mm_cmpeq_epi8(indices, _mm_set1_epi8(char(i)));
+        looked = _mm_or_si128(looked, _mm_and_si128(match, _mm_set1_epi8(char(values[i]))));
+    }
+#endif
+    const __m128i shift = _mm_cvtsi32_si128(8 * channel);
+    const __m128i keep = _mm_set1_epi32(int(~(0xffu << (8 * channel))));
+    for (int group = 0; group < 4; group++) {
+        __m128i* out = reinterpret_cast<__m128i*>(rgba + group * 16);
+        const __m128i texels = _mm_and_si128(_mm_loadu_si128(out), keep);
+        _mm_storeu_si128(out, _mm_or_si128(texels, _mm_sll_epi32(widenGroup(looked, group), shift)));
+    }
+#elif TEXTURE_DECODER_NEON
+    const uint8x8_t table = vld1_u8(values);
+    const uint8x16_t indices = vld1q_u8(fields);
+    const uint8x16_t looked = vcombine_u8(vtbl1_u8(table, vget_low_u8(indices)), vtbl1_u8(table, vget_high_u8(indices)));
+    const int32x4_t shift = vdupq_n_s32(8 * channel);
+    const uint32x4_t keep = vdupq_n_u32(~(0xffu << (8 * channel)));
+    for (int group = 0; group < 4; group++) {
+        uint8_t* out = rgba + group * 16;
+        const uint32x4_t texels = vandq_u32(vreinterpretq_u32_u8(vld1q_u8(out)), keep);
+        vst1q_u8(out, vreinterpretq_u8_u32(vorrq_u32(texels, vshlq_u32(widenGroup(looked, group), shift))));
+    }
+#else
+    for (int i = 0; i < 16; i++) {
+        rgba[i * 4 + channel] = values[fields[i]];
+    }
+#endif
+}
+
+// BC1 palette: the two RGB565 endpoints and the two colors between them, or their midpoint and transparent black
+void expandBc1Palette(uint16_t c0, uint16_t c1, bool fourColors, uint8_t (*palette)[4]) {
+#if TEXTURE_DECODER_AVX || TEXTURE_DECODER_SSE
+    // Every channel is moved to the top bits of its lane and replicated into the low bits by a multiplication:
+    // (r << 11) * 264 >> 16 is r << 3 | r >> 2, (g << 10) * 260 >> 16 is g << 2 | g >> 4
+    const __m128i colors = _mm_setr_epi16(short(c0), short(c0), short(c0), 0, short(c1), short(c1), short(c1), 0);
+    const __m128i masks = _mm_setr_epi16(short(0xf800), 0x07e0, 0x001f, 0, short(0xf800), 0x07e0, 0x001f, 0);
+    const __m128i channels = _mm_mullo_epi16(_mm_and_si128(colors, masks), _mm_setr_epi16(1, 32, 2048, 0, 1, 32, 2048, 0));
+    const __m128i endpoints = _mm_or_si128(_mm_mulhi_epu16(channels, _mm_setr_epi16(264, 260, 264, 0, 264, 260, 264, 0)),
+                                           _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255));
+    const __m128i swapped = _mm_shuffle_epi32(endpoints, _MM_SHUFFLE(1, 0, 3, 2));
+    __m128i between;
+    if (fourColors) {
+        // (2a + b) / 3 and (a + 2b) / 3, the division a multiplication by 65536 / 3
+        between = _mm_mulhi_epu16(_mm_add_epi16(_mm_add_epi16(endpoints, endpoints), swapped), _mm_set1_epi16(21846));
+    } else {
+        between = _mm_and_si128(_mm_srli_epi16(_mm_add_epi16(endpoints, swapped), 1), _mm_setr_epi16(-1, -1, -1, -1, 0, 0, 0, 0));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(palette), _mm_packus_epi16(endpoints, between));
+#elif TEXTURE_DECODER_NEON
+    // See the SSE path
+    const uint16_t colors[8] = {c0, c0, c0, 0, c1, c1, c1, 0};
+    const uint16_t masks[8] = {0xf800, 0x07e0, 0x001f, 0, 0xf800, 0x07e0, 0x001f, 0};
+    const uint16_t toTop[8] = {1, 32, 2048, 0, 1, 32, 2048, 0};
+    const uint16_t replicate[8] = {264, 260, 264, 0, 264, 260, 264, 0};
+    const uint16_t alpha[8] = {0, 0, 0, 255, 0, 0, 0, 255};
+    const uint16x8_t channels = vmulq_u16(vandq_u16(vld1q_u16(colors), vld1q_u16(masks)), vld1q_u16(toTop));
+    const uint16x8_t endpoints = vorrq_u16(multiplyHigh(channels, vld1q_u16(replicate)), vld1q_u16(alpha));
+    const uint16x8_t swapped = vextq_u16(endpoints, endpoints, 4);
+    uint16x8_t between;
+    if (fourColors) {
+        between = multiplyHigh(vaddq_u16(vaddq_u16(endpoints, endpoints), swapped), vdupq_n_u16(21846));
+    } else {
+        between = vcombine_u16(vget_low_u16(vshrq_n_u16(vaddq_u16(endpoints, swapped), 1)), vdup_n_u16(0));
+    }
+    vst1q_u8(palette[0], vcombine_u8(vqmovn_u16(endpoints), vqmovn_u16(between)));
+#else
+    for (int i = 0; i < 2; i++) {
+        const uint16_t c = i == 0 ? c0 : c1;
+        const int r = (c >> 11) & 31;
+        const int g = (c >> 5) & 63;
+        const int b = c & 31;
+        palette[i][0] = uint8_t(r << 3 | r >> 2);
+        palette[i][1] = uint8_t(g << 2 | g >> 4);
+        palette[i][2] = uint8_t(b << 3 | b >> 2);
+        palette[i][3] = 255;
+    }
+    for (int channel = 0; channel < 3; channel++) {
+        const int a = palette[0][channel];
+        const int b = palette[1][channel];
+        if (fourColors) {
+            palette[2][channel] = uint8_t((2 * a + b) / 3);
+            palette[3][channel] = uint8_t((a + 2 * b) / 3);
+        } else {
+            palette[2][channel] = uint8_t((a + b) / 2);
+            palette[3][channel] = 0;
+        }
+    }
+    palette[2][3] = 255;
+    palette[3][3] = fourColors ? 255 : 0;
+#endif
+}
+
+// BC1 color: two RGB565 endpoints and 2 bit indices. c0 <= c1 selects the three color + transparent black mode,
+// which BC3 doesn't have (its colors are always four).
+void decodeBc1Colors(const uint8_t* block, uint8_t* rgba, bool allowTransparent) {
+    const uint16_t c0 = uint16_t(block[0] | block[1] << 8);
+    const uint16_t c1 = uint16_t(block[2] | block[3] << 8);
+    uint8_t palette[4][4];
+    expandBc1Palette(c0, c1, c0 > c1 || !allowTransparent, palette);
+    uint8_t indices[16] = {};
+    unpackFields(readLittle32(block + 4), k_bc1Indices, indices);
+    lookupTexels(palette, 4, indices, rgba);
+}
+
+// Weights of a0 and a1 in the BC4 values, in sevenths when a0 > a1, otherwise in fifths with 0 and 255 last
+const uint16_t k_bc4Sevenths[2][8] = {{7, 0, 6, 5, 4, 3, 2, 1}, {0, 7, 1, 2, 3, 4, 5, 6}};
+const uint16_t k_bc4Fifths[2][8] = {{5, 0, 4, 3, 2, 1, 0, 0}, {0, 5, 1, 2, 3, 4, 0, 0}};
+
+void expandBc4Values(int a0, int a1, uint8_t* values) {
+    const bool sevenths = a0 > a1;
+    const uint16_t(&weights)[2][8] = sevenths ? k_bc4Sevenths : k_bc4Fifths;
+#if TEXTURE_DECODER_AVX || TEXTURE_DECODER_SSE
+    const __m128i first = _mm_mullo_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(weights[0])), _mm_set1_epi16(short(a0)));
+    const __m128i second = _mm_mullo_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(weights[1])), _mm_set1_epi16(short(a1)));
+    // The division is a multiplication by 65536 / 7 or 65536 / 5, rounded up, exact for sums up to 7 * 255
+    __m128i interpolated = _mm_mulhi_epu16(_mm_add_epi16(first, second), _mm_set1_epi16(short(sevenths ? 9363 : 13108)));
+    if (!sevenths) {
+        interpolated = _mm_or_si128(interpolated, _mm_setr_epi16(0, 0, 0, 0, 0, 0, 0, 255));
+    }
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(values), _mm_packus_epi16(interpolated, interpolated));
+#elif TEXTURE_DECODER_NEON
+    const uint16x8_t sum = vmlaq_n_u16(vmulq_n_u16(vld1q_u16(weights[0]), uint16_t(a0)), vld1q_u16(weights[1]), uint16_t(a1));
+    uint16x8_t interpolated = multiplyHigh(sum, vdupq_n_u16(sevenths ? 9363 : 13108));
+    if (!sevenths) {
+        interpolated = vsetq_lane_u16(255, interpolated, 7);
+    }
+    vst1_u8(values, vqmovn_u16(interpolated));
+#else
+    for (int i = 0; i < 8; i++) {
+        values[i] = uint8_t((weights[0][i] * a0 + weights[1][i] * a1) / (sevenths ? 7 : 5));
+    }
+    if (!sevenths) {
+        values[7] = 255;
+    }
+#endif
+}
+
+// BC3 alpha / BC4 / BC5 channel: two 8 bit endpoints, 3 bit indices, 8 or 6 interpolated values
+void decodeBc4Channel(const uint8_t* block, uint8_t* rgba, int channel) {
+    uint8_t values[8];
+    expandBc4Values(block[0], block[1], values);
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; i++) {
+        bits |= uint64_t(block[2 + i]) << (8 * i);
+    }
+    uint8_t indices[16] = {};
+    unpackFields(bits, k_bc4Indices, indices);
+    lookupChannel(values, indices, rgba, channel);
+}
+
+const int16_t k_etcModifiers[8][4] = {
+    {2, 8, -2, -8}, {5, 17, -5, -17}, {9, 29, -9, -29}, {13, 42, -13, -42},
+    {18, 60, -18, -60}, {24, 80, -24, -80}, {33, 106, -33, -106}, {47, 183, -47, -183}
+};
+const int16_t k_etcDistances[8] = {3, 6, 11, 16, 23, 32, 41, 64};
+
+int16_t extend4(int value) { return int16_t(value << 4 | value); }
+int16_t extend5(int value) { return int16_t(value << 3 | value >> 2); }
+int16_t extend6(int value) { return int16_t(value << 2 | value >> 4); }
+int16_t extend7(int value) { return int16_t(value << 1 | value >> 6); }
+
+// The first palette entry of every texel in individual and differential mode: the second sub-block's modifiers are
+// entries 4 to 7. Sub-blocks are the left and right halves, or the top and bottom ones with the flip bit.
+const uint8_t k_etcSubBlockEntries[2][16] = {
+    {0, 0, 4, 4, 0, 0, 4, 4, 0, 0, 4, 4, 0, 0, 4, 4},
+    {0, 0, 0, 0, 0, 0, 0, 0, 4, 4, 4, 4, 4, 4, 4, 4}
+};
+
+// Pixel indices of ETC blocks are stored column by column: bit x * 4 + y of the LSB and MSB halves
+void unpackEtcIndices(uint64_t bits, uint8_t* fields) {
+    unpackFields(bits, k_etcIndexLsbs, fields);
+    unpackFields(bits, k_etcIndexMsbs, fields);
+}
+
+// palette[i] = the RGB of colors[i] + offsets[i], clamped, for 4 entries. The colors are RGBA with alpha 255.
+void offsetColors(const int16_t* const* colors, const int16_t* offsets, uint8_t (*palette)[4]) {
+#if TEXTURE_DECODER_AVX || TEXTURE_DECODER_SSE
+    const __m128i rgb = _mm_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+    const __m128i pairs = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(offsets)),
+                                             _mm_loadl_epi64(reinterpret_cast<const __m128i*>(offsets)));
+    const __m128i firstOffsets = _mm_and_si128(_mm_unpacklo_epi32(pairs, pairs), rgb);
+    const __m128i secondOffsets = _mm_and_si128(_mm_unpackhi_epi32(pairs, pairs), rgb);
+    const __m128i first = _mm_unpacklo_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(colors[0])),
+                                             _mm_loadl_epi64(reinterpret_cast<const __m128i*>(colors[1])));
+    const __m128i second = _mm_unpacklo_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(colors[2])),
+                                              _mm_loadl_epi64(reinterpret_cast<const __m128i*>(colors[3])));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(palette),
+                     _mm_packus_epi16(_mm_adds_epi16(first, firstOffsets), _mm_adds_epi16(second, secondOffsets)));
+#elif TEXTURE_DECODER_NEON
+    const int16_t rgbLanes[8] = {-1, -1, -1, 0, -1, -1, -1, 0};
+    const int16x8_t rgb = vld1q_s16(rgbLanes);
+    const int16x8_t firstOffsets = vandq_s16(vcombine_s16(vdup_n_s16(offsets[0]), vdup_n_s16(offsets[1])), rgb);
+    const int16x8_t secondOffsets = vandq_s16(vcombine_s16(vdup_n_s16(offsets[2]), vdup_n_s16(offsets[3])), rgb);
+    const int16x8_t first = vqaddq_s16(vcombine_s16(vld1_s16(colors[0]), vld1_s16(colors[1])), firstOffsets);
+    const int16x8_t second = vqaddq_s16(vcombine_s16(vld1_s16(colors[2]), vld1_s16(colors[3])), secondOffsets);
+    vst1q_u8(palette[0], vcombine_u8(vqmovun_s16(first), vqmovun_s16(second)));
+#else
+    for (int i = 0; i < 4; i++) {
+        for (int c = 0; c < 3; c++) {
+            palette[i][c] = clampByte(colors[i][c] + offsets[i]);
+        }
+        palette[i][3] = clampByte(colors[i][3]);
+    }
+#endif
+}
+
+void decodeEtc2Rgb(const uint8_t* block, uint8_t* rgba) {
+    const uint64_t bits = readBig64(block);
+    const bool differential = (bits >> 33) & 1;
+    const bool flip = (bits >> 32) & 1;
+    int16_t base[2][4] = {{0, 0, 0, 255}, {0, 0, 0, 255}};
+    if (!differential) {
+        for (int c = 0; c < 3; c++) {
+            base[0][c] = extend4(int(bits >> (60 - 8 * c)) & 15);
+            base[1][c] = extend4(int(bits >> (56 - 8 * c)) & 15);
+        }
+    } else {
+        int colors5[3];
+        int deltas[3];
+        for (int c = 0; c < 3; c++) {
+            colors5[c] = int(bits >> (59 - 8 * c)) & 31;
+            deltas[c] = int(bits >> (56 - 8 * c)) & 7;
+            deltas[c] = deltas[c] >= 4 ? deltas[c] - 8 : deltas[c];
+        }
+        const int r = colors5[0] + deltas[0];
+        const int g = colors5[1] + deltas[1];
+        const int b = colors5[2] + deltas[2];
+        if (r < 0 || r > 31) {
+            // T mode: two colors, the second gets +-distance
+            const int r1 = int((bits >> 59) & 3) << 2 | int((bits >> 56) & 3);
+            const int16_t color[2][4] = {
+                {extend4(r1), extend4(int(bits >> 52) & 15), extend4(int(bits >> 48) & 15), 255},
+                {extend4(int(bits >> 44) & 15), extend4(int(bits >> 40) & 15), extend4(int(bits >> 36) & 15), 255}
+            };
+            const int16_t distance = k_etcDistances[int((bits >> 34) & 3) << 1 | int((bits >> 32) & 1)];
+            const int16_t* colors[4] = {color[0], color[1], color[1], color[1]};
+            const int16_t offsets[4] = {0, distance, 0, int16_t(-distance)};
+            uint8_t palette[4][4];
+            offsetColors(colors, offsets, palette);
+            uint8_t indices[16] = {};
+            unpackEtcIndices(bits, indices);
+            lookupTexels(palette, 4, indices, rgba);
+            return;
+        }
+        if (g < 0 || g > 31) {
+            // H mode: two colors, both get +-distance; the order of the colors carries one more distance bit
+            const int r1 = int(bits >> 59) & 15;
+            const int g1 = int((bits >> 56) & 7) << 1 | int((bits >> 52) & 1);
+            const int b1 = int((bits >> 51) & 1) << 3 | int((bits >> 47) & 7);
+            const int r2 = int(bits >> 43) & 15;
+            const int g2 = int(bits >> 39) & 15;
+            const int b2 = int(bits >> 35) & 15;
+            const int16_t color[2][4] = {{extend4(r1), extend4(g1), extend4(b1), 255}, {extend4(r2), extend4(g2), extend4(b2), 255}};
+            const int value0 = r1 << 8 | g1 << 4 | b1;
+            const int value1 = r2 << 8 | g2 << 4 | b2;
+            const int distanceIndex = int((bits >> 34) & 1) << 2 | int((bits >> 32) & 1) << 1 | (value0 >= value1 ? 1 : 0);
+            const int16_t distance = k_etcDistances[distanceIndex];
+            const int16_t* colors[4] = {color[0], color[0], color[1], color[1]};
+            const int16_t offsets[4] = {distance, int16_t(-distance), distance, int16_t(-distance)};
+            uint8_t palette[4][4];
+            offsetColors(colors, offsets, palette);
+            uint8_t indices[16] = {};
+            unpackEtcIndices(bits, indices);
+            lookupTexels(palette, 4, indices, rgba);
+            return;
+        }
+        if (b < 0 || b > 31) {
+            // Planar mode: three colors (origin, horizontal, vertical) interpolated across the block. Every texel is
+            // its own color, there is no palette to expand.
+            const int ro = extend6(int(bits >> 57) & 63);
+            const int go = extend7(int((bits >> 56) & 1) << 6 | int((bits >> 49) & 63));
+            const int bo = extend6(int((bits >> 48) & 1) << 5 | int((bits >> 43) & 3) << 3 | int((bits >> 39) & 7));
+            const int rh = extend6(int((bits >> 34) & 31) << 1 | int((bits >> 32) & 1));
+            const int gh = extend7(int(bits >> 25) & 127);
+            const int bh = extend6(int(bits >> 19) & 63);
+            const int rv = extend6(int(bits >> 13) & 63);
+            const int gv = extend7(int(bits >> 6) & 127);
+            const int bv = extend6(int(bits) & 63);
+            for (int y = 0; y < 4; y++) {
+                for (int x = 0; x < 4; x++) {
+                    uint8_t* texel = rgba + (y * 4 + x) * 4;
+                    texel[0] = clampByte((x * (rh - ro) + y * (rv - ro) + 4 * ro + 2) >> 2);
+                    texel[1] = clampByte((x * (gh - go) + y * (gv - go) + 4 * go + 2) >> 2);
+                    texel[2] = clampByte((x * (bh - bo) + y * (bv - bo) + 4 * bo + 2) >> 2);
+                    texel[3] = 255;
+                }
+            }
+            return;
+        }
+        for (int c = 0; c < 3; c++) {
+            base[0][c] = extend5(colors5[c]);
+        }
+        base[1][0] = extend5(r);
+        base[1][1] = extend5(g);
+        base[1][2] = extend5(b);
+    }
+    // Individual / differential: two sub-blocks (2x4 or 4x2 with flip), each with a base color and modifier table.
+    // Index values 0, 1 are the positive modifiers, 2, 3 the negative ones (MSB set).
+    uint8_t palette[8][4];
+    for (int subBlock = 0; subBlock < 2; subBlock++) {
+        const int16_t* colors[4] = {base[subBlock], base[subBlock], base[subBlock], base[subBlock]};
+        const int table = int(bits >> (37 - 3 * subBlock)) & 7;
+        offsetColors(colors, k_etcModifiers[table], palette + subBlock * 4);
+    }
+    uint8_t indices[16];
+    std::memcpy(indices, k_etcSubBlockEntries[flip ? 1 : 0], sizeof(indices));
+    unpackEtcIndices(bits, indices);
+    lookupTexels(palette, 8, indices, rgba);
+}
+
+const int16_t k_eacModifiers[16][8] = {
+    {-3, -6, -9, -15, 2, 5, 8, 14}, {-3, -7, -10, -13, 2, 6, 9, 12}, {-2, -5, -8, -13, 1, 4, 7, 12},
+    {-2, -4, -6, -13, 1, 3, 5, 12}, {-3, -6, -8, -12, 2, 5, 7, 11}, {-3, -7, -9, -11, 2, 6, 8, 10},
+    {-4, -7, -8, -11, 3, 6, 7, 10}, {-3, -5, -8, -11, 2, 4, 7, 10}, {-2, -6, -8, -10, 1, 5, 7, 9},
+    {-2, -5, -8, -10, 1, 4, 7, 9}, {-2, -4, -8, -10, 1, 3, 7, 9}, {-2, -5, -7, -10, 1, 4, 6, 9},
+    {-3, -4, -7, -10, 2, 3, 6, 9}, {-1, -2, -3, -10, 0, 1, 2, 9}, {-4, -6, -8, -9, 3, 5, 7, 8},
+    {-3, -5, -7, -9, 2, 4, 6, 8}
+};
+
+// values[i] = base + modifiers[i] * multiplier, clamped
+void expandEacValues(int base, int multiplier, const int16_t* modifiers, uint8_t* values) {
+#if TEXTURE_DECODER_AVX || TEXTURE_DECODER_SSE
+    const __m128i scaled = _mm_mullo_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(modifiers)), _mm_set1_epi16(short(multiplier)));
+    const __m128i sum = _mm_add_epi16(_mm_set1_epi16(short(base)), scaled);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(values), _mm_packus_epi16(sum, sum));
+#elif TEXTURE_DECODER_NEON
+    vst1_u8(values, vqmovun_s16(vmlaq_n_s16(vdupq_n_s16(int16_t(base)), vld1q_s16(modifiers), int16_t(multiplier))));
+#else
+    for (int i = 0; i < 8; i++) {
+        values[i] = clampByte(base + modifiers[i] * multiplier);
+    }
+#endif
+}
+
+// EAC alpha of ETC2 RGBA8: base, multiplier, modifier table and 3 bit indices stored column by column
+void decodeEacAlpha(const uint8_t* block, uint8_t* rgba) {
+    const uint64_t bits = readBig64(block);
+    uint8_t values[8];
+    expandEacValues(int(bits >> 56) & 255, int(bits >> 52) & 15, k_eacModifiers[int(bits >> 48) & 15], values);
+    uint8_t indices[16] = {};
+    unpackFields(bits, k_eacIndices, indices);
+    lookupChannel(values, indices, rgba, 3);
+}
+
+} // namespace
+
+size_t blockSize(BlockFormat format) {
+    switch (format) {
+    case BlockFormat::Bc1:
+    case BlockFormat::Bc4:
+    case BlockFormat::Etc2Rgb:
+        return 8;
+    default:
+        return 16;
+    }
+}
+
+void decodeBlock(BlockFormat format, const uint8_t* block, uint8_t* rgba) {
+    switch (format) {
+    case BlockFormat::Bc1:
+        decodeBc1Colors(block, rgba, true);
+        break;
+    case BlockFormat::Bc3:
+        decodeBc1Colors(block + 8, rgba, false);
+        decodeBc4Channel(block, rgba, 3);
+        break;
+    case BlockFormat::Bc4:
+    case BlockFormat::Bc5:
+        for (int i = 0; i < 16; i++) {
+            rgba[i * 4 + 0] = 0;
+            rgba[i * 4 + 1] = 0;
+            rgba[i * 4 + 2] = 0;
+            rgba[i * 4 + 3] = 255;
+        }
+        decodeBc4Channel(block, rgba, 0);
+        if (format == BlockFormat::Bc5) {
+            decodeBc4Channel(block + 8, rgba, 1);
+        }
+        break;
+    case BlockFormat::Etc2Rgb:
+        decodeEtc2Rgb(block, rgba);
+        break;
+    case BlockFormat::Etc2Rgba:
+        decodeEtc2Rgb(block + 8, rgba);
+        decodeEacAlpha(block, rgba);
+        break;
+    }
+}
+
+void decodeImage(BlockFormat format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* rgba, JobSystem& jobs) {
+    const uint32_t blocksX = (width + 3) / 4;
+    const uint32_t blocksY = (height + 3) / 4;
+    const size_t size = blockSize(format);
+    auto decodeRows = [=](uint32_t firstRow, uint32_t endRow) {
+        uint8_t texels[16 * 4];
+        for (uint32_t by = firstRow; by < endRow; by++) {
+            for (uint32_t bx = 0; bx < blocksX; bx++) {
+                decodeBlock(format, blocks + (size_t(by) * blocksX + bx) * size, texels);
+                // Edge blocks only partially cover the image
+                const uint32_t columns = std::min(4u, width - bx * 4);
+                const uint32_t rows = std::min(4u, height - by * 4);
+                for (uint32_t y = 0; y < rows; y++) {
+                    std::memcpy(rgba + ((size_t(by) * 4 + y) * width + bx * 4) * 4, texels + y * 16, columns * 4);
+                }
+            }
+        }
+    };
+    // 16 block rows per job, small levels aren't worth more than one
+    jobs.parallelFor(blocksY, 16, decodeRows);
+}
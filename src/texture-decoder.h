@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class JobSystem;
+
+// CPU decoders for the block compressed formats a device may lack: BC1, BC3, BC4, BC5 (desktop formats missing on most
+// phones) and ETC2 RGB8, RGBA8 (mobile formats missing on most desktop GPUs). ASTC and BC6H/BC7 have no CPU fallback.
+enum class BlockFormat {
+    Bc1,     // RGB(A) with 1 bit alpha, 8 byte blocks
+    Bc3,     // BC1 color + interpolated alpha, 16 byte blocks
+    Bc4,     // one interpolated channel, decoded to red, 8 byte blocks
+    Bc5,     // two interpolated channels, decoded to red and green, 16 byte blocks
+    Etc2Rgb, // ETC1 compatible plus the T, H and planar modes, 8 byte blocks
+    Etc2Rgba // EAC alpha + ETC2 RGB, 16 byte blocks
+};
+
+size_t blockSize(BlockFormat format);
+
+// Decodes one 4x4 block into 16 RGBA8 texels, row by row
+void decodeBlock(BlockFormat format, const uint8_t* block, uint8_t* rgba);
+
+// Decodes a whole image of width x height texels (blocks are 4x4, partial at the edges) into tightly packed RGBA8.
+// The block rows are split into jobs.
+void decodeImage(BlockFormat format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* rgba, JobSystem& jobs);
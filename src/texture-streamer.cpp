@@ -0,0 +1,423 @@
+#include "texture-streamer.h"
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <stdexcept>
+
+// Level 0 rows uploaded per frame, so a large texture doesn't stall a frame on the CPU copy or the ring
+static constexpr vk::DeviceSize k_uploadBytesPerFrame = 4 * 1024 * 1024;
+static constexpr vk::DeviceSize k_stagingRingSize = 16 * 1024 * 1024;
+
+static vk::ImageSubresourceRange colorLevels(uint32_t baseLevel, uint32_t levelCount) {
+    return vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, baseLevel, levelCount, 0, 1);
+}
+
+static void imageBarrier(vk::CommandBuffer commandBuffer, vk::Image image, vk::ImageSubresourceRange range,
+                         vk::ImageLayout oldLayout, vk::ImageLayout newLayout, vk::AccessFlags srcAccess, vk::AccessFlags dstAccess,
+                         vk::PipelineStageFlags srcStage, vk::PipelineStageFlags dstStage,
+                         uint32_t srcQueueFamily = VK_QUEUE_FAMILY_IGNORED, uint32_t dstQueueFamily = VK_QUEUE_FAMILY_IGNORED) {
+    vk::ImageMemoryBarrier barrier(srcAccess, dstAccess, oldLayout, newLayout, srcQueueFamily, dstQueueFamily, image, range);
+    commandBuffer.pipelineBarrier(srcStage, dstStage, {}, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+TextureStreamer::TextureStreamer(vk::PhysicalDevice physicalDevice, vk::Device device, uint32_t graphicsFamily,
+                                 vk::Queue transferQueue, uint32_t transferFamily, vk::DeviceSize budget, uint32_t framesInFlight)
+    : physicalDevice(physicalDevice), device(device), graphicsFamily(graphicsFamily), transferFamily(transferFamily),
+      memoryBudget(budget), framesInFlight(framesInFlight) {
+    stagingRing = std::make_unique<StagingRing>(physicalDevice, device, transferQueue, transferFamily, k_stagingRingSize);
+
+    vk::SamplerCreateInfo samplerInfo{};
+    samplerInfo.setMagFilter(vk::Filter::eLinear)
+        .setMinFilter(vk::Filter::eLinear)
+        .setMipmapMode(vk::SamplerMipmapMode::eLinear)
+        .setAddressModeU(vk::SamplerAddressMode::eRepeat)
+        .setAddressModeV(vk::SamplerAddressMode::eRepeat)
+        .setAddressModeW(vk::SamplerAddressMode::eRepeat)
+        .setMaxLod(VK_LOD_CLAMP_NONE); // levels come and go, the image view decides which ones exist
+    linearSampler = device.createSampler(samplerInfo);
+    placeholder = createImage(vk::Format::eR8G8B8A8Unorm, 1, 1, 1, vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled, true);
+    stats.budget = budget;
+}
+
+TextureStreamer::~TextureStreamer() {
+    stagingRing.reset(); // waits for its uploads
+    if (streamIn) {
+        destroyImage(streamIn->image);
+        destroyImage(streamIn->scratch);
+    }
+    for (auto& entry : retired) {
+        destroyImage(entry.image);
+    }
+    for (auto& texture : textures) {
+        destroyImage(texture.resident);
+    }
+    destroyImage(placeholder);
+    device.destroySampler(linearSampler);
+}
+
+TextureStreamer::Handle TextureStreamer::addTexture(const TextureSource& source) {
+    Texture texture;
+    texture.source = source;
+    texture.width = source.width;
+    texture.height = source.height;
+    texture.mipCount = static_cast<uint32_t>(source.levels.size());
+    if (source.generateMips) {
+        const auto features = physicalDevice.getFormatProperties(source.format).optimalTilingFeatures;
+        const vk::FormatFeatureFlags blit = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst;
+        if ((features & blit) != blit) {
+            throw std::runtime_error("the texture format doesn't support blits, mip levels can't be generated");
+        }
+        if (!(features & vk::FormatFeatureFlagBits::eSampledImageFilterLinear)) {
+            texture.mipFilter = vk::Filter::eNearest;
+        }
+        texture.mipCount = 0;
+        for (uint32_t size = std::max(texture.width, texture.height); size > 0; size >>= 1) {
+            texture.mipCount++;
+        }
+    }
+    texture.requestedMip = texture.mipCount - 1; // the smallest level until someone asks for more
+    textures.push_back(texture);
+    return static_cast<Handle>(textures.size() - 1);
+}
+
+void TextureStreamer::request(Handle texture, uint32_t finestUsefulMip, float priority) {
+    textures[texture].requestedMip = std::min(finestUsefulMip, textures[texture].mipCount - 1);
+    textures[texture].priority = priority;
+}
+
+vk::ImageView TextureStreamer::view(Handle texture) const {
+    return textures[texture].residentMip == k_notResident ? placeholder.view : textures[texture].resident.view;
+}
+
+bool TextureStreamer::busy() const {
+    if (streamIn) {
+        return true;
+    }
+    return std::any_of(textures.begin(), textures.end(), [](const Texture& texture) {
+        return texture.targetMip != k_notResident && texture.targetMip < texture.residentMip;
+    });
+}
+
+TextureStreamer::Statistics TextureStreamer::statistics() const {
+    Statistics result = stats;
+    for (const auto& texture : textures) {
+        result.residentBytes += texture.resident.size;
+    }
+    return result;
+}
+
+void TextureStreamer::recordStreaming(vk::CommandBuffer commandBuffer, uint64_t frame) {
+    if (!placeholderReady) {
+        initializePlaceholder(commandBuffer);
+    }
+    while (!retired.empty() && frame >= retired.front().frame + framesInFlight) {
+        destroyImage(retired.front().image);
+        retired.pop_front();
+    }
+
+    plan();
+    // Eviction first, it frees the memory a stream-in may need
+    for (Handle i = 0; i < textures.size(); i++) {
+        Texture& texture = textures[i];
+        if (texture.residentMip == k_notResident || (streamIn && streamIn->texture == i)) {
+            continue;
+        }
+        if (texture.targetMip == k_notResident) {
+            retire(texture.resident, frame);
+            texture.residentMip = k_notResident;
+            stats.evictions++;
+        } else if (texture.targetMip > texture.residentMip) {
+            evict(commandBuffer, i, texture.targetMip, frame);
+        }
+    }
+
+    if (streamIn) {
+        if (!streamIn->uploaded) {
+            uploadRows();
+        } else if (stagingRing->isComplete(streamIn->uploadSerial)) {
+            finishStreamIn(commandBuffer, frame);
+        }
+        return;
+    }
+
+    // One stream-in at a time, the most important texture that wants finer levels than it has
+    vk::DeviceSize committed = 0;
+    for (const auto& texture : textures) {
+        committed += texture.residentMip == k_notResident ? 0 : levelBytes(texture, texture.residentMip);
+    }
+    std::optional<Handle> next;
+    for (Handle i = 0; i < textures.size(); i++) {
+        const Texture& texture = textures[i];
+        if (texture.targetMip == k_notResident || texture.targetMip >= texture.residentMip) {
+            continue;
+        }
+        const vk::DeviceSize current = texture.residentMip == k_notResident ? 0 : levelBytes(texture, texture.residentMip);
+        if (committed - current + levelBytes(texture, texture.targetMip) > memoryBudget) {
+            continue;
+        }
+        if (!next || texture.priority > textures[*next].priority) {
+            next = i;
+        }
+    }
+    if (next) {
+        startStreamIn(*next, textures[*next].targetMip);
+        uploadRows();
+    }
+}
+
+// Splits the budget by priority: every texture gets its requested levels (or the ones it already has, so nothing is
+// dropped without pressure) as long as they fit, the rest get coarser levels or nothing.
+void TextureStreamer::plan() {
+    std::vector<Handle> order(textures.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](Handle a, Handle b) { return textures[a].priority > textures[b].priority; });
+    vk::DeviceSize remaining = memoryBudget;
+    for (Handle i : order) {
+        Texture& texture = textures[i];
+        uint32_t mip = std::min(texture.requestedMip, texture.residentMip);
+        while (mip + 1 < texture.mipCount && levelBytes(texture, mip) > remaining) {
+            mip++;
+        }
+        if (levelBytes(texture, mip) > remaining) {
+            texture.targetMip = k_notResident;
+            continue;
+        }
+        texture.targetMip = mip;
+        remaining -= levelBytes(texture, mip);
+    }
+}
+
+void TextureStreamer::startStreamIn(Handle handle, uint32_t mip) {
+    const Texture& texture = textures[handle];
+    const vk::Format format = texture.source.format;
+    StreamIn work;
+    work.texture = handle;
+    work.mip = mip;
+    work.level = texture.source.generateMips ? 0 : mip;
+    work.image = createImage(format, std::max(texture.width >> mip, 1u), std::max(texture.height >> mip, 1u), texture.mipCount - mip,
+                             vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled, true);
+    if (texture.source.generateMips && mip > 0) {
+        work.scratch = createImage(format, texture.width, texture.height, mip + 1,
+                                   vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst, false);
+    }
+    streamIn = work;
+    imageBarrier(stagingRing->commandBuffer(), uploadTarget(), uploadRange(), vk::ImageLayout::eUndefined,
+                 vk::ImageLayout::eTransferDstOptimal, {}, vk::AccessFlagBits::eTransferWrite,
+                 vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer);
+}
+
+// Generated levels only need level 0 uploaded, into the scratch image when the finest levels aren't kept
+vk::Image TextureStreamer::uploadTarget() const {
+    return streamIn->scratch.image ? streamIn->scratch.image : streamIn->image.image;
+}
+
+vk::ImageSubresourceRange TextureStreamer::uploadRange() const {
+    const Texture& texture = textures[streamIn->texture];
+    return texture.source.generateMips ? colorLevels(0, 1) : colorLevels(0, texture.mipCount - streamIn->mip);
+}
+
+void TextureStreamer::uploadRows() {
+    const Texture& texture = textures[streamIn->texture];
+    const TextureSource& source = texture.source;
+    const uint32_t lastLevel = source.generateMips ? 0 : texture.mipCount - 1;
+    vk::DeviceSize bytes = 0;
+    while (!streamIn->uploaded && bytes < k_uploadBytesPerFrame) {
+        const uint32_t level = streamIn->level;
+        const uint32_t width = std::max(texture.width >> level, 1u);
+        const uint32_t height = std::max(texture.height >> level, 1u);
+        const uint32_t blockRows = (height + source.blockHeight - 1) / source.blockHeight;
+        const vk::DeviceSize rowSize = vk::DeviceSize((width + source.blockWidth - 1) / source.blockWidth) * source.blockSize;
+        const uint32_t rows = std::min(blockRows - streamIn->rowsUploaded,
+                                       static_cast<uint32_t>(std::max<vk::DeviceSize>((k_uploadBytesPerFrame - bytes) / rowSize, 1)));
+        const uint32_t targetLevel = source.generateMips ? 0 : level - streamIn->mip;
+        stagingRing->copyToImage(source.levels[level] + streamIn->rowsUploaded * rowSize, width, height, streamIn->rowsUploaded, rows,
+                                 rowSize, source.blockHeight, uploadTarget(), targetLevel);
+        streamIn->rowsUploaded += rows;
+        bytes += rows * rowSize;
+        if (streamIn->rowsUploaded == blockRows) {
+            streamIn->rowsUploaded = 0;
+            streamIn->uploaded = level == lastLevel;
+            streamIn->level++;
+        }
+    }
+    stats.uploadedBytes += bytes;
+    if (streamIn->uploaded && transferFamily != graphicsFamily) {
+        // Release to the graphics queue, finishStreamIn() records the matching acquire
+        imageBarrier(stagingRing->commandBuffer(), uploadTarget(), uploadRange(), vk::ImageLayout::eTransferDstOptimal,
+                     vk::ImageLayout::eTransferDstOptimal, vk::AccessFlagBits::eTransferWrite, {},
+                     vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, transferFamily, graphicsFamily);
+    }
+    streamIn->uploadSerial = stagingRing->flush();
+}
+
+void TextureStreamer::finishStreamIn(vk::CommandBuffer commandBuffer, uint64_t frame) {
+    Texture& texture = textures[streamIn->texture];
+    const uint32_t mip = streamIn->mip;
+    if (transferFamily != graphicsFamily) {
+        imageBarrier(commandBuffer, uploadTarget(), uploadRange(), vk::ImageLayout::eTransferDstOptimal,
+                     vk::ImageLayout::eTransferDstOptimal, {}, vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite,
+                     vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, transferFamily, graphicsFamily);
+    }
+    const uint32_t width = std::max(texture.width >> mip, 1u);
+    const uint32_t height = std::max(texture.height >> mip, 1u);
+    if (!texture.source.generateMips) {
+        // Every level was uploaded
+        imageBarrier(commandBuffer, streamIn->image.image, colorLevels(0, texture.mipCount - mip), vk::ImageLayout::eTransferDstOptimal,
+                     vk::ImageLayout::eShaderReadOnlyOptimal, vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+                     vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader);
+    } else {
+        finishGeneratedLevels(commandBuffer, width, height);
+    }
+
+    if (texture.residentMip != k_notResident) {
+        retire(texture.resident, frame);
+    }
+    retire(streamIn->scratch, frame);
+    texture.resident = streamIn->image;
+    texture.residentMip = mip;
+    streamIn.reset();
+    stats.streamedIn++;
+}
+
+void TextureStreamer::finishGeneratedLevels(vk::CommandBuffer commandBuffer, uint32_t width, uint32_t height) {
+    const Texture& texture = textures[streamIn->texture];
+    const uint32_t mip = streamIn->mip;
+    if (mip > 0) {
+        // Downsample level 0 to the first kept level in the scratch image, then continue from there in the real one
+        generateMips(commandBuffer, streamIn->scratch.image, texture.width, texture.height, mip + 1, texture.mipFilter);
+        imageBarrier(commandBuffer, streamIn->image.image, colorLevels(0, 1), vk::ImageLayout::eUndefined,
+                     vk::ImageLayout::eTransferDstOptimal, {}, vk::AccessFlagBits::eTransferWrite,
+                     vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer);
+        vk::ImageCopy region(vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, mip, 0, 1), {},
+                             vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1), {}, vk::Extent3D(width, height, 1));
+        commandBuffer.copyImage(streamIn->scratch.image, vk::ImageLayout::eTransferSrcOptimal, streamIn->image.image,
+                                vk::ImageLayout::eTransferDstOptimal, 1, &region);
+    }
+    generateMips(commandBuffer, streamIn->image.image, width, height, texture.mipCount - mip, texture.mipFilter);
+    imageBarrier(commandBuffer, streamIn->image.image, colorLevels(0, texture.mipCount - mip), vk::ImageLayout::eTransferSrcOptimal,
+                 vk::ImageLayout::eShaderReadOnlyOptimal, vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+                 vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader);
+}
+
+// Keeps the levels from mip on: they are copied into a smaller image, the old one is retired
+void TextureStreamer::evict(vk::CommandBuffer commandBuffer, Handle handle, uint32_t mip, uint64_t frame) {
+    Texture& texture = textures[handle];
+    const uint32_t skipped = mip - texture.residentMip;
+    const uint32_t levelCount = texture.mipCount - mip;
+    Image smaller = createImage(texture.source.format, std::max(texture.width >> mip, 1u), std::max(texture.height >> mip, 1u), levelCount,
+                                vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled, true);
+    // Earlier frames may still be sampling the old image, the barrier waits for their fragment shaders
+    imageBarrier(commandBuffer, texture.resident.image, colorLevels(skipped, levelCount), vk::ImageLayout::eShaderReadOnlyOptimal,
+                 vk::ImageLayout::eTransferSrcOptimal, {}, vk::AccessFlagBits::eTransferRead,
+                 vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eTransfer);
+    imageBarrier(commandBuffer, smaller.image, colorLevels(0, levelCount), vk::ImageLayout::eUndefined,
+                 vk::ImageLayout::eTransferDstOptimal, {}, vk::AccessFlagBits::eTransferWrite,
+                 vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer);
+    std::vector<vk::ImageCopy> regions;
+    for (uint32_t level = 0; level < levelCount; level++) {
+        const vk::Extent3D extent(std::max(texture.width >> (mip + level), 1u), std::max(texture.height >> (mip + level), 1u), 1);
+        regions.push_back(vk::ImageCopy(vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, skipped + level, 0, 1), {},
+                                        vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level, 0, 1), {}, extent));
+    }
+    commandBuffer.copyImage(texture.resident.image, vk::ImageLayout::eTransferSrcOptimal, smaller.image,
+                            vk::ImageLayout::eTransferDstOptimal, static_cast<uint32_t>(regions.size()), regions.data());
+    imageBarrier(commandBuffer, smaller.image, colorLevels(0, levelCount), vk::ImageLayout::eTransferDstOptimal,
+                 vk::ImageLayout::eShaderReadOnlyOptimal, vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+                 vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader);
+    retire(texture.resident, frame);
+    texture.resident = smaller;
+    texture.residentMip = mip;
+    stats.evictions++;
+}
+
+void TextureStreamer::initializePlaceholder(vk::CommandBuffer commandBuffer) {
+    imageBarrier(commandBuffer, placeholder.image, colorLevels(0, 1), vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+                 {}, vk::AccessFlagBits::eTransferWrite, vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer);
+    const vk::ClearColorValue white(std::array<float, 4>{1.0f, 1.0f, 1.0f, 1.0f});
+    const vk::ImageSubresourceRange range = colorLevels(0, 1);
+    commandBuffer.clearColorImage(placeholder.image, vk::ImageLayout::eTransferDstOptimal, &white, 1, &range);
+    imageBarrier(commandBuffer, placeholder.image, colorLevels(0, 1), vk::ImageLayout::eTransferDstOptimal,
+                 vk::ImageLayout::eShaderReadOnlyOptimal, vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+                 vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader);
+    placeholderReady = true;
+}
+
+// Expects level 0 in transfer destination layout, leaves every level in transfer source layout
+void TextureStreamer::generateMips(vk::CommandBuffer commandBuffer, vk::Image image, uint32_t width, uint32_t height, uint32_t levelCount,
+                                   vk::Filter filter) {
+    if (levelCount > 1) {
+        imageBarrier(commandBuffer, image, colorLevels(1, levelCount - 1), vk::ImageLayout::eUndefined,
+                     vk::ImageLayout::eTransferDstOptimal, {}, vk::AccessFlagBits::eTransferWrite,
+                     vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer);
+    }
+    for (uint32_t level = 0; level < levelCount; level++) {
+        imageBarrier(commandBuffer, image, colorLevels(level, 1), vk::ImageLayout::eTransferDstOptimal,
+                     vk::ImageLayout::eTransferSrcOptimal, vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferRead,
+                     vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer);
+        if (level + 1 == levelCount) {
+            break;
+        }
+        const int32_t srcWidth = static_cast<int32_t>(std::max(width >> level, 1u));
+        const int32_t srcHeight = static_cast<int32_t>(std::max(height >> level, 1u));
+        vk::ImageBlit blit;
+        blit.srcSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level, 0, 1);
+        blit.srcOffsets[1] = vk::Offset3D(srcWidth, srcHeight, 1);
+        blit.dstSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level + 1, 0, 1);
+        blit.dstOffsets[1] = vk::Offset3D(std::max(srcWidth / 2, 1), std::max(srcHeight / 2, 1), 1);
+        commandBuffer.blitImage(image, vk::ImageLayout::eTransferSrcOptimal, image, vk::ImageLayout::eTransferDstOptimal, 1, &blit, filter);
+    }
+}
+
+TextureStreamer::Image TextureStreamer::createImage(vk::Format format, uint32_t width, uint32_t height, uint32_t levelCount,
+                                                    vk::ImageUsageFlags usage, bool createView) {
+    Image result;
+    vk::ImageCreateInfo imageInfo({}, vk::ImageType::e2D, format, vk::Extent3D(width, height, 1), levelCount, 1,
+                                  vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal, usage, vk::SharingMode::eExclusive);
+    result.image = device.createImage(imageInfo);
+    auto memRequirements = device.getImageMemoryRequirements(result.image);
+    vk::MemoryAllocateInfo allocInfo(memRequirements.size, findMemoryType(memRequirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal));
+    result.memory = device.allocateMemory(allocInfo);
+    device.bindImageMemory(result.image, result.memory, 0);
+    result.size = memRequirements.size;
+    if (createView) {
+        vk::ImageViewCreateInfo viewInfo({}, result.image, vk::ImageViewType::e2D, format, {}, colorLevels(0, levelCount));
+        result.view = device.createImageView(viewInfo);
+    }
+    return result;
+}
+
+void TextureStreamer::destroyImage(Image& image) {
+    device.destroyImageView(image.view);
+    device.destroyImage(image.image);
+    device.freeMemory(image.memory);
+    image = Image{};
+}
+
+void TextureStreamer::retire(Image& image, uint64_t frame) {
+    if (image.image) {
+        retired.push_back({image, frame});
+    }
+    image = Image{};
+}
+
+vk::DeviceSize TextureStreamer::levelBytes(const Texture& texture, uint32_t mip) const {
+    vk::DeviceSize size = 0;
+    const TextureSource& source = texture.source;
+    for (uint32_t level = mip; level < texture.mipCount; level++) {
+        const vk::DeviceSize blocksX = (std::max(texture.width >> level, 1u) + source.blockWidth - 1) / source.blockWidth;
+        const vk::DeviceSize blocksY = (std::max(texture.height >> level, 1u) + source.blockHeight - 1) / source.blockHeight;
+        size += blocksX * blocksY * source.blockSize;
+    }
+    return size;
+}
+
+uint32_t TextureStreamer::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const {
+    auto memProperties = physicalDevice.getMemoryProperties();
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1u << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+    throw std::runtime_error("failed to find a memory type for a texture!");
+}
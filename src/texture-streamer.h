@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "staging-ring.h"
+#include "vulkan-common.h"
+
+// Texels of a texture, in memory that outlives the streamer (typically a file mapping). Either only level 0 in a
+// format the GPU can blit, the other levels are generated, or the stored mip levels in any format (e.g. block
+// compressed), which are uploaded as they are.
+struct TextureSource {
+    vk::Format format = vk::Format::eR8G8B8A8Srgb;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t blockWidth = 1; // texels per block, 1x1 for uncompressed formats
+    uint32_t blockHeight = 1;
+    uint32_t blockSize = 4;  // bytes per block
+    std::vector<const uint8_t*> levels; // level 0 first, tightly packed rows of blocks
+    bool generateMips = false;          // levels holds level 0 only, generate the full chain from it
+};
+
+// Keeps textures resident at the mip levels the renderer asks for, within a memory budget.
+//
+// Texels are uploaded through a staging ring on the transfer queue, a few megabytes per frame. Sources with stored
+// levels upload just the levels that are wanted. Sources with only level 0 get the rest of the mip chain generated on
+// the GPU with a chain of blits; when such a texture is wanted at a coarser level than 0, level 0 goes into a
+// transient scratch image, is downsampled there and only the wanted levels are kept. When the requests don't fit
+// into the budget, the lowest priority textures lose their finest levels: their remaining levels are copied into a
+// smaller image on the GPU, nothing is uploaded again.
+//
+// The graphics side of streaming (ownership acquire, blits, copies, layout transitions) is recorded into the frame's
+// command buffer before its render pass, so a texture switches to its new image within the frame that uses it.
+// Replaced images are destroyed once the frames in flight that may still sample them are done.
+// Not thread safe, everything is called on the render thread.
+class TextureStreamer {
+public:
+    using Handle = uint32_t;
+
+    TextureStreamer(vk::PhysicalDevice physicalDevice, vk::Device device, uint32_t graphicsFamily, vk::Queue transferQueue,
+                    uint32_t transferFamily, vk::DeviceSize budget, uint32_t framesInFlight);
+    ~TextureStreamer(); // the device has to be idle
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // The source's texels have to outlive the streamer
+    Handle addTexture(const TextureSource& source);
+    // This frame's demand: the finest mip level worth having (e.g. from the screen-space size) and how important the
+    // texture is relative to the others. Textures nobody asks for keep their last request.
+    void request(Handle texture, uint32_t finestUsefulMip, float priority);
+    // Once per frame, after the frame's fence wait and before its render pass: finishes streaming whose upload
+    // completed, evicts over budget, starts the next upload. `frame` counts the frames, it retires replaced images.
+    void recordStreaming(vk::CommandBuffer commandBuffer, uint64_t frame);
+
+    // The texture's current image, a 1x1 white placeholder while nothing is resident. Shader read-only layout.
+    vk::ImageView view(Handle texture) const;
+    vk::ImageView placeholderView() const { return placeholder.view; }
+    vk::Sampler sampler() const { return linearSampler; }
+    uint32_t mipCount(Handle texture) const { return textures[texture].mipCount; }
+    // Work is in flight or requests are still unmet, keep drawing frames to finish it
+    bool busy() const;
+
+    struct Statistics {
+        vk::DeviceSize budget = 0;
+        vk::DeviceSize residentBytes = 0;
+        uint64_t uploadedBytes = 0;
+        uint64_t streamedIn = 0; // completed stream-ins
+        uint64_t evictions = 0;  // textures that dropped their finest levels
+    };
+    Statistics statistics() const;
+
+private:
+    static constexpr uint32_t k_notResident = UINT32_MAX;
+
+    struct Image {
+        vk::Image image;
+        vk::DeviceMemory memory;
+        vk::ImageView view;
+        vk::DeviceSize size = 0;
+    };
+    struct Texture {
+        TextureSource source;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t mipCount = 0;
+        vk::Filter mipFilter = vk::Filter::eLinear; // for generated levels
+        Image resident;
+        uint32_t residentMip = k_notResident; // finest level of `resident`
+        uint32_t requestedMip = 0;
+        float priority = 0.0f;
+        uint32_t targetMip = k_notResident; // what the budget allows, set by plan()
+    };
+    // The one stream-in in flight: the stored levels from mip on (or level 0 only) go up block row by block row,
+    // then the GPU finishes the image
+    struct StreamIn {
+        Handle texture = 0;
+        uint32_t mip = 0;
+        Image image;
+        Image scratch;             // generated levels: level 0 and the levels down to mip, only when mip > 0
+        uint32_t level = 0;        // source level being uploaded
+        uint32_t rowsUploaded = 0; // of that level, in block rows
+        bool uploaded = false;
+        uint64_t uploadSerial = 0; // staging ring batch of the last rows
+    };
+    struct Retired {
+        Image image;
+        uint64_t frame = 0; // destroyed once this frame's successors in flight completed
+    };
+
+    void plan();
+    void startStreamIn(Handle texture, uint32_t mip);
+    void uploadRows();
+    vk::Image uploadTarget() const;
+    vk::ImageSubresourceRange uploadRange() const;
+    void finishStreamIn(vk::CommandBuffer commandBuffer, uint64_t frame);
+    void finishGeneratedLevels(vk::CommandBuffer commandBuffer, uint32_t width, uint32_t height);
+    void evict(vk::CommandBuffer commandBuffer, Handle texture, uint32_t mip, uint64_t frame);
+    void initializePlaceholder(vk::CommandBuffer commandBuffer);
+    void generateMips(vk::CommandBuffer commandBuffer, vk::Image image, uint32_t width, uint32_t height, uint32_t levelCount,
+                      vk::Filter filter);
+    Image createImage(vk::Format format, uint32_t width, uint32_t height, uint32_t levelCount, vk::ImageUsageFlags usage, bool createView);
+    void destroyImage(Image& image);
+    void retire(Image& image, uint64_t frame);
+    vk::DeviceSize levelBytes(const Texture& texture, uint32_t mip) const; // size of the levels from mip on
+    uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const;
+
+    vk::PhysicalDevice physicalDevice;
+    vk::Device device;
+    uint32_t graphicsFamily;
+    uint32_t transferFamily;
+    vk::DeviceSize memoryBudget;
+    uint32_t framesInFlight;
+    std::unique_ptr<StagingRing> stagingRing;
+    vk::Sampler linearSampler;
+    Image placeholder;
+    bool placeholderReady = false;
+    std::vector<Texture> textures;
+    std::optional<StreamIn> streamIn;
+    std::deque<Retired> retired;
+    Statistics stats;
+};
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cmath>
+
+// Just enough linear algebra for cameras and model transforms.
+// Matrices are column-major like GLSL's, so they can be pushed to shaders as they are.
+struct Vec3 {
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+};
+
+inline Vec3 operator+(Vec3 a, Vec3 b) { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+inline Vec3 operator-(Vec3 a, Vec3 b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+inline Vec3 operator*(Vec3 a, float s) { return {a.x * s, a.y * s, a.z * s}; }
+inline float dot(Vec3 a, Vec3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Vec3 cross(Vec3 a, Vec3 b) { return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x}; }
+inline float length(Vec3 v) { return std::sqrt(dot(v, v)); }
+inline Vec3 normalize(Vec3 v) {
+    float len = length(v);
+    return len > 0.0f ? v * (1.0f / len) : v;
+}
+
+struct Mat4 {
+    float m[16] = {1, 0, 0, 0,
+                   0, 1, 0, 0,
+                   0, 0, 1, 0,
+                   0, 0, 0, 1};
+
+    float& at(int column, int row) { return m[column * 4 + row]; }
+    float at(int column, int row) const { return m[column * 4 + row]; }
+};
+
+inline Mat4 operator*(const Mat4& a, const Mat4& b) {
+    Mat4 result;
+    for (int column = 0; column < 4; column++) {
+        for (int row = 0; row < 4; row++) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; k++) {
+                sum += a.at(k, row) * b.at(column, k);
+            }
+            result.at(column, row) = sum;
+        }
+    }
+    return result;
+}
+
+inline Vec3 transformPoint(const Mat4& matrix, Vec3 p) {
+    return {matrix.at(0, 0) * p.x + matrix.at(1, 0) * p.y + matrix.at(2, 0) * p.z + matrix.at(3, 0),
+            matrix.at(0, 1) * p.x + matrix.at(1, 1) * p.y + matrix.at(2, 1) * p.z + matrix.at(3, 1),
+            matrix.at(0, 2) * p.x + matrix.at(1, 2) * p.y + matrix.at(2, 2) * p.z + matrix.at(3, 2)};
+}
+
+inline Vec3 transformDirection(const Mat4& matrix, Vec3 d) {
+    return {matrix.at(0, 0) * d.x + matrix.at(1, 0) * d.y + matrix.at(2, 0) * d.z,
+            matrix.at(0, 1) * d.x + matrix.at(1, 1) * d.y + matrix.at(2, 1) * d.z,
+            matrix.at(0, 2) * d.x + matrix.at(1, 2) * d.y + matrix.at(2, 2) * d.z};
+}
+
+inline Mat4 translation(Vec3 t) {
+    Mat4 result;
+    result.at(3, 0) = t.x;
+    result.at(3, 1) = t.y;
+    result.at(3, 2) = t.z;
+    return result;
+}
+
+inline Mat4 scaling(Vec3 s) {
+    Mat4 result;
+    result.at(0, 0) = s.x;
+    result.at(1, 1) = s.y;
+    result.at(2, 2) = s.z;
+    return result;
+}
+
+// Counter-clockwise around z, from x towards y
+inline Mat4 rotationZ(float radians) {
+    const float c = std::cos(radians);
+    const float s = std::sin(radians);
+    Mat4 result;
+    result.at(0, 0) = c;
+    result.at(0, 1) = s;
+    result.at(1, 0) = -s;
+    result.at(1, 1) = c;
+    return result;
+}
+
+// Right handed, camera looks down -z
+inline Mat4 lookAt(Vec3 eye, Vec3 target, Vec3 up) {
+    Vec3 forward = normalize(target - eye);
+    Vec3 side = normalize(cross(forward, up));
+    Vec3 cameraUp = cross(side, forward);
+    Mat4 result;
+    result.at(0, 0) = side.x;     result.at(1, 0) = side.y;     result.at(2, 0) = side.z;
+    result.at(0, 1) = cameraUp.x; result.at(1, 1) = cameraUp.y; result.at(2, 1) = cameraUp.z;
+    result.at(0, 2) = -forward.x; result.at(1, 2) = -forward.y; result.at(2, 2) = -forward.z;
+    result.at(3, 0) = -dot(side, eye);
+    result.at(3, 1) = -dot(cameraUp, eye);
+    result.at(3, 2) = dot(forward, eye);
+    return result;
+}
+
+// Vulkan clip space: y points down and depth goes from 0 (near) to 1 (far)
+inline Mat4 perspective(float verticalFovRadians, float aspect, float nearPlane, float farPlane) {
+    const float f = 1.0f / std::tan(verticalFovRadians * 0.5f);
+    Mat4 result;
+    result.at(0, 0) = f / aspect;
+    result.at(1, 1) = -f;
+    result.at(2, 2) = farPlane / (nearPlane - farPlane);
+    result.at(2, 3) = -1.0f;
+    result.at(3, 2) = nearPlane * farPlane / (nearPlane - farPlane);
+    result.at(3, 3) = 0.0f;
+    return result;
+}
+
+// Frustum planes of a view-projection matrix with Vulkan depth (0..1), in the space the matrix transforms from.
+// Each plane is (normal, distance) with the normal pointing inwards and normalized, so a sphere is outside
+// when dot(normal, center) + distance < -radius for any plane. Order: left, right, bottom, top, near, far.
+inline void extractFrustumPlanes(const Mat4& viewProjection, float planes[6][4]) {
+    auto row = [&](int r, int c) { return viewProjection.at(c, r); };
+    for (int c = 0; c < 4; c++) {
+        planes[0][c] = row(3, c) + row(0, c);
+        planes[1][c] = row(3, c) - row(0, c);
+        planes[2][c] = row(3, c) + row(1, c);
+        planes[3][c] = row(3, c) - row(1, c);
+        planes[4][c] = row(2, c);
+        planes[5][c] = row(3, c) - row(2, c);
+    }
+    for (int p = 0; p < 6; p++) {
+        const float len = std::sqrt(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+        if (len > 0.0f) {
+            for (int c = 0; c < 4; c++) {
+                planes[p][c] /= len;
+            }
+        }
+    }
+}
@@ -0,0 +1,92 @@
+#include "video-recorder.h"
+
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <iostream>
+#include <stdexcept>
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include "logger.h"
+
+VideoRecorder::VideoRecorder(const std::string& path, YuvFormat format, uint32_t width, uint32_t height, double fps)
+    : format(format), size(frameSize(width, height)) {
+    if (path == "-") {
+        output = stdout;
+#if defined(_WIN32)
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        // Keep log messages out of the video stream: the logger is done with stdout when this returns, the header
+        // below is the first thing written to it
+        logger().redirectToStderr();
+        std::cout.rdbuf(std::cerr.rdbuf());
+    } else {
+        output = std::fopen(path.c_str(), "wb");
+        ownsOutput = true;
+    }
+    if (!output) {
+        throw std::runtime_error("Failed to open " + path + " for recording");
+    }
+#if !defined(_WIN32)
+    std::signal(SIGPIPE, SIG_IGN); // a reader closing the pipe has to surface as a write error
+#endif
+    if (format == YuvFormat::I420) {
+        // Frame rate as a fraction with millihertz precision, e.g. 60000:1000
+        const unsigned long rate = static_cast<unsigned long>(std::lround(fps * 1000.0));
+        std::fprintf(output, "YUV4MPEG2 W%u H%u F%lu:1000 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n", width, height, rate);
+    }
+    LOG("Recording " << width << "x" << height << (format == YuvFormat::I420 ? " I420 (Y4M)" : " NV12 (raw)") << " to " << path);
+    thread = std::thread(&VideoRecorder::run, this);
+}
+
+VideoRecorder::~VideoRecorder() {
+    stopping.store(true, std::memory_order_release);
+    wake.notify_one();
+    thread.join();
+    std::fflush(output);
+    if (ownsOutput) {
+        std::fclose(output);
+    }
+    LOG("Recorded " << framesWritten() << " frames");
+}
+
+bool VideoRecorder::submit(const uint8_t* planes, std::atomic<bool>* done) {
+    if (!jobs.tryPush(Job{planes, done})) {
+        return false;
+    }
+    // No lock here, a missed notification only delays the writer until its next timed wake-up
+    wake.notify_one();
+    return true;
+}
+
+void VideoRecorder::run() {
+    for (;;) {
+        Job job;
+        if (!jobs.tryPop(job)) {
+            // Drain everything that was submitted before shutting down
+            if (stopping.load(std::memory_order_acquire)) {
+                break;
+            }
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait_for(lock, std::chrono::milliseconds(10));
+            continue;
+        }
+        if (!failed) {
+            if (format == YuvFormat::I420) {
+                std::fputs("FRAME\n", output);
+            }
+            // The GPU wrote the planes in stream order, one write covers the whole frame
+            if (std::fwrite(job.planes, 1, size, output) == size) {
+                written.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                // A closed pipe ends the recording, not the application
+                failed = true;
+                LOG_ERROR("Recording stopped, writing the video stream failed");
+            }
+        }
+        job.done->store(true, std::memory_order_release); // the readback memory may be reused from now on
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "spsc-queue.h"
+
+enum class YuvFormat {
+    I420, // planar Y, U, V; streamed as Y4M
+    Nv12  // Y plane + interleaved UV plane; streamed as headerless raw video (Y4M can't carry it)
+};
+
+// Streams 4:2:0 frames that were converted on the GPU to a file or pipe ("-" writes to stdout).
+// Frames are written straight from the readback memory, so nothing gets allocated or copied per frame.
+class VideoRecorder {
+public:
+    // Throws if the output can't be opened
+    VideoRecorder(const std::string& path, YuvFormat format, uint32_t width, uint32_t height, double fps);
+    ~VideoRecorder();
+
+    static size_t frameSize(uint32_t width, uint32_t height) { return size_t(width) * height * 3 / 2; }
+
+    // Render thread only. Returns false when the writer is behind, the caller keeps ownership of the memory then.
+    bool submit(const uint8_t* planes, std::atomic<bool>* done);
+
+    uint64_t framesWritten() const { return written.load(std::memory_order_relaxed); }
+
+private:
+    struct Job {
+        const uint8_t* planes = nullptr;
+        std::atomic<bool>* done = nullptr;
+    };
+
+    void run();
+
+    FILE* output = nullptr;
+    bool ownsOutput = false;
+    YuvFormat format;
+    size_t size;
+    bool failed = false;
+    std::atomic<uint64_t> written{0};
+    SpscQueue<Job, 8> jobs;
+    std::atomic<bool> stopping{false};
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    std::thread thread;
+};
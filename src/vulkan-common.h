@@ -0,0 +1,24 @@
+#pragma once
+
+// Every translation unit that talks to Vulkan includes vulkan.hpp through here, so they all agree on the dispatch setup.
+#define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifdef __ANDROID__
+#include "vulkan-wrapper-patch.h"
+#include <vulkan_wrapper.h>
+#undef VK_NO_PROTOTYPES
+#endif
+#include <vulkan/vulkan.hpp>
+
+// Mesh shaders need SPIR-V 1.4 and therefore Vulkan 1.1, which is only requested on desktop
+#if defined(VK_EXT_mesh_shader) && !defined(__ANDROID__)
+#define NARU_MESH_SHADER_SUPPORT 1
+#endif
+
+// Conditional rendering (--occlusion-culling) needs its feature queried through Vulkan 1.1, which is only requested
+// on desktop. Without it the CPU skips the draw, a few frames later.
+#if defined(VK_EXT_conditional_rendering) && !defined(__ANDROID__)
+#define NARU_CONDITIONAL_RENDERING_SUPPORT 1
+#endif
@@ -0,0 +1,133 @@
+// Loads hand-built .nmesh files through MeshFile (see src/mesh-file.h): well-formed ones have to load, malformed ones
+// have to be rejected before anything reads through their counts and offsets.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "mesh-file.h"
+
+namespace {
+
+// `triangleCount` triangles over the same three vertices, 32 bit indices (written in indexSize). No meshlets unless
+// addMeshlet() is called.
+struct TestMesh {
+    MeshFileHeader header{};
+    std::vector<PackedVertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<MeshletDescriptor> meshlets;
+    std::vector<uint32_t> meshletVertices;
+    std::vector<uint32_t> meshletTriangles;
+
+    explicit TestMesh(uint32_t triangleCount = 1) {
+        std::memcpy(header.magic, MESH_FILE_MAGIC, sizeof(MESH_FILE_MAGIC));
+        header.version = MESH_FILE_VERSION;
+        header.vertexStride = sizeof(PackedVertex);
+        header.indexSize = 4;
+        vertices.resize(3);
+        for (uint32_t i = 0; i < triangleCount * 3; i++) {
+            indices.push_back(i % 3);
+        }
+    }
+
+    // One meshlet with the triangle
+    void addMeshlet() {
+        MeshletDescriptor meshlet{};
+        meshlet.coneCutoff = 1.0f;
+        meshlet.vertexOffset = static_cast<uint32_t>(meshletVertices.size());
+        meshlet.triangleOffset = static_cast<uint32_t>(meshletTriangles.size());
+        meshlet.vertexCount = 3;
+        meshlet.triangleCount = 1;
+        meshlets.push_back(meshlet);
+        meshletVertices.insert(meshletVertices.end(), {0, 1, 2});
+        meshletTriangles.push_back(0 | 1 << 8 | 2 << 16);
+    }
+
+    // Blocks at MESH_FILE_ALIGNMENT boundaries, like mesh-converter writes them
+    std::string write(const std::string& name) {
+        header.vertexCount = static_cast<uint32_t>(vertices.size());
+        header.indexCount = static_cast<uint32_t>(indices.size());
+        std::vector<uint8_t> bytes(sizeof(MeshFileHeader));
+        auto append = [&](const void* data, size_t size) {
+            bytes.resize((bytes.size() + MESH_FILE_ALIGNMENT - 1) / MESH_FILE_ALIGNMENT * MESH_FILE_ALIGNMENT);
+            const uint64_t offset = bytes.size();
+            bytes.insert(bytes.end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+            return offset;
+        };
+        header.vertexOffset = append(vertices.data(), vertices.size() * sizeof(PackedVertex));
+        if (header.indexSize == 2) {
+            const std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+            header.indexOffset = append(shortIndices.data(), shortIndices.size() * sizeof(uint16_t));
+        } else {
+            header.indexOffset = append(indices.data(), indices.size() * sizeof(uint32_t));
+        }
+        header.meshletCount = static_cast<uint32_t>(meshlets.size());
+        header.meshletVertexCount = static_cast<uint32_t>(meshletVertices.size());
+        header.meshletTriangleCount = static_cast<uint32_t>(meshletTriangles.size());
+        header.meshletOffset = append(meshlets.data(), meshlets.size() * sizeof(MeshletDescriptor));
+        header.meshletVertexOffset = append(meshletVertices.data(), meshletVertices.size() * sizeof(uint32_t));
+        header.meshletTriangleOffset = append(meshletTriangles.data(), meshletTriangles.size() * sizeof(uint32_t));
+        std::memcpy(bytes.data(), &header, sizeof(header));
+
+        const std::string path = (std::filesystem::temp_directory_path() / ("naru-mesh-file-test-" + name + ".nmesh")).string();
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        return path;
+    }
+};
+
+int failures = 0;
+
+void expect(const std::string& name, bool rejected, const std::function<void(TestMesh&)>& change) {
+    TestMesh mesh;
+    change(mesh);
+    const std::string path = mesh.write(name);
+    std::string error;
+    try {
+        MeshFile file(path);
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    std::remove(path.c_str());
+    if (error.empty() == rejected) {
+        std::cout << "FAIL " << name << (rejected ? ": loaded" : ": " + error) << std::endl;
+        failures++;
+    } else {
+        std::cout << "ok   " << name << std::endl;
+    }
+}
+
+}
+
+int main() {
+    expect("valid", false, [](TestMesh&) {});
+    expect("no-vertices", true, [](TestMesh& mesh) {
+        mesh.vertices.clear();
+        mesh.indices.clear();
+    });
+    expect("no-indices", true, [](TestMesh& mesh) { mesh.indices.clear(); });
+    expect("index-beyond-vertices", true, [](TestMesh& mesh) { mesh.indices[1] = 3; });
+    expect("16-bit-indices", false, [](TestMesh& mesh) { mesh.header.indexSize = 2; });
+    expect("16-bit-index-beyond-vertices", true, [](TestMesh& mesh) {
+        mesh.header.indexSize = 2;
+        mesh.indices[2] = 3;
+    });
+    expect("meshlets", false, [](TestMesh& mesh) { mesh.addMeshlet(); });
+    expect("meshlet-vertex-beyond-vertices", true, [](TestMesh& mesh) {
+        mesh.addMeshlet();
+        mesh.meshletVertices[2] = 3;
+    });
+    expect("meshlet-triangle-beyond-meshlet-vertices", true, [](TestMesh& mesh) {
+        mesh.addMeshlet();
+        mesh.meshletTriangles[0] = 0 | 1 << 8 | 3 << 16;
+    });
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,250 @@
+// Decodes hand-built blocks through decodeBlock and decodeImage (see src/texture-decoder.h) and compares every texel
+// with reference values worked out by hand from the format specifications. Whichever SIMD path the build selects is
+// the one tested.
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "job-system.h"
+#include "texture-decoder.h"
+
+namespace {
+
+using Texel = std::array<int, 4>;
+using Pattern = std::function<int(int x, int y)>; // palette index of texel x, y
+
+int failures = 0;
+
+void expectBlock(const std::string& name, BlockFormat format, const std::vector<uint8_t>& block,
+                 const std::function<Texel(int x, int y)>& reference) {
+    uint8_t rgba[16 * 4];
+    decodeBlock(format, block.data(), rgba);
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            const uint8_t* texel = rgba + (y * 4 + x) * 4;
+            const Texel expected = reference(x, y);
+            if (texel[0] != expected[0] || texel[1] != expected[1] || texel[2] != expected[2] || texel[3] != expected[3]) {
+                std::cout << "FAIL " << name << ": texel " << x << "," << y << " is " << int(texel[0]) << " " << int(texel[1])
+                          << " " << int(texel[2]) << " " << int(texel[3]) << ", expected " << expected[0] << " "
+                          << expected[1] << " " << expected[2] << " " << expected[3] << std::endl;
+                failures++;
+                return;
+            }
+        }
+    }
+    std::cout << "ok   " << name << std::endl;
+}
+
+void appendLittle(std::vector<uint8_t>& bytes, uint64_t value, int count) {
+    for (int i = 0; i < count; i++) {
+        bytes.push_back(uint8_t(value >> (8 * i)));
+    }
+}
+
+void appendBig(std::vector<uint8_t>& bytes, uint64_t value) {
+    for (int i = 7; i >= 0; i--) {
+        bytes.push_back(uint8_t(value >> (8 * i)));
+    }
+}
+
+// RGB565 endpoints, 2 bit indices row by row
+std::vector<uint8_t> bc1Block(uint16_t c0, uint16_t c1, const Pattern& pattern) {
+    std::vector<uint8_t> block;
+    appendLittle(block, c0, 2);
+    appendLittle(block, c1, 2);
+    uint32_t indices = 0;
+    for (int i = 0; i < 16; i++) {
+        indices |= uint32_t(pattern(i % 4, i / 4)) << (2 * i);
+    }
+    appendLittle(block, indices, 4);
+    return block;
+}
+
+// 8 bit endpoints, 3 bit indices row by row
+std::vector<uint8_t> bc4Block(uint8_t a0, uint8_t a1, const Pattern& pattern) {
+    std::vector<uint8_t> block = {a0, a1};
+    uint64_t indices = 0;
+    for (int i = 0; i < 16; i++) {
+        indices |= uint64_t(pattern(i % 4, i / 4)) << (3 * i);
+    }
+    appendLittle(block, indices, 6);
+    return block;
+}
+
+// `high` holds bits 63 to 32 of the block (colors, tables, flags), the index LSB and MSB planes go column by column
+std::vector<uint8_t> etcBlock(uint32_t high, const Pattern& pattern) {
+    uint64_t bits = uint64_t(high) << 32;
+    for (int x = 0; x < 4; x++) {
+        for (int y = 0; y < 4; y++) {
+            const int index = pattern(x, y);
+            bits |= uint64_t(index & 1) << (x * 4 + y);
+            bits |= uint64_t(index >> 1) << (16 + x * 4 + y);
+        }
+    }
+    std::vector<uint8_t> block;
+    appendBig(block, bits);
+    return block;
+}
+
+// Base, multiplier, modifier table, 3 bit indices column by column from the top
+std::vector<uint8_t> eacBlock(uint8_t base, int multiplier, int table, const Pattern& pattern) {
+    uint64_t bits = uint64_t(base) << 56 | uint64_t(multiplier) << 52 | uint64_t(table) << 48;
+    for (int x = 0; x < 4; x++) {
+        for (int y = 0; y < 4; y++) {
+            bits |= uint64_t(pattern(x, y)) << (45 - 3 * (x * 4 + y));
+        }
+    }
+    std::vector<uint8_t> block;
+    appendBig(block, bits);
+    return block;
+}
+
+std::vector<uint8_t> concatenate(std::vector<uint8_t> first, const std::vector<uint8_t>& second) {
+    first.insert(first.end(), second.begin(), second.end());
+    return first;
+}
+
+// Every palette entry appears, in a different order in every row
+int diagonal4(int x, int y) { return (x + y) % 4; }
+int diagonal8(int x, int y) { return (x + 3 * y) % 8; }
+
+void testBc1() {
+    // c0 > c1: red, blue and two thirds in between
+    const Texel red4[4] = {{255, 0, 0, 255}, {0, 0, 255, 255}, {170, 0, 85, 255}, {85, 0, 170, 255}};
+    expectBlock("bc1-four-colors", BlockFormat::Bc1, bc1Block(0xf800, 0x001f, diagonal4),
+                [&](int x, int y) { return red4[diagonal4(x, y)]; });
+    // c0 <= c1: the midpoint and transparent black
+    const Texel blue3[4] = {{0, 0, 255, 255}, {255, 0, 0, 255}, {127, 0, 127, 255}, {0, 0, 0, 0}};
+    expectBlock("bc1-three-colors", BlockFormat::Bc1, bc1Block(0x001f, 0xf800, diagonal4),
+                [&](int x, int y) { return blue3[diagonal4(x, y)]; });
+    // Bit replication of the 5 and 6 bit channels: 16 -> 132, 32 -> 130
+    const Texel grey[4] = {{132, 130, 132, 255}, {0, 0, 0, 255}, {88, 86, 88, 255}, {44, 43, 44, 255}};
+    expectBlock("bc1-channel-expansion", BlockFormat::Bc1, bc1Block(0x8410, 0x0000, diagonal4),
+                [&](int x, int y) { return grey[diagonal4(x, y)]; });
+}
+
+void testBc3() {
+    // Alpha a0 > a1: 8 values in sevenths. The colors are always four, even with c0 <= c1.
+    const int alpha[8] = {255, 0, 218, 182, 145, 109, 72, 36};
+    const Texel colors[4] = {{0, 0, 255, 0}, {255, 0, 0, 0}, {85, 0, 170, 0}, {170, 0, 85, 0}};
+    const auto block = concatenate(bc4Block(255, 0, diagonal8), bc1Block(0x001f, 0xf800, diagonal4));
+    expectBlock("bc3", BlockFormat::Bc3, block, [&](int x, int y) {
+        Texel texel = colors[diagonal4(x, y)];
+        texel[3] = alpha[diagonal8(x, y)];
+        return texel;
+    });
+}
+
+void testBc4Bc5() {
+    // a0 <= a1: 6 values in fifths, then 0 and 255
+    const int fifths[8] = {0, 255, 51, 102, 153, 204, 0, 255};
+    expectBlock("bc4", BlockFormat::Bc4, bc4Block(0, 255, diagonal8),
+                [&](int x, int y) { return Texel{fifths[diagonal8(x, y)], 0, 0, 255}; });
+    // Green a0 > a1: 8 values in sevenths
+    const int sevenths[8] = {200, 100, 185, 171, 157, 142, 128, 114};
+    auto reversed = [](int x, int y) { return 7 - diagonal8(x, y); };
+    const auto block = concatenate(bc4Block(0, 255, diagonal8), bc4Block(200, 100, reversed));
+    expectBlock("bc5", BlockFormat::Bc5, block,
+                [&](int x, int y) { return Texel{fifths[diagonal8(x, y)], sevenths[reversed(x, y)], 0, 255}; });
+}
+
+void testEtc2() {
+    // Individual: 4 bit base colors 8 4 2 (136 68 34) and 1 15 0 (17 255 0), tables 0 and 7, left and right halves
+    const Texel individual[2][4] = {
+        {{138, 70, 36, 255}, {144, 76, 42, 255}, {134, 66, 32, 255}, {128, 60, 26, 255}},
+        {{64, 255, 47, 255}, {200, 255, 183, 255}, {0, 208, 0, 255}, {0, 72, 0, 255}}
+    };
+    expectBlock("etc2-individual", BlockFormat::Etc2Rgb, etcBlock(0x814f2000u | 0 << 5 | 7 << 2, diagonal4),
+                [&](int x, int y) { return individual[x >= 2][diagonal4(x, y)]; });
+    // Differential: 5 bit base 16 0 31 (132 0 255), deltas +3 0 -4 (156 0 222), tables 1 and 3, flipped: top and bottom
+    const Texel differential[2][4] = {
+        {{137, 5, 255, 255}, {149, 17, 255, 255}, {127, 0, 250, 255}, {115, 0, 238, 255}},
+        {{169, 13, 235, 255}, {198, 42, 255, 255}, {143, 0, 209, 255}, {114, 0, 180, 255}}
+    };
+    expectBlock("etc2-differential-flipped", BlockFormat::Etc2Rgb,
+                etcBlock(0x8300fc00u | 1 << 5 | 3 << 2 | 1 << 1 | 1, diagonal4),
+                [&](int x, int y) { return differential[y >= 2][diagonal4(x, y)]; });
+    // T mode (red overflows): 170 85 0, and 51 204 255 +- distance 32
+    const Texel t[4] = {{170, 85, 0, 255}, {83, 236, 255, 255}, {51, 204, 255, 255}, {19, 172, 223, 255}};
+    expectBlock("etc2-t-mode", BlockFormat::Etc2Rgb, etcBlock(0xf2503cf0u | 2 << 2 | 1 << 1 | 1, diagonal4),
+                [&](int x, int y) { return t[diagonal4(x, y)]; });
+    // H mode (green overflows): 204 102 51 and 34 153 238, each +- distance 16
+    const Texel h[4] = {{220, 118, 67, 255}, {188, 86, 35, 255}, {50, 169, 254, 255}, {18, 137, 222, 255}};
+    expectBlock("etc2-h-mode", BlockFormat::Etc2Rgb, etcBlock(0x630594f0u | 1 << 1 | 1, diagonal4),
+                [&](int x, int y) { return h[diagonal4(x, y)]; });
+}
+
+void testEtc2Eac() {
+    // EAC base 128, multiplier 3, table 13 over the differential block
+    const int alpha[8] = {125, 122, 119, 98, 128, 131, 134, 155};
+    const auto block = concatenate(eacBlock(128, 3, 13, diagonal8),
+                                   etcBlock(0x8300fc00u | 1 << 5 | 3 << 2 | 1 << 1 | 1, diagonal4));
+    const Texel differential[2][4] = {
+        {{137, 5, 255, 0}, {149, 17, 255, 0}, {127, 0, 250, 0}, {115, 0, 238, 0}},
+        {{169, 13, 235, 0}, {198, 42, 255, 0}, {143, 0, 209, 0}, {114, 0, 180, 0}}
+    };
+    expectBlock("etc2-eac", BlockFormat::Etc2Rgba, block, [&](int x, int y) {
+        Texel texel = differential[y >= 2][diagonal4(x, y)];
+        texel[3] = alpha[diagonal8(x, y)];
+        return texel;
+    });
+    // Base 250, multiplier 10, table 0: the values clamp at 255
+    const int clamped[8] = {220, 190, 160, 100, 255, 255, 255, 255};
+    const auto clampedBlock = concatenate(eacBlock(250, 10, 0, diagonal8),
+                                          etcBlock(0x8300fc00u | 1 << 5 | 3 << 2 | 1 << 1 | 1, diagonal4));
+    expectBlock("etc2-eac-clamped", BlockFormat::Etc2Rgba, clampedBlock, [&](int x, int y) {
+        Texel texel = differential[y >= 2][diagonal4(x, y)];
+        texel[3] = clamped[diagonal8(x, y)];
+        return texel;
+    });
+}
+
+// A 6x5 image: 2x2 blocks, the right and bottom ones only partially inside. Every block is one color.
+void testImage() {
+    const uint16_t colors[4] = {0xf800, 0x07e0, 0x001f, 0xffff};
+    const Texel expected[4] = {{255, 0, 0, 255}, {0, 255, 0, 255}, {0, 0, 255, 255}, {255, 255, 255, 255}};
+    std::vector<uint8_t> blocks;
+    for (uint16_t color : colors) {
+        const auto block = bc1Block(color, 0, [](int, int) { return 0; });
+        blocks.insert(blocks.end(), block.begin(), block.end());
+    }
+    const uint32_t width = 6;
+    const uint32_t height = 5;
+    std::vector<uint8_t> rgba(width * height * 4 + 4, 0xcd); // one texel past the end, which has to stay untouched
+    JobSystem jobs(2);
+    decodeImage(BlockFormat::Bc1, blocks.data(), width, height, rgba.data(), jobs);
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            const Texel& color = expected[(y / 4) * 2 + x / 4];
+            const uint8_t* texel = rgba.data() + (y * width + x) * 4;
+            if (texel[0] != color[0] || texel[1] != color[1] || texel[2] != color[2] || texel[3] != color[3]) {
+                std::cout << "FAIL image: texel " << x << "," << y << " has the wrong block's color" << std::endl;
+                failures++;
+                return;
+            }
+        }
+    }
+    if (rgba[width * height * 4] != 0xcd) {
+        std::cout << "FAIL image: written past the end" << std::endl;
+        failures++;
+        return;
+    }
+    std::cout << "ok   image" << std::endl;
+}
+
+}
+
+int main() {
+    testBc1();
+    testBc3();
+    testBc4Bc5();
+    testEtc2();
+    testEtc2Eac();
+    testImage();
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,33 @@
+#!/bin/sh
+# Checks that the recovery from a lost device returns while frames are being captured and recorded: the frames in
+# flight when the device is lost hold capture and recording slots that never complete, the recovery has to drop them
+# rather than wait for them. Needs a display, like any run of Naru.
+#
+#   tools/check-device-recovery.sh [path to Naru, default build/Naru]
+set -u
+
+naru=${1:-build/Naru}
+out=$(mktemp -d)
+trap 'rm -rf "$out"' EXIT
+
+# Frames 29 and 30 are in flight or pending at the loss, 60 is captured after the recovery and ends the run
+status=0
+timeout 60 "$naru" --continuous --lose-device-at 30 --capture-frames 29,30,60 --capture-dir "$out" --exit-after-capture \
+    --record "$out/video.y4m" || status=$?
+if [ "$status" -eq 124 ]; then
+    echo "FAIL: no exit within 60 s, the device loss recovery hangs"
+    exit 1
+elif [ "$status" -ne 0 ]; then
+    echo "FAIL: Naru exited with status $status"
+    exit 1
+fi
+if [ ! -f "$out/capture-60.png" ]; then
+    echo "FAIL: frame 60, after the recovery, wasn't captured"
+    exit 1
+fi
+frames=$(grep -a -c '^FRAME' "$out/video.y4m" || true)
+if [ "$frames" -lt 30 ]; then
+    echo "FAIL: $frames frames recorded, expected frames from before and after the recovery"
+    exit 1
+fi
+echo "OK: recovered, $frames frames recorded"
@@ -0,0 +1,100 @@
+#!/bin/sh
+# Checks that every Vulkan entry point the sources call is in NARU_INSTRUMENTED_VULKAN_FUNCTIONS, so
+# --profile-vulkan doesn't silently miss calls added later. Vulkan calls are recognized by the name of the handle
+# they are made through (see the receivers below) and mapped to their entry point the way vulkan.hpp names its
+# methods: commandBuffer.draw is vkCmdDraw, physicalDevice.getProperties vkGetPhysicalDeviceProperties. A handle
+# variable of a new name has to be added to the receivers to be checked.
+#
+#   tools/check-instrumented-dispatch.sh [path to src, default src]
+set -u
+
+src=${1:-src}
+list="$src/instrumented-dispatch.h"
+if [ ! -f "$list" ]; then
+    echo "FAIL: no $list"
+    exit 1
+fi
+
+listed=$(grep -o 'X(vk[A-Za-z0-9]*)' "$list" | sed 's/^X(//; s/)$//')
+
+# receiver.method( or receiver.method<...>( of every Vulkan handle, one "receiver method file:line" per call
+calls=$(grep -nE '\b(device|physicalDevice|bestScoredDevice|instance|commandBuffer(\(\))?|currentCommandBuffer\(\)|queue|graphicsQueue|presentQueue|transferQueue)\.[a-z][A-Za-z0-9]*[[:space:]]*[(<]' \
+            "$src"/*.cpp "$src"/*.h |
+        sed -E 's/^([^:]*:[0-9]+):.*/\1 &/' |
+        awk '{
+            location = $1
+            line = substr($0, length(location) + 2)
+            while (match(line, /(device|physicalDevice|bestScoredDevice|instance|commandBuffer(\(\))?|currentCommandBuffer\(\)|queue|graphicsQueue|presentQueue|transferQueue)\.[a-z][A-Za-z0-9]*[ \t]*[(<]/)) {
+                call = substr(line, RSTART, RLENGTH)
+                line = substr(line, RSTART + RLENGTH)
+                sub(/[ \t]*[(<]$/, "", call)
+                split(call, parts, ".")
+                print parts[1], parts[2], location
+            }
+        }')
+
+# Entry points a method of a receiver may stand for, several when a variable name is used for different handle types
+# (a physical device is called device while devices are picked)
+candidates() {
+    receiver=$1
+    method=$2
+    capitalized=$(printf '%s' "$method" | awk '{ print toupper(substr($0, 1, 1)) substr($0, 2) }')
+    case $receiver in
+        commandBuffer|"commandBuffer()"|"currentCommandBuffer()")
+            case $method in
+                begin) echo vkBeginCommandBuffer ;;
+                end) echo vkEndCommandBuffer ;;
+                reset) echo vkResetCommandBuffer ;;
+                *) echo "vkCmd$capitalized" ;;
+            esac ;;
+        queue|graphicsQueue|presentQueue|transferQueue)
+            echo "vkQueue$capitalized" ;;
+        instance)
+            case $method in
+                destroy) echo vkDestroyInstance ;;
+                *) echo "vk$capitalized" ;;
+            esac ;;
+        *)
+            # Device
+            case $method in
+                destroy) echo vkDestroyDevice ;;
+                waitIdle) echo vkDeviceWaitIdle ;;
+                getQueue) echo vkGetDeviceQueue ;;
+                createGraphicsPipeline) echo vkCreateGraphicsPipelines ;;
+                createComputePipeline) echo vkCreateComputePipelines ;;
+                *) echo "vk$capitalized" ;;
+            esac
+            # Physical device
+            case $method in
+                get*) echo "vkGetPhysicalDevice${capitalized#Get}" ;;
+            esac ;;
+    esac
+}
+
+status=0
+checked=0
+for entry in $(printf '%s\n' "$calls" | awk 'NF == 3 { print $1 "|" $2 "|" $3 }' | sort -u); do
+    receiver=${entry%%|*}
+    rest=${entry#*|}
+    method=${rest%%|*}
+    location=${rest#*|}
+    checked=$((checked + 1))
+    found=0
+    for name in $(candidates "$receiver" "$method"); do
+        if printf '%s\n' "$listed" | grep -qx "$name"; then
+            found=1
+        fi
+    done
+    if [ "$found" -eq 0 ]; then
+        echo "FAIL: $location calls $receiver.$method, $(candidates "$receiver" "$method" | tr '\n' ' ')isn't in NARU_INSTRUMENTED_VULKAN_FUNCTIONS"
+        status=1
+    fi
+done
+if [ "$checked" -eq 0 ]; then
+    echo "FAIL: no Vulkan calls found in $src"
+    exit 1
+fi
+if [ "$status" -eq 0 ]; then
+    echo "OK: $checked Vulkan call sites, all instrumented"
+fi
+exit $status
@@ -0,0 +1,196 @@
+// Micro-benchmark of the job system used by Naru (see src/job-system.h): scheduling cost per job and how the
+// throughput scales with the thread count, from one thread up to 64.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "job-system.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchmarkOptions {
+    uint32_t jobs = 1000000;
+    uint32_t maxThreads = std::min(64u, std::max(std::thread::hardware_concurrency(), 1u));
+    uint32_t repeats = 5; // the best run of each measurement is reported
+};
+
+void printUsage(const char* executable) {
+    std::cout << "Usage: " << executable << " [options]" << std::endl
+              << "  --jobs <n>        jobs per measurement (default 1000000)" << std::endl
+              << "  --max-threads <n> highest thread count measured, workers + the main thread (default: cores, at most 64)" << std::endl
+              << "  --repeats <n>     runs per measurement, the best one is reported (default 5)" << std::endl
+              << "  --help            show this message" << std::endl;
+}
+
+uint32_t parseCount(const std::string& option, const std::string& value) {
+    try {
+        size_t parsed = 0;
+        const unsigned long number = std::stoul(value, &parsed);
+        if (parsed == value.size() && number > 0) {
+            return static_cast<uint32_t>(number);
+        }
+    } catch (const std::exception&) {
+    }
+    throw std::runtime_error("Invalid value for " + option + ": " + value);
+}
+
+BenchmarkOptions parseCommandLine(int argc, char* argv[]) {
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        auto nextValue = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("Missing value for " + arg);
+            }
+            return argv[++i];
+        };
+        if (arg == "--jobs") {
+            options.jobs = parseCount(arg, nextValue());
+        } else if (arg == "--max-threads") {
+            options.maxThreads = std::min(parseCount(arg, nextValue()), 64u);
+        } else if (arg == "--repeats") {
+            options.repeats = parseCount(arg, nextValue());
+        } else if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            std::exit(EXIT_SUCCESS);
+        } else {
+            printUsage(argv[0]);
+            throw std::runtime_error("Unknown option: " + arg);
+        }
+    }
+    return options;
+}
+
+// Fixed amount of arithmetic the optimizer can't drop, a few microseconds
+uint32_t busyWork(uint32_t seed) {
+    uint32_t x = seed | 1;
+    for (int i = 0; i < 1000; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+    }
+    return x;
+}
+
+template <typename F>
+double bestNanoseconds(uint32_t repeats, const F& measure) {
+    double best = 1e300;
+    for (uint32_t i = 0; i < repeats; i++) {
+        const auto start = Clock::now();
+        measure();
+        best = std::min(best, std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+    }
+    return best;
+}
+
+struct Result {
+    uint32_t threads;
+    double spawnNs;      // per empty job started and waited for by the main thread alone
+    double fanOutNs;     // per empty job, started by jobs on every thread (wall time)
+    double computeNs;    // per busyWork job, wall time
+    double waveUs;       // per wave of one job per thread, each wave starting after the previous one finished
+    double stolenPercent;
+};
+
+Result measure(const BenchmarkOptions& options, uint32_t threads) {
+    JobSystem jobs(threads - 1);
+    Result result{};
+    result.threads = threads;
+    std::atomic<uint32_t> sink{0};
+
+    // One producer: the cost of starting, running and counting down a job that does nothing
+    result.spawnNs = bestNanoseconds(options.repeats, [&]() {
+        JobCounter counter;
+        for (uint32_t i = 0; i < options.jobs; i++) {
+            jobs.run([]() {}, &counter);
+        }
+        jobs.wait(counter);
+    }) / options.jobs;
+
+    // Every thread produces: a few jobs per thread each start a slice of the empty jobs into their own deque
+    const uint32_t producers = threads * 8;
+    result.fanOutNs = bestNanoseconds(options.repeats, [&]() {
+        JobCounter counter;
+        for (uint32_t p = 0; p < producers; p++) {
+            jobs.run([&jobs, &counter, &options, producers]() {
+                for (uint32_t i = 0; i < options.jobs / producers; i++) {
+                    jobs.run([]() {}, &counter);
+                }
+            }, &counter);
+        }
+        jobs.wait(counter);
+    }) / options.jobs;
+
+    const uint32_t computeJobs = std::max(options.jobs / 20, 1u);
+    result.computeNs = bestNanoseconds(options.repeats, [&]() {
+        jobs.parallelFor(computeJobs, 1, [&](uint32_t begin, uint32_t end) {
+            uint32_t value = 0;
+            for (uint32_t i = begin; i < end; i++) {
+                value += busyWork(i);
+            }
+            sink.fetch_add(value, std::memory_order_relaxed);
+        });
+    }) / computeJobs;
+
+    // Dependencies: every wave is parked on the previous wave's counter, which measures the wake-up latency
+    const uint32_t waves = std::max(options.jobs / 1000, 10u);
+    result.waveUs = bestNanoseconds(options.repeats, [&]() {
+        std::vector<JobCounter> counters(waves);
+        for (uint32_t w = 0; w < waves; w++) {
+            for (uint32_t t = 0; t < threads; t++) {
+                jobs.run([&sink, t]() { sink.fetch_add(busyWork(t) & 1, std::memory_order_relaxed); }, &counters[w],
+                         w > 0 ? &counters[w - 1] : nullptr);
+            }
+        }
+        jobs.wait(counters.back());
+        for (auto& counter : counters) {
+            jobs.wait(counter);
+        }
+    }) / waves / 1000.0;
+
+    const JobSystem::Statistics statistics = jobs.statistics();
+    result.stolenPercent = statistics.jobs > 0 ? 100.0 * double(statistics.stolen) / double(statistics.jobs) : 0.0;
+    return result;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        const BenchmarkOptions options = parseCommandLine(argc, argv);
+        std::cout << "Jobs per measurement: " << options.jobs << ", best of " << options.repeats << " runs, "
+                  << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+        std::cout << std::setw(8) << "threads" << std::setw(14) << "spawn ns/job" << std::setw(15) << "fan-out ns/job"
+                  << std::setw(16) << "compute ns/job" << std::setw(10) << "speedup" << std::setw(12) << "efficiency"
+                  << std::setw(10) << "wave us" << std::setw(9) << "stolen" << std::endl;
+        std::cout << std::fixed;
+        double singleThreadCompute = 0.0;
+        for (uint32_t threads = 1; threads <= options.maxThreads; threads = threads < options.maxThreads ? std::min(threads * 2, options.maxThreads) : threads + 1) {
+            const Result result = measure(options, threads);
+            if (threads == 1) {
+                singleThreadCompute = result.computeNs;
+            }
+            const double speedup = singleThreadCompute / result.computeNs;
+            std::cout << std::setw(8) << threads << std::setprecision(1) << std::setw(14) << result.spawnNs
+                      << std::setw(15) << result.fanOutNs << std::setw(16) << result.computeNs << std::setprecision(2)
+                      << std::setw(9) << speedup << "x" << std::setw(11) << 100.0 * speedup / threads << "%"
+                      << std::setw(10) << result.waveUs << std::setprecision(1) << std::setw(8) << result.stolenPercent
+                      << "%" << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,209 @@
+#include "json.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& text) : text(text) {}
+
+    JsonValue parseDocument() {
+        JsonValue value = parseValue();
+        skipWhitespace();
+        if (position != text.size()) {
+            fail("trailing characters");
+        }
+        return value;
+    }
+
+private:
+    [[noreturn]] void fail(const char* what) const {
+        throw std::runtime_error("JSON parse error at offset " + std::to_string(position) + ": " + what);
+    }
+
+    void skipWhitespace() {
+        while (position < text.size() && (text[position] == ' ' || text[position] == '\t' || text[position] == '\n' || text[position] == '\r')) {
+            position++;
+        }
+    }
+
+    bool consume(char c) {
+        skipWhitespace();
+        if (position < text.size() && text[position] == c) {
+            position++;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c) {
+        if (!consume(c)) {
+            fail("unexpected character");
+        }
+    }
+
+    bool consumeLiteral(const char* literal) {
+        const std::string word(literal);
+        if (text.compare(position, word.size(), word) == 0) {
+            position += word.size();
+            return true;
+        }
+        return false;
+    }
+
+    JsonValue parseValue() {
+        skipWhitespace();
+        if (position >= text.size()) {
+            fail("unexpected end of input");
+        }
+        JsonValue value;
+        const char c = text[position];
+        if (c == '{') {
+            value.valueType = JsonValue::Type::Object;
+            position++;
+            if (!consume('}')) {
+                do {
+                    skipWhitespace();
+                    std::string key = parseString();
+                    expect(':');
+                    value.members[key] = parseValue();
+                } while (consume(','));
+                expect('}');
+            }
+        } else if (c == '[') {
+            value.valueType = JsonValue::Type::Array;
+            position++;
+            if (!consume(']')) {
+                do {
+                    value.elements.push_back(parseValue());
+                } while (consume(','));
+                expect(']');
+            }
+        } else if (c == '"') {
+            value.valueType = JsonValue::Type::String;
+            value.stringValue = parseString();
+        } else if (consumeLiteral("true")) {
+            value.valueType = JsonValue::Type::Bool;
+            value.boolValue = true;
+        } else if (consumeLiteral("false")) {
+            value.valueType = JsonValue::Type::Bool;
+        } else if (consumeLiteral("null")) {
+        } else {
+            const char* begin = text.c_str() + position;
+            char* end = nullptr;
+            value.numberValue = std::strtod(begin, &end);
+            if (end == begin) {
+                fail("invalid value");
+            }
+            value.valueType = JsonValue::Type::Number;
+            position += static_cast<size_t>(end - begin);
+        }
+        return value;
+    }
+
+    static void appendUtf8(std::string& out, uint32_t codePoint) {
+        if (codePoint < 0x80) {
+            out += static_cast<char>(codePoint);
+        } else if (codePoint < 0x800) {
+            out += static_cast<char>(0xC0 | (codePoint >> 6));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else if (codePoint < 0x10000) {
+            out += static_cast<char>(0xE0 | (codePoint >> 12));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (codePoint >> 18));
+            out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+    }
+
+    uint32_t parseHex4() {
+        if (position + 4 > text.size()) {
+            fail("truncated escape");
+        }
+        const std::string digits = text.substr(position, 4);
+        char* end = nullptr;
+        const unsigned long value = std::strtoul(digits.c_str(), &end, 16);
+        if (end != digits.c_str() + 4) {
+            fail("invalid escape");
+        }
+        position += 4;
+        return static_cast<uint32_t>(value);
+    }
+
+    std::string parseString() {
+        if (position >= text.size() || text[position] != '"') {
+            fail("expected a string");
+        }
+        position++;
+        std::string out;
+        while (true) {
+            if (position >= text.size()) {
+                fail("unterminated string");
+            }
+            const char c = text[position++];
+            if (c == '"') {
+                break;
+            }
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (position >= text.size()) {
+                fail("unterminated string");
+            }
+            const char escape = text[position++];
+            switch (escape) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t codePoint = parseHex4();
+                if (codePoint >= 0xD800 && codePoint < 0xDC00 && text.compare(position, 2, "\\u") == 0) {
+                    position += 2;
+                    const uint32_t low = parseHex4();
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                }
+                appendUtf8(out, codePoint);
+                break;
+            }
+            default: fail("invalid escape");
+            }
+        }
+        return out;
+    }
+
+    const std::string& text;
+    size_t position = 0;
+};
+
+JsonValue JsonValue::parse(const std::string& text) {
+    return JsonParser(text).parseDocument();
+}
+
+bool JsonValue::has(const std::string& key) const {
+    return members.find(key) != members.end();
+}
+
+const JsonValue& JsonValue::operator[](const std::string& key) const {
+    static const JsonValue null;
+    auto it = members.find(key);
+    return it != members.end() ? it->second : null;
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const {
+    static const JsonValue null;
+    return index < elements.size() ? elements[index] : null;
+}
+
+size_t JsonValue::size() const {
+    return valueType == Type::Array ? elements.size() : members.size();
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Just enough JSON to read glTF: a DOM of null, bool, number, string, array and object values
+class JsonValue {
+public:
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    static JsonValue parse(const std::string& text); // throws std::runtime_error on malformed input
+
+    Type type() const { return valueType; }
+    bool isNull() const { return valueType == Type::Null; }
+    bool has(const std::string& key) const;
+    // Missing members and out of range elements return a null value
+    const JsonValue& operator[](const std::string& key) const;
+    const JsonValue& operator[](size_t index) const;
+    size_t size() const;
+
+    double number(double fallback = 0.0) const { return valueType == Type::Number ? numberValue : fallback; }
+    const std::string& string() const { return stringValue; }
+    bool boolean() const { return valueType == Type::Bool && boolValue; }
+
+private:
+    friend class JsonParser;
+
+    Type valueType = Type::Null;
+    bool boolValue = false;
+    double numberValue = 0.0;
+    std::string stringValue;
+    std::vector<JsonValue> elements;
+    std::map<std::string, JsonValue> members;
+};
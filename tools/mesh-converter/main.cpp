@@ -0,0 +1,229 @@
+// Converts OBJ / glTF meshes to the .nmesh format loaded by Naru --mesh (see src/mesh-format.h):
+// optimizes the triangle order for the post-transform cache and overdraw, the vertex order for fetch locality,
+// quantizes the vertices to 16 bytes and splits the result into meshlets for cluster culling.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include "mesh-format.h"
+#include "mesh-import.h"
+#include "mesh-optimizer.h"
+#include "meshlet-builder.h"
+
+namespace {
+
+struct ConverterOptions {
+    std::string input;
+    std::string output;
+    bool optimize = true;
+};
+
+void printUsage(const char* executable) {
+    std::cout << "Usage: " << executable << " [options] <input.obj|.gltf|.glb> <output.nmesh>" << std::endl
+              << "  --no-optimize     keep the source triangle and vertex order" << std::endl
+              << "  --help            show this message" << std::endl;
+}
+
+ConverterOptions parseCommandLine(int argc, char* argv[]) {
+    ConverterOptions options;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--no-optimize") {
+            options.optimize = false;
+        } else if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            std::exit(EXIT_SUCCESS);
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            printUsage(argv[0]);
+            throw std::runtime_error("Unknown option: " + arg);
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.size() != 2) {
+        printUsage(argv[0]);
+        throw std::runtime_error("Expected an input and an output path");
+    }
+    options.input = paths[0];
+    options.output = paths[1];
+    return options;
+}
+
+struct PackedVertexHash {
+    size_t operator()(const PackedVertex& vertex) const {
+        uint64_t words[2];
+        std::memcpy(words, &vertex, sizeof(words));
+        return std::hash<uint64_t>()(words[0] * 0x9E3779B97F4A7C15ull ^ words[1]);
+    }
+};
+
+struct PackedVertexEqual {
+    bool operator()(const PackedVertex& a, const PackedVertex& b) const { return std::memcmp(&a, &b, sizeof(PackedVertex)) == 0; }
+};
+
+// Quantizes every vertex and merges the ones that became identical, rewriting the indices
+std::vector<PackedVertex> quantize(const ImportedMesh& mesh, const float boundsMin[3], const float boundsMax[3],
+                                   std::vector<uint32_t>& indices) {
+    std::vector<uint32_t> remap(mesh.vertexCount());
+    std::vector<PackedVertex> vertices;
+    std::unordered_map<PackedVertex, uint32_t, PackedVertexHash, PackedVertexEqual> unique;
+    for (size_t v = 0; v < mesh.vertexCount(); v++) {
+        PackedVertex packed{};
+        for (int axis = 0; axis < 3; axis++) {
+            const float extent = boundsMax[axis] - boundsMin[axis];
+            const float relative = extent > 0.0f ? (mesh.positions[v * 3 + axis] - boundsMin[axis]) / extent : 0.0f;
+            packed.position[axis] = meshquantization::toUnorm16(relative);
+        }
+        packed.position[3] = 0;
+        if (!mesh.texCoords.empty()) {
+            packed.texCoord[0] = meshquantization::toHalf(mesh.texCoords[v * 2]);
+            packed.texCoord[1] = meshquantization::toHalf(mesh.texCoords[v * 2 + 1]);
+        }
+        meshquantization::toOctahedral(&mesh.normals[v * 3], packed.normal);
+        auto [it, inserted] = unique.try_emplace(packed, uint32_t(vertices.size()));
+        if (inserted) {
+            vertices.push_back(packed);
+        }
+        remap[v] = it->second;
+    }
+    for (uint32_t& index : indices) {
+        index = remap[index];
+    }
+    return vertices;
+}
+
+uint64_t alignUp(uint64_t value) {
+    return (value + MESH_FILE_ALIGNMENT - 1) / MESH_FILE_ALIGNMENT * MESH_FILE_ALIGNMENT;
+}
+
+void writeMeshFile(const std::string& path, MeshFileHeader header, const std::vector<PackedVertex>& vertices,
+                   const std::vector<uint32_t>& indices, const MeshletData& meshlets) {
+    header.vertexOffset = alignUp(sizeof(MeshFileHeader));
+    header.indexOffset = alignUp(header.vertexOffset + vertices.size() * sizeof(PackedVertex));
+    header.meshletOffset = alignUp(header.indexOffset + indices.size() * header.indexSize);
+    header.meshletVertexOffset = alignUp(header.meshletOffset + meshlets.meshlets.size() * sizeof(MeshletDescriptor));
+    header.meshletTriangleOffset = alignUp(header.meshletVertexOffset + meshlets.vertices.size() * sizeof(uint32_t));
+    header.meshletCount = uint32_t(meshlets.meshlets.size());
+    header.meshletVertexCount = uint32_t(meshlets.vertices.size());
+    header.meshletTriangleCount = uint32_t(meshlets.triangles.size());
+    std::vector<char> contents(header.meshletTriangleOffset + meshlets.triangles.size() * sizeof(uint32_t), 0);
+    std::memcpy(contents.data(), &header, sizeof(header));
+    std::memcpy(contents.data() + header.vertexOffset, vertices.data(), vertices.size() * sizeof(PackedVertex));
+    std::memcpy(contents.data() + header.meshletOffset, meshlets.meshlets.data(), meshlets.meshlets.size() * sizeof(MeshletDescriptor));
+    std::memcpy(contents.data() + header.meshletVertexOffset, meshlets.vertices.data(), meshlets.vertices.size() * sizeof(uint32_t));
+    std::memcpy(contents.data() + header.meshletTriangleOffset, meshlets.triangles.data(), meshlets.triangles.size() * sizeof(uint32_t));
+    char* indexData = contents.data() + header.indexOffset;
+    for (size_t i = 0; i < indices.size(); i++) {
+        if (header.indexSize == 2) {
+            const uint16_t index = static_cast<uint16_t>(indices[i]);
+            std::memcpy(indexData + i * 2, &index, 2);
+        } else {
+            std::memcpy(indexData + i * 4, &indices[i], 4);
+        }
+    }
+    std::ofstream file(path, std::ios::binary);
+    file.write(contents.data(), std::streamsize(contents.size()));
+    if (!file) {
+        throw std::runtime_error("failed to write " + path);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        const ConverterOptions options = parseCommandLine(argc, argv);
+        const auto start = std::chrono::steady_clock::now();
+
+        ImportedMesh mesh = importMesh(options.input);
+        if (mesh.indices.empty()) {
+            throw std::runtime_error(options.input + " contains no triangles");
+        }
+        if (mesh.normals.empty()) {
+            computeNormals(mesh);
+        }
+
+        MeshFileHeader header{};
+        std::memcpy(header.magic, MESH_FILE_MAGIC, sizeof(header.magic));
+        header.version = MESH_FILE_VERSION;
+        header.vertexStride = sizeof(PackedVertex);
+        for (int axis = 0; axis < 3; axis++) {
+            header.boundsMin[axis] = header.boundsMax[axis] = mesh.positions[axis];
+        }
+        for (size_t v = 0; v < mesh.vertexCount(); v++) {
+            for (int axis = 0; axis < 3; axis++) {
+                header.boundsMin[axis] = std::min(header.boundsMin[axis], mesh.positions[v * 3 + axis]);
+                header.boundsMax[axis] = std::max(header.boundsMax[axis], mesh.positions[v * 3 + axis]);
+            }
+        }
+
+        std::vector<uint32_t> indices = mesh.indices;
+        std::vector<PackedVertex> vertices = quantize(mesh, header.boundsMin, header.boundsMax, indices);
+        std::cout << "Imported " << mesh.vertexCount() << " vertices, " << indices.size() / 3 << " triangles, "
+                  << vertices.size() << " unique vertices after quantization" << std::endl;
+
+        if (options.optimize) {
+            std::vector<float> positions(vertices.size() * 3);
+            for (size_t v = 0; v < vertices.size(); v++) {
+                for (int axis = 0; axis < 3; axis++) {
+                    positions[v * 3 + axis] = vertices[v].position[axis] / 65535.0f;
+                }
+            }
+            const float acmrBefore = averageCacheMissRatio(indices, vertices.size());
+            std::vector<uint32_t> clusters;
+            indices = optimizeVertexCache(indices, vertices.size(), clusters);
+            const float acmrTipsify = averageCacheMissRatio(indices, vertices.size());
+            optimizeOverdraw(indices, clusters, positions);
+            const float acmrAfter = averageCacheMissRatio(indices, vertices.size());
+
+            const std::vector<uint32_t> remap = optimizeVertexFetch(indices, vertices.size());
+            std::vector<PackedVertex> reordered(remap.size());
+            for (size_t v = 0; v < remap.size(); v++) {
+                reordered[v] = vertices[remap[v]];
+            }
+            vertices.swap(reordered);
+            std::cout << "ACMR (cache " << VERTEX_CACHE_SIZE << "): " << acmrBefore << " -> " << acmrTipsify << " (vertex cache), "
+                      << acmrAfter << " (with " << clusters.size() << " overdraw clusters)" << std::endl;
+        }
+
+        // Meshlet bounds are computed from the positions as the GPU will see them, after quantization
+        std::vector<float> positions(vertices.size() * 3);
+        for (size_t v = 0; v < vertices.size(); v++) {
+            for (int axis = 0; axis < 3; axis++) {
+                const float extent = header.boundsMax[axis] - header.boundsMin[axis];
+                positions[v * 3 + axis] = header.boundsMin[axis] + vertices[v].position[axis] / 65535.0f * extent;
+            }
+        }
+        const MeshletData meshlets = buildMeshlets(indices, positions);
+        size_t cullableCones = 0;
+        for (const MeshletDescriptor& meshlet : meshlets.meshlets) {
+            cullableCones += meshlet.coneCutoff < 1.0f;
+        }
+        std::cout << "Meshlets: " << meshlets.meshlets.size() << " (max " << MESHLET_MAX_VERTICES << " vertices, "
+                  << MESHLET_MAX_TRIANGLES << " triangles), " << float(indices.size() / 3) / float(std::max<size_t>(meshlets.meshlets.size(), 1))
+                  << " triangles and " << float(meshlets.vertices.size()) / float(std::max<size_t>(meshlets.meshlets.size(), 1))
+                  << " vertices on average, " << cullableCones << " with a usable normal cone" << std::endl;
+
+        header.vertexCount = uint32_t(vertices.size());
+        header.indexCount = uint32_t(indices.size());
+        header.indexSize = vertices.size() <= 0x10000 ? 2 : 4;
+        writeMeshFile(options.output, header, vertices, indices, meshlets);
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Wrote " << options.output << ": " << vertices.size() * sizeof(PackedVertex) << " bytes of vertices, "
+                  << indices.size() * header.indexSize << " bytes of " << header.indexSize * 8 << " bit indices in "
+                  << seconds << " s" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
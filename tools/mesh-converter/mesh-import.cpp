@@ -0,0 +1,510 @@
+#include "mesh-import.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "json.h"
+
+namespace {
+
+std::string readFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("failed to open " + path);
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+std::string directoryOf(const std::string& path) {
+    const size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+std::string lowercaseExtension(const std::string& path) {
+    const size_t dot = path.find_last_of('.');
+    std::string extension = dot == std::string::npos ? std::string() : path.substr(dot + 1);
+    for (char& c : extension) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return extension;
+}
+
+// OBJ
+
+struct ObjCorner {
+    int position;
+    int texCoord;
+    int normal;
+    bool operator==(const ObjCorner& other) const {
+        return position == other.position && texCoord == other.texCoord && normal == other.normal;
+    }
+};
+
+struct ObjCornerHash {
+    size_t operator()(const ObjCorner& corner) const {
+        return (size_t(corner.position) * 73856093u) ^ (size_t(corner.texCoord) * 19349663u) ^ (size_t(corner.normal) * 83492791u);
+    }
+};
+
+// Resolves a 1-based (or negative, relative) OBJ index to 0-based, -1 when absent
+int resolveObjIndex(const std::string& token, size_t count) {
+    if (token.empty()) {
+        return -1;
+    }
+    const int index = std::stoi(token);
+    const int resolved = index < 0 ? int(count) + index : index - 1;
+    if (resolved < 0 || resolved >= int(count)) {
+        throw std::runtime_error("OBJ index out of range: " + token);
+    }
+    return resolved;
+}
+
+} // namespace
+
+ImportedMesh importObj(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("failed to open " + path);
+    }
+    std::vector<float> positions;
+    std::vector<float> texCoords;
+    std::vector<float> normals;
+    std::vector<ObjCorner> corners;
+    bool hasTexCoords = false;
+    bool hasNormals = false;
+
+    std::string line;
+    std::vector<ObjCorner> polygon;
+    while (std::getline(file, line)) {
+        std::istringstream stream(line);
+        std::string keyword;
+        stream >> keyword;
+        if (keyword == "v") {
+            float x = 0, y = 0, z = 0;
+            stream >> x >> y >> z;
+            positions.insert(positions.end(), {x, y, z});
+        } else if (keyword == "vt") {
+            float u = 0, v = 0;
+            stream >> u >> v;
+            texCoords.insert(texCoords.end(), {u, 1.0f - v}); // OBJ has the origin at the bottom left
+        } else if (keyword == "vn") {
+            float x = 0, y = 0, z = 0;
+            stream >> x >> y >> z;
+            normals.insert(normals.end(), {x, y, z});
+        } else if (keyword == "f") {
+            polygon.clear();
+            std::string vertex;
+            while (stream >> vertex) {
+                std::array<std::string, 3> parts;
+                size_t part = 0;
+                for (char c : vertex) {
+                    if (c == '/') {
+                        if (++part >= parts.size()) {
+                            break;
+                        }
+                    } else {
+                        parts[part] += c;
+                    }
+                }
+                ObjCorner corner{resolveObjIndex(parts[0], positions.size() / 3), resolveObjIndex(parts[1], texCoords.size() / 2),
+                                 resolveObjIndex(parts[2], normals.size() / 3)};
+                if (corner.position < 0) {
+                    throw std::runtime_error("OBJ face without a position in " + path);
+                }
+                hasTexCoords |= corner.texCoord >= 0;
+                hasNormals |= corner.normal >= 0;
+                polygon.push_back(corner);
+            }
+            for (size_t i = 2; i < polygon.size(); i++) {
+                corners.insert(corners.end(), {polygon[0], polygon[i - 1], polygon[i]});
+            }
+        }
+    }
+
+    // OBJ indexes every attribute separately, the GPU needs one index per unique combination
+    ImportedMesh mesh;
+    std::unordered_map<ObjCorner, uint32_t, ObjCornerHash> unique;
+    mesh.indices.reserve(corners.size());
+    for (const ObjCorner& corner : corners) {
+        auto [it, inserted] = unique.try_emplace(corner, uint32_t(mesh.vertexCount()));
+        if (inserted) {
+            mesh.positions.insert(mesh.positions.end(), &positions[corner.position * 3], &positions[corner.position * 3] + 3);
+            if (hasTexCoords) {
+                const float* uv = corner.texCoord >= 0 ? &texCoords[corner.texCoord * 2] : nullptr;
+                mesh.texCoords.insert(mesh.texCoords.end(), {uv ? uv[0] : 0.0f, uv ? uv[1] : 0.0f});
+            }
+            if (hasNormals) {
+                const float* n = corner.normal >= 0 ? &normals[corner.normal * 3] : nullptr;
+                mesh.normals.insert(mesh.normals.end(), {n ? n[0] : 0.0f, n ? n[1] : 0.0f, n ? n[2] : 1.0f});
+            }
+        }
+        mesh.indices.push_back(it->second);
+    }
+    return mesh;
+}
+
+// glTF
+
+namespace {
+
+using Matrix = std::array<float, 16>; // column-major
+
+Matrix multiply(const Matrix& a, const Matrix& b) {
+    Matrix result{};
+    for (int col = 0; col < 4; col++) {
+        for (int row = 0; row < 4; row++) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; k++) {
+                sum += a[k * 4 + row] * b[col * 4 + k];
+            }
+            result[col * 4 + row] = sum;
+        }
+    }
+    return result;
+}
+
+Matrix nodeTransform(const JsonValue& node) {
+    Matrix m{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    if (node.has("matrix")) {
+        for (size_t i = 0; i < 16; i++) {
+            m[i] = float(node["matrix"][i].number());
+        }
+        return m;
+    }
+    const JsonValue& t = node["translation"];
+    const JsonValue& r = node["rotation"];
+    const JsonValue& s = node["scale"];
+    const float x = float(r[0].number(0)), y = float(r[1].number(0)), z = float(r[2].number(0)), w = float(r[3].number(1));
+    const float sx = float(s[0].number(1)), sy = float(s[1].number(1)), sz = float(s[2].number(1));
+    // T * R * S
+    m = {(1 - 2 * (y * y + z * z)) * sx, (2 * (x * y + z * w)) * sx, (2 * (x * z - y * w)) * sx, 0,
+         (2 * (x * y - z * w)) * sy, (1 - 2 * (x * x + z * z)) * sy, (2 * (y * z + x * w)) * sy, 0,
+         (2 * (x * z + y * w)) * sz, (2 * (y * z - x * w)) * sz, (1 - 2 * (x * x + y * y)) * sz, 0,
+         float(t[0].number()), float(t[1].number()), float(t[2].number()), 1};
+    return m;
+}
+
+std::vector<uint8_t> decodeBase64(const std::string& text) {
+    std::vector<uint8_t> out;
+    uint32_t accumulator = 0;
+    int bits = 0;
+    for (char c : text) {
+        int value;
+        if (c >= 'A' && c <= 'Z') value = c - 'A';
+        else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+        else if (c >= '0' && c <= '9') value = c - '0' + 52;
+        else if (c == '+' || c == '-') value = 62;
+        else if (c == '/' || c == '_') value = 63;
+        else continue; // padding and whitespace
+        accumulator = (accumulator << 6) | uint32_t(value);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out.push_back(uint8_t(accumulator >> bits));
+        }
+    }
+    return out;
+}
+
+class GltfDocument {
+public:
+    GltfDocument(const std::string& path) {
+        const std::string contents = readFile(path);
+        std::string jsonText;
+        std::vector<uint8_t> binaryChunk;
+        if (contents.size() >= 12 && contents.compare(0, 4, "glTF") == 0) {
+            // GLB: 12 byte header, then chunks of {length, type, data}
+            size_t offset = 12;
+            while (offset + 8 <= contents.size()) {
+                uint32_t length, type;
+                std::memcpy(&length, contents.data() + offset, 4);
+                std::memcpy(&type, contents.data() + offset + 4, 4);
+                offset += 8;
+                if (offset + length > contents.size()) {
+                    throw std::runtime_error("truncated GLB chunk in " + path);
+                }
+                if (type == 0x4E4F534Au) { // JSON
+                    jsonText.assign(contents.data() + offset, length);
+                } else if (type == 0x004E4942u) { // BIN
+                    binaryChunk.assign(contents.begin() + offset, contents.begin() + offset + length);
+                }
+                offset += (length + 3) & ~3u;
+            }
+        } else {
+            jsonText = contents;
+        }
+        document = JsonValue::parse(jsonText);
+
+        const JsonValue& bufferList = document["buffers"];
+        for (size_t i = 0; i < bufferList.size(); i++) {
+            const JsonValue& buffer = bufferList[i];
+            if (!buffer.has("uri")) {
+                buffers.push_back(binaryChunk); // the GLB binary chunk
+                continue;
+            }
+            const std::string& uri = buffer["uri"].string();
+            if (uri.compare(0, 5, "data:") == 0) {
+                const size_t comma = uri.find(',');
+                if (comma == std::string::npos || uri.rfind(";base64", comma) == std::string::npos) {
+                    throw std::runtime_error("unsupported data URI in " + path);
+                }
+                buffers.push_back(decodeBase64(uri.substr(comma + 1)));
+            } else {
+                const std::string data = readFile(directoryOf(path) + uri);
+                buffers.emplace_back(data.begin(), data.end());
+            }
+        }
+    }
+
+    const JsonValue& json() const { return document; }
+
+    // Reads a float (or normalized integer) accessor into `components` floats per element
+    std::vector<float> readFloats(size_t accessorIndex, size_t components) const {
+        const JsonValue& accessor = document["accessors"][accessorIndex];
+        const size_t count = size_t(accessor["count"].number());
+        const int componentType = int(accessor["componentType"].number());
+        const bool normalized = accessor["normalized"].boolean();
+        std::vector<float> out(count * components);
+        forEachElement(accessor, components, [&](size_t element, size_t component, const uint8_t* data) {
+            float value = 0.0f;
+            switch (componentType) {
+            case 5126: std::memcpy(&value, data, 4); break;
+            case 5121: value = normalized ? data[0] / 255.0f : data[0]; break;
+            case 5123: { uint16_t v; std::memcpy(&v, data, 2); value = normalized ? v / 65535.0f : v; break; }
+            case 5120: value = normalized ? std::max(int8_t(data[0]) / 127.0f, -1.0f) : int8_t(data[0]); break;
+            case 5122: { int16_t v; std::memcpy(&v, data, 2); value = normalized ? std::max(v / 32767.0f, -1.0f) : v; break; }
+            default: throw std::runtime_error("unsupported glTF component type");
+            }
+            out[element * components + component] = value;
+        });
+        return out;
+    }
+
+    std::vector<uint32_t> readIndices(size_t accessorIndex) const {
+        const JsonValue& accessor = document["accessors"][accessorIndex];
+        const int componentType = int(accessor["componentType"].number());
+        std::vector<uint32_t> out(size_t(accessor["count"].number()));
+        forEachElement(accessor, 1, [&](size_t element, size_t, const uint8_t* data) {
+            switch (componentType) {
+            case 5121: out[element] = data[0]; break;
+            case 5123: { uint16_t v; std::memcpy(&v, data, 2); out[element] = v; break; }
+            case 5125: std::memcpy(&out[element], data, 4); break;
+            default: throw std::runtime_error("unsupported glTF index type");
+            }
+        });
+        return out;
+    }
+
+private:
+    static size_t componentSize(int componentType) {
+        switch (componentType) {
+        case 5120: case 5121: return 1;
+        case 5122: case 5123: return 2;
+        case 5125: case 5126: return 4;
+        default: throw std::runtime_error("unsupported glTF component type");
+        }
+    }
+
+    template <typename Function>
+    void forEachElement(const JsonValue& accessor, size_t components, Function function) const {
+        if (!accessor.has("bufferView")) {
+            return; // all zeros (sparse accessors are not supported)
+        }
+        const JsonValue& view = document["bufferViews"][size_t(accessor["bufferView"].number())];
+        const std::vector<uint8_t>& buffer = buffers.at(size_t(view["buffer"].number()));
+        const size_t size = componentSize(int(accessor["componentType"].number()));
+        const size_t stride = view.has("byteStride") ? size_t(view["byteStride"].number()) : size * components;
+        const size_t base = size_t(view["byteOffset"].number()) + size_t(accessor["byteOffset"].number());
+        const size_t count = size_t(accessor["count"].number());
+        if (count > 0 && base + (count - 1) * stride + components * size > buffer.size()) {
+            throw std::runtime_error("glTF accessor out of buffer bounds");
+        }
+        for (size_t element = 0; element < count; element++) {
+            for (size_t component = 0; component < components; component++) {
+                function(element, component, buffer.data() + base + element * stride + component * size);
+            }
+        }
+    }
+
+    JsonValue document;
+    std::vector<std::vector<uint8_t>> buffers;
+};
+
+void appendPrimitive(const GltfDocument& gltf, const JsonValue& primitive, const Matrix& transform, ImportedMesh& mesh,
+                     bool& hasNormals, bool& hasTexCoords) {
+    if (primitive.has("mode") && int(primitive["mode"].number()) != 4) {
+        return; // only triangle lists
+    }
+    const JsonValue& attributes = primitive["attributes"];
+    if (!attributes.has("POSITION")) {
+        return;
+    }
+    const std::vector<float> positions = gltf.readFloats(size_t(attributes["POSITION"].number()), 3);
+    const size_t count = positions.size() / 3;
+    std::vector<float> normals = attributes.has("NORMAL") ? gltf.readFloats(size_t(attributes["NORMAL"].number()), 3) : std::vector<float>();
+    std::vector<float> texCoords = attributes.has("TEXCOORD_0") ? gltf.readFloats(size_t(attributes["TEXCOORD_0"].number()), 2) : std::vector<float>();
+
+    // Attributes only some primitives have are filled with defaults for the others
+    const size_t base = mesh.vertexCount();
+    if (!normals.empty() && !hasNormals) {
+        mesh.normals.assign(base * 3, 0.0f);
+        hasNormals = true;
+    }
+    if (!texCoords.empty() && !hasTexCoords) {
+        mesh.texCoords.assign(base * 2, 0.0f);
+        hasTexCoords = true;
+    }
+
+    // Normals go through the inverse transpose; the 3x3 cofactor matrix is proportional to it and normals get renormalized
+    const Matrix& m = transform;
+    auto at = [&](int col, int row) { return m[col * 4 + row]; };
+    float cofactor[3][3];
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+            const int r1 = (r + 1) % 3, r2 = (r + 2) % 3, c1 = (c + 1) % 3, c2 = (c + 2) % 3;
+            cofactor[r][c] = at(c1, r1) * at(c2, r2) - at(c2, r1) * at(c1, r2);
+        }
+    }
+    // A negative determinant mirrors the geometry: the cofactors then point inwards and the winding has to be flipped
+    const float determinant = at(0, 0) * cofactor[0][0] + at(1, 0) * cofactor[0][1] + at(2, 0) * cofactor[0][2];
+    const float normalSign = determinant < 0.0f ? -1.0f : 1.0f;
+    for (size_t i = 0; i < count; i++) {
+        const float* p = &positions[i * 3];
+        for (int row = 0; row < 3; row++) {
+            mesh.positions.push_back(at(0, row) * p[0] + at(1, row) * p[1] + at(2, row) * p[2] + at(3, row));
+        }
+        if (hasNormals) {
+            float n[3] = {0.0f, 0.0f, 1.0f};
+            if (!normals.empty()) {
+                const float* source = &normals[i * 3];
+                for (int row = 0; row < 3; row++) {
+                    n[row] = cofactor[row][0] * source[0] + cofactor[row][1] * source[1] + cofactor[row][2] * source[2];
+                }
+                const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                for (float& v : n) {
+                    v = length > 0.0f ? normalSign * v / length : 0.0f;
+                }
+            }
+            mesh.normals.insert(mesh.normals.end(), n, n + 3);
+        }
+        if (hasTexCoords) {
+            mesh.texCoords.push_back(texCoords.empty() ? 0.0f : texCoords[i * 2]);
+            mesh.texCoords.push_back(texCoords.empty() ? 0.0f : texCoords[i * 2 + 1]);
+        }
+    }
+
+    std::vector<uint32_t> indices;
+    if (primitive.has("indices")) {
+        indices = gltf.readIndices(size_t(primitive["indices"].number()));
+    } else {
+        indices.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            indices[i] = uint32_t(i);
+        }
+    }
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        for (size_t corner = 0; corner < 3; corner++) {
+            const uint32_t index = indices[i + (determinant < 0.0f ? 2 - corner : corner)];
+            if (index >= count) {
+                throw std::runtime_error("glTF index out of range");
+            }
+            mesh.indices.push_back(uint32_t(base) + index);
+        }
+    }
+}
+
+void appendNode(const GltfDocument& gltf, size_t nodeIndex, const Matrix& parent, ImportedMesh& mesh, bool& hasNormals,
+                bool& hasTexCoords, int depth) {
+    if (depth > 64) {
+        throw std::runtime_error("glTF node hierarchy too deep (cycle?)");
+    }
+    const JsonValue& node = gltf.json()["nodes"][nodeIndex];
+    const Matrix transform = multiply(parent, nodeTransform(node));
+    if (node.has("mesh")) {
+        const JsonValue& primitives = gltf.json()["meshes"][size_t(node["mesh"].number())]["primitives"];
+        for (size_t i = 0; i < primitives.size(); i++) {
+            appendPrimitive(gltf, primitives[i], transform, mesh, hasNormals, hasTexCoords);
+        }
+    }
+    const JsonValue& children = node["children"];
+    for (size_t i = 0; i < children.size(); i++) {
+        appendNode(gltf, size_t(children[i].number()), transform, mesh, hasNormals, hasTexCoords, depth + 1);
+    }
+}
+
+} // namespace
+
+ImportedMesh importGltf(const std::string& path) {
+    GltfDocument gltf(path);
+    ImportedMesh mesh;
+    bool hasNormals = false;
+    bool hasTexCoords = false;
+    const Matrix identity{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+
+    const JsonValue& scenes = gltf.json()["scenes"];
+    if (scenes.size() > 0) {
+        const JsonValue& scene = scenes[size_t(gltf.json()["scene"].number(0))];
+        for (size_t i = 0; i < scene["nodes"].size(); i++) {
+            appendNode(gltf, size_t(scene["nodes"][i].number()), identity, mesh, hasNormals, hasTexCoords, 0);
+        }
+    } else {
+        // No scene: take every mesh untransformed
+        const JsonValue& meshes = gltf.json()["meshes"];
+        for (size_t m = 0; m < meshes.size(); m++) {
+            for (size_t i = 0; i < meshes[m]["primitives"].size(); i++) {
+                appendPrimitive(gltf, meshes[m]["primitives"][i], identity, mesh, hasNormals, hasTexCoords);
+            }
+        }
+    }
+    return mesh;
+}
+
+ImportedMesh importMesh(const std::string& path) {
+    const std::string extension = lowercaseExtension(path);
+    if (extension == "obj") {
+        return importObj(path);
+    }
+    if (extension == "gltf" || extension == "glb") {
+        return importGltf(path);
+    }
+    throw std::runtime_error("unsupported mesh file type: " + path);
+}
+
+void computeNormals(ImportedMesh& mesh) {
+    mesh.normals.assign(mesh.positions.size(), 0.0f);
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        const float* a = &mesh.positions[mesh.indices[i] * 3];
+        const float* b = &mesh.positions[mesh.indices[i + 1] * 3];
+        const float* c = &mesh.positions[mesh.indices[i + 2] * 3];
+        const float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+        const float e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+        // The unnormalized cross product weights every face by its area
+        const float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+        for (size_t corner = 0; corner < 3; corner++) {
+            float* target = &mesh.normals[mesh.indices[i + corner] * 3];
+            target[0] += n[0];
+            target[1] += n[1];
+            target[2] += n[2];
+        }
+    }
+    for (size_t v = 0; v < mesh.vertexCount(); v++) {
+        float* n = &mesh.normals[v * 3];
+        const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length > 0.0f) {
+            n[0] /= length;
+            n[1] /= length;
+            n[2] /= length;
+        } else {
+            n[2] = 1.0f;
+        }
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Triangle list in full precision, as read from the source file. Attributes are per vertex and either empty or
+// vertexCount long.
+struct ImportedMesh {
+    std::vector<float> positions; // xyz
+    std::vector<float> normals;   // xyz
+    std::vector<float> texCoords; // uv
+    std::vector<uint32_t> indices;
+
+    size_t vertexCount() const { return positions.size() / 3; }
+};
+
+// Wavefront OBJ: v/vt/vn/f, polygons are fan-triangulated, negative indices are supported
+ImportedMesh importObj(const std::string& path);
+// glTF 2.0 (.gltf with embedded or external buffers, or .glb): every triangle primitive of the default scene,
+// with node transforms applied
+ImportedMesh importGltf(const std::string& path);
+
+// Dispatches on the file extension, throws std::runtime_error on unsupported or malformed files
+ImportedMesh importMesh(const std::string& path);
+
+// Area weighted vertex normals, used when the source has none
+void computeNormals(ImportedMesh& mesh);
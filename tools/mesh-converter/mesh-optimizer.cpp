@@ -0,0 +1,247 @@
+#include "mesh-optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// FIFO post-transform cache simulation
+class CacheSimulator {
+public:
+    CacheSimulator(size_t vertexCount, size_t cacheSize) : timestamps(vertexCount, 0), cacheSize(cacheSize) {}
+
+    // Returns true on a miss
+    bool access(uint32_t vertex) {
+        if (timestamps[vertex] != 0 && time - timestamps[vertex] < cacheSize) {
+            return false;
+        }
+        timestamps[vertex] = time++; // FIFO: hits don't refresh the entry
+        return true;
+    }
+
+    void flush() { time += cacheSize; }
+
+private:
+    std::vector<size_t> timestamps;
+    size_t time = 1;
+    size_t cacheSize;
+};
+
+} // namespace
+
+float averageCacheMissRatio(const std::vector<uint32_t>& indices, size_t vertexCount, size_t cacheSize) {
+    if (indices.size() < 3) {
+        return 0.0f;
+    }
+    CacheSimulator cache(vertexCount, cacheSize);
+    size_t misses = 0;
+    for (uint32_t index : indices) {
+        misses += cache.access(index);
+    }
+    return float(misses) / float(indices.size() / 3);
+}
+
+std::vector<uint32_t> optimizeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount,
+                                          std::vector<uint32_t>& clusters, float overdrawThreshold, size_t cacheSize) {
+    const size_t triangleCount = indices.size() / 3;
+
+    // Vertex -> triangle adjacency (CSR layout)
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++) {
+        liveTriangles[indices[i]]++;
+    }
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+    }
+    std::vector<uint32_t> adjacency(adjacencyOffsets.back());
+    std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++) {
+        for (size_t corner = 0; corner < 3; corner++) {
+            adjacency[fill[indices[t * 3 + corner]]++] = uint32_t(t);
+        }
+    }
+
+    std::vector<size_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+    std::vector<uint32_t> hardBoundaries; // triangle indices where the walk had to jump to an unrelated vertex
+    size_t time = cacheSize + 1;
+    size_t cursor = 0;
+    int64_t fanning = vertexCount > 0 ? 0 : -1;
+
+    auto skipDeadEnd = [&]() -> int64_t {
+        while (!deadEnd.empty()) {
+            const uint32_t vertex = deadEnd.back();
+            deadEnd.pop_back();
+            if (liveTriangles[vertex] > 0) {
+                return vertex;
+            }
+        }
+        while (cursor < vertexCount) {
+            if (liveTriangles[cursor] > 0) {
+                return int64_t(cursor);
+            }
+            cursor++;
+        }
+        return -1;
+    };
+
+    hardBoundaries.push_back(0);
+    while (fanning >= 0) {
+        candidates.clear();
+        for (uint32_t a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; a++) {
+            const uint32_t triangle = adjacency[a];
+            if (emitted[triangle]) {
+                continue;
+            }
+            for (size_t corner = 0; corner < 3; corner++) {
+                const uint32_t vertex = indices[triangle * 3 + corner];
+                output.push_back(vertex);
+                deadEnd.push_back(vertex);
+                candidates.push_back(vertex);
+                liveTriangles[vertex]--;
+                if (time - cacheTime[vertex] > cacheSize) {
+                    cacheTime[vertex] = time++;
+                }
+            }
+            emitted[triangle] = true;
+        }
+
+        // Next fanning vertex: the candidate that stays in the cache while its remaining triangles get emitted,
+        // preferring the oldest one
+        int64_t best = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t vertex : candidates) {
+            if (liveTriangles[vertex] == 0) {
+                continue;
+            }
+            int64_t priority = 0;
+            if (time - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize) {
+                priority = int64_t(time - cacheTime[vertex]);
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                best = vertex;
+            }
+        }
+        if (best < 0) {
+            best = skipDeadEnd();
+            if (best >= 0 && output.size() / 3 > hardBoundaries.back()) {
+                hardBoundaries.push_back(uint32_t(output.size() / 3));
+            }
+        }
+        fanning = best;
+    }
+
+    // Split the hard clusters further wherever the cache efficiency of the run so far, with a cold cache at the
+    // cluster start, is already within the threshold of the whole mesh: cutting there costs almost nothing
+    const float limit = overdrawThreshold * averageCacheMissRatio(output, vertexCount, cacheSize);
+    clusters.clear();
+    CacheSimulator cache(vertexCount, cacheSize);
+    hardBoundaries.push_back(uint32_t(output.size() / 3));
+    for (size_t h = 0; h + 1 < hardBoundaries.size(); h++) {
+        size_t start = hardBoundaries[h];
+        size_t misses = 0;
+        clusters.push_back(uint32_t(start));
+        cache.flush();
+        for (size_t t = start; t < hardBoundaries[h + 1]; t++) {
+            for (size_t corner = 0; corner < 3; corner++) {
+                misses += cache.access(output[t * 3 + corner]);
+            }
+            if (t + 1 < hardBoundaries[h + 1] && float(misses) <= limit * float(t + 1 - start)) {
+                start = t + 1;
+                misses = 0;
+                clusters.push_back(uint32_t(start));
+                cache.flush();
+            }
+        }
+    }
+    return output;
+}
+
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<uint32_t>& clusters, const std::vector<float>& positions) {
+    const size_t triangleCount = indices.size() / 3;
+    if (clusters.size() < 2) {
+        return;
+    }
+
+    // Area weighted mesh centroid
+    double meshCentroid[3] = {0.0, 0.0, 0.0};
+    double meshArea = 0.0;
+    struct Cluster {
+        uint32_t begin;
+        uint32_t end;
+        float sortKey;
+    };
+    std::vector<Cluster> sorted(clusters.size());
+    std::vector<double> clusterData(clusters.size() * 7, 0.0); // centroid * area (3), normal (3), area
+
+    for (size_t c = 0; c < clusters.size(); c++) {
+        sorted[c].begin = clusters[c];
+        sorted[c].end = c + 1 < clusters.size() ? clusters[c + 1] : uint32_t(triangleCount);
+        double* data = &clusterData[c * 7];
+        for (uint32_t t = sorted[c].begin; t < sorted[c].end; t++) {
+            const float* a = &positions[indices[t * 3] * 3];
+            const float* b = &positions[indices[t * 3 + 1] * 3];
+            const float* p = &positions[indices[t * 3 + 2] * 3];
+            const double e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+            const double e2[3] = {p[0] - a[0], p[1] - a[1], p[2] - a[2]};
+            const double n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+            const double area = 0.5 * std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (int i = 0; i < 3; i++) {
+                const double centroid = (a[i] + b[i] + p[i]) / 3.0;
+                data[i] += centroid * area;
+                data[3 + i] += n[i]; // |n| = 2 * area, so the sum is area weighted
+                meshCentroid[i] += centroid * area;
+            }
+            data[6] += area;
+            meshArea += area;
+        }
+    }
+    if (meshArea <= 0.0) {
+        return;
+    }
+    for (double& v : meshCentroid) {
+        v /= meshArea;
+    }
+
+    for (size_t c = 0; c < clusters.size(); c++) {
+        const double* data = &clusterData[c * 7];
+        double key = 0.0;
+        if (data[6] > 0.0) {
+            const double length = std::sqrt(data[3] * data[3] + data[4] * data[4] + data[5] * data[5]);
+            for (int i = 0; i < 3; i++) {
+                const double toCluster = data[i] / data[6] - meshCentroid[i];
+                key += toCluster * (length > 0.0 ? data[3 + i] / length : 0.0);
+            }
+        }
+        sorted[c].sortKey = float(key);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+    std::vector<uint32_t> reordered;
+    reordered.reserve(indices.size());
+    for (const Cluster& cluster : sorted) {
+        reordered.insert(reordered.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+    }
+    indices.swap(reordered);
+}
+
+std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount) {
+    constexpr uint32_t unassigned = ~0u;
+    std::vector<uint32_t> newIndex(vertexCount, unassigned);
+    std::vector<uint32_t> remap;
+    remap.reserve(vertexCount);
+    for (uint32_t& index : indices) {
+        if (newIndex[index] == unassigned) {
+            newIndex[index] = uint32_t(remap.size());
+            remap.push_back(index);
+        }
+        index = newIndex[index];
+    }
+    return remap;
+}
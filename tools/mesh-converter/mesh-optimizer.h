@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Post-transform vertex cache size the optimizations are tuned for
+constexpr size_t VERTEX_CACHE_SIZE = 16;
+
+// Average cache miss ratio (transformed vertices per triangle) of a triangle list, simulated with a FIFO cache.
+// 3.0 is the worst case, ~0.5 the practical lower bound for regular meshes.
+float averageCacheMissRatio(const std::vector<uint32_t>& indices, size_t vertexCount, size_t cacheSize = VERTEX_CACHE_SIZE);
+
+// Tipsify (Sander, Nehab, Barczak: "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007).
+// Reorders the triangles for the post-transform cache in linear time. The triangle index where each cluster
+// starts is written to `clusters`: a cluster is a run of triangles that can be moved as a whole without
+// hurting the cache efficiency by more than `overdrawThreshold` (relative ACMR).
+std::vector<uint32_t> optimizeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount,
+                                          std::vector<uint32_t>& clusters, float overdrawThreshold = 1.05f,
+                                          size_t cacheSize = VERTEX_CACHE_SIZE);
+
+// Sorts the clusters front to back for a viewer outside the mesh: clusters whose average normal points away from
+// the mesh centroid tend to occlude the rest, so they are drawn first. Needs the clusters of optimizeVertexCache.
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<uint32_t>& clusters, const std::vector<float>& positions);
+
+// Returns the vertex order in which the indices first reference them, so vertex fetches walk memory linearly.
+// remap[newIndex] = oldIndex, unreferenced vertices are dropped. The indices are rewritten in place.
+std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount);
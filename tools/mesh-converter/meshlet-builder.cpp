@@ -0,0 +1,111 @@
+#include "meshlet-builder.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+void computeBounds(MeshletDescriptor& meshlet, const MeshletData& data, const std::vector<float>& positions) {
+    const uint32_t* vertices = &data.vertices[meshlet.vertexOffset];
+    float boundsMin[3] = {INFINITY, INFINITY, INFINITY};
+    float boundsMax[3] = {-INFINITY, -INFINITY, -INFINITY};
+    for (uint32_t v = 0; v < meshlet.vertexCount; v++) {
+        for (int axis = 0; axis < 3; axis++) {
+            boundsMin[axis] = std::min(boundsMin[axis], positions[vertices[v] * 3 + axis]);
+            boundsMax[axis] = std::max(boundsMax[axis], positions[vertices[v] * 3 + axis]);
+        }
+    }
+    float radius = 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+        meshlet.center[axis] = 0.5f * (boundsMin[axis] + boundsMax[axis]);
+    }
+    for (uint32_t v = 0; v < meshlet.vertexCount; v++) {
+        const float* p = &positions[vertices[v] * 3];
+        const float dx = p[0] - meshlet.center[0], dy = p[1] - meshlet.center[1], dz = p[2] - meshlet.center[2];
+        radius = std::max(radius, std::sqrt(dx * dx + dy * dy + dz * dz));
+    }
+    meshlet.radius = radius;
+
+    // Normal cone: average of the unit face normals, widened to contain all of them
+    std::vector<float> normals;
+    float axis[3] = {0.0f, 0.0f, 0.0f};
+    for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+        const uint32_t packed = data.triangles[meshlet.triangleOffset + t];
+        const float* a = &positions[vertices[packed & 0xFF] * 3];
+        const float* b = &positions[vertices[(packed >> 8) & 0xFF] * 3];
+        const float* c = &positions[vertices[(packed >> 16) & 0xFF] * 3];
+        const float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+        const float e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+        float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+        const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length == 0.0f) {
+            continue; // degenerate triangles are never visible and don't constrain the cone
+        }
+        for (int i = 0; i < 3; i++) {
+            n[i] /= length;
+            axis[i] += n[i];
+        }
+        normals.insert(normals.end(), n, n + 3);
+    }
+    const float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    float minDot = 1.0f;
+    for (int i = 0; i < 3; i++) {
+        meshlet.coneAxis[i] = axisLength > 0.0f ? axis[i] / axisLength : 0.0f;
+    }
+    for (size_t n = 0; n < normals.size(); n += 3) {
+        minDot = std::min(minDot, normals[n] * meshlet.coneAxis[0] + normals[n + 1] * meshlet.coneAxis[1] + normals[n + 2] * meshlet.coneAxis[2]);
+    }
+    // Cones wider than ~84 degrees (half angle) almost never cull anything, don't bother testing them
+    meshlet.coneCutoff = (normals.empty() || minDot <= 0.1f) ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+}
+
+} // namespace
+
+MeshletData buildMeshlets(const std::vector<uint32_t>& indices, const std::vector<float>& positions) {
+    MeshletData data;
+    const size_t vertexCount = positions.size() / 3;
+    // Local index of every vertex in the meshlet being built, localMeshlet tells whether the entry is current
+    std::vector<uint32_t> localIndex(vertexCount, 0);
+    std::vector<uint32_t> localMeshlet(vertexCount, ~0u);
+
+    MeshletDescriptor current{};
+    auto finish = [&]() {
+        if (current.triangleCount == 0) {
+            return;
+        }
+        computeBounds(current, data, positions);
+        data.meshlets.push_back(current);
+        current = MeshletDescriptor{};
+        current.vertexOffset = uint32_t(data.vertices.size());
+        current.triangleOffset = uint32_t(data.triangles.size());
+    };
+
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        const uint32_t meshletIndex = uint32_t(data.meshlets.size());
+        uint32_t newVertices = 0;
+        for (size_t corner = 0; corner < 3; corner++) {
+            const uint32_t vertex = indices[t + corner];
+            // Repeated vertices within the triangle are only counted once
+            const bool repeated = (corner > 0 && indices[t] == vertex) || (corner > 1 && indices[t + 1] == vertex);
+            newVertices += localMeshlet[vertex] != meshletIndex && !repeated;
+        }
+        if (current.vertexCount + newVertices > MESHLET_MAX_VERTICES || current.triangleCount + 1 > MESHLET_MAX_TRIANGLES) {
+            finish();
+        }
+        const uint32_t target = uint32_t(data.meshlets.size());
+        uint32_t packed = 0;
+        for (size_t corner = 0; corner < 3; corner++) {
+            const uint32_t vertex = indices[t + corner];
+            if (localMeshlet[vertex] != target) {
+                localMeshlet[vertex] = target;
+                localIndex[vertex] = current.vertexCount++;
+                data.vertices.push_back(vertex);
+            }
+            packed |= localIndex[vertex] << (corner * 8);
+        }
+        data.triangles.push_back(packed);
+        current.triangleCount++;
+    }
+    finish();
+    return data;
+}
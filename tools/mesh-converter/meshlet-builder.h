@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "mesh-format.h"
+
+struct MeshletData {
+    std::vector<MeshletDescriptor> meshlets;
+    std::vector<uint32_t> vertices;  // global vertex indices, MeshletDescriptor::vertexOffset points in here
+    std::vector<uint32_t> triangles; // three meshlet-local 8 bit indices per entry
+};
+
+// Splits a triangle list into meshlets of at most MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES
+// triangles, keeping the triangle order (so a cache optimized order yields compact meshlets), and computes the
+// bounding sphere and normal cone of each. `positions` are the xyz positions the GPU will see.
+MeshletData buildMeshlets(const std::vector<uint32_t>& indices, const std::vector<float>& positions);